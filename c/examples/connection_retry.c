@@ -6,11 +6,16 @@
 
 #include <signal.h>
 #include <stdlib.h> // For atoi()
+#include <time.h> // For nanosleep()
 
+#include "point_one/polaris/backoff.h"
 #include "point_one/polaris/polaris.h"
 #include "point_one/polaris/portability.h"
 
 static PolarisContext_t context;
+static PolarisBackoff_t backoff;
+static volatile sig_atomic_t connected = 0;
+static volatile sig_atomic_t exit_requested = 0;
 
 void HandleData(void* info, PolarisContext_t* polaris_context,
                 const uint8_t* buffer, size_t size_bytes) {
@@ -22,7 +27,23 @@ void HandleSignal(int sig) {
 
   P1_printf("Caught signal %s (%d). Closing Polaris connection.\n",
             strsignal(sig), sig);
-  Polaris_Disconnect(&context);
+  exit_requested = 1;
+  if (connected) {
+    Polaris_Disconnect(&context);
+  }
+}
+
+// Wait before reconnecting. The delay grows exponentially with random jitter
+// while attempts fail, so that many clients disconnected at the same time do
+// not all reconnect at once. The wait ends early if a signal is caught.
+static void WaitToReconnect(void) {
+  uint32_t delay_ms = Polaris_BackoffNext(&backoff);
+  P1_printf("Reconnecting in %u ms.\n", (unsigned)delay_ms);
+
+  struct timespec delay;
+  delay.tv_sec = delay_ms / 1000;
+  delay.tv_nsec = (long)(delay_ms % 1000) * 1000000;
+  nanosleep(&delay, NULL);
 }
 
 int main(int argc, const char* argv[]) {
@@ -39,10 +60,16 @@ int main(int argc, const char* argv[]) {
   int log_level = argc > 3 ? atoi(argv[3]) : POLARIS_LOG_LEVEL_INFO;
   Polaris_SetLogLevel(log_level);
 
+  Polaris_BackoffInit(&backoff, 0, 0, 0);
+
+  signal(SIGINT, HandleSignal);
+  signal(SIGTERM, HandleSignal);
+
   const int MAX_RECONNECTS = 2;
   int auth_valid = 0;
   int reconnect_count = 0;
-  while (1) {
+  int auth_rejections = 0;
+  while (!exit_requested) {
     // Retrieve an access token using the specified API key.
     if (!auth_valid) {
       if (Polaris_Init(&context) != POLARIS_SUCCESS) {
@@ -60,6 +87,7 @@ int main(int argc, const char* argv[]) {
       } else if (ret != POLARIS_SUCCESS) {
         P1_printf("Authentication failed. Retrying.\n");
         Polaris_Free(&context);
+        WaitToReconnect();
         continue;
       }
 
@@ -85,6 +113,7 @@ int main(int argc, const char* argv[]) {
         reconnect_count = 0;
         Polaris_Free(&context);
       }
+      WaitToReconnect();
       continue;
     }
 
@@ -104,32 +133,62 @@ int main(int argc, const char* argv[]) {
         auth_valid = 0;
         reconnect_count = 0;
       }
+      WaitToReconnect();
       continue;
     }
 
     // Receive incoming RTCM data until the application exits.
     P1_printf("Sent position. Listening for data...\n");
 
-    signal(SIGINT, HandleSignal);
-    signal(SIGTERM, HandleSignal);
+    PolarisStats_t stats;
+    Polaris_GetStats(&context, &stats);
+    uint64_t reads_before_run = stats.reads;
+
+    // If a signal was caught while connecting, exit now. Otherwise, the signal
+    // handler will close the connection and Polaris_Run() will return.
+    connected = 1;
+    if (exit_requested) {
+      break;
+    }
 
     int ret = Polaris_Run(&context, 30000);
+    connected = 0;
     if (ret == POLARIS_SUCCESS) {
       break;
     }
-    else if (ret == POLARIS_CONNECTION_CLOSED) {
+
+    // If data was received, the connection was working, so reconnect quickly.
+    // A rejection message does not count.
+    Polaris_GetStats(&context, &stats);
+    if (ret != POLARIS_AUTH_REJECTED && stats.reads != reads_before_run) {
+      Polaris_BackoffReset(&backoff);
+      auth_rejections = 0;
+    }
+
+    if (ret == POLARIS_CONNECTION_CLOSED) {
       P1_printf("Connection terminated remotely. Reconnecting.\n");
     }
     else if (ret == POLARIS_TIMED_OUT) {
       P1_printf("Connection timed out. Reconnecting.\n");
     }
+    else if (ret == POLARIS_AUTH_REJECTED) {
+      // No sense retrying with a token the network told us is invalid.
+      // Reauthenticate right away the first time. If a new token is rejected
+      // too, back off as usual rather than hammering the authentication
+      // service.
+      P1_printf("Authentication token rejected. Reauthenticating.\n");
+      Polaris_Free(&context);
+      auth_valid = 0;
+      reconnect_count = 0;
+      if (auth_rejections++ > 0) {
+        WaitToReconnect();
+      }
+      continue;
+    }
     else {
       P1_printf("Unexpected error (%d). Reconnecting.\n", ret);
     }
 
-    signal(SIGINT, SIG_DFL);
-    signal(SIGTERM, SIG_DFL);
-
     if (++reconnect_count >= MAX_RECONNECTS) {
       P1_printf(
           "Max reconnects exceeded. Clearing access token and retrying "
@@ -137,6 +196,7 @@ int main(int argc, const char* argv[]) {
       auth_valid = 0;
       reconnect_count = 0;
     }
+    WaitToReconnect();
   }
 
   Polaris_Free(&context);
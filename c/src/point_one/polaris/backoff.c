@@ -0,0 +1,72 @@
+/**************************************************************************/ /**
+ * @brief Reconnect delay calculation with exponential backoff and jitter.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/backoff.h"
+
+#include "point_one/polaris/portability.h"
+
+/******************************************************************************/
+static uint32_t NextRandom(PolarisBackoff_t* backoff) {
+  // xorshift32. The state must never be 0.
+  uint32_t x = backoff->random_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  backoff->random_state = x;
+  return x;
+}
+
+/******************************************************************************/
+void Polaris_BackoffInit(PolarisBackoff_t* backoff, uint32_t base_delay_ms,
+                         uint32_t max_delay_ms, uint32_t seed) {
+  backoff->base_delay_ms =
+      base_delay_ms > 0 ? base_delay_ms : POLARIS_BACKOFF_BASE_DELAY_MS;
+  backoff->max_delay_ms =
+      max_delay_ms > 0 ? max_delay_ms : POLARIS_BACKOFF_MAX_DELAY_MS;
+  if (backoff->max_delay_ms < backoff->base_delay_ms) {
+    backoff->max_delay_ms = backoff->base_delay_ms;
+  }
+
+  if (seed == 0) {
+    // Mix in the address of the state so clients in the same process differ.
+    uint64_t now_us = P1_GetMonotonicTimeUS();
+    uintptr_t address = (uintptr_t)backoff;
+    seed = (uint32_t)(now_us ^ (now_us >> 32) ^ address ^
+                      ((uint64_t)address >> 16));
+  }
+  backoff->random_state = seed != 0 ? seed : 0x9E3779B9;
+
+  Polaris_BackoffReset(backoff);
+}
+
+/******************************************************************************/
+void Polaris_BackoffReset(PolarisBackoff_t* backoff) {
+  backoff->last_delay_ms = 0;
+  backoff->attempts = 0;
+}
+
+/******************************************************************************/
+uint32_t Polaris_BackoffNext(PolarisBackoff_t* backoff) {
+  uint64_t low_ms = 0;
+  uint64_t high_ms = backoff->base_delay_ms;
+  if (backoff->attempts > 0) {
+    low_ms = backoff->base_delay_ms;
+    high_ms = (uint64_t)backoff->last_delay_ms * 3;
+  }
+
+  if (high_ms > backoff->max_delay_ms) {
+    high_ms = backoff->max_delay_ms;
+  }
+
+  uint64_t delay_ms = low_ms;
+  if (high_ms > low_ms) {
+    delay_ms += NextRandom(backoff) % (high_ms - low_ms + 1);
+  }
+
+  backoff->last_delay_ms = (uint32_t)delay_ms;
+  ++backoff->attempts;
+  return backoff->last_delay_ms;
+}
@@ -0,0 +1,99 @@
+/**************************************************************************/ /**
+ * @brief Reconnect delay calculation with exponential backoff and jitter.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief The default base reconnect delay (in ms).
+ *
+ * The first delay after a reset is at most this value, and later delays are at
+ * least this value. See @ref PolarisBackoff_t.
+ */
+#ifndef POLARIS_BACKOFF_BASE_DELAY_MS
+# define POLARIS_BACKOFF_BASE_DELAY_MS 500
+#endif
+
+/**
+ * @brief The default maximum delay (in ms) between reconnect attempts.
+ */
+#ifndef POLARIS_BACKOFF_MAX_DELAY_MS
+# define POLARIS_BACKOFF_MAX_DELAY_MS 30000
+#endif
+
+/**
+ * @brief Reconnect delay state.
+ *
+ * Delays are computed using "decorrelated jitter": each delay is chosen
+ * uniformly at random between the base delay and 3 times the previous delay,
+ * limited to the maximum delay. Delays grow exponentially on average while
+ * consecutive attempts fail, and clients that lose their connections at the
+ * same time (e.g., during a regional network outage) quickly spread their
+ * reconnect attempts out rather than retrying in lockstep.
+ *
+ * The first delay after a reset is chosen between 0 and the base delay, so a
+ * dropped connection is normally reestablished quickly.
+ *
+ * See @ref Polaris_BackoffInit() and @ref Polaris_BackoffNext().
+ */
+typedef struct {
+  /** The minimum delay (in ms) after the first attempt. */
+  uint32_t base_delay_ms;
+  /** The maximum delay (in ms). */
+  uint32_t max_delay_ms;
+  /** The most recent delay (in ms), or 0 if none since the last reset. */
+  uint32_t last_delay_ms;
+  /** The number of delays returned since the last reset. */
+  uint32_t attempts;
+  /** Internal random number generator state. */
+  uint32_t random_state;
+} PolarisBackoff_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize reconnect delay state.
+ *
+ * Each client should use a different random seed so their delays are not
+ * synchronized. If `seed` is 0, a seed is derived from the current time, which
+ * may not be unique on embedded devices that start at the same time. There,
+ * consider using a hash of the device's unique ID instead.
+ *
+ * @param backoff The state to be initialized.
+ * @param base_delay_ms The base delay (in ms), or 0 to use the default value,
+ *        @ref POLARIS_BACKOFF_BASE_DELAY_MS.
+ * @param max_delay_ms The maximum delay (in ms), or 0 to use the default value,
+ *        @ref POLARIS_BACKOFF_MAX_DELAY_MS.
+ * @param seed The random seed, or 0 to choose one automatically.
+ */
+void Polaris_BackoffInit(PolarisBackoff_t* backoff, uint32_t base_delay_ms,
+                         uint32_t max_delay_ms, uint32_t seed);
+
+/**
+ * @brief Reset the delay to its initial value.
+ *
+ * This should be called once a connection succeeds (e.g., when data is
+ * received).
+ *
+ * @param backoff The state to be reset.
+ */
+void Polaris_BackoffReset(PolarisBackoff_t* backoff);
+
+/**
+ * @brief Get the delay to wait before the next reconnect attempt.
+ *
+ * @param backoff The state to be updated.
+ *
+ * @return The delay (in ms).
+ */
+uint32_t Polaris_BackoffNext(PolarisBackoff_t* backoff);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
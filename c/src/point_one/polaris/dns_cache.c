@@ -0,0 +1,314 @@
+/**************************************************************************/ /**
+ * @brief Process-wide DNS resolution cache.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/dns_cache.h"
+
+#ifdef P1_FREERTOS
+
+/******************************************************************************/
+void Polaris_ClearDNSCache(void) {}
+
+#else  // POSIX
+
+#  include <netdb.h>    // For getaddrinfo()
+#  include <netinet/in.h>
+#  include <pthread.h>
+#  include <stdint.h>
+#  include <string.h>  // For memcpy() and strcmp()
+#  include <time.h>    // For clock_gettime()
+
+// The maximum length of a DNS name (RFC 1035). Longer names are never cached.
+#  define MAX_HOSTNAME_LENGTH 253
+
+typedef struct {
+  char hostname[MAX_HOSTNAME_LENGTH + 1];
+  PolarisAddressList_t addresses;
+  uint64_t resolved_time_ms;
+  uint64_t last_used_time_ms;
+  uint8_t invalidated;
+  uint8_t refreshing;
+} DNSCacheEntry_t;
+
+#  if POLARIS_DNS_CACHE_SIZE > 0
+static pthread_mutex_t __cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DNSCacheEntry_t __cache[POLARIS_DNS_CACHE_SIZE];
+#  endif
+
+/******************************************************************************/
+static uint64_t GetMonotonicTimeMS(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+/******************************************************************************/
+static int LookupHost(const char* hostname, PolarisAddressList_t* result) {
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+
+  struct addrinfo* addresses = NULL;
+  int ret = getaddrinfo(hostname, NULL, &hints, &addresses);
+  if (ret != 0) {
+    return ret;
+  }
+
+  // getaddrinfo() returns addresses in order of preference (RFC 6724). Per RFC
+  // 8305 section 4, we keep that order within each address family, but
+  // interleave the families, starting with the family of the most preferred
+  // address. That way, if one family is broken (e.g., IPv6 is advertised but
+  // not routed), we only wait one attempt delay before trying the other.
+  const struct addrinfo* preferred[POLARIS_MAX_CONNECT_ADDRESSES];
+  const struct addrinfo* other[POLARIS_MAX_CONNECT_ADDRESSES];
+  size_t num_preferred = 0;
+  size_t num_other = 0;
+  for (const struct addrinfo* address = addresses; address != NULL;
+       address = address->ai_next) {
+    if (address->ai_addrlen > sizeof(struct sockaddr_storage)) {
+      continue;
+    } else if (address->ai_family == addresses->ai_family) {
+      if (num_preferred < POLARIS_MAX_CONNECT_ADDRESSES) {
+        preferred[num_preferred++] = address;
+      }
+    } else if (address->ai_family == AF_INET ||
+               address->ai_family == AF_INET6) {
+      if (num_other < POLARIS_MAX_CONNECT_ADDRESSES) {
+        other[num_other++] = address;
+      }
+    }
+  }
+
+  result->count = 0;
+  for (size_t i = 0; i < num_preferred || i < num_other; ++i) {
+    const struct addrinfo* next[2] = {i < num_preferred ? preferred[i] : NULL,
+                                      i < num_other ? other[i] : NULL};
+    for (size_t j = 0; j < 2; ++j) {
+      if (next[j] != NULL && result->count < POLARIS_MAX_CONNECT_ADDRESSES) {
+        memcpy(&result->addresses[result->count], next[j]->ai_addr,
+               next[j]->ai_addrlen);
+        result->address_lengths[result->count] = next[j]->ai_addrlen;
+        ++result->count;
+      }
+    }
+  }
+
+  freeaddrinfo(addresses);
+  return result->count > 0 ? 0 : EAI_NONAME;
+}
+
+/******************************************************************************/
+static void SetPort(PolarisAddressList_t* addresses, int port) {
+  for (size_t i = 0; i < addresses->count; ++i) {
+    struct sockaddr_storage* address = &addresses->addresses[i];
+    if (address->ss_family == AF_INET) {
+      ((struct sockaddr_in*)address)->sin_port = htons((uint16_t)port);
+    } else if (address->ss_family == AF_INET6) {
+      ((struct sockaddr_in6*)address)->sin6_port = htons((uint16_t)port);
+    }
+  }
+}
+
+#  if POLARIS_DNS_CACHE_SIZE > 0
+/******************************************************************************/
+static DNSCacheEntry_t* FindEntry(const char* hostname) {
+  for (size_t i = 0; i < POLARIS_DNS_CACHE_SIZE; ++i) {
+    if (__cache[i].hostname[0] != '\0' &&
+        strcmp(__cache[i].hostname, hostname) == 0) {
+      return &__cache[i];
+    }
+  }
+  return NULL;
+}
+
+/******************************************************************************/
+static DNSCacheEntry_t* AllocateEntry(const char* hostname) {
+  // Use an empty entry if available, otherwise replace the least recently used
+  // one. Entries being refreshed in the background are never replaced.
+  DNSCacheEntry_t* result = NULL;
+  for (size_t i = 0; i < POLARIS_DNS_CACHE_SIZE; ++i) {
+    DNSCacheEntry_t* entry = &__cache[i];
+    if (entry->refreshing) {
+      continue;
+    } else if (entry->hostname[0] == '\0') {
+      result = entry;
+      break;
+    } else if (result == NULL ||
+               entry->last_used_time_ms < result->last_used_time_ms) {
+      result = entry;
+    }
+  }
+
+  if (result != NULL) {
+    strcpy(result->hostname, hostname);
+    result->addresses.count = 0;
+    result->invalidated = 0;
+  }
+
+  return result;
+}
+
+/******************************************************************************/
+static void* RefreshEntry(void* arg) {
+  DNSCacheEntry_t* entry = (DNSCacheEntry_t*)arg;
+
+  // Entries are not reassigned while being refreshed, but they may be cleared
+  // by Polaris_ClearDNSCache(), so we work on a copy of the hostname.
+  char hostname[MAX_HOSTNAME_LENGTH + 1];
+  pthread_mutex_lock(&__cache_mutex);
+  strcpy(hostname, entry->hostname);
+  pthread_mutex_unlock(&__cache_mutex);
+
+  PolarisAddressList_t addresses;
+  int ret = LookupHost(hostname, &addresses);
+
+  pthread_mutex_lock(&__cache_mutex);
+  // If the lookup failed, keep serving the existing addresses. We'll try again
+  // the next time the entry is used.
+  if (ret == 0 && strcmp(entry->hostname, hostname) == 0) {
+    entry->addresses = addresses;
+    entry->resolved_time_ms = GetMonotonicTimeMS();
+    entry->invalidated = 0;
+  }
+  entry->refreshing = 0;
+  pthread_mutex_unlock(&__cache_mutex);
+
+  return NULL;
+}
+
+/******************************************************************************/
+static void StartRefresh(DNSCacheEntry_t* entry) {
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  pthread_t thread;
+  entry->refreshing = 1;
+  if (pthread_create(&thread, &attr, &RefreshEntry, entry) != 0) {
+    entry->refreshing = 0;
+  }
+
+  pthread_attr_destroy(&attr);
+}
+#  endif  // POLARIS_DNS_CACHE_SIZE > 0
+
+/******************************************************************************/
+int Polaris_ResolveHost(const char* hostname, int port,
+                        PolarisAddressList_t* result, int* lookup_error) {
+  *lookup_error = 0;
+
+#  if POLARIS_DNS_CACHE_SIZE > 0
+  if (strlen(hostname) > MAX_HOSTNAME_LENGTH) {
+    *lookup_error = LookupHost(hostname, result);
+    if (*lookup_error != 0) {
+      return -1;
+    }
+
+    SetPort(result, port);
+    return POLARIS_DNS_RESOLVED;
+  }
+
+  // Use the cached entry if we have one. If it has expired, refresh it in the
+  // background and use the old addresses in the meantime.
+  pthread_mutex_lock(&__cache_mutex);
+  uint64_t now_ms = GetMonotonicTimeMS();
+  DNSCacheEntry_t* entry = FindEntry(hostname);
+  if (entry != NULL && !entry->invalidated) {
+    int status = POLARIS_DNS_CACHED;
+    if (now_ms - entry->resolved_time_ms >= POLARIS_DNS_CACHE_TTL_MS) {
+      status = POLARIS_DNS_STALE;
+      if (!entry->refreshing) {
+        StartRefresh(entry);
+      }
+    }
+
+    entry->last_used_time_ms = now_ms;
+    *result = entry->addresses;
+    pthread_mutex_unlock(&__cache_mutex);
+
+    SetPort(result, port);
+    return status;
+  }
+  pthread_mutex_unlock(&__cache_mutex);
+
+  // Not cached (or invalidated): perform a lookup now. We do not hold the lock
+  // while waiting so that other connections are not blocked.
+  PolarisAddressList_t addresses;
+  *lookup_error = LookupHost(hostname, &addresses);
+
+  int status;
+  pthread_mutex_lock(&__cache_mutex);
+  now_ms = GetMonotonicTimeMS();
+  entry = FindEntry(hostname);
+  if (*lookup_error == 0) {
+    if (entry == NULL) {
+      entry = AllocateEntry(hostname);
+    }
+
+    if (entry != NULL) {
+      entry->addresses = addresses;
+      entry->resolved_time_ms = now_ms;
+      entry->last_used_time_ms = now_ms;
+      entry->invalidated = 0;
+    }
+
+    *result = addresses;
+    status = POLARIS_DNS_RESOLVED;
+  }
+  // If the lookup failed, fall back to the last known addresses, if any.
+  else if (entry != NULL && entry->addresses.count > 0) {
+    entry->last_used_time_ms = now_ms;
+    *result = entry->addresses;
+    status = POLARIS_DNS_STALE;
+  } else {
+    status = -1;
+  }
+  pthread_mutex_unlock(&__cache_mutex);
+
+  if (status >= 0) {
+    SetPort(result, port);
+  }
+
+  return status;
+#  else
+  *lookup_error = LookupHost(hostname, result);
+  if (*lookup_error != 0) {
+    return -1;
+  }
+
+  SetPort(result, port);
+  return POLARIS_DNS_RESOLVED;
+#  endif  // POLARIS_DNS_CACHE_SIZE > 0
+}
+
+/******************************************************************************/
+void Polaris_InvalidateHost(const char* hostname) {
+#  if POLARIS_DNS_CACHE_SIZE > 0
+  pthread_mutex_lock(&__cache_mutex);
+  DNSCacheEntry_t* entry = FindEntry(hostname);
+  if (entry != NULL) {
+    entry->invalidated = 1;
+  }
+  pthread_mutex_unlock(&__cache_mutex);
+#  else
+  (void)hostname;
+#  endif
+}
+
+/******************************************************************************/
+void Polaris_ClearDNSCache(void) {
+#  if POLARIS_DNS_CACHE_SIZE > 0
+  pthread_mutex_lock(&__cache_mutex);
+  for (size_t i = 0; i < POLARIS_DNS_CACHE_SIZE; ++i) {
+    __cache[i].hostname[0] = '\0';
+    __cache[i].addresses.count = 0;
+  }
+  pthread_mutex_unlock(&__cache_mutex);
+#  endif
+}
+
+#endif  // P1_FREERTOS
@@ -0,0 +1,84 @@
+/**************************************************************************/ /**
+ * @brief Process-wide DNS resolution cache.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h> // For size_t
+
+#include "point_one/polaris/polaris.h"
+
+#ifndef P1_FREERTOS
+
+#  include <sys/socket.h> // For sockaddr_storage and socklen_t
+
+/** The addresses were resolved by a new DNS lookup. */
+#  define POLARIS_DNS_RESOLVED 0
+/** The addresses were taken from the cache and are within their TTL. */
+#  define POLARIS_DNS_CACHED 1
+/**
+ * The addresses were taken from the cache and are older than their TTL, either
+ * because a background refresh is in progress or because the lookup failed.
+ */
+#  define POLARIS_DNS_STALE 2
+
+/**
+ * @brief A list of resolved addresses for a host, in the order in which they
+ *        should be tried.
+ */
+typedef struct {
+  struct sockaddr_storage addresses[POLARIS_MAX_CONNECT_ADDRESSES];
+  socklen_t address_lengths[POLARIS_MAX_CONNECT_ADDRESSES];
+  size_t count;
+} PolarisAddressList_t;
+
+#  ifdef __cplusplus
+extern "C" {
+#  endif
+
+/**
+ * @brief Resolve the IPv4 and IPv6 addresses for a host, using the cache if
+ *        possible.
+ *
+ * Addresses are ordered for connection racing as described in RFC 8305 section
+ * 4: the resolver's order of preference is kept within each address family,
+ * and the families are interleaved.
+ *
+ * If the cache contains an entry for the host within @ref
+ * POLARIS_DNS_CACHE_TTL_MS, it is returned without a lookup. If the entry has
+ * expired, it is still returned, and a new lookup is started in the background.
+ * If there is no entry, or it was invalidated by @ref Polaris_InvalidateHost(),
+ * a lookup is performed immediately; if that lookup fails, any previous entry
+ * is returned instead.
+ *
+ * @param hostname The host to be resolved.
+ * @param port The port to be set in each returned address.
+ * @param result The resolved addresses.
+ * @param lookup_error Set to the `getaddrinfo()` error code if a lookup failed,
+ *        or 0 otherwise.
+ *
+ * @return @ref POLARIS_DNS_RESOLVED, @ref POLARIS_DNS_CACHED, or @ref
+ *         POLARIS_DNS_STALE on success.
+ * @return <0 if the host could not be resolved and is not cached.
+ */
+int Polaris_ResolveHost(const char* hostname, int port,
+                        PolarisAddressList_t* result, int* lookup_error);
+
+/**
+ * @brief Mark the cached addresses for a host as invalid, e.g., after failing
+ *        to connect to any of them.
+ *
+ * The next call to @ref Polaris_ResolveHost() will perform a new lookup, and
+ * will only use the invalidated addresses if that lookup fails.
+ *
+ * @param hostname The host to be invalidated.
+ */
+void Polaris_InvalidateHost(const char* hostname);
+
+#  ifdef __cplusplus
+} // extern "C"
+#  endif
+
+#endif // P1_FREERTOS
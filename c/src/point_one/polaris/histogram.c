@@ -0,0 +1,102 @@
+/**************************************************************************/ /**
+ * @brief Fixed-size, log-bucketed latency histograms.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/histogram.h"
+
+#include <string.h> // For memset()
+
+#define SUB_BUCKET_BITS POLARIS_HISTOGRAM_SUB_BUCKET_BITS
+#define SUB_BUCKET_COUNT POLARIS_HISTOGRAM_SUB_BUCKET_COUNT
+
+/******************************************************************************/
+void Polaris_HistogramReset(PolarisHistogram_t* histogram) {
+  memset(histogram, 0, sizeof(*histogram));
+}
+
+/******************************************************************************/
+void Polaris_HistogramRecord(PolarisHistogram_t* histogram, uint32_t value) {
+  ++histogram->counts[Polaris_HistogramGetBucketIndex(value)];
+  if (histogram->total_count == 0 || value < histogram->min) {
+    histogram->min = value;
+  }
+  if (value > histogram->max) {
+    histogram->max = value;
+  }
+  ++histogram->total_count;
+  histogram->sum += value;
+}
+
+/******************************************************************************/
+size_t Polaris_HistogramGetBucketIndex(uint32_t value) {
+  if (value < SUB_BUCKET_COUNT) {
+    return value;
+  }
+
+  // Values in [2^N, 2^(N+1)) are split into SUB_BUCKET_COUNT buckets using the
+  // SUB_BUCKET_BITS bits immediately below the most significant bit.
+  int msb = 31 - __builtin_clz(value);
+  int shift = msb - SUB_BUCKET_BITS;
+  return (size_t)(shift + 1) * SUB_BUCKET_COUNT +
+         ((value >> shift) & (SUB_BUCKET_COUNT - 1));
+}
+
+/******************************************************************************/
+uint32_t Polaris_HistogramGetBucketLowerBound(size_t index) {
+  if (index < SUB_BUCKET_COUNT) {
+    return (uint32_t)index;
+  } else if (index >= POLARIS_HISTOGRAM_NUM_BUCKETS) {
+    return UINT32_MAX;
+  } else {
+    size_t shift = index / SUB_BUCKET_COUNT - 1;
+    uint64_t mantissa = SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT;
+    return (uint32_t)(mantissa << shift);
+  }
+}
+
+/******************************************************************************/
+uint32_t Polaris_HistogramGetPercentile(const PolarisHistogram_t* histogram,
+                                        double percentile) {
+  if (histogram->total_count == 0) {
+    return 0;
+  }
+
+  if (percentile < 0.0) {
+    percentile = 0.0;
+  } else if (percentile > 100.0) {
+    percentile = 100.0;
+  }
+
+  // Find the bucket containing the Nth smallest value.
+  uint64_t target = (uint64_t)(percentile / 100.0 * histogram->total_count);
+  if ((double)target < percentile / 100.0 * histogram->total_count) {
+    ++target;
+  }
+  if (target == 0) {
+    target = 1;
+  }
+
+  uint64_t cumulative_count = 0;
+  for (size_t i = 0; i < POLARIS_HISTOGRAM_NUM_BUCKETS; ++i) {
+    cumulative_count += histogram->counts[i];
+    if (cumulative_count >= target) {
+      uint32_t upper_bound = i + 1 < POLARIS_HISTOGRAM_NUM_BUCKETS
+                                 ? Polaris_HistogramGetBucketLowerBound(i + 1) - 1
+                                 : UINT32_MAX;
+      return upper_bound < histogram->max ? upper_bound : histogram->max;
+    }
+  }
+
+  return histogram->max;
+}
+
+/******************************************************************************/
+double Polaris_HistogramGetMean(const PolarisHistogram_t* histogram) {
+  if (histogram->total_count == 0) {
+    return 0.0;
+  } else {
+    return (double)histogram->sum / (double)histogram->total_count;
+  }
+}
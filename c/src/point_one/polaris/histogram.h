@@ -0,0 +1,122 @@
+/**************************************************************************/ /**
+ * @brief Fixed-size, log-bucketed latency histograms.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h> // For size_t
+#include <stdint.h>
+
+/**
+ * @brief The number of bits of precision kept for each recorded value.
+ *
+ * Values are grouped into power-of-two ranges, each divided into
+ * `2^POLARIS_HISTOGRAM_SUB_BUCKET_BITS` equally sized buckets. With the default
+ * of 2 bits, the reported value for any bucket is within 25% of the true value.
+ * Each additional bit halves the error and doubles the size of @ref
+ * PolarisHistogram_t.
+ */
+#ifndef POLARIS_HISTOGRAM_SUB_BUCKET_BITS
+# define POLARIS_HISTOGRAM_SUB_BUCKET_BITS 2
+#endif
+
+#define POLARIS_HISTOGRAM_SUB_BUCKET_COUNT \
+  (1 << POLARIS_HISTOGRAM_SUB_BUCKET_BITS)
+
+/**
+ * @brief The number of buckets required to cover the full range of a 32-bit
+ *        value.
+ */
+#define POLARIS_HISTOGRAM_NUM_BUCKETS           \
+  ((33 - POLARIS_HISTOGRAM_SUB_BUCKET_BITS) * \
+   POLARIS_HISTOGRAM_SUB_BUCKET_COUNT)
+
+/**
+ * @brief A histogram of 32-bit values (typically durations in microseconds).
+ *
+ * Values less than @ref POLARIS_HISTOGRAM_SUB_BUCKET_COUNT are counted exactly.
+ * Larger values are counted in logarithmically spaced buckets: bucket `i`
+ * covers the range [@ref Polaris_HistogramGetBucketLowerBound() `(i)`, @ref
+ * Polaris_HistogramGetBucketLowerBound() `(i + 1)`). Recording a value is
+ * constant time and never allocates memory.
+ */
+typedef struct {
+  uint32_t counts[POLARIS_HISTOGRAM_NUM_BUCKETS];
+  /** The total number of recorded values. */
+  uint64_t total_count;
+  /** The sum of all recorded values. */
+  uint64_t sum;
+  /** The smallest recorded value, or 0 if empty. */
+  uint32_t min;
+  /** The largest recorded value, or 0 if empty. */
+  uint32_t max;
+} PolarisHistogram_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Clear all recorded values.
+ *
+ * @param histogram The histogram to be reset.
+ */
+void Polaris_HistogramReset(PolarisHistogram_t* histogram);
+
+/**
+ * @brief Record a single value.
+ *
+ * @param histogram The histogram to be updated.
+ * @param value The value to be recorded.
+ */
+void Polaris_HistogramRecord(PolarisHistogram_t* histogram, uint32_t value);
+
+/**
+ * @brief Get the index of the bucket containing a value.
+ *
+ * @param value The value to be found.
+ *
+ * @return The bucket index.
+ */
+size_t Polaris_HistogramGetBucketIndex(uint32_t value);
+
+/**
+ * @brief Get the smallest value counted in a bucket.
+ *
+ * @param index The bucket index.
+ *
+ * @return The lower bound of the bucket, or `UINT32_MAX` if `index` is past the
+ *         last bucket.
+ */
+uint32_t Polaris_HistogramGetBucketLowerBound(size_t index);
+
+/**
+ * @brief Get the approximate value below which a given percentage of recorded
+ *        values fall.
+ *
+ * The result is the largest value in the bucket containing the requested
+ * percentile, limited to the largest recorded value. In other words, at least
+ * `percentile`% of the recorded values are less than or equal to the result.
+ *
+ * @param histogram The histogram to be queried.
+ * @param percentile The desired percentile, in the range [0.0, 100.0].
+ *
+ * @return The percentile value, or 0 if the histogram is empty.
+ */
+uint32_t Polaris_HistogramGetPercentile(const PolarisHistogram_t* histogram,
+                                        double percentile);
+
+/**
+ * @brief Get the average of all recorded values.
+ *
+ * @param histogram The histogram to be queried.
+ *
+ * @return The mean value, or 0.0 if the histogram is empty.
+ */
+double Polaris_HistogramGetMean(const PolarisHistogram_t* histogram);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -15,6 +15,7 @@
 
 #ifndef P1_FREERTOS
 #  include <fcntl.h>  // For fcntl()
+#  include <pthread.h>
 #  include <time.h>   // For struct tm
 #endif
 
@@ -23,12 +24,26 @@
 #  include <openssl/ssl.h>
 #endif
 
+#include "point_one/polaris/dns_cache.h"
 #include "point_one/polaris/polaris_internal.h"
 #include "point_one/polaris/portability.h"
 
+// Kernel timestamps on TLS connections require a custom BIO, which uses the
+// OpenSSL 1.1.0 BIO_meth_*() API (also provided by BoringSSL).
+#if P1_HAVE_KERNEL_TIMESTAMPS && \
+    (!defined(POLARIS_USE_TLS) || OPENSSL_VERSION_NUMBER >= 0x10100000L)
+#  define POLARIS_KERNEL_TIMESTAMPS_SUPPORTED 1
+#else
+#  define POLARIS_KERNEL_TIMESTAMPS_SUPPORTED 0
+#endif
+
+// The start of GPS time (1980/1/6 00:00:00 UTC), in ms since the UNIX epoch.
+#define GPS_EPOCH_UNIX_TIME_MS 315964800000LL
+
 #define POLARIS_NOT_AUTHENTICATED 0
 #define POLARIS_AUTHENTICATED 1
 #define POLARIS_AUTHENTICATION_SKIPPED 2
+#define POLARIS_AUTHENTICATION_REJECTED 3
 
 #define MAKE_STR(x) #x
 #define STR(x) MAKE_STR(x)
@@ -40,6 +55,7 @@
 #if P1_NO_PRINT
 #  define P1_PrintMessage(level, x, ...) P1_NOOP
 #  define P1_PrintErrno(x, ...) P1_NOOP
+#  define P1_PrintErrnoLevel(level, x, ...) P1_NOOP
 
 #  define P1_PrintData(buffer, length) P1_NOOP
 #  if POLARIS_USE_TLS
@@ -52,10 +68,27 @@ static int __log_level = POLARIS_LOG_LEVEL_INFO;
 
 static PolarisPrintCallback_t __print_callback = NULL;
 
-static int PrintTime(char* buffer, size_t capacity_bytes) {
-  // Get the current _local_ time (not UTC).
+#  ifdef P1_FREERTOS
+#    define P1_IsAsyncPrintEnabled() 0
+#  else
+static int __async_print_enabled = 0;
+#    define P1_IsAsyncPrintEnabled() \
+      __atomic_load_n(&__async_print_enabled, __ATOMIC_ACQUIRE)
+
+static int SetAsyncPrintEnabled(int enabled);
+static void EnqueuePrintMessage(int line, int level, const char* message);
+#  endif
+
+static int PrintTime(const P1_TimeValue_t* time, char* buffer,
+                     size_t capacity_bytes) {
+  // Get the current _local_ time (not UTC), or the time the message was queued
+  // when printing asynchronously.
   P1_TimeValue_t now;
-  P1_GetCurrentTime(&now);
+  if (time) {
+    now = *time;
+  } else {
+    P1_GetCurrentTime(&now);
+  }
   uint64_t now_ms = P1_GetTimeMS(&now);
   now_ms += P1_GetUTCOffsetSec(&now) * 1000;
 
@@ -97,24 +130,44 @@ static int PrintTime(char* buffer, size_t capacity_bytes) {
   return length;
 }
 
+static void OutputMessage(const P1_TimeValue_t* time, int line, int level,
+                          const char* message) {
+  if (__print_callback) {
+    __print_callback("polaris.c", line, level, message);
+  } else {
+    PrintTime(time, NULL, 0);
+    P1_fprintf(stderr, " polaris.c:%d] %s\n", line, message);
+  }
+}
+
+static void DeliverMessage(int line, int level, const char* message) {
+#  ifndef P1_FREERTOS
+  if (P1_IsAsyncPrintEnabled()) {
+    EnqueuePrintMessage(line, level, message);
+    return;
+  }
+#  endif
+  OutputMessage(NULL, line, level, message);
+}
+
 static void P1_PrintToCallback(int line, int level, const char* format, ...) {
   char buffer[POLARIS_MAX_PRINT_LENGTH + 1];
   va_list args;
   va_start(args, format);
   vsnprintf(buffer, sizeof(buffer), format, args);
   va_end(args);
-  __print_callback("polaris.c", line, level, buffer);
+  DeliverMessage(line, level, buffer);
 }
 
-#  define P1_DoPrint(line, level, x, ...)                       \
-    if (__log_level >= level) {                                 \
-      if (__print_callback) {                                   \
-        P1_PrintToCallback(line, level, x, ##__VA_ARGS__);      \
-      } else {                                                  \
-        PrintTime(NULL, 0);                                     \
-        P1_fprintf(stderr, " polaris.c:" STR(line) "] " x "\n", \
-                   ##__VA_ARGS__);                              \
-      }                                                         \
+#  define P1_DoPrint(line, level, x, ...)                          \
+    if (__log_level >= level) {                                    \
+      if (__print_callback || P1_IsAsyncPrintEnabled()) {          \
+        P1_PrintToCallback(line, level, x, ##__VA_ARGS__);         \
+      } else {                                                     \
+        PrintTime(NULL, NULL, 0);                                  \
+        P1_fprintf(stderr, " polaris.c:" STR(line) "] " x "\n",    \
+                   ##__VA_ARGS__);                                 \
+      }                                                            \
     }
 
 #  define P1_PrintMessage(level, x, ...) \
@@ -231,22 +284,165 @@ static void __P1_PrintSSLError(int level, int line, PolarisContext_t* context,
 #  define P1_PrintSSLError(context, x, ret) P1_NOOP
 #endif  // POLARIS_NO_PRINT / POLARIS_USE_TLS
 
+// The maximum length of an HTTP status or header line that is stored while
+// parsing a response. Longer lines are truncated, which is harmless for the
+// headers we need (e.g., Content-Length).
+#define HTTP_MAX_LINE_SIZE 128
+
+// Returned by GetHTTPResponse() if a reused keep-alive connection was closed
+// before any response was received.
+#define HTTP_CONNECTION_STALE -100
+
+typedef enum {
+  HTTP_STATE_STATUS_LINE,
+  HTTP_STATE_HEADER_LINE,
+  HTTP_STATE_BODY,
+  HTTP_STATE_BODY_UNTIL_CLOSE,
+  HTTP_STATE_CHUNK_SIZE,
+  HTTP_STATE_CHUNK_DATA,
+  HTTP_STATE_CHUNK_END,
+  HTTP_STATE_TRAILER,
+  HTTP_STATE_DONE,
+  HTTP_STATE_INVALID,
+} HTTPParserState_t;
+
+typedef struct {
+  HTTPParserState_t state;
+  int status_code;
+  uint8_t chunked;
+  uint8_t has_content_length;
+  uint8_t connection_close;
+  // Remaining bytes in the body (Content-Length) or the current chunk.
+  size_t remaining_bytes;
+  char line[HTTP_MAX_LINE_SIZE + 1];
+  size_t line_length;
+
+  uint8_t* body;
+  size_t body_capacity;
+  size_t body_size;
+  uint8_t body_truncated;
+} HTTPResponseParser_t;
+
+// The duration of each phase of opening a connection (in ms), or -1 if not
+// performed. See PolarisStats_t.
+typedef struct {
+  int32_t dns_lookup_ms;
+  int32_t tcp_connect_ms;
+  int32_t tls_handshake_ms;
+} ConnectTiming_t;
+
 static int ValidateUniqueID(const char* unique_id);
 
 static int OpenSocket(PolarisContext_t* context, const char* endpoint_url,
-                      int endpoint_port);
+                      int endpoint_port, ConnectTiming_t* timing);
+
+static void ConfigureSocket(PolarisContext_t* context);
+
+#ifndef P1_FREERTOS
+static int ConnectToEndpoint(PolarisContext_t* context,
+                             const char* endpoint_url, int endpoint_port,
+                             ConnectTiming_t* timing);
+#endif
 
 static int SendPOSTRequest(PolarisContext_t* context, const char* endpoint_url,
                            int endpoint_port, const char* address,
                            const void* content, size_t content_length);
 
-static int GetHTTPResponse(PolarisContext_t* context);
+static int GetHTTPResponse(PolarisContext_t* context, int reused_connection);
+
+static void ResetHTTPParser(HTTPResponseParser_t* parser);
+
+static size_t ParseHTTPData(HTTPResponseParser_t* parser, const uint8_t* data,
+                            size_t size_bytes);
+
+static int IsHTTPConnectionReusable(PolarisContext_t* context,
+                                    const char* endpoint_url,
+                                    int endpoint_port);
 
 static void CloseSocket(PolarisContext_t* context, int destroy_context);
 
+#ifdef POLARIS_USE_TLS
+static SSL_CTX* AcquireSSLContext(void);
+
+static void ReleaseSSLContext(SSL_CTX* ssl_ctx);
+
+static SSL_SESSION* GetTLSSession(const char* endpoint_url, int endpoint_port);
+
+static void RemoveTLSSession(const char* endpoint_url, int endpoint_port);
+#endif
+
+static void HandleRTCMFrame(void* info, const uint8_t* frame,
+                            size_t size_bytes);
+
+static int IsAuthRejectionText(const char* text, size_t length);
+
+static void UpdateCorrectionAge(PolarisContext_t* context,
+                                const uint8_t* frame, size_t size_bytes);
+
+static void ResetCorrectionAge(PolarisContext_t* context);
+
+static void SetSocketNonBlocking(PolarisContext_t* context);
+
+static int ReceiveData(PolarisContext_t* context, int nonblocking);
+
+static size_t DrainSocket(PolarisContext_t* context, size_t offset_bytes);
+
+static size_t EncodeECEFPosition(void* buffer, double x_m, double y_m,
+                                 double z_m);
+
+static size_t EncodeLLAPosition(void* buffer, double latitude_deg,
+                                double longitude_deg, double altitude_m);
+
+static size_t EncodeBeaconRequest(void* buffer, const char* beacon_id);
+
+static int WriteRequestData(PolarisContext_t* context, const uint8_t* buffer,
+                            size_t size_bytes);
+
+static void ClearPendingRequest(PolarisContext_t* context);
+
+static int FlushPendingRequest(PolarisContext_t* context);
+
+static int SendRequest(PolarisContext_t* context, const void* buffer,
+                       size_t size_bytes);
+
+static void QueueRequest(PolarisContext_t* context, const void* buffer,
+                         size_t size_bytes);
+
+static int SendQueuedRequest(PolarisContext_t* context);
+
+static int WaitForDataRequest(PolarisContext_t* context);
+
+static int WaitForData(PolarisContext_t* context, int timeout_ms);
+
+static uint64_t GetCurrentTimeMS(void);
+
+static void RecordDuration(PolarisHistogram_t* histogram, uint64_t duration_us);
+
+#if !defined(POLARIS_USE_TLS) || POLARIS_KERNEL_TIMESTAMPS_SUPPORTED
+static P1_RecvSize_t ReadSocket(PolarisContext_t* context, void* buffer,
+                                size_t size_bytes, int flags);
+#endif
+
+#ifdef POLARIS_USE_TLS
+static void AttachSocketToTLS(PolarisContext_t* context);
+#endif
+
 /******************************************************************************/
 int Polaris_Init(PolarisContext_t* context) {
-  if (POLARIS_RECV_BUFFER_SIZE < POLARIS_MAX_HTTP_MESSAGE_SIZE) {
+  return Polaris_InitWithRecvBuffer(context, NULL, 0);
+}
+
+/******************************************************************************/
+int Polaris_InitWithRecvBuffer(PolarisContext_t* context, uint8_t* buffer,
+                               size_t size_bytes) {
+  if (buffer != NULL && size_bytes < POLARIS_MAX_HTTP_MESSAGE_SIZE) {
+    P1_PrintError(
+        "Error: Receive buffer too small for authentication response. "
+        "[size=%u B, min=%u B]",
+        (unsigned)size_bytes, (unsigned)POLARIS_MAX_HTTP_MESSAGE_SIZE);
+    return POLARIS_NOT_ENOUGH_SPACE;
+  } else if (buffer == NULL &&
+             POLARIS_RECV_BUFFER_SIZE < POLARIS_MAX_HTTP_MESSAGE_SIZE) {
     P1_PrintWarning(
         "Warning: Receive buffer smaller than expected authentication "
         "response.");
@@ -259,16 +455,65 @@ int Polaris_Init(PolarisContext_t* context) {
 
   context->socket = P1_INVALID_SOCKET;
   context->auth_token[0] = '\0';
+  context->auth_token_lifetime_sec = 0;
   context->authenticated = POLARIS_NOT_AUTHENTICATED;
   context->disconnected = 0;
   context->total_bytes_received = 0;
   context->data_request_sent = 0;
+  context->request_sequence = 0;
+  context->request_size = 0;
+  context->request_sent_sequence = 0;
+  ClearPendingRequest(context);
   context->rtcm_callback = NULL;
   context->rtcm_callback_info = NULL;
+  context->rtcm_frame_callback = NULL;
+  context->rtcm_frame_callback_info = NULL;
+  context->rtcm_timestamped_callback = NULL;
+  context->rtcm_timestamped_callback_info = NULL;
+  context->kernel_timestamps = 0;
+  context->kernel_receive_time_ns = 0;
+  context->correction_age_enabled = 0;
+  context->leap_seconds = POLARIS_GPS_UTC_LEAP_SECONDS;
+  context->current_receive_time_ns = 0;
+  ResetCorrectionAge(context);
+  context->stall_multiplier = 0.0;
+  context->min_stall_timeout_ms = POLARIS_MIN_STALL_TIMEOUT_MS;
+  context->read_gap_count = 0;
+  Polaris_RTCMFramerReset(&context->rtcm_framer);
+  context->auth_status_callback = NULL;
+  context->auth_status_callback_info = NULL;
+  context->nonblocking = 0;
+  context->poll_events = 0;
+  context->batched_reads = 0;
+  context->connect_timeout_ms = POLARIS_CONNECT_TIMEOUT_MS;
+  Polaris_GetDefaultSocketOptions(&context->socket_options);
+  context->http_keep_alive = 0;
+  context->http_connection_open = 0;
+  context->http_port = 0;
+  context->http_host[0] = '\0';
+
+  memset(&context->stats, 0, sizeof(context->stats));
+  context->stats.dns_lookup_ms = -1;
+  context->stats.tcp_connect_ms = -1;
+  context->stats.tls_handshake_ms = -1;
+  context->stats.auth_ms = -1;
+
+  Polaris_HistogramReset(&context->read_interval_histogram);
+  Polaris_HistogramReset(&context->callback_duration_histogram);
+  context->last_read_time_us = 0;
+
+  if (buffer == NULL) {
+    context->recv_buffer = context->recv_buffer_storage;
+    context->recv_buffer_size = sizeof(context->recv_buffer_storage);
+  } else {
+    context->recv_buffer = buffer;
+    context->recv_buffer_size = size_bytes;
+  }
 
 #ifdef POLARIS_USE_TLS
   context->ssl = NULL;
   context->ssl_ctx = NULL;
+  context->tls_session_resumed = 0;
 
   SSL_library_init();
   OpenSSL_add_all_algorithms();
@@ -278,7 +523,16 @@ int Polaris_Init(PolarisContext_t* context) {
 }
 
 /******************************************************************************/
-void Polaris_Free(PolarisContext_t* context) { CloseSocket(context, 1); }
+void Polaris_Free(PolarisContext_t* context) {
+  CloseSocket(context, 1);
+
+#ifdef POLARIS_USE_TLS
+  if (context->ssl_ctx != NULL) {
+    ReleaseSSLContext((SSL_CTX*)context->ssl_ctx);
+    context->ssl_ctx = NULL;
+  }
+#endif
+}
 
 /******************************************************************************/
 void Polaris_SetLogLevel(int log_level) {
@@ -294,6 +548,18 @@ void Polaris_SetPrintCallback(PolarisPrintCallback_t callback) {
 #endif
 }
 
+/******************************************************************************/
+int Polaris_SetAsyncPrint(int enabled) {
+#if P1_NO_PRINT
+  (void)enabled;
+  return POLARIS_SUCCESS;
+#elif defined(P1_FREERTOS)
+  return enabled ? POLARIS_ERROR : POLARIS_SUCCESS;
+#else
+  return SetAsyncPrintEnabled(enabled);
+#endif
+}
+
 /******************************************************************************/
 int Polaris_Authenticate(PolarisContext_t* context, const char* api_key,
                          const char* unique_id) {
@@ -329,7 +595,7 @@ int Polaris_AuthenticateTo(PolarisContext_t* context, const char* api_key,
       "}";
 
   int content_size = snprintf((char*)context->recv_buffer,
-                              POLARIS_RECV_BUFFER_SIZE, AUTH_REQUEST_TEMPLATE,
+                              context->recv_buffer_size, AUTH_REQUEST_TEMPLATE,
                               api_key, unique_id == NULL ? "" : unique_id);
   if (content_size < 0) {
     P1_PrintError("Error populating authentication request payload.");
@@ -339,6 +605,10 @@ int Polaris_AuthenticateTo(PolarisContext_t* context, const char* api_key,
   P1_PrintDebug("Sending auth request. [api_key=%.7s..., unique_id=%s, url=%s]",
                 api_key, unique_id, api_url);
   context->auth_token[0] = '\0';
+  context->auth_token_lifetime_sec = 0;
+  ++context->stats.auth_requests;
+  P1_TimeValue_t start_time;
+  P1_GetCurrentTime(&start_time);
 #ifdef POLARIS_USE_TLS
   int status_code = SendPOSTRequest(context, api_url, 443, "/api/v1/auth/token",
                                     context->recv_buffer, (size_t)content_size);
@@ -346,6 +616,13 @@ int Polaris_AuthenticateTo(PolarisContext_t* context, const char* api_key,
   int status_code = SendPOSTRequest(context, api_url, 80, "/api/v1/auth/token",
                                     context->recv_buffer, (size_t)content_size);
 #endif
+  P1_TimeValue_t end_time;
+  P1_GetCurrentTime(&end_time);
+  context->stats.auth_ms = P1_GetElapsedMS(&start_time, &end_time);
+  if (status_code != 200) {
+    ++context->stats.auth_failures;
+  }
+
   if (status_code < 0) {
     P1_PrintError("Error sending authentication request.");
     return status_code;
@@ -357,15 +634,30 @@ int Polaris_AuthenticateTo(PolarisContext_t* context, const char* api_key,
         strstr((char*)context->recv_buffer, "\"access_token\":\"");
     if (token_start == NULL) {
       P1_PrintError("Authentication token not found in response.");
+      ++context->stats.auth_failures;
       return POLARIS_AUTH_ERROR;
     } else {
       token_start += 16;
       if (sscanf(token_start, "%" STR(POLARIS_MAX_TOKEN_SIZE) "[^\"]s",
                  context->auth_token) != 1) {
         P1_PrintError("Authentication token not found in response.");
+        ++context->stats.auth_failures;
         return POLARIS_AUTH_ERROR;
       } else {
         P1_PrintDebug("Received access token: %s", context->auth_token);
+
+        // The token lifetime is optional. If present, applications may use it
+        // to decide when a stored token should no longer be reused.
+        const char* expires_start =
+            strstr((char*)context->recv_buffer, "\"expires_in\":");
+        int lifetime_sec;
+        if (expires_start != NULL &&
+            sscanf(expires_start + 13, " %d", &lifetime_sec) == 1 &&
+            lifetime_sec > 0) {
+          context->auth_token_lifetime_sec = lifetime_sec;
+          P1_PrintDebug("Access token expires in %d seconds.", lifetime_sec);
+        }
+
         return POLARIS_SUCCESS;
       }
     }
@@ -389,6 +681,7 @@ int Polaris_SetAuthToken(PolarisContext_t* context, const char* auth_token) {
     return POLARIS_NOT_ENOUGH_SPACE;
   } else {
     memcpy(context->auth_token, auth_token, length + 1);
+    context->auth_token_lifetime_sec = 0;
     P1_PrintDebug("Using user-specified access token: %s", context->auth_token);
     return POLARIS_SUCCESS;
   }
@@ -413,18 +706,60 @@ int Polaris_ConnectTo(PolarisContext_t* context, const char* endpoint_url,
     return POLARIS_AUTH_ERROR;
   }
 
+  int ret = Polaris_OpenStream(context, endpoint_url, endpoint_port);
+  if (ret != POLARIS_SUCCESS) {
+    // Polaris_OpenStream() will print an error.
+    return ret;
+  }
+
+  return Polaris_SendAuthToken(context);
+}
+
+/******************************************************************************/
+int Polaris_OpenStream(PolarisContext_t* context, const char* endpoint_url,
+                       int endpoint_port) {
   // Connect to the corrections endpoint.
   context->disconnected = 0;
   context->authenticated = POLARIS_NOT_AUTHENTICATED;
   context->total_bytes_received = 0;
   context->data_request_sent = 0;
-  int ret = OpenSocket(context, endpoint_url, endpoint_port);
+  // Resend the queued request, if any, on the new connection. The sequence
+  // number of a complete request is always even.
+  context->request_sent_sequence = 1;
+  Polaris_RTCMFramerReset(&context->rtcm_framer);
+  context->last_read_time_us = 0;
+  context->kernel_receive_time_ns = 0;
+
+  ++context->stats.connect_attempts;
+  context->stats.first_byte_time_ms = 0;
+  ConnectTiming_t timing;
+  int ret = OpenSocket(context, endpoint_url, endpoint_port, &timing);
+  context->stats.dns_lookup_ms = timing.dns_lookup_ms;
+  context->stats.tcp_connect_ms = timing.tcp_connect_ms;
+  context->stats.tls_handshake_ms = timing.tls_handshake_ms;
   if (ret != POLARIS_SUCCESS) {
     P1_PrintError("Error connecting to corrections endpoint: tcp://%s:%d.",
                   endpoint_url, endpoint_port);
+    ++context->stats.connect_failures;
     return ret;
   }
 
+  context->stats.last_connect_time_ms = GetCurrentTimeMS();
+  return POLARIS_SUCCESS;
+}
+
+/******************************************************************************/
+int Polaris_SendAuthToken(PolarisContext_t* context) {
+  if (context->auth_token[0] == '\0') {
+    P1_PrintError("Error: Auth token not specified.");
+    CloseSocket(context, 1);
+    return POLARIS_AUTH_ERROR;
+  } else if (context->socket == P1_INVALID_SOCKET ||
+             context->http_connection_open) {
+    P1_PrintError("Error: Corrections stream not open.");
+    return POLARIS_SOCKET_ERROR;
+  }
+
   // Send the auth token.
   //
   // Note: We use the receive buffer here to send the auth message since the
@@ -439,9 +774,10 @@ int Polaris_ConnectTo(PolarisContext_t* context, const char* endpoint_url,
   P1_PrintDebug("Sending access token message. [size=%u B]",
                 (unsigned)message_size);
 #ifdef POLARIS_USE_TLS
-  ret = SSL_write(context->ssl, context->recv_buffer, message_size);
+  int ret = SSL_write(context->ssl, context->recv_buffer, message_size);
 #else
-  ret = send(context->socket, context->recv_buffer, message_size, 0);
+  int ret = send(context->socket, context->recv_buffer, message_size,
+                 P1_SEND_FLAGS);
 #endif
   if (ret != message_size) {
     P1_PrintReadWriteError(context, "Error sending authentication token", ret);
@@ -449,6 +785,9 @@ int Polaris_ConnectTo(PolarisContext_t* context, const char* endpoint_url,
     return POLARIS_SEND_ERROR;
   }
 
+  context->stats.bytes_sent += message_size;
+  SetSocketNonBlocking(context);
+
   return POLARIS_SUCCESS;
 }
 
@@ -464,14 +803,9 @@ int Polaris_ConnectWithoutAuth(PolarisContext_t* context,
   }
 
   // Connect to the corrections endpoint.
-  context->disconnected = 0;
-  context->authenticated = POLARIS_NOT_AUTHENTICATED;
-  context->total_bytes_received = 0;
-  context->data_request_sent = 0;
-  ret = OpenSocket(context, endpoint_url, endpoint_port);
+  ret = Polaris_OpenStream(context, endpoint_url, endpoint_port);
   if (ret != POLARIS_SUCCESS) {
-    P1_PrintError("Error connecting to corrections endpoint: tcp://%s:%d.",
-                  endpoint_url, endpoint_port);
+    // Polaris_OpenStream() will print an error.
     return ret;
   }
 
@@ -488,25 +822,36 @@ int Polaris_ConnectWithoutAuth(PolarisContext_t* context,
 #ifdef POLARIS_USE_TLS
     ret = SSL_write(context->ssl, context->send_buffer, message_size);
 #else
-    ret = send(context->socket, context->send_buffer, message_size, 0);
+    ret = send(context->socket, context->send_buffer, message_size,
+               P1_SEND_FLAGS);
 #endif
     if (ret != message_size) {
       P1_PrintReadWriteError(context, "Error sending unique ID", ret);
       CloseSocket(context, 1);
       return POLARIS_SEND_ERROR;
     }
+
+    context->stats.bytes_sent += message_size;
   }
 
   context->authenticated = POLARIS_AUTHENTICATION_SKIPPED;
 
+  SetSocketNonBlocking(context);
+
   return POLARIS_SUCCESS;
 }
 
 /******************************************************************************/
 void Polaris_Disconnect(PolarisContext_t* context) {
-  if (context->socket != P1_INVALID_SOCKET) {
+  // An idle HTTP keep-alive connection is not in use by Polaris_Work(), so it
+  // can be closed and freed immediately.
+  if (context->http_connection_open) {
+    P1_PrintDebug("Closing idle HTTP connection.");
+    CloseSocket(context, 1);
+  } else if (context->socket != P1_INVALID_SOCKET) {
     P1_PrintDebug("Closing Polaris connection.");
     context->disconnected = 1;
+    ++context->stats.closed_by_user;
 #ifdef POLARIS_USE_TLS
     SSL_shutdown(context->ssl);
 #endif
@@ -520,6 +865,103 @@ void Polaris_Disconnect(PolarisContext_t* context) {
   }
 }
 
+/******************************************************************************/
+void Polaris_Interrupt(PolarisContext_t* context) {
+  // Note: The socket and TLS connection are closed by the thread receiving data
+  // once it sees the connection was disconnected. See Polaris_Disconnect().
+  if (context->socket != P1_INVALID_SOCKET && !context->http_connection_open &&
+      !context->disconnected) {
+    P1_PrintDebug("Interrupting Polaris connection.");
+    context->disconnected = 1;
+    ++context->stats.closed_by_user;
+    shutdown(context->socket, SHUT_RDWR);
+  }
+}
+
+/******************************************************************************/
+int Polaris_TakeConnection(PolarisContext_t* context,
+                           PolarisContext_t* source) {
+  if (source->socket == P1_INVALID_SOCKET || source->http_connection_open ||
+      source->disconnected) {
+    P1_PrintError("Error: Corrections stream not open.");
+    return POLARIS_SOCKET_ERROR;
+  }
+
+#ifdef POLARIS_USE_TLS
+  // The TLS connection uses the shared TLS context. Take our own reference to
+  // it, if we don't already have one, so it is not freed along with the
+  // source context.
+  if (context->ssl_ctx == NULL) {
+    context->ssl_ctx = AcquireSSLContext();
+    if (context->ssl_ctx == NULL) {
+      P1_PrintError("SSL context failed to initialize.");
+      return POLARIS_ERROR;
+    }
+  }
+#endif
+
+  if (context->socket != P1_INVALID_SOCKET && !context->http_connection_open) {
+    P1_PrintDebug("Closing Polaris connection.");
+    ++context->stats.closed_by_user;
+  }
+  CloseSocket(context, 1);
+
+  P1_PrintDebug("Taking over corrections stream.");
+  context->socket = source->socket;
+  context->ssl = source->ssl;
+  context->tls_session_resumed = source->tls_session_resumed;
+  context->authenticated = source->authenticated;
+  context->disconnected = 0;
+  context->total_bytes_received = source->total_bytes_received;
+  context->data_request_sent = source->data_request_sent;
+  // A request partially sent by the source context must be finished on the
+  // same connection.
+  memcpy(context->pending_request_buffer, source->pending_request_buffer,
+         source->pending_request_size);
+  context->pending_request_size = source->pending_request_size;
+  context->pending_request_offset = source->pending_request_offset;
+  context->pending_poll_events = source->pending_poll_events;
+  // Resend the queued request, if any. It may be newer than the one sent by
+  // the source context.
+  context->request_sent_sequence = 1;
+  context->rtcm_framer = source->rtcm_framer;
+  context->last_read_time_us = source->last_read_time_us;
+  context->kernel_receive_time_ns = source->kernel_receive_time_ns;
+
+#ifdef POLARIS_USE_TLS
+  // Apply our own batched reads setting to the new connection.
+  if (context->ssl != NULL) {
+    SSL_set_read_ahead(context->ssl, context->batched_reads);
+  }
+#endif
+
+#if defined(POLARIS_USE_TLS) && POLARIS_KERNEL_TIMESTAMPS_SUPPORTED
+  // The timestamped socket BIO reads using the context it was created for.
+  if (context->ssl != NULL) {
+    BIO* bio = SSL_get_rbio(context->ssl);
+    if (bio != NULL && BIO_get_data(bio) == source) {
+      BIO_set_data(bio, context);
+    }
+  }
+#endif
+
+  SetSocketNonBlocking(context);
+
+  ++context->stats.connections_taken;
+  context->stats.last_connect_time_ms = source->stats.last_connect_time_ms;
+  context->stats.first_byte_time_ms = source->stats.first_byte_time_ms;
+  context->stats.dns_lookup_ms = source->stats.dns_lookup_ms;
+  context->stats.tcp_connect_ms = source->stats.tcp_connect_ms;
+  context->stats.tls_handshake_ms = source->stats.tls_handshake_ms;
+
+  source->socket = P1_INVALID_SOCKET;
+  source->ssl = NULL;
+  source->disconnected = 1;
+  ClearPendingRequest(source);
+  Polaris_RTCMFramerReset(&source->rtcm_framer);
+  return POLARIS_SUCCESS;
+}
+
 /******************************************************************************/
 void Polaris_SetRTCMCallback(PolarisContext_t* context,
                              PolarisCallback_t callback, void* callback_info) {
@@ -527,6 +969,51 @@ void Polaris_SetRTCMCallback(PolarisContext_t* context,
   context->rtcm_callback_info = callback_info;
 }
 
+/******************************************************************************/
+void Polaris_SetRTCMFrameCallback(PolarisContext_t* context,
+                                  PolarisCallback_t callback,
+                                  void* callback_info) {
+  // Discard any partial frame left over from a previous callback so a new
+  // callback never receives the tail end of data it did not see the start of.
+  if (callback != context->rtcm_frame_callback) {
+    Polaris_RTCMFramerReset(&context->rtcm_framer);
+  }
+
+  context->rtcm_frame_callback = callback;
+  context->rtcm_frame_callback_info = callback_info;
+}
+
+/******************************************************************************/
+void Polaris_SetRTCMTimestampedCallback(PolarisContext_t* context,
+                                        PolarisTimestampedCallback_t callback,
+                                        void* callback_info) {
+  context->rtcm_timestamped_callback = callback;
+  context->rtcm_timestamped_callback_info = callback_info;
+}
+
+/******************************************************************************/
+int Polaris_SetKernelTimestamps(PolarisContext_t* context, int enabled) {
+#if POLARIS_KERNEL_TIMESTAMPS_SUPPORTED
+  context->kernel_timestamps = enabled ? 1 : 0;
+  return POLARIS_SUCCESS;
+#else
+  if (enabled) {
+    P1_PrintError("Kernel receive timestamps not supported on this platform.");
+    return POLARIS_ERROR;
+  } else {
+    return POLARIS_SUCCESS;
+  }
+#endif
+}
+
+/******************************************************************************/
+void Polaris_SetAuthStatusCallback(PolarisContext_t* context,
+                                   PolarisAuthStatusCallback_t callback,
+                                   void* callback_info) {
+  context->auth_status_callback = callback;
+  context->auth_status_callback_info = callback_info;
+}
+
 /******************************************************************************/
 int Polaris_SendECEFPosition(PolarisContext_t* context, double x_m, double y_m,
                              double z_m) {
@@ -541,39 +1028,20 @@ int Polaris_SendECEFPosition(PolarisContext_t* context, double x_m, double y_m,
   }
 #endif
 
-  PolarisHeader_t* header = Polaris_PopulateHeader(
-      context->send_buffer, POLARIS_ID_ECEF, sizeof(PolarisECEFMessage_t));
-  PolarisECEFMessage_t* payload = (PolarisECEFMessage_t*)(header + 1);
-  payload->x_cm = htole32((int32_t)(x_m * 1e2));
-  payload->y_cm = htole32((int32_t)(y_m * 1e2));
-  payload->z_cm = htole32((int32_t)(z_m * 1e2));
-  size_t message_size = Polaris_PopulateChecksum(context->send_buffer);
+  size_t message_size = EncodeECEFPosition(context->send_buffer, x_m, y_m, z_m);
 
 #ifdef P1_FREERTOS
   // Floating point printf() not available in FreeRTOS.
   P1_PrintDebug("Sending ECEF position. [size=%u B, position=[%d, %d, %d] cm]",
-                (unsigned)message_size, le32toh(payload->x_cm),
-                le32toh(payload->y_cm), le32toh(payload->z_cm));
+                (unsigned)message_size, (int)(x_m * 1e2), (int)(y_m * 1e2),
+                (int)(z_m * 1e2));
 #else
   P1_PrintDebug(
       "Sending ECEF position. [size=%u B, position=[%.2f, %.2f, %.2f]]",
       (unsigned)message_size, x_m, y_m, z_m);
 #endif
-  P1_PrintData(context->send_buffer, message_size);
 
-#ifdef POLARIS_USE_TLS
-  int ret = SSL_write(context->ssl, context->send_buffer, message_size);
-#else
-  int ret = send(context->socket, context->send_buffer, message_size, 0);
-#endif
-
-  if (ret != message_size) {
-    P1_PrintReadWriteError(context, "Error sending ECEF position", ret);
-    return POLARIS_SEND_ERROR;
-  } else {
-    context->data_request_sent = 1;
-    return POLARIS_SUCCESS;
-  }
+  return SendRequest(context, context->send_buffer, message_size);
 }
 
 /******************************************************************************/
@@ -590,43 +1058,22 @@ int Polaris_SendLLAPosition(PolarisContext_t* context, double latitude_deg,
   }
 #endif
 
-  // TODO Cache double buffer and flip flop, then send in Work()
-  //  - If we do this can we take out the mutex in polaris_client.cc?
-
-  PolarisHeader_t* header = Polaris_PopulateHeader(
-      context->send_buffer, POLARIS_ID_LLA, sizeof(PolarisLLAMessage_t));
-  PolarisLLAMessage_t* payload = (PolarisLLAMessage_t*)(header + 1);
-  payload->latitude_dege7 = htole32((int32_t)(latitude_deg * 1e7));
-  payload->longitude_dege7 = htole32((int32_t)(longitude_deg * 1e7));
-  payload->altitude_mm = htole32((int32_t)(altitude_m * 1e3));
-  size_t message_size = Polaris_PopulateChecksum(context->send_buffer);
+  size_t message_size = EncodeLLAPosition(context->send_buffer, latitude_deg,
+                                          longitude_deg, altitude_m);
 
 #ifdef P1_FREERTOS
   // Floating point printf() not available in FreeRTOS.
   P1_PrintDebug(
       "Sending LLA position. [size=%u B, position=[%d.0e-7, %d.0e-7, %d]]",
-      (unsigned)message_size, le32toh(payload->latitude_dege7),
-      le32toh(payload->longitude_dege7), le32toh(payload->altitude_mm));
+      (unsigned)message_size, (int)(latitude_deg * 1e7),
+      (int)(longitude_deg * 1e7), (int)(altitude_m * 1e3));
 #else
   P1_PrintDebug(
       "Sending LLA position. [size=%u B, position=[%.6f, %.6f, %.2f]]",
       (unsigned)message_size, latitude_deg, longitude_deg, altitude_m);
 #endif
-  P1_PrintData(context->send_buffer, message_size);
-
-#ifdef POLARIS_USE_TLS
-  int ret = SSL_write(context->ssl, context->send_buffer, message_size);
-#else
-  int ret = send(context->socket, context->send_buffer, message_size, 0);
-#endif
 
-  if (ret != message_size) {
-    P1_PrintReadWriteError(context, "Error sending LLA position", ret);
-    return POLARIS_SEND_ERROR;
-  } else {
-    context->data_request_sent = 1;
-    return POLARIS_SUCCESS;
-  }
+  return SendRequest(context, context->send_buffer, message_size);
 }
 
 /******************************************************************************/
@@ -642,29 +1089,54 @@ int Polaris_RequestBeacon(PolarisContext_t* context, const char* beacon_id) {
   }
 #endif
 
-  size_t id_length = strlen(beacon_id);
-  PolarisHeader_t* header = Polaris_PopulateHeader(
-      context->send_buffer, POLARIS_ID_BEACON, id_length);
-  memmove(header + 1, beacon_id, id_length);
-  size_t message_size = Polaris_PopulateChecksum(context->send_buffer);
+  size_t message_size = EncodeBeaconRequest(context->send_buffer, beacon_id);
+  if (message_size == 0) {
+    P1_PrintError("Error: Beacon ID too long. [beacon='%s']", beacon_id);
+    return POLARIS_NOT_ENOUGH_SPACE;
+  }
 
   P1_PrintDebug("Sending beacon request. [size=%u B, beacon='%s']",
                 (unsigned)message_size, beacon_id);
-  P1_PrintData(context->send_buffer, message_size);
 
-#ifdef POLARIS_USE_TLS
-  int ret = SSL_write(context->ssl, context->send_buffer, message_size);
-#else
-  int ret = send(context->socket, context->send_buffer, message_size, 0);
-#endif
+  return SendRequest(context, context->send_buffer, message_size);
+}
 
-  if (ret != message_size) {
-    P1_PrintReadWriteError(context, "Error sending beacon request", ret);
-    return POLARIS_SEND_ERROR;
-  } else {
-    context->data_request_sent = 1;
-    return POLARIS_SUCCESS;
+/******************************************************************************/
+int Polaris_QueueECEFPosition(PolarisContext_t* context, double x_m, double y_m,
+                              double z_m) {
+  uint8_t buffer[POLARIS_SEND_BUFFER_SIZE] __attribute__((aligned(4)));
+  size_t message_size = EncodeECEFPosition(buffer, x_m, y_m, z_m);
+  QueueRequest(context, buffer, message_size);
+  return POLARIS_SUCCESS;
+}
+
+/******************************************************************************/
+int Polaris_QueueLLAPosition(PolarisContext_t* context, double latitude_deg,
+                             double longitude_deg, double altitude_m) {
+  uint8_t buffer[POLARIS_SEND_BUFFER_SIZE] __attribute__((aligned(4)));
+  size_t message_size =
+      EncodeLLAPosition(buffer, latitude_deg, longitude_deg, altitude_m);
+  QueueRequest(context, buffer, message_size);
+  return POLARIS_SUCCESS;
+}
+
+/******************************************************************************/
+int Polaris_QueueBeaconRequest(PolarisContext_t* context,
+                               const char* beacon_id) {
+  uint8_t buffer[POLARIS_SEND_BUFFER_SIZE] __attribute__((aligned(4)));
+  size_t message_size = EncodeBeaconRequest(buffer, beacon_id);
+  if (message_size == 0) {
+    P1_PrintError("Error: Beacon ID too long. [beacon='%s']", beacon_id);
+    return POLARIS_NOT_ENOUGH_SPACE;
   }
+
+  QueueRequest(context, buffer, message_size);
+  return POLARIS_SUCCESS;
+}
+
+/******************************************************************************/
+void Polaris_ClearQueuedRequest(PolarisContext_t* context) {
+  QueueRequest(context, NULL, 0);
 }
 
 /******************************************************************************/
@@ -683,27 +1155,283 @@ int Polaris_Work(PolarisContext_t* context) {
   }
 
   P1_PrintDebug("Listening for data block.");
+  return ReceiveData(context, 0);
+}
 
-#ifdef POLARIS_USE_TLS
-  P1_RecvSize_t bytes_read =
-      SSL_read(context->ssl, context->recv_buffer, POLARIS_RECV_BUFFER_SIZE);
-#else
-  P1_RecvSize_t bytes_read =
-      recv(context->socket, context->recv_buffer, POLARIS_RECV_BUFFER_SIZE, 0);
-#endif
+/******************************************************************************/
+int Polaris_PollOnce(PolarisContext_t* context) {
+  if (context->disconnected) {
+    P1_PrintDebug("Connection terminated by user request.");
+    CloseSocket(context, 1);
+    return POLARIS_CONNECTION_CLOSED;
+  } else if (context->socket == P1_INVALID_SOCKET) {
+    P1_PrintError("Error: Polaris connection not currently open.");
+    CloseSocket(context, 1);
+    return POLARIS_SOCKET_ERROR;
+  }
 
-#ifdef P1_FREERTOS
-  // FreeRTOS does not use errno for recv() errors, but instead returns the
-  // equivalent error value. On a socket timeout, it returns 0 instead of
-  // ETIMEDOUT.
-  //
-  // We try to mimick the actual POSIX behavior to simplify the code below, so
-  // we set bytes_read to -1 and set errno accordingly.
-  //
-  // Later, we will need to restore them both before calling
-  // P1_PrintReadWriteError(). That function and P1_PrintErrno(), which it calls
-  // if TLS is disabled, expect to be provided the return code, not errno.
-  P1_RecvSize_t original_bytes_read = bytes_read;
+  // Read until there's nothing left. Note that for TLS connections, OpenSSL may
+  // have already pulled more data off the socket than it has handed to us, so
+  // we can't rely on the socket readiness alone to tell us when we're done.
+  int total_bytes = 0;
+  while (1) {
+    int ret = ReceiveData(context, 1);
+    if (ret < 0) {
+      return ret;
+    } else if (ret == 0 || context->disconnected) {
+      return total_bytes;
+    } else {
+      total_bytes += ret;
+    }
+  }
+}
+
+/******************************************************************************/
+P1_Socket_t Polaris_GetFileDescriptor(const PolarisContext_t* context) {
+  return context->socket;
+}
+
+/******************************************************************************/
+int Polaris_GetPollEvents(const PolarisContext_t* context) {
+  if (context->socket == P1_INVALID_SOCKET) {
+    return 0;
+  } else {
+    return context->poll_events | context->pending_poll_events;
+  }
+}
+
+/******************************************************************************/
+void Polaris_SetNonBlocking(PolarisContext_t* context, int enabled) {
+  context->nonblocking = enabled ? 1 : 0;
+  if (context->socket != P1_INVALID_SOCKET) {
+    SetSocketNonBlocking(context);
+  }
+}
+
+/******************************************************************************/
+void Polaris_SetBatchedReads(PolarisContext_t* context, int enabled) {
+  context->batched_reads = enabled ? 1 : 0;
+#ifdef POLARIS_USE_TLS
+  if (context->ssl != NULL) {
+    SSL_set_read_ahead(context->ssl, context->batched_reads);
+  }
+#endif
+}
+
+/******************************************************************************/
+void Polaris_SetConnectTimeout(PolarisContext_t* context, int timeout_ms) {
+  context->connect_timeout_ms =
+      timeout_ms > 0 ? timeout_ms : POLARIS_CONNECT_TIMEOUT_MS;
+}
+
+/******************************************************************************/
+void Polaris_GetDefaultSocketOptions(PolarisSocketOptions_t* options) {
+  memset(options, 0, sizeof(*options));
+}
+
+/******************************************************************************/
+void Polaris_GetLowLatencySocketOptions(PolarisSocketOptions_t* options) {
+  Polaris_GetDefaultSocketOptions(options);
+  options->no_delay = 1;
+  options->keepalive = 1;
+  options->keepalive_idle_sec = 5;
+  options->keepalive_interval_sec = 2;
+  options->keepalive_count = 3;
+  options->user_timeout_ms = 10000;
+}
+
+/******************************************************************************/
+void Polaris_SetSocketOptions(PolarisContext_t* context,
+                              const PolarisSocketOptions_t* options) {
+  context->socket_options = *options;
+}
+
+/******************************************************************************/
+void Polaris_SetHTTPKeepAlive(PolarisContext_t* context, int enabled) {
+  context->http_keep_alive = enabled ? 1 : 0;
+  if (!context->http_keep_alive && context->http_connection_open) {
+    P1_PrintDebug("Closing idle HTTP connection.");
+    CloseSocket(context, 1);
+  }
+}
+
+/******************************************************************************/
+int Polaris_IsTLSSessionResumed(const PolarisContext_t* context) {
+  return context->tls_session_resumed;
+}
+
+/******************************************************************************/
+void Polaris_GetStats(const PolarisContext_t* context, PolarisStats_t* stats) {
+  *stats = context->stats;
+}
+
+/******************************************************************************/
+void Polaris_GetReadIntervalHistogram(const PolarisContext_t* context,
+                                      PolarisHistogram_t* histogram) {
+  *histogram = context->read_interval_histogram;
+}
+
+/******************************************************************************/
+void Polaris_GetCallbackDurationHistogram(const PolarisContext_t* context,
+                                          PolarisHistogram_t* histogram) {
+  *histogram = context->callback_duration_histogram;
+}
+
+/******************************************************************************/
+void Polaris_ResetHistograms(PolarisContext_t* context) {
+  Polaris_HistogramReset(&context->read_interval_histogram);
+  Polaris_HistogramReset(&context->callback_duration_histogram);
+}
+
+/******************************************************************************/
+int Polaris_SetCorrectionAgeMonitor(PolarisContext_t* context, int enabled) {
+#ifdef P1_FREERTOS
+  if (enabled) {
+    P1_PrintError("Correction age monitoring not supported on FreeRTOS.");
+    return POLARIS_ERROR;
+  } else {
+    return POLARIS_SUCCESS;
+  }
+#else
+  if (enabled && !context->correction_age_enabled) {
+    ResetCorrectionAge(context);
+  }
+  context->correction_age_enabled = enabled ? 1 : 0;
+  return POLARIS_SUCCESS;
+#endif
+}
+
+/******************************************************************************/
+void Polaris_SetLeapSeconds(PolarisContext_t* context, int leap_seconds) {
+  context->leap_seconds = (int8_t)leap_seconds;
+}
+
+/******************************************************************************/
+void Polaris_GetCorrectionAge(const PolarisContext_t* context,
+                              PolarisCorrectionAge_t* age) {
+  *age = context->correction_age;
+
+  // The ring buffer is filled from the start, so if it is not full yet, the
+  // valid entries are at the front.
+  age->window_count =
+      age->epoch_count < POLARIS_CORRECTION_AGE_WINDOW_SIZE
+          ? age->epoch_count
+          : POLARIS_CORRECTION_AGE_WINDOW_SIZE;
+  age->window_min_age_ms = 0;
+  age->window_max_age_ms = 0;
+  age->window_mean_age_ms = 0;
+  if (age->window_count == 0) {
+    return;
+  }
+
+  int64_t sum_ms = 0;
+  age->window_min_age_ms = INT32_MAX;
+  age->window_max_age_ms = INT32_MIN;
+  for (uint32_t i = 0; i < age->window_count; ++i) {
+    int32_t age_ms = context->correction_ages_ms[i];
+    sum_ms += age_ms;
+    if (age_ms < age->window_min_age_ms) {
+      age->window_min_age_ms = age_ms;
+    }
+    if (age_ms > age->window_max_age_ms) {
+      age->window_max_age_ms = age_ms;
+    }
+  }
+  age->window_mean_age_ms = (int32_t)(sum_ms / (int64_t)age->window_count);
+}
+
+/******************************************************************************/
+void Polaris_SetStallDetection(PolarisContext_t* context, double multiplier,
+                               int min_timeout_ms) {
+  context->stall_multiplier = multiplier > 0.0 ? multiplier : 0.0;
+  context->min_stall_timeout_ms =
+      min_timeout_ms > 0 ? min_timeout_ms : POLARIS_MIN_STALL_TIMEOUT_MS;
+}
+
+/******************************************************************************/
+int Polaris_GetStallTimeout(const PolarisContext_t* context) {
+  if (context->stall_multiplier <= 0.0 ||
+      context->read_gap_count < POLARIS_STALL_WINDOW_SIZE) {
+    return -1;
+  }
+
+  // Data typically arrives in bursts (one per epoch) spread across several
+  // reads, so we use the longest recent interval as the stream period rather
+  // than the average.
+  uint32_t period_ms = 0;
+  for (size_t i = 0; i < POLARIS_STALL_WINDOW_SIZE; ++i) {
+    if (context->read_gaps_ms[i] > period_ms) {
+      period_ms = context->read_gaps_ms[i];
+    }
+  }
+
+  double timeout_ms = period_ms * context->stall_multiplier;
+  if (timeout_ms < context->min_stall_timeout_ms) {
+    return context->min_stall_timeout_ms;
+  } else if (timeout_ms > INT32_MAX) {
+    return INT32_MAX;
+  } else {
+    return (int)timeout_ms;
+  }
+}
+
+/******************************************************************************/
+static void SetSocketNonBlocking(PolarisContext_t* context) {
+  // FreeRTOS does not support O_NONBLOCK. Instead, we pass MSG_DONTWAIT to
+  // recv() in ReceiveData() when non-blocking mode is enabled.
+#ifndef P1_FREERTOS
+  int flags = fcntl(context->socket, F_GETFL);
+  if (context->nonblocking) {
+    flags |= O_NONBLOCK;
+  } else {
+    flags &= ~O_NONBLOCK;
+  }
+
+  if (fcntl(context->socket, F_SETFL, flags) < 0) {
+    P1_PrintErrno("Error setting socket blocking mode", -1);
+  }
+#endif  // P1_FREERTOS
+
+  context->poll_events = POLARIS_WANT_READ;
+}
+
+/******************************************************************************/
+static int ReceiveData(PolarisContext_t* context, int nonblocking) {
+  // Send the most recent position or beacon request queued by the application,
+  // if it has changed. If the send fails, the read below will report the
+  // socket error.
+  SendQueuedRequest(context);
+  if (!nonblocking) {
+    int ret = WaitForDataRequest(context);
+    if (ret != POLARIS_SUCCESS) {
+      if (ret == POLARIS_TIMED_OUT) {
+        ++context->stats.receive_timeouts;
+      }
+      return ret;
+    }
+  }
+
+#ifdef POLARIS_USE_TLS
+  P1_RecvSize_t bytes_read =
+      SSL_read(context->ssl, context->recv_buffer, context->recv_buffer_size);
+#else
+  P1_RecvSize_t bytes_read =
+      ReadSocket(context, context->recv_buffer, context->recv_buffer_size,
+                 nonblocking ? MSG_DONTWAIT : 0);
+#endif
+
+#ifdef P1_FREERTOS
+  // FreeRTOS does not use errno for recv() errors, but instead returns the
+  // equivalent error value. On a socket timeout, it returns 0 instead of
+  // ETIMEDOUT.
+  //
+  // We try to mimick the actual POSIX behavior to simplify the code below, so
+  // we set bytes_read to -1 and set errno accordingly.
+  //
+  // Later, we will need to restore them both before calling
+  // P1_PrintReadWriteError(). That function and P1_PrintErrno(), which it calls
+  // if TLS is disabled, expect to be provided the return code, not errno.
+  P1_RecvSize_t original_bytes_read = bytes_read;
   int original_errno = errno;
   if (bytes_read == 0) {
     bytes_read = -1;
@@ -722,6 +1450,33 @@ int Polaris_Work(PolarisContext_t* context) {
   // (POLARIS_RECV_TIMEOUT_MS; typically a few seconds). This is not the same as
   // the longer connection timeout used by Polaris_Run() to decide if the
   // connection was lost upstream (typically 30 seconds or longer).
+  //
+  // In non-blocking mode, there's no timeout: we simply return 0 to indicate
+  // that no data is available right now. For TLS connections, OpenSSL may need
+  // to write to the socket before it can read again (e.g., during
+  // renegotiation), so we tell the caller what to wait for.
+  if (bytes_read < 0 && nonblocking) {
+#ifdef POLARIS_USE_TLS
+    int ssl_error = SSL_get_error(context->ssl, bytes_read);
+    if (ssl_error == SSL_ERROR_WANT_READ) {
+      context->poll_events = POLARIS_WANT_READ;
+      return 0;
+    } else if (ssl_error == SSL_ERROR_WANT_WRITE) {
+      context->poll_events = POLARIS_WANT_WRITE;
+      return 0;
+    } else if (ssl_error == SSL_ERROR_SYSCALL &&
+               (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      context->poll_events = POLARIS_WANT_READ;
+      return 0;
+    }
+#else
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ETIMEDOUT) {
+      context->poll_events = POLARIS_WANT_READ;
+      return 0;
+    }
+#endif
+  }
+
   if (bytes_read < 0) {
 #ifdef POLARIS_USE_TLS
     int ssl_error = SSL_get_error(context->ssl, bytes_read);
@@ -745,6 +1500,7 @@ int Polaris_Work(PolarisContext_t* context) {
                                bytes_read);
       }
 
+      ++context->stats.receive_timeouts;
       return POLARIS_TIMED_OUT;
     }
   }
@@ -798,9 +1554,11 @@ int Polaris_Work(PolarisContext_t* context) {
     // 2. The authentication token was rejected and socket was closed remotely
     //
     // Note that in general for case (2), we do expect the server to send an
-    // RTCM 1029 message indicating the reason for failure. That would be
-    // handled as "data received but not authenticated" (authenticated == 0),
-    // followed by EINTR or a similar condition above. total_bytes_received will
+    // RTCM 1029 message indicating the reason for failure. That is detected
+    // below when the message arrives, and we return POLARIS_AUTH_REJECTED
+    // without waiting for the socket to close. If the socket is closed before
+    // the complete 1029 message arrives, it will be handled as "data received
+    // but not authenticated" (authenticated == 0). total_bytes_received will
     // not be 0.
     //
     // Similarly, if we received something from the server but no position or
@@ -809,10 +1567,10 @@ int Polaris_Work(PolarisContext_t* context) {
     // not authenticated" (authenticated == 0).
     int ret = POLARIS_CONNECTION_CLOSED;
     if (context->authenticated == POLARIS_AUTHENTICATED) {
-      // Note that currently, we only declare authenticated == 1 after we
-      // receive enough data to confirm we did not get an error 1029 response,
-      // so we do not expect to get here if the user did not send either a
-      // position or base station request.
+      // Note that we only declare authenticated == 1 after we receive a
+      // complete RTCM message other than an error 1029 response, so we do not
+      // expect to get here if the user did not send either a position or base
+      // station request.
       //
       // No warning needed. If there was a socket error, we'll have printed a
       // warning above.
@@ -845,35 +1603,120 @@ int Polaris_Work(PolarisContext_t* context) {
           "request issued.");
     }
 
+    // Note: Connections closed by the user are counted by Polaris_Disconnect().
+    if (!context->disconnected) {
+      if (ret == POLARIS_FORBIDDEN) {
+        ++context->stats.closed_on_auth_rejected;
+      } else if (bytes_read == 0) {
+        ++context->stats.closed_remotely;
+      } else {
+        ++context->stats.closed_on_error;
+      }
+    }
+
+#ifdef POLARIS_USE_TLS
+    // If the connection was reset or the TLS session failed, we can't send a
+    // TLS close notification. Trying to do so may raise SIGPIPE.
+    int ssl_error = SSL_get_error(context->ssl, bytes_read);
+    if (ssl_error == SSL_ERROR_SYSCALL || ssl_error == SSL_ERROR_SSL) {
+      SSL_set_quiet_shutdown(context->ssl, 1);
+    }
+#endif
+
     CloseSocket(context, 1);
     return ret;
   } else {
+    // In batched mode, pick up anything else that has already arrived so we
+    // can dispatch it all at once.
+    if (context->batched_reads) {
+      bytes_read += DrainSocket(context, (size_t)bytes_read);
+    }
+
+    context->poll_events = POLARIS_WANT_READ;
+
+    int64_t read_time_ns =
+        context->rtcm_timestamped_callback || context->correction_age_enabled
+            ? P1_GetCurrentTimeNS()
+            : 0;
+    context->current_receive_time_ns = context->kernel_receive_time_ns != 0
+                                           ? context->kernel_receive_time_ns
+                                           : read_time_ns;
+
+    uint64_t now_ms = GetCurrentTimeMS();
+    if (context->total_bytes_received == 0) {
+      context->stats.first_byte_time_ms = now_ms;
+    }
+    context->stats.last_byte_time_ms = now_ms;
+    context->stats.bytes_received += bytes_read;
+    ++context->stats.reads;
+
+    uint64_t now_us = P1_GetMonotonicTimeUS();
+    if (context->last_read_time_us != 0) {
+      uint64_t interval_us = now_us - context->last_read_time_us;
+      RecordDuration(&context->read_interval_histogram, interval_us);
+
+      uint64_t interval_ms = interval_us / 1000;
+      context->read_gaps_ms[context->read_gap_count %
+                            POLARIS_STALL_WINDOW_SIZE] =
+          interval_ms > UINT32_MAX ? UINT32_MAX : (uint32_t)interval_ms;
+      ++context->read_gap_count;
+    }
+    context->last_read_time_us = now_us;
+
     context->total_bytes_received += bytes_read;
     P1_PrintDebug("Received %u bytes. [%" PRIu64 " bytes total]",
                   (unsigned)bytes_read,
                   (uint64_t)context->total_bytes_received);
     P1_PrintData(context->recv_buffer, bytes_read);
 
+    // Forward the data block along as is.
     // We do not consider the connection authenticated (auth token valid and
-    // accepted by the network) until after we begin receiving data. It the auth
-    // token is rejected, the network may respond with an RTCM 1029 text message
-    // indicating the reason. However, we do not currently parse the incoming
-    // RTCM stream, so instead we simply wait until we've received more than the
-    // maximum 1029 message size.
+    // accepted by the network) until after we begin receiving data. If the
+    // auth token is rejected, the network responds with an RTCM 1029 text
+    // message indicating the reason, so we decode the incoming RTCM stream
+    // until the token is accepted or rejected (see HandleRTCMFrame()) before
+    // delivering the data. Once rejected, we stop and do not deliver anything
+    // else received on the connection.
     //
     // If the user never sends a position or beacon request to the network, no
     // data will be received. That does not necessarily imply an authentication
     // failure.
-    if (!context->authenticated && context->total_bytes_received > 270) {
-      P1_PrintDebug("Sufficient data received. Authentication token accepted.");
-      context->authenticated = POLARIS_AUTHENTICATED;
+    const int auth_pending =
+        context->authenticated == POLARIS_NOT_AUTHENTICATED;
+    if (auth_pending) {
+      Polaris_RTCMFramerProcess(&context->rtcm_framer, context->recv_buffer,
+                                bytes_read, &HandleRTCMFrame, context);
+      if (context->authenticated == POLARIS_AUTHENTICATION_REJECTED) {
+        ++context->stats.closed_on_auth_rejected;
+        CloseSocket(context, 1);
+        return POLARIS_AUTH_REJECTED;
+      }
     }
 
-    // We don't interpret the incoming RTCM data, so there's no need to buffer
-    // it up to a complete RTCM frame. We'll just forward what we got along.
     if (context->rtcm_callback) {
+      ++context->stats.callbacks;
+      uint64_t callback_start_us = P1_GetMonotonicTimeUS();
       context->rtcm_callback(context->rtcm_callback_info, context,
                              context->recv_buffer, bytes_read);
+      RecordDuration(&context->callback_duration_histogram,
+                     P1_GetMonotonicTimeUS() - callback_start_us);
+    }
+
+    if (context->rtcm_timestamped_callback) {
+      PolarisReceiveTime_t receive_time;
+      receive_time.kernel_time_ns = context->kernel_receive_time_ns;
+      receive_time.read_time_ns = read_time_ns;
+      context->rtcm_timestamped_callback(
+          context->rtcm_timestamped_callback_info, context,
+          context->recv_buffer, bytes_read, &receive_time);
+    }
+
+    // After the token is accepted, we only need to frame the data if the user
+    // asked for it.
+    if (!auth_pending &&
+        (context->rtcm_frame_callback || context->correction_age_enabled)) {
+      Polaris_RTCMFramerProcess(&context->rtcm_framer, context->recv_buffer,
+                                bytes_read, &HandleRTCMFrame, context);
     }
 
     if (context->disconnected) {
@@ -886,140 +1729,561 @@ int Polaris_Work(PolarisContext_t* context) {
 }
 
 /******************************************************************************/
-int Polaris_Run(PolarisContext_t* context, int connection_timeout_ms) {
-  // The following should be unlikely to happen, but we call CloseSocket() just
-  // in case this function is called after Polaris_Disconnect() to clean up the
-  // SSL session.
-  if (context->disconnected) {
-    P1_PrintDebug("Connection terminated by user request.");
-    CloseSocket(context, 1);
-    return POLARIS_SUCCESS;
-  } else if (context->socket == P1_INVALID_SOCKET) {
-    P1_PrintError("Error: Polaris connection not currently open.");
-    CloseSocket(context, 1);
-    return POLARIS_SOCKET_ERROR;
-  }
-
-  P1_PrintDebug("Listening for data.");
-
-  P1_TimeValue_t last_read_time;
-  P1_GetCurrentTime(&last_read_time);
-
-  int ret = POLARIS_ERROR;
-  while (1) {
-    // Read the next data block.
-    ret = Polaris_Work(context);
-
-    // Check if the read timed out. This can happen if the client briefly loses
-    // cell coverage, etc., so we do not consider short gaps an error. See if
-    // we've hit the longer connection timeout and, if so, close the connection.
-    // Otherwise, try again.
+static size_t DrainSocket(PolarisContext_t* context, size_t offset_bytes) {
+  // Read until the socket has no more data, or the buffer is full. Any error or
+  // remote shutdown here is left for the next call to ReceiveData() to report,
+  // so the data we already have is delivered first.
+  size_t total_bytes = offset_bytes;
+  while (total_bytes < context->recv_buffer_size) {
+#ifdef POLARIS_USE_TLS
+    // With read-ahead enabled, OpenSSL has already pulled everything available
+    // off the socket in a single read. Stop once its buffer is empty rather
+    // than going back to the socket.
     //
-    // We treat 0 bytes as a read timeout condition just to be safe, but in
-    // practice Polaris_Work() should handle all timeout, error, and connection
-    // closed conditions and this should not happen.
-    if (ret == POLARIS_TIMED_OUT || ret == 0) {
-      P1_TimeValue_t current_time;
-      P1_GetCurrentTime(&current_time);
-      int elapsed_ms = P1_GetElapsedMS(&last_read_time, &current_time);
-      P1_PrintDebug("%d ms elapsed since last data arrived.", elapsed_ms);
-      if (elapsed_ms >= connection_timeout_ms) {
-        P1_PrintWarning("Warning: Connection timed out after %d ms.",
-                        elapsed_ms);
-        CloseSocket(context, 1);
-        ret = POLARIS_TIMED_OUT;
-        break;
-      }
-    }
-    // If an error occurred or the connection was terminated, break. The socket
-    // will have already been closed and a debug message printed by
-    // Polaris_Work().
-    else if (ret < 0) {
+    // Note that the buffered data may end with a partial TLS record. In
+    // blocking mode, SSL_read() will wait for the remainder, which is normally
+    // already in flight as part of the same burst, up to the socket receive
+    // timeout.
+#  if OPENSSL_VERSION_NUMBER < 0x10100000L
+    if (SSL_pending(context->ssl) <= 0) {
+#  else
+    if (!SSL_has_pending(context->ssl)) {
+#  endif
       break;
     }
-    // Data received and dispatched to the callback.
-    else {
-      P1_GetCurrentTime(&last_read_time);
 
-      if (context->disconnected) {
-        P1_PrintDebug("Connection terminated by user.");
-        CloseSocket(context, 1);
-        ret = POLARIS_SUCCESS;
-        break;
-      }
+    P1_RecvSize_t bytes_read =
+        SSL_read(context->ssl, context->recv_buffer + total_bytes,
+                 context->recv_buffer_size - total_bytes);
+#else
+    P1_RecvSize_t bytes_read =
+        ReadSocket(context, context->recv_buffer + total_bytes,
+                   context->recv_buffer_size - total_bytes, MSG_DONTWAIT);
+#endif
+
+    if (bytes_read <= 0) {
+      break;
+    } else {
+      total_bytes += (size_t)bytes_read;
     }
   }
 
-  P1_PrintDebug("Received %" PRIu64 " total bytes.",
-                (uint64_t)context->total_bytes_received);
-  if (ret == POLARIS_CONNECTION_CLOSED && context->disconnected) {
-    return POLARIS_SUCCESS;
-  } else {
-    return ret;
-  }
+  return total_bytes - offset_bytes;
 }
 
+#if !defined(POLARIS_USE_TLS) || POLARIS_KERNEL_TIMESTAMPS_SUPPORTED
 /******************************************************************************/
-static int ValidateUniqueID(const char* unique_id) {
-  size_t length = unique_id == NULL ? 0 : strlen(unique_id);
-  if (length == 0) {
-    // Unique IDs are optional (but recommended). If unspecified, an ID will be
-    // autogenerated on the back end.
-    return POLARIS_SUCCESS;
-  } else if (length > POLARIS_MAX_UNIQUE_ID_SIZE) {
-    P1_PrintError("Unique ID must be a maximum of %d characters. [id='%s']",
-                  POLARIS_MAX_UNIQUE_ID_SIZE, unique_id);
-    return POLARIS_ERROR;
-  } else {
-    for (const char* ptr = unique_id; *ptr != '\0'; ++ptr) {
-      char c = *ptr;
-      if (c != '-' && c != '_' && (c < 'A' || c > 'Z') &&
-          (c < 'a' || c > 'z') && (c < '0' || c > '9')) {
-        P1_PrintError("Invalid unique ID specified. [id='%s']", unique_id);
-        return POLARIS_ERROR;
+static P1_RecvSize_t ReadSocket(PolarisContext_t* context, void* buffer,
+                                size_t size_bytes, int flags) {
+#  if POLARIS_KERNEL_TIMESTAMPS_SUPPORTED
+  if (context->kernel_timestamps) {
+    struct iovec iov;
+    iov.iov_base = buffer;
+    iov.iov_len = size_bytes;
+
+    union {
+      char buffer[CMSG_SPACE(sizeof(struct timespec))];
+      struct cmsghdr align;
+    } control;
+
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    P1_RecvSize_t bytes_read = recvmsg(context->socket, &message, flags);
+    if (bytes_read > 0) {
+      // For TCP, the timestamp is that of the most recent packet whose data
+      // was returned by this read.
+      for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL;
+           cmsg = CMSG_NXTHDR(&message, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET &&
+            cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+          struct timespec timestamp;
+          memcpy(&timestamp, CMSG_DATA(cmsg), sizeof(timestamp));
+          context->kernel_receive_time_ns =
+              ((int64_t)timestamp.tv_sec * 1000000000) + timestamp.tv_nsec;
+        }
       }
     }
 
-    return POLARIS_SUCCESS;
+    return bytes_read;
   }
+#  endif
+
+  return recv(context->socket, buffer, size_bytes, flags);
 }
+#endif
 
 /******************************************************************************/
-#ifdef P1_FREERTOS
-static inline int P1_SetAddress(const char* hostname, int port,
-                                P1_SocketAddrV4_t* result) {
-  uint32_t ip = FreeRTOS_gethostbyname(hostname);
-  if (ip == 0) {
-    return -1;
-  } else {
-    result->sin_family = AF_INET;
-    result->sin_port = FreeRTOS_htons(port);
-    result->sin_addr = ip;
-    return 0;
-  }
-}
+static size_t EncodeECEFPosition(void* buffer, double x_m, double y_m,
+                                 double z_m) {
+  PolarisHeader_t* header = Polaris_PopulateHeader(
+      buffer, POLARIS_ID_ECEF, sizeof(PolarisECEFMessage_t));
+  PolarisECEFMessage_t* payload = (PolarisECEFMessage_t*)(header + 1);
+  payload->x_cm = htole32((int32_t)(x_m * 1e2));
+  payload->y_cm = htole32((int32_t)(y_m * 1e2));
+  payload->z_cm = htole32((int32_t)(z_m * 1e2));
+  return Polaris_PopulateChecksum(buffer);
+}
+
+/******************************************************************************/
+static size_t EncodeLLAPosition(void* buffer, double latitude_deg,
+                                double longitude_deg, double altitude_m) {
+  PolarisHeader_t* header = Polaris_PopulateHeader(
+      buffer, POLARIS_ID_LLA, sizeof(PolarisLLAMessage_t));
+  PolarisLLAMessage_t* payload = (PolarisLLAMessage_t*)(header + 1);
+  payload->latitude_dege7 = htole32((int32_t)(latitude_deg * 1e7));
+  payload->longitude_dege7 = htole32((int32_t)(longitude_deg * 1e7));
+  payload->altitude_mm = htole32((int32_t)(altitude_m * 1e3));
+  return Polaris_PopulateChecksum(buffer);
+}
+
+/******************************************************************************/
+static size_t EncodeBeaconRequest(void* buffer, const char* beacon_id) {
+  size_t id_length = strlen(beacon_id);
+  if (id_length > POLARIS_SEND_BUFFER_SIZE - sizeof(PolarisHeader_t) -
+                      sizeof(PolarisChecksum_t)) {
+    return 0;
+  }
+
+  PolarisHeader_t* header =
+      Polaris_PopulateHeader(buffer, POLARIS_ID_BEACON, id_length);
+  memmove(header + 1, beacon_id, id_length);
+  return Polaris_PopulateChecksum(buffer);
+}
+
+/******************************************************************************/
+static int WriteRequestData(PolarisContext_t* context, const uint8_t* buffer,
+                            size_t size_bytes) {
+  // In non-blocking mode, the socket may not be able to take the request right
+  // now. Rather than treating that as an error, we return 0 and record what to
+  // wait for. For TLS connections, OpenSSL may also need to read before it can
+  // write (e.g., during renegotiation).
+#ifdef POLARIS_USE_TLS
+  int ret = SSL_write(context->ssl, buffer, (int)size_bytes);
+  if (ret > 0) {
+    return ret;
+  }
+
+  int ssl_error = SSL_get_error(context->ssl, ret);
+  if (ssl_error == SSL_ERROR_WANT_WRITE ||
+      (ssl_error == SSL_ERROR_SYSCALL &&
+       (errno == EAGAIN || errno == EWOULDBLOCK))) {
+    context->pending_poll_events = POLARIS_WANT_WRITE;
+    return 0;
+  } else if (ssl_error == SSL_ERROR_WANT_READ) {
+    context->pending_poll_events = POLARIS_WANT_READ;
+    return 0;
+  }
+#else
+  int ret = (int)send(context->socket, buffer, size_bytes, P1_SEND_FLAGS);
+  if (ret > 0) {
+    return ret;
+  } else if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    context->pending_poll_events = POLARIS_WANT_WRITE;
+    return 0;
+  }
+#endif
+
+  P1_PrintReadWriteError(context, "Error sending position/beacon request", ret);
+  return POLARIS_SEND_ERROR;
+}
+
+/******************************************************************************/
+static void ClearPendingRequest(PolarisContext_t* context) {
+  context->pending_request_size = 0;
+  context->pending_request_offset = 0;
+  context->pending_poll_events = 0;
+}
+
+/******************************************************************************/
+static int FlushPendingRequest(PolarisContext_t* context) {
+  if (context->pending_request_size == 0) {
+    return POLARIS_SUCCESS;
+  }
+
+  // Note: OpenSSL requires a write that could not be completed to be retried
+  // with the same data. The TLS connection is configured to accept the data
+  // from the new position in the buffer, and to report partial writes.
+  while (context->pending_request_offset < context->pending_request_size) {
+    int ret = WriteRequestData(
+        context,
+        context->pending_request_buffer + context->pending_request_offset,
+        context->pending_request_size - context->pending_request_offset);
+    if (ret < 0) {
+      ClearPendingRequest(context);
+      return ret;
+    } else if (ret == 0) {
+      return POLARIS_WOULD_BLOCK;
+    } else {
+      context->pending_request_offset += (uint32_t)ret;
+    }
+  }
+
+  P1_PrintDebug("Sent pending request. [size=%u B]",
+                (unsigned)context->pending_request_size);
+  context->data_request_sent = 1;
+  context->stats.bytes_sent += context->pending_request_size;
+  ++context->stats.requests_sent;
+  ClearPendingRequest(context);
+  return POLARIS_SUCCESS;
+}
+
+/******************************************************************************/
+static int SendRequest(PolarisContext_t* context, const void* buffer,
+                       size_t size_bytes) {
+  P1_PrintData((const uint8_t*)buffer, size_bytes);
+
+  // A request that has been partially sent must be finished before anything
+  // else is sent. If it still can't be, replace any queued request with this
+  // one so it is sent afterward.
+  int ret = FlushPendingRequest(context);
+  if (ret == POLARIS_WOULD_BLOCK) {
+    P1_PrintDebug("Previous request not sent yet. Queueing request.");
+    QueueRequest(context, buffer, size_bytes);
+    return POLARIS_WOULD_BLOCK;
+  } else if (ret != POLARIS_SUCCESS) {
+    return ret;
+  }
+
+  size_t offset_bytes = 0;
+  while (offset_bytes < size_bytes) {
+    ret = WriteRequestData(context, (const uint8_t*)buffer + offset_bytes,
+                           size_bytes - offset_bytes);
+    if (ret < 0) {
+      return ret;
+    } else if (ret == 0) {
+      // Keep the request, and send the rest of it once the socket is ready.
+      P1_PrintDebug(
+          "Socket not ready. Request will be sent later. [sent=%u/%u B]",
+          (unsigned)offset_bytes, (unsigned)size_bytes);
+      memcpy(context->pending_request_buffer, buffer, size_bytes);
+      context->pending_request_size = (uint32_t)size_bytes;
+      context->pending_request_offset = (uint32_t)offset_bytes;
+      return POLARIS_WOULD_BLOCK;
+    } else {
+      offset_bytes += (size_t)ret;
+    }
+  }
+
+  context->data_request_sent = 1;
+  context->stats.bytes_sent += size_bytes;
+  ++context->stats.requests_sent;
+  return POLARIS_SUCCESS;
+}
+
+/******************************************************************************/
+static void QueueRequest(PolarisContext_t* context, const void* buffer,
+                         size_t size_bytes) {
+  // The queued request is protected by a sequence lock. The sequence number is
+  // odd while a write is in progress: writers claim the slot by incrementing
+  // it, and publish the new request by incrementing it again when finished.
+  // The I/O thread never blocks writers. If it sees an odd or changed sequence
+  // number, it simply tries again on its next pass.
+  uint32_t sequence;
+  while (1) {
+    sequence = __atomic_load_n(&context->request_sequence, __ATOMIC_RELAXED);
+    if ((sequence & 1) == 0 &&
+        __atomic_compare_exchange_n(&context->request_sequence, &sequence,
+                                    sequence + 1, 0, __ATOMIC_ACQUIRE,
+                                    __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  // Note: The request is copied with relaxed atomic stores so that concurrent
+  // reads by SendQueuedRequest() are well-defined. They will be discarded if
+  // torn.
+  for (size_t i = 0; i < size_bytes; ++i) {
+    __atomic_store_n(&context->request_buffer[i], ((const uint8_t*)buffer)[i],
+                     __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&context->request_size, (uint32_t)size_bytes,
+                   __ATOMIC_RELAXED);
+
+  __atomic_store_n(&context->request_sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************/
+static int SendQueuedRequest(PolarisContext_t* context) {
+  // Finish sending any request that could not be sent earlier first.
+  int ret = FlushPendingRequest(context);
+  if (ret != POLARIS_SUCCESS) {
+    return ret;
+  }
+
+  uint32_t sequence =
+      __atomic_load_n(&context->request_sequence, __ATOMIC_ACQUIRE);
+  if ((sequence & 1) != 0 || sequence == context->request_sent_sequence) {
+    return POLARIS_SUCCESS;
+  }
+
+  // Copy the request out before sending it, then make sure it was not modified
+  // while we were reading. If it was, we'll pick up the new request next time.
+  uint8_t buffer[POLARIS_SEND_BUFFER_SIZE] __attribute__((aligned(4)));
+  uint32_t size_bytes =
+      __atomic_load_n(&context->request_size, __ATOMIC_RELAXED);
+  if (size_bytes > sizeof(buffer)) {
+    size_bytes = sizeof(buffer);
+  }
+  for (uint32_t i = 0; i < size_bytes; ++i) {
+    buffer[i] = __atomic_load_n(&context->request_buffer[i], __ATOMIC_RELAXED);
+  }
+
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&context->request_sequence, __ATOMIC_RELAXED) !=
+      sequence) {
+    return POLARIS_SUCCESS;
+  }
+
+  if (size_bytes == 0) {
+    context->request_sent_sequence = sequence;
+    return POLARIS_SUCCESS;
+  }
+
+  P1_PrintDebug("Sending queued request. [size=%u B]", (unsigned)size_bytes);
+  ret = SendRequest(context, buffer, size_bytes);
+  if (ret == POLARIS_SUCCESS || ret == POLARIS_WOULD_BLOCK) {
+    context->request_sent_sequence = sequence;
+  }
+
+  return ret;
+}
+
+/******************************************************************************/
+static int WaitForDataRequest(PolarisContext_t* context) {
+  // The server will not send any data until a position or beacon request has
+  // been sent. Rather than blocking in recv() for the full receive timeout
+  // while the application queues its first request, wait in short slices and
+  // check for a queued request between each one (see WaitForData()).
+  if (context->data_request_sent) {
+    return POLARIS_SUCCESS;
+  }
+
+  int ret = WaitForData(context, POLARIS_RECV_TIMEOUT_MS);
+  if (ret == POLARIS_TIMED_OUT) {
+    P1_PrintWarning("Warning: Socket read timed out.");
+  }
+  return ret;
+}
+
+/******************************************************************************/
+static int WaitForData(PolarisContext_t* context, int timeout_ms) {
+  // FreeRTOS sockets do not support poll(). There, we rely on the socket
+  // receive timeout, and any queued request will be sent on the next read.
+#ifdef P1_FREERTOS
+  (void)context;
+  (void)timeout_ms;
 #else
+  uint64_t deadline_us = P1_GetMonotonicTimeUS() + (uint64_t)timeout_ms * 1000;
+  while (!context->disconnected) {
+#  ifdef POLARIS_USE_TLS
+    // OpenSSL may already have data buffered that poll() cannot see: either
+    // decrypted application data, or raw records pulled into its read-ahead
+    // buffer by an earlier read.
+#    if OPENSSL_VERSION_NUMBER < 0x10100000L
+    if (SSL_pending(context->ssl) > 0) {
+#    else
+    if (SSL_has_pending(context->ssl)) {
+#    endif
+      break;
+    }
+#  endif
+
+    uint64_t now_us = P1_GetMonotonicTimeUS();
+    if (now_us >= deadline_us) {
+      return POLARIS_TIMED_OUT;
+    }
+
+    // Until the first request has been sent, wake up periodically to check for
+    // a request queued by another thread.
+    uint64_t wait_ms = (deadline_us - now_us + 999) / 1000;
+    if (!context->data_request_sent &&
+        wait_ms > POLARIS_REQUEST_POLL_INTERVAL_MS) {
+      wait_ms = POLARIS_REQUEST_POLL_INTERVAL_MS;
+    }
+
+    struct pollfd poll_fd;
+    poll_fd.fd = context->socket;
+    poll_fd.events = POLLIN;
+    poll_fd.revents = 0;
+    int ret = poll(&poll_fd, 1, (int)wait_ms);
+    if (ret != 0) {
+      // Data available, socket error, or interrupted: let the read report it.
+      break;
+    }
+
+    // If the send fails, the read will report the socket error.
+    if (!context->data_request_sent &&
+        SendQueuedRequest(context) != POLARIS_SUCCESS) {
+      break;
+    }
+  }
+#endif  // P1_FREERTOS
+
+  return POLARIS_SUCCESS;
+}
+
+/******************************************************************************/
+static uint64_t GetCurrentTimeMS(void) {
+  P1_TimeValue_t now;
+  P1_GetCurrentTime(&now);
+  return P1_GetTimeMS(&now);
+}
+
+/******************************************************************************/
+static void RecordDuration(PolarisHistogram_t* histogram,
+                           uint64_t duration_us) {
+  Polaris_HistogramRecord(histogram, duration_us > UINT32_MAX
+                                         ? UINT32_MAX
+                                         : (uint32_t)duration_us);
+}
+
+/******************************************************************************/
+int Polaris_Run(PolarisContext_t* context, int connection_timeout_ms) {
+  // The following should be unlikely to happen, but we call CloseSocket() just
+  // in case this function is called after Polaris_Disconnect() to clean up the
+  // SSL session.
+  if (context->disconnected) {
+    P1_PrintDebug("Connection terminated by user request.");
+    CloseSocket(context, 1);
+    return POLARIS_SUCCESS;
+  } else if (context->socket == P1_INVALID_SOCKET) {
+    P1_PrintError("Error: Polaris connection not currently open.");
+    CloseSocket(context, 1);
+    return POLARIS_SOCKET_ERROR;
+  }
+
+  P1_PrintDebug("Listening for data.");
+
+  uint64_t start_time_us = P1_GetMonotonicTimeUS();
+
+  int ret = POLARIS_ERROR;
+  while (1) {
+    // Check how long it has been since data last arrived. Short gaps can happen
+    // if the client briefly loses cell coverage, etc., so we do not consider
+    // them an error. See if we've hit the longer connection timeout, or the
+    // adaptive stall timeout once data is flowing, and if so, close the
+    // connection.
+    uint64_t last_data_time_us = start_time_us;
+    int timeout_ms = connection_timeout_ms;
+    int stall_timeout_ms = -1;
+    if (context->last_read_time_us > start_time_us) {
+      last_data_time_us = context->last_read_time_us;
+      stall_timeout_ms = Polaris_GetStallTimeout(context);
+      if (stall_timeout_ms > 0 && stall_timeout_ms < timeout_ms) {
+        timeout_ms = stall_timeout_ms;
+      }
+    }
+
+    int elapsed_ms =
+        (int)((P1_GetMonotonicTimeUS() - last_data_time_us) / 1000);
+    if (elapsed_ms >= timeout_ms) {
+      if (timeout_ms == stall_timeout_ms) {
+        P1_PrintWarning("Warning: Data stream stalled after %d ms.",
+                        elapsed_ms);
+        ++context->stats.closed_on_stall;
+      } else {
+        P1_PrintWarning("Warning: Connection timed out after %d ms.",
+                        elapsed_ms);
+      }
+      ++context->stats.closed_on_timeout;
+      CloseSocket(context, 1);
+      ret = POLARIS_TIMED_OUT;
+      break;
+    }
+
+    // Wait for data until the deadline, rather than relying on the socket
+    // receive timeout, so a lost connection is detected promptly.
+#ifndef P1_FREERTOS
+    int wait_ms = timeout_ms - elapsed_ms;
+    if (wait_ms > POLARIS_RECV_TIMEOUT_MS) {
+      wait_ms = POLARIS_RECV_TIMEOUT_MS;
+    }
+
+    if (WaitForData(context, wait_ms) == POLARIS_TIMED_OUT) {
+      if (wait_ms == POLARIS_RECV_TIMEOUT_MS) {
+        P1_PrintWarning("Warning: Socket read timed out.");
+        ++context->stats.receive_timeouts;
+      }
+      P1_PrintDebug("%d ms elapsed since last data arrived.",
+                    elapsed_ms + wait_ms);
+      continue;
+    }
+#endif
+
+    // Read the next data block.
+    ret = Polaris_Work(context);
+
+    // We treat 0 bytes as a read timeout condition just to be safe, but in
+    // practice Polaris_Work() should handle all timeout, error, and connection
+    // closed conditions and this should not happen.
+    if (ret == POLARIS_TIMED_OUT || ret == 0) {
+      continue;
+    }
+    // If an error occurred or the connection was terminated, break. The socket
+    // will have already been closed and a debug message printed by
+    // Polaris_Work().
+    else if (ret < 0) {
+      break;
+    }
+    // Data received and dispatched to the callback.
+    else if (context->disconnected) {
+      P1_PrintDebug("Connection terminated by user.");
+      CloseSocket(context, 1);
+      ret = POLARIS_SUCCESS;
+      break;
+    }
+  }
+
+  P1_PrintDebug("Received %" PRIu64 " total bytes.",
+                (uint64_t)context->total_bytes_received);
+  if (ret == POLARIS_CONNECTION_CLOSED && context->disconnected) {
+    return POLARIS_SUCCESS;
+  } else {
+    return ret;
+  }
+}
+
+/******************************************************************************/
+static int ValidateUniqueID(const char* unique_id) {
+  size_t length = unique_id == NULL ? 0 : strlen(unique_id);
+  if (length == 0) {
+    // Unique IDs are optional (but recommended). If unspecified, an ID will be
+    // autogenerated on the back end.
+    return POLARIS_SUCCESS;
+  } else if (length > POLARIS_MAX_UNIQUE_ID_SIZE) {
+    P1_PrintError("Unique ID must be a maximum of %d characters. [id='%s']",
+                  POLARIS_MAX_UNIQUE_ID_SIZE, unique_id);
+    return POLARIS_ERROR;
+  } else {
+    for (const char* ptr = unique_id; *ptr != '\0'; ++ptr) {
+      char c = *ptr;
+      if (c != '-' && c != '_' && (c < 'A' || c > 'Z') &&
+          (c < 'a' || c > 'z') && (c < '0' || c > '9')) {
+        P1_PrintError("Invalid unique ID specified. [id='%s']", unique_id);
+        return POLARIS_ERROR;
+      }
+    }
+
+    return POLARIS_SUCCESS;
+  }
+}
+
+/******************************************************************************/
+#ifdef P1_FREERTOS
 static inline int P1_SetAddress(const char* hostname, int port,
                                 P1_SocketAddrV4_t* result) {
-  struct hostent* host_info = gethostbyname(hostname);
-  if (host_info == NULL) {
-    P1_PrintError("Unable to resolve \"%s\": %s", hostname, hstrerror(h_errno));
+  uint32_t ip = FreeRTOS_gethostbyname(hostname);
+  if (ip == 0) {
     return -1;
-  }
-  // IPv6 not currently supported by the API.
-  else if (host_info->h_addrtype != AF_INET) {
-    P1_PrintWarning(
-        "Warning: DNS lookup for \"%s\" returned an IPv6 address (not "
-        "supported).",
-        hostname);
-    // Explicitly set h_errno to _something_ (gethostbyname() doesn't touch
-    // h_errno on success).
-    h_errno = NO_RECOVERY;
-    return -2;
   } else {
     result->sin_family = AF_INET;
-    result->sin_port = htons(port);
-    memcpy(&result->sin_addr, host_info->h_addr_list[0], host_info->h_length);
+    result->sin_port = FreeRTOS_htons(port);
+    result->sin_addr = ip;
     return 0;
   }
 }
@@ -1027,38 +2291,43 @@ static inline int P1_SetAddress(const char* hostname, int port,
 
 /******************************************************************************/
 static int OpenSocket(PolarisContext_t* context, const char* endpoint_url,
-                      int endpoint_port) {
+                      int endpoint_port, ConnectTiming_t* timing) {
+  timing->dns_lookup_ms = -1;
+  timing->tcp_connect_ms = -1;
+  timing->tls_handshake_ms = -1;
+
+  // Close an idle HTTP keep-alive connection, if open, before opening a new one.
+  if (context->http_connection_open) {
+    P1_PrintDebug("Closing idle HTTP connection.");
+    CloseSocket(context, 1);
+  }
+
   // Is the connection already open?
   if (context->socket != P1_INVALID_SOCKET) {
     P1_PrintError("Error: socket already open.");
     return POLARIS_ERROR;
   }
 #ifdef POLARIS_USE_TLS
-  else if (context->ssl_ctx != NULL || context->ssl != NULL) {
+  else if (context->ssl != NULL) {
     P1_PrintError("Error: SSL context not freed.");
     return POLARIS_ERROR;
   }
 #endif
 
 #ifdef POLARIS_USE_TLS
-  // Configure TLS.
-  P1_PrintDebug("Configuring TLS context.");
-#  if OPENSSL_VERSION_NUMBER < 0x10100000L
-  context->ssl_ctx = SSL_CTX_new(TLSv1_2_client_method());
-#  else
-  context->ssl_ctx = SSL_CTX_new(TLS_client_method());
-#  endif
-  // we specifically disable older insecure protocols
-  SSL_CTX_set_options(context->ssl_ctx, SSL_OP_NO_SSLv2);
-  SSL_CTX_set_options(context->ssl_ctx, SSL_OP_NO_SSLv3);
-  SSL_CTX_set_options(context->ssl_ctx, SSL_OP_NO_TLSv1);
-
+  // Use the shared TLS context. We keep a reference to it until
+  // Polaris_Free() is called so it is not recreated on every reconnect.
   if (context->ssl_ctx == NULL) {
-    P1_PrintError("SSL context failed to initialize.");
-    return POLARIS_ERROR;
+    context->ssl_ctx = AcquireSSLContext();
+    if (context->ssl_ctx == NULL) {
+      P1_PrintError("SSL context failed to initialize.");
+      return POLARIS_ERROR;
+    }
   }
+  context->tls_session_resumed = 0;
 #endif
 
+#ifdef P1_FREERTOS
   // Open a socket.
   context->socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
   if (context->socket < 0) {
@@ -1067,45 +2336,27 @@ static int OpenSocket(PolarisContext_t* context, const char* endpoint_url,
     return POLARIS_SOCKET_ERROR;
   }
 
-  P1_PrintDebug(
-      "Configuring socket. [socket=%d, read_timeout=%d ms, send_timeout=%d "
-      "ms]",
-      context->socket, POLARIS_RECV_TIMEOUT_MS, POLARIS_SEND_TIMEOUT_MS);
-
-  // Set send/receive timeouts.
-  P1_TimeValue_t timeout;
-  P1_SetTimeMS(POLARIS_RECV_TIMEOUT_MS, &timeout);
-  setsockopt(context->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout,
-             sizeof(timeout));
-  P1_SetTimeMS(POLARIS_SEND_TIMEOUT_MS, &timeout);
-  setsockopt(context->socket, SOL_SOCKET, SO_SNDTIMEO, &timeout,
-             sizeof(timeout));
-
-#ifndef P1_FREERTOS
-  int flags = fcntl(context->socket, F_GETFL);
-  P1_PrintDebug("Socket flags: 0x%08x", flags);
-#endif  // P1_FREERTOS
+  // Note: FreeRTOS uses the receive timeout for connect(), so we must configure
+  // the socket before connecting.
+  ConfigureSocket(context);
 
   // Lookup the IP of the endpoint used for auth requests.
   P1_PrintDebug("Performing DNS lookup for '%s'.", endpoint_url);
+  P1_TimeValue_t start_time;
+  P1_GetCurrentTime(&start_time);
   P1_SocketAddrV4_t address;
   if (P1_SetAddress(endpoint_url, endpoint_port, &address) < 0) {
-#ifdef P1_FREERTOS
     P1_PrintError("Error locating address '%s'.", endpoint_url);
-#else
-    P1_PrintError("Error locating address '%s'. [error=%s (%d)]", endpoint_url,
-                  hstrerror(h_errno), h_errno);
-#endif
     CloseSocket(context, 1);
     return POLARIS_SOCKET_ERROR;
   }
 
+  P1_TimeValue_t lookup_time;
+  P1_GetCurrentTime(&lookup_time);
+  timing->dns_lookup_ms = P1_GetElapsedMS(&start_time, &lookup_time);
+
   // Connect to the server.
-#ifdef P1_FREERTOS
   uint32_t ip_host_endian = ntohl(address.sin_addr);
-#else
-  uint32_t ip_host_endian = ntohl(address.sin_addr.s_addr);
-#endif
   P1_PrintDebug("Connecting to 'tcp://%d.%d.%d.%d:%d'.",
                 (ip_host_endian >> 24) & 0xFF, (ip_host_endian >> 16) & 0xFF,
                 (ip_host_endian >> 8) & 0xFF, ip_host_endian & 0xFF,
@@ -1117,83 +2368,1019 @@ static int OpenSocket(PolarisContext_t* context, const char* endpoint_url,
     CloseSocket(context, 1);
     return POLARIS_SOCKET_ERROR;
   }
+
+  P1_TimeValue_t connect_time;
+  P1_GetCurrentTime(&connect_time);
+  timing->tcp_connect_ms = P1_GetElapsedMS(&lookup_time, &connect_time);
+#else
+  int ret = ConnectToEndpoint(context, endpoint_url, endpoint_port, timing);
+  if (ret != POLARIS_SUCCESS) {
+    CloseSocket(context, 1);
+    return ret;
+  }
+
+  ConfigureSocket(context);
+#endif
   P1_PrintDebug("Connected successfully.");
 
-#ifdef POLARIS_USE_TLS
-  // Create new SSL connection state and attach the socket.
-  P1_PrintDebug("Establishing TLS connection.");
-  context->ssl = SSL_new(context->ssl_ctx);
-  SSL_set_fd(context->ssl, context->socket);
+#ifdef POLARIS_USE_TLS
+  // Create new SSL connection state and attach the socket.
+  P1_PrintDebug("Establishing TLS connection.");
+  P1_TimeValue_t tls_start_time;
+  P1_GetCurrentTime(&tls_start_time);
+  context->ssl = SSL_new(context->ssl_ctx);
+  AttachSocketToTLS(context);
+
+  // In non-blocking mode, a request that could not be written is retried from
+  // the context's own buffer, and may be written in pieces. See
+  // FlushPendingRequest().
+  SSL_set_mode(context->ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                                 SSL_MODE_ENABLE_PARTIAL_WRITE);
+
+  // In batched mode, let OpenSSL read as much as is available from the socket
+  // at once, rather than one TLS record at a time. See DrainSocket().
+  if (context->batched_reads) {
+    SSL_set_read_ahead(context->ssl, 1);
+  }
+
+  // Enable the TLS extension for servers that use SNI, explicitly telling it
+  // the hostname of the remote server.
+  SSL_set_tlsext_host_name(context->ssl, endpoint_url);
+
+  // If we've connected to this endpoint before, try to resume the previous
+  // session to avoid a full handshake.
+  SSL_SESSION* session = GetTLSSession(endpoint_url, endpoint_port);
+  if (session != NULL) {
+    SSL_set_session(context->ssl, session);
+    SSL_SESSION_free(session);
+  }
+
+  // Perform SSL handhshake.
+  ret = SSL_connect(context->ssl);
+  if (ret != 1) {
+    // If the server rejected the handshake, don't try to resume the same
+    // session again.
+    if (session != NULL) {
+      RemoveTLSSession(endpoint_url, endpoint_port);
+    }
+
+#  if !P1_NO_PRINT
+    // Note: We intentionally reuse the receive buffer to store the error
+    // message to be displayed to avoid requiring additional stack here. At this
+    // point we're trying to open the socket, so there should be nobody actively
+    // using the receive buffer.
+    snprintf((char*)context->recv_buffer, context->recv_buffer_size,
+             "TLS handshake failed for tcp://%s:%d", endpoint_url,
+             endpoint_port);
+    P1_PrintSSLError(context, (char*)context->recv_buffer, ret);
+#  endif  // !P1_NO_PRINT
+    CloseSocket(context, 1);
+    return POLARIS_SOCKET_ERROR;
+  }
+
+  const SSL_CIPHER* c = SSL_get_current_cipher(context->ssl);
+  if (c == NULL) {
+    P1_PrintError(
+        "Server failed to negotiate encryption cipher. Verify that endpoint "
+        "tcp://%s:%d supports TLS 1.2 or better.",
+        endpoint_url, endpoint_port);
+    CloseSocket(context, 1);
+    return POLARIS_ERROR;
+  }
+
+  P1_TimeValue_t tls_end_time;
+  P1_GetCurrentTime(&tls_end_time);
+  timing->tls_handshake_ms = P1_GetElapsedMS(&tls_start_time, &tls_end_time);
+
+  context->tls_session_resumed = SSL_session_reused(context->ssl) ? 1 : 0;
+  P1_PrintDebug("Connected with %s encryption. [session %s]",
+                SSL_get_cipher(context->ssl),
+                context->tls_session_resumed ? "resumed" : "not resumed");
+  ShowCerts(context->ssl);
+#endif
+
+  return POLARIS_SUCCESS;
+}
+
+/******************************************************************************/
+static void ConfigureSocket(PolarisContext_t* context) {
+  P1_PrintDebug(
+      "Configuring socket. [socket=%d, read_timeout=%d ms, send_timeout=%d "
+      "ms]",
+      context->socket, POLARIS_RECV_TIMEOUT_MS, POLARIS_SEND_TIMEOUT_MS);
+
+  // Set send/receive timeouts.
+  P1_TimeValue_t timeout;
+  P1_SetTimeMS(POLARIS_RECV_TIMEOUT_MS, &timeout);
+  setsockopt(context->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+             sizeof(timeout));
+  P1_SetTimeMS(POLARIS_SEND_TIMEOUT_MS, &timeout);
+  setsockopt(context->socket, SOL_SOCKET, SO_SNDTIMEO, &timeout,
+             sizeof(timeout));
+
+#if POLARIS_KERNEL_TIMESTAMPS_SUPPORTED
+  if (context->kernel_timestamps) {
+    int enabled = 1;
+    if (setsockopt(context->socket, SOL_SOCKET, SO_TIMESTAMPNS, &enabled,
+                   sizeof(enabled)) < 0) {
+      P1_PrintErrno("Error enabling kernel receive timestamps", -1);
+    }
+  }
+#endif
+
+#ifndef P1_FREERTOS
+  int flags = fcntl(context->socket, F_GETFL);
+  P1_PrintDebug("Socket flags: 0x%08x", flags);
+#endif  // P1_FREERTOS
+}
+
+#ifndef P1_FREERTOS
+/******************************************************************************/
+static void SetSocketOption(P1_Socket_t sock, int level, int option,
+                            int value, const char* name) {
+  if (setsockopt(sock, level, option, &value, sizeof(value)) < 0) {
+    P1_PrintWarning("Warning: Unable to set %s. [error=%s (%d)]", name,
+                    strerror(errno), errno);
+  }
+}
+
+/******************************************************************************/
+static void ApplySocketOptions(P1_Socket_t sock,
+                               const PolarisSocketOptions_t* options) {
+  // Note: Buffer sizes must be set before connecting so the TCP window scale
+  // negotiated with the server can take advantage of them.
+  if (options->recv_buffer_size > 0) {
+    SetSocketOption(sock, SOL_SOCKET, SO_RCVBUF, options->recv_buffer_size,
+                    "SO_RCVBUF");
+  }
+
+  if (options->send_buffer_size > 0) {
+    SetSocketOption(sock, SOL_SOCKET, SO_SNDBUF, options->send_buffer_size,
+                    "SO_SNDBUF");
+  }
+
+  if (options->no_delay) {
+    SetSocketOption(sock, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+  }
+
+  if (options->keepalive) {
+    SetSocketOption(sock, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+
+    if (options->keepalive_idle_sec > 0) {
+#  if defined(TCP_KEEPIDLE)
+      SetSocketOption(sock, IPPROTO_TCP, TCP_KEEPIDLE,
+                      options->keepalive_idle_sec, "TCP_KEEPIDLE");
+#  elif defined(TCP_KEEPALIVE)  // macOS
+      SetSocketOption(sock, IPPROTO_TCP, TCP_KEEPALIVE,
+                      options->keepalive_idle_sec, "TCP_KEEPALIVE");
+#  else
+      P1_PrintWarning("Warning: Keepalive idle time not supported.");
+#  endif
+    }
+
+    if (options->keepalive_interval_sec > 0) {
+#  ifdef TCP_KEEPINTVL
+      SetSocketOption(sock, IPPROTO_TCP, TCP_KEEPINTVL,
+                      options->keepalive_interval_sec, "TCP_KEEPINTVL");
+#  else
+      P1_PrintWarning("Warning: Keepalive interval not supported.");
+#  endif
+    }
+
+    if (options->keepalive_count > 0) {
+#  ifdef TCP_KEEPCNT
+      SetSocketOption(sock, IPPROTO_TCP, TCP_KEEPCNT, options->keepalive_count,
+                      "TCP_KEEPCNT");
+#  else
+      P1_PrintWarning("Warning: Keepalive probe count not supported.");
+#  endif
+    }
+  }
+
+  if (options->user_timeout_ms > 0) {
+#  ifdef TCP_USER_TIMEOUT
+    SetSocketOption(sock, IPPROTO_TCP, TCP_USER_TIMEOUT,
+                    options->user_timeout_ms, "TCP_USER_TIMEOUT");
+#  else
+    P1_PrintWarning("Warning: TCP user timeout not supported.");
+#  endif
+  }
+
+  if (options->busy_poll_us > 0) {
+#  ifdef SO_BUSY_POLL
+    SetSocketOption(sock, SOL_SOCKET, SO_BUSY_POLL, options->busy_poll_us,
+                    "SO_BUSY_POLL");
+#  else
+    P1_PrintWarning("Warning: Socket busy polling not supported.");
+#  endif
+  }
+}
+
+/******************************************************************************/
+static P1_Socket_t StartConnect(const struct sockaddr_storage* address,
+                                socklen_t address_length,
+                                const PolarisSocketOptions_t* options,
+                                int* connected) {
+#  if !P1_NO_PRINT
+  if (__log_level >= POLARIS_LOG_LEVEL_DEBUG) {
+    char host[64];
+    char port[8];
+    if (getnameinfo((const struct sockaddr*)address, address_length, host,
+                    sizeof(host), port, sizeof(port),
+                    NI_NUMERICHOST | NI_NUMERICSERV) == 0) {
+      if (address->ss_family == AF_INET6) {
+        P1_PrintDebug("Connecting to 'tcp://[%s]:%s'.", host, port);
+      } else {
+        P1_PrintDebug("Connecting to 'tcp://%s:%s'.", host, port);
+      }
+    }
+  }
+#  endif  // !P1_NO_PRINT
+
+  *connected = 0;
+
+  P1_Socket_t sock = socket(address->ss_family, SOCK_STREAM, IPPROTO_TCP);
+  if (sock < 0) {
+    P1_PrintErrnoLevel(POLARIS_LOG_LEVEL_DEBUG, "Error creating socket", sock);
+    return P1_INVALID_SOCKET;
+  }
+
+  ApplySocketOptions(sock, options);
+
+  // Connect without blocking so we can enforce our own timeout and race
+  // multiple addresses.
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+
+  if (connect(sock, (const struct sockaddr*)address, address_length) == 0) {
+    *connected = 1;
+  } else if (errno != EINPROGRESS) {
+    int error = errno;
+    P1_PrintErrnoLevel(POLARIS_LOG_LEVEL_DEBUG, "Error connecting to endpoint",
+                       -1);
+    close(sock);
+    errno = error;
+    return P1_INVALID_SOCKET;
+  }
+
+  return sock;
+}
+
+/******************************************************************************/
+static int ConnectToEndpoint(PolarisContext_t* context,
+                             const char* endpoint_url, int endpoint_port,
+                             ConnectTiming_t* timing) {
+  // Lookup all IPv4 and IPv6 addresses for the endpoint. If we've connected to
+  // this host recently, this will use the cached addresses and return
+  // immediately.
+  P1_PrintDebug("Performing DNS lookup for '%s'.", endpoint_url);
+  P1_TimeValue_t lookup_start_time;
+  P1_GetCurrentTime(&lookup_start_time);
+  PolarisAddressList_t addresses;
+  int lookup_error;
+  int ret = Polaris_ResolveHost(endpoint_url, endpoint_port, &addresses,
+                                &lookup_error);
+  P1_TimeValue_t start_time;
+  P1_GetCurrentTime(&start_time);
+  timing->dns_lookup_ms = P1_GetElapsedMS(&lookup_start_time, &start_time);
+  if (ret < 0) {
+    P1_PrintError("Error locating address '%s'. [error=%s (%d)]", endpoint_url,
+                  gai_strerror(lookup_error), lookup_error);
+    return POLARIS_SOCKET_ERROR;
+  } else if (ret == POLARIS_DNS_CACHED) {
+    P1_PrintDebug("Using cached addresses for '%s'.", endpoint_url);
+  } else if (ret == POLARIS_DNS_STALE) {
+    if (lookup_error != 0) {
+      P1_PrintWarning(
+          "Warning: Unable to resolve '%s'. Using previous addresses. "
+          "[error=%s (%d)]",
+          endpoint_url, gai_strerror(lookup_error), lookup_error);
+    } else {
+      P1_PrintDebug("Using expired cached addresses for '%s'; refreshing.",
+                    endpoint_url);
+    }
+  }
+
+  // Start a connection attempt to the first address. If it has not completed
+  // after POLARIS_CONNECT_ATTEMPT_DELAY_MS, or if it fails, start the next one
+  // while continuing to wait for the first. The first attempt to complete wins,
+  // and all others are canceled.
+  struct pollfd pending[POLARIS_MAX_CONNECT_ADDRESSES];
+  size_t num_pending = 0;
+  size_t next_candidate = 0;
+  int last_error = ECONNREFUSED;
+
+  int last_attempt_ms = 0;
+  int attempt_failed = 0;
+
+  P1_Socket_t connected_socket = P1_INVALID_SOCKET;
+  while (1) {
+    P1_TimeValue_t current_time;
+    P1_GetCurrentTime(&current_time);
+    int elapsed_ms = P1_GetElapsedMS(&start_time, &current_time);
+    if (elapsed_ms >= context->connect_timeout_ms) {
+      P1_PrintError(
+          "Error connecting to endpoint: timed out after %d ms. [%u address(es) "
+          "tried]",
+          elapsed_ms, (unsigned)next_candidate);
+      break;
+    }
+
+    // Start the next attempt if the previous one is taking too long, or if an
+    // attempt just failed.
+    if (next_candidate < addresses.count &&
+        (num_pending == 0 || attempt_failed ||
+         elapsed_ms - last_attempt_ms >= POLARIS_CONNECT_ATTEMPT_DELAY_MS)) {
+      attempt_failed = 0;
+      int connected;
+      P1_Socket_t sock =
+          StartConnect(&addresses.addresses[next_candidate],
+                       addresses.address_lengths[next_candidate],
+                       &context->socket_options, &connected);
+      ++next_candidate;
+      if (sock == P1_INVALID_SOCKET) {
+        last_error = errno;
+        attempt_failed = 1;
+        continue;
+      } else if (connected) {
+        connected_socket = sock;
+        break;
+      } else {
+        pending[num_pending].fd = sock;
+        pending[num_pending].events = POLLOUT;
+        pending[num_pending].revents = 0;
+        ++num_pending;
+        last_attempt_ms = elapsed_ms;
+      }
+    }
+
+    if (num_pending == 0) {
+      errno = last_error;
+      P1_PrintErrno("Error connecting to endpoint", -1);
+      break;
+    }
+
+    // Wait for an attempt to complete, or for the next attempt to be due.
+    int wait_ms = context->connect_timeout_ms - elapsed_ms;
+    if (next_candidate < addresses.count) {
+      int next_attempt_ms =
+          last_attempt_ms + POLARIS_CONNECT_ATTEMPT_DELAY_MS - elapsed_ms;
+      if (next_attempt_ms < wait_ms) {
+        wait_ms = next_attempt_ms > 0 ? next_attempt_ms : 0;
+      }
+    }
+
+    if (poll(pending, num_pending, wait_ms) < 0 && errno != EINTR) {
+      P1_PrintErrno("Error waiting for connection", -1);
+      break;
+    }
+
+    for (size_t i = 0; i < num_pending;) {
+      if (pending[i].revents == 0) {
+        ++i;
+        continue;
+      }
+
+      int error = 0;
+      socklen_t error_size = sizeof(error);
+      if (getsockopt(pending[i].fd, SOL_SOCKET, SO_ERROR, &error,
+                     &error_size) < 0) {
+        error = errno;
+      }
+
+      if (error == 0) {
+        connected_socket = pending[i].fd;
+      } else {
+        errno = error;
+        P1_PrintErrnoLevel(POLARIS_LOG_LEVEL_DEBUG,
+                           "Error connecting to endpoint", -1);
+        last_error = error;
+        attempt_failed = 1;
+        close(pending[i].fd);
+      }
+
+      pending[i] = pending[--num_pending];
+      if (connected_socket != P1_INVALID_SOCKET) {
+        break;
+      }
+    }
+
+    if (connected_socket != P1_INVALID_SOCKET) {
+      break;
+    }
+  }
+
+  // Cancel any attempts still in progress.
+  for (size_t i = 0; i < num_pending; ++i) {
+    close(pending[i].fd);
+  }
+
+  // If we couldn't reach any of the addresses, they may be out of date. Look
+  // them up again next time.
+  if (connected_socket == P1_INVALID_SOCKET) {
+    Polaris_InvalidateHost(endpoint_url);
+    return POLARIS_SOCKET_ERROR;
+  }
+
+  P1_TimeValue_t connect_time;
+  P1_GetCurrentTime(&connect_time);
+  timing->tcp_connect_ms = P1_GetElapsedMS(&start_time, &connect_time);
+
+  // Restore blocking mode. SetSocketNonBlocking() will change this later if the
+  // user enabled non-blocking mode.
+  fcntl(connected_socket, F_SETFL,
+        fcntl(connected_socket, F_GETFL) & ~O_NONBLOCK);
+
+  context->socket = connected_socket;
+  return POLARIS_SUCCESS;
+}
+#endif  // P1_FREERTOS
+
+/******************************************************************************/
+void CloseSocket(PolarisContext_t* context, int destroy_context) {
+#ifdef POLARIS_USE_TLS
+  if (destroy_context && context->ssl != NULL) {
+    P1_PrintDebug("Shutting down TLS context.");
+    if (SSL_get_shutdown(context->ssl) == 0) {
+      SSL_shutdown(context->ssl);
+    }
+
+    SSL_free(context->ssl);
+    context->ssl = NULL;
+  }
+#endif
+
+  if (context->socket != P1_INVALID_SOCKET) {
+    P1_PrintDebug("Closing socket.");
+    close(context->socket);
+    context->socket = P1_INVALID_SOCKET;
+  }
+
+  context->http_connection_open = 0;
+
+  // Any request not sent yet was for this connection.
+  ClearPendingRequest(context);
+
+  // Note: The shared TLS context (ssl_ctx) is released by Polaris_Free().
+  //
+  // Note: We do not clear any of the authenticated, disconnected, etc. flags
+  // here since it is used to determine the return value in Polaris_Run()
+  // _after_ Polaris_Work() has returned and may have closed the socket.
+}
+
+#ifdef POLARIS_USE_TLS
+// The TLS context is shared by all Polaris contexts in the process, so it is
+// only created and configured once. Session tickets received from each
+// endpoint are stored below and used to resume the session on reconnect.
+//
+// Both are protected by __tls_mutex. OpenSSL itself allows an SSL_CTX to be
+// used by multiple threads at once.
+#  ifdef P1_FREERTOS
+#    define LockTLSState() P1_NOOP
+#    define UnlockTLSState() P1_NOOP
+#  else
+static pthread_mutex_t __tls_mutex = PTHREAD_MUTEX_INITIALIZER;
+#    define LockTLSState() pthread_mutex_lock(&__tls_mutex)
+#    define UnlockTLSState() pthread_mutex_unlock(&__tls_mutex)
+#  endif
+
+static SSL_CTX* __ssl_ctx = NULL;
+static int __ssl_ctx_ref_count = 0;
+
+#  define TLS_SESSION_KEY_SIZE 264
+
+typedef struct {
+  char key[TLS_SESSION_KEY_SIZE];
+  SSL_SESSION* session;
+} TLSSessionEntry_t;
+
+static TLSSessionEntry_t __tls_sessions[POLARIS_TLS_SESSION_CACHE_SIZE];
+static size_t __next_tls_session = 0;
+
+#  if POLARIS_KERNEL_TIMESTAMPS_SUPPORTED
+// A socket BIO that reads using ReadSocket() so kernel receive timestamps are
+// captured as OpenSSL reads from the socket. Created along with __ssl_ctx.
+static BIO_METHOD* __timestamp_bio_method = NULL;
+
+/******************************************************************************/
+static int IsRetryableSocketError(int error) {
+  // Same conditions as OpenSSL's BIO_sock_should_retry().
+  return error == EAGAIN || error == EWOULDBLOCK || error == EINTR ||
+         error == EINPROGRESS || error == EALREADY || error == ENOTCONN ||
+         error == EPROTO;
+}
+
+/******************************************************************************/
+static int ReadTimestampBIO(BIO* bio, char* buffer, int size_bytes) {
+  PolarisContext_t* context = (PolarisContext_t*)BIO_get_data(bio);
+  BIO_clear_retry_flags(bio);
+  int ret = (int)ReadSocket(context, buffer, (size_t)size_bytes, 0);
+  if (ret < 0 && IsRetryableSocketError(errno)) {
+    BIO_set_retry_read(bio);
+  }
+#    ifdef BIO_FLAGS_IN_EOF
+  else if (ret == 0) {
+    BIO_set_flags(bio, BIO_FLAGS_IN_EOF);
+  }
+#    endif
+  return ret;
+}
+
+/******************************************************************************/
+static int WriteTimestampBIO(BIO* bio, const char* buffer, int size_bytes) {
+  PolarisContext_t* context = (PolarisContext_t*)BIO_get_data(bio);
+  BIO_clear_retry_flags(bio);
+  int ret =
+      (int)send(context->socket, buffer, (size_t)size_bytes, P1_SEND_FLAGS);
+  if (ret < 0 && IsRetryableSocketError(errno)) {
+    BIO_set_retry_write(bio);
+  }
+  return ret;
+}
+
+/******************************************************************************/
+static long ControlTimestampBIO(BIO* bio, int command, long value, void* ptr) {
+  (void)value;
+  switch (command) {
+    case BIO_CTRL_FLUSH:
+      return 1;
+    // Report the underlying socket so SSL_get_fd() works, e.g., for
+    // StoreTLSSession().
+    case BIO_C_GET_FD: {
+      PolarisContext_t* context = (PolarisContext_t*)BIO_get_data(bio);
+      if (ptr != NULL) {
+        *(int*)ptr = (int)context->socket;
+      }
+      return (long)context->socket;
+    }
+#    ifdef BIO_FLAGS_IN_EOF
+    case BIO_CTRL_EOF:
+      return BIO_test_flags(bio, BIO_FLAGS_IN_EOF) ? 1 : 0;
+#    endif
+    default:
+      return 0;
+  }
+}
+
+/******************************************************************************/
+static BIO_METHOD* CreateTimestampBIOMethod(void) {
+  BIO_METHOD* method =
+      BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK |
+                       BIO_TYPE_DESCRIPTOR,
+                   "Polaris timestamped socket");
+  if (method != NULL) {
+    BIO_meth_set_read(method, &ReadTimestampBIO);
+    BIO_meth_set_write(method, &WriteTimestampBIO);
+    BIO_meth_set_ctrl(method, &ControlTimestampBIO);
+  }
+  return method;
+}
+#  endif  // POLARIS_KERNEL_TIMESTAMPS_SUPPORTED
+
+/******************************************************************************/
+static int GetTLSSessionKey(char* buffer, const char* endpoint_url,
+                            int endpoint_port) {
+  int length = snprintf(buffer, TLS_SESSION_KEY_SIZE, "%s:%d", endpoint_url,
+                        endpoint_port);
+  return length > 0 && length < TLS_SESSION_KEY_SIZE ? 0 : -1;
+}
+
+/******************************************************************************/
+static TLSSessionEntry_t* FindTLSSession(const char* key) {
+  for (size_t i = 0; i < POLARIS_TLS_SESSION_CACHE_SIZE; ++i) {
+    if (__tls_sessions[i].session != NULL &&
+        strcmp(__tls_sessions[i].key, key) == 0) {
+      return &__tls_sessions[i];
+    }
+  }
+  return NULL;
+}
+
+/******************************************************************************/
+static int StoreTLSSession(SSL* ssl, SSL_SESSION* session) {
+  // Called by OpenSSL when a new session (or TLS 1.3 session ticket) is
+  // received. We identify the endpoint using the SNI hostname and the peer's
+  // port.
+  const char* hostname = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+  struct sockaddr_storage peer;
+  socklen_t peer_length = sizeof(peer);
+  if (hostname == NULL ||
+      getpeername(SSL_get_fd(ssl), (struct sockaddr*)&peer, &peer_length) < 0) {
+    return 0;
+  }
+
+  int port;
+  if (peer.ss_family == AF_INET6) {
+    port = ntohs(((struct sockaddr_in6*)&peer)->sin6_port);
+  } else {
+    port = ntohs(((struct sockaddr_in*)&peer)->sin_port);
+  }
+
+  char key[TLS_SESSION_KEY_SIZE];
+  if (GetTLSSessionKey(key, hostname, port) < 0) {
+    return 0;
+  }
+
+  // OpenSSL marks the connection's session as not resumable if the connection
+  // ends with an error, including when the server closes the socket without a
+  // TLS close_notify alert. Since that is exactly when we reconnect, we store a
+  // copy of the session instead.
+#  if OPENSSL_VERSION_NUMBER >= 0x10101000L
+  session = SSL_SESSION_dup(session);
+  if (session == NULL) {
+    return 0;
+  }
+#  elif OPENSSL_VERSION_NUMBER >= 0x10100000L
+  SSL_SESSION_up_ref(session);
+#  else
+  CRYPTO_add(&session->references, 1, CRYPTO_LOCK_SSL_SESSION);
+#  endif
+
+  // Replace the existing session for this endpoint, or the oldest entry.
+  LockTLSState();
+  TLSSessionEntry_t* entry = FindTLSSession(key);
+  if (entry == NULL) {
+    entry = &__tls_sessions[__next_tls_session];
+    __next_tls_session =
+        (__next_tls_session + 1) % POLARIS_TLS_SESSION_CACHE_SIZE;
+    strcpy(entry->key, key);
+  }
+
+  if (entry->session != NULL) {
+    SSL_SESSION_free(entry->session);
+  }
+  entry->session = session;
+  UnlockTLSState();
+
+  // We hold our own reference, so the original is still owned by OpenSSL.
+  return 0;
+}
+
+/******************************************************************************/
+static SSL_SESSION* GetTLSSession(const char* endpoint_url,
+                                  int endpoint_port) {
+  char key[TLS_SESSION_KEY_SIZE];
+  if (GetTLSSessionKey(key, endpoint_url, endpoint_port) < 0) {
+    return NULL;
+  }
+
+  SSL_SESSION* session = NULL;
+  LockTLSState();
+  TLSSessionEntry_t* entry = FindTLSSession(key);
+  if (entry != NULL) {
+    // Take a reference while holding the lock, since the session may be
+    // replaced by another thread at any time.
+    session = entry->session;
+#  if OPENSSL_VERSION_NUMBER < 0x10100000L
+    CRYPTO_add(&session->references, 1, CRYPTO_LOCK_SSL_SESSION);
+#  else
+    SSL_SESSION_up_ref(session);
+#  endif
+  }
+  UnlockTLSState();
+
+  return session;
+}
+
+/******************************************************************************/
+static void RemoveTLSSession(const char* endpoint_url, int endpoint_port) {
+  char key[TLS_SESSION_KEY_SIZE];
+  if (GetTLSSessionKey(key, endpoint_url, endpoint_port) < 0) {
+    return;
+  }
+
+  LockTLSState();
+  TLSSessionEntry_t* entry = FindTLSSession(key);
+  if (entry != NULL) {
+    SSL_SESSION_free(entry->session);
+    entry->session = NULL;
+  }
+  UnlockTLSState();
+}
+
+/******************************************************************************/
+static SSL_CTX* AcquireSSLContext(void) {
+  LockTLSState();
+  if (__ssl_ctx == NULL) {
+    P1_PrintDebug("Configuring TLS context.");
+#  if OPENSSL_VERSION_NUMBER < 0x10100000L
+    __ssl_ctx = SSL_CTX_new(TLSv1_2_client_method());
+#  else
+    __ssl_ctx = SSL_CTX_new(TLS_client_method());
+#  endif
+
+    if (__ssl_ctx != NULL) {
+      // we specifically disable older insecure protocols
+      SSL_CTX_set_options(__ssl_ctx, SSL_OP_NO_SSLv2);
+      SSL_CTX_set_options(__ssl_ctx, SSL_OP_NO_SSLv3);
+      SSL_CTX_set_options(__ssl_ctx, SSL_OP_NO_TLSv1);
+
+      // Store sessions ourselves, keyed by endpoint, rather than in OpenSSL's
+      // internal cache, which is intended for servers.
+      SSL_CTX_set_session_cache_mode(
+          __ssl_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+      SSL_CTX_sess_set_new_cb(__ssl_ctx, &StoreTLSSession);
+
+#  if POLARIS_KERNEL_TIMESTAMPS_SUPPORTED
+      __timestamp_bio_method = CreateTimestampBIOMethod();
+#  endif
+    }
+  }
+
+  if (__ssl_ctx != NULL) {
+    ++__ssl_ctx_ref_count;
+  }
+  SSL_CTX* result = __ssl_ctx;
+  UnlockTLSState();
+
+  return result;
+}
+
+/******************************************************************************/
+static void ReleaseSSLContext(SSL_CTX* ssl_ctx) {
+  LockTLSState();
+  if (ssl_ctx == __ssl_ctx && --__ssl_ctx_ref_count == 0) {
+    P1_PrintDebug("Freeing TLS context.");
+    SSL_CTX_free(__ssl_ctx);
+    __ssl_ctx = NULL;
+
+#  if POLARIS_KERNEL_TIMESTAMPS_SUPPORTED
+    if (__timestamp_bio_method != NULL) {
+      BIO_meth_free(__timestamp_bio_method);
+      __timestamp_bio_method = NULL;
+    }
+#  endif
+
+    // Sessions are tied to the context that created them.
+    for (size_t i = 0; i < POLARIS_TLS_SESSION_CACHE_SIZE; ++i) {
+      if (__tls_sessions[i].session != NULL) {
+        SSL_SESSION_free(__tls_sessions[i].session);
+        __tls_sessions[i].session = NULL;
+      }
+    }
+  }
+  UnlockTLSState();
+}
+
+/******************************************************************************/
+static void AttachSocketToTLS(PolarisContext_t* context) {
+#  if POLARIS_KERNEL_TIMESTAMPS_SUPPORTED
+  // The BIO method is owned by the shared TLS context, which this context holds
+  // a reference to.
+  if (context->kernel_timestamps && __timestamp_bio_method != NULL) {
+    BIO* bio = BIO_new(__timestamp_bio_method);
+    if (bio != NULL) {
+      BIO_set_data(bio, context);
+      BIO_set_init(bio, 1);
+      SSL_set_bio(context->ssl, bio, bio);
+      return;
+    }
+
+    P1_PrintWarning(
+        "Warning: Unable to create TLS socket BIO. Kernel receive timestamps "
+        "will not be available.");
+  }
+#  endif
+
+  SSL_set_fd(context->ssl, context->socket);
+}
+#endif  // POLARIS_USE_TLS
+
+/******************************************************************************/
+static void ResetHTTPParser(HTTPResponseParser_t* parser) {
+  parser->state = HTTP_STATE_STATUS_LINE;
+  parser->status_code = 0;
+  parser->chunked = 0;
+  parser->has_content_length = 0;
+  parser->connection_close = 0;
+  parser->remaining_bytes = 0;
+  parser->line_length = 0;
+}
+
+/******************************************************************************/
+static int MatchesIgnoreCase(const char* text, size_t length,
+                             const char* lowercase_str) {
+  if (strlen(lowercase_str) != length) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < length; ++i) {
+    char c = text[i];
+    if (c >= 'A' && c <= 'Z') {
+      c = (char)(c - 'A' + 'a');
+    }
+
+    if (c != lowercase_str[i]) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/******************************************************************************/
+static int HTTPHeaderValueContains(const char* value,
+                                   const char* lowercase_token) {
+  // Header values such as "Transfer-Encoding" and "Connection" are
+  // case-insensitive lists.
+  size_t value_length = strlen(value);
+  size_t token_length = strlen(lowercase_token);
+  for (size_t i = 0; i + token_length <= value_length; ++i) {
+    if (MatchesIgnoreCase(value + i, token_length, lowercase_token)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/******************************************************************************/
+static void HandleHTTPLine(HTTPResponseParser_t* parser) {
+  char* line = parser->line;
+  line[parser->line_length] = '\0';
+  if (parser->line_length > 0 && line[parser->line_length - 1] == '\r') {
+    line[--parser->line_length] = '\0';
+  }
+
+  switch (parser->state) {
+    case HTTP_STATE_STATUS_LINE: {
+      int minor_version;
+      if (parser->line_length == 0) {
+        // Tolerate empty lines before the status line.
+        break;
+      } else if (sscanf(line, "HTTP/1.%d %d", &minor_version,
+                        &parser->status_code) != 2) {
+        parser->state = HTTP_STATE_INVALID;
+      } else {
+        // HTTP/1.0 connections close after each response unless the server
+        // says otherwise.
+        parser->connection_close = minor_version == 0 ? 1 : 0;
+        parser->state = HTTP_STATE_HEADER_LINE;
+      }
+      break;
+    }
+
+    case HTTP_STATE_HEADER_LINE: {
+      // A blank line ends the headers. Determine how the body is framed.
+      if (parser->line_length == 0) {
+        if (parser->status_code >= 100 && parser->status_code < 200) {
+          // Informational (e.g., 100 Continue): the real response follows.
+          ResetHTTPParser(parser);
+        } else if (parser->status_code == 204 || parser->status_code == 304) {
+          parser->state = HTTP_STATE_DONE;
+        } else if (parser->chunked) {
+          parser->state = HTTP_STATE_CHUNK_SIZE;
+        } else if (parser->has_content_length) {
+          parser->state = parser->remaining_bytes > 0 ? HTTP_STATE_BODY
+                                                      : HTTP_STATE_DONE;
+        } else {
+          parser->state = HTTP_STATE_BODY_UNTIL_CLOSE;
+          parser->connection_close = 1;
+        }
+        break;
+      }
 
-  // Enable the TLS extension for servers that use SNI, explicitly telling it
-  // the hostname of the remote server.
-  SSL_set_tlsext_host_name(context->ssl, endpoint_url);
+      char* separator = strchr(line, ':');
+      if (separator == NULL) {
+        break;
+      }
 
-  // Perform SSL handhshake.
-  ret = SSL_connect(context->ssl);
-  if (ret != 1) {
-#  if !P1_NO_PRINT
-    // Note: We intentionally reuse the receive buffer to store the error
-    // message to be displayed to avoid requiring additional stack here. At this
-    // point we're trying to open the socket, so there should be nobody actively
-    // using the receive buffer.
-    snprintf((char*)context->recv_buffer, POLARIS_RECV_BUFFER_SIZE,
-             "TLS handshake failed for tcp://%s:%d", endpoint_url,
-             endpoint_port);
-    P1_PrintSSLError(context, (char*)context->recv_buffer, ret);
-#  endif  // !P1_NO_PRINT
-    CloseSocket(context, 1);
-    return POLARIS_SOCKET_ERROR;
-  }
+      size_t name_length = (size_t)(separator - line);
+      char* value = separator + 1;
+      while (*value == ' ' || *value == '\t') {
+        ++value;
+      }
 
-  const SSL_CIPHER* c = SSL_get_current_cipher(context->ssl);
-  if (c == NULL) {
-    P1_PrintError(
-        "Server failed to negotiate encryption cipher. Verify that endpoint "
-        "tcp://%s:%d supports TLS 1.2 or better.",
-        endpoint_url, endpoint_port);
-    CloseSocket(context, 1);
-    return POLARIS_ERROR;
+      if (MatchesIgnoreCase(line, name_length, "content-length")) {
+        char* end;
+        parser->remaining_bytes = (size_t)strtoul(value, &end, 10);
+        if (end == value) {
+          parser->state = HTTP_STATE_INVALID;
+        } else {
+          parser->has_content_length = 1;
+        }
+      } else if (MatchesIgnoreCase(line, name_length,
+                                      "transfer-encoding")) {
+        parser->chunked = (uint8_t)HTTPHeaderValueContains(value, "chunked");
+      } else if (MatchesIgnoreCase(line, name_length, "connection")) {
+        if (HTTPHeaderValueContains(value, "close")) {
+          parser->connection_close = 1;
+        } else if (HTTPHeaderValueContains(value, "keep-alive")) {
+          parser->connection_close = 0;
+        }
+      }
+      break;
+    }
+
+    case HTTP_STATE_CHUNK_SIZE: {
+      // Chunk extensions (";name=value") are ignored.
+      char* end;
+      parser->remaining_bytes = (size_t)strtoul(line, &end, 16);
+      if (end == line) {
+        parser->state = HTTP_STATE_INVALID;
+      } else if (parser->remaining_bytes == 0) {
+        parser->state = HTTP_STATE_TRAILER;
+      } else {
+        parser->state = HTTP_STATE_CHUNK_DATA;
+      }
+      break;
+    }
+
+    case HTTP_STATE_CHUNK_END:
+      parser->state = parser->line_length == 0 ? HTTP_STATE_CHUNK_SIZE
+                                               : HTTP_STATE_INVALID;
+      break;
+
+    case HTTP_STATE_TRAILER:
+      // Trailer fields are ignored. A blank line ends the response.
+      if (parser->line_length == 0) {
+        parser->state = HTTP_STATE_DONE;
+      }
+      break;
+
+    default:
+      break;
   }
 
-  P1_PrintDebug("Connected with %s encryption.", SSL_get_cipher(context->ssl));
-  ShowCerts(context->ssl);
-#endif
+  parser->line_length = 0;
+}
 
-  return POLARIS_SUCCESS;
+/******************************************************************************/
+static void StoreHTTPBody(HTTPResponseParser_t* parser, const uint8_t* data,
+                          size_t size_bytes) {
+  size_t available_bytes = parser->body_capacity - parser->body_size;
+  if (size_bytes > available_bytes) {
+    size_bytes = available_bytes;
+    parser->body_truncated = 1;
+  }
+
+  // Note: The incoming data may be read into the body buffer itself, just past
+  // the end of the stored body, so we use memmove().
+  memmove(parser->body + parser->body_size, data, size_bytes);
+  parser->body_size += size_bytes;
 }
 
 /******************************************************************************/
-void CloseSocket(PolarisContext_t* context, int destroy_context) {
-#ifdef POLARIS_USE_TLS
-  if (destroy_context && context->ssl != NULL) {
-    P1_PrintDebug("Shutting down TLS context.");
-    if (SSL_get_shutdown(context->ssl) == 0) {
-      SSL_shutdown(context->ssl);
-    }
+static size_t ParseHTTPData(HTTPResponseParser_t* parser, const uint8_t* data,
+                            size_t size_bytes) {
+  size_t offset = 0;
+  while (offset < size_bytes && parser->state != HTTP_STATE_DONE &&
+         parser->state != HTTP_STATE_INVALID) {
+    if (parser->state == HTTP_STATE_BODY ||
+        parser->state == HTTP_STATE_CHUNK_DATA ||
+        parser->state == HTTP_STATE_BODY_UNTIL_CLOSE) {
+      size_t count = size_bytes - offset;
+      if (parser->state != HTTP_STATE_BODY_UNTIL_CLOSE &&
+          count > parser->remaining_bytes) {
+        count = parser->remaining_bytes;
+      }
 
-    SSL_free(context->ssl);
-    context->ssl = NULL;
+      StoreHTTPBody(parser, data + offset, count);
+      offset += count;
+
+      if (parser->state != HTTP_STATE_BODY_UNTIL_CLOSE) {
+        parser->remaining_bytes -= count;
+        if (parser->remaining_bytes == 0) {
+          parser->state = parser->state == HTTP_STATE_BODY
+                              ? HTTP_STATE_DONE
+                              : HTTP_STATE_CHUNK_END;
+        }
+      }
+    } else {
+      // Header and chunk size lines. We only need the start of each line, so
+      // anything past HTTP_MAX_LINE_SIZE is discarded.
+      char c = (char)data[offset++];
+      if (c == '\n') {
+        HandleHTTPLine(parser);
+      } else if (parser->line_length < HTTP_MAX_LINE_SIZE) {
+        parser->line[parser->line_length++] = c;
+      }
+    }
   }
-#endif
 
-  if (context->socket != P1_INVALID_SOCKET) {
-    P1_PrintDebug("Closing socket.");
-    close(context->socket);
-    context->socket = P1_INVALID_SOCKET;
+  return offset;
+}
+
+/******************************************************************************/
+static int IsHTTPConnectionReusable(PolarisContext_t* context,
+                                    const char* endpoint_url,
+                                    int endpoint_port) {
+  if (!context->http_connection_open || context->http_port != endpoint_port ||
+      strcmp(context->http_host, endpoint_url) != 0) {
+    return 0;
   }
 
-#ifdef POLARIS_USE_TLS
-  if (destroy_context && context->ssl_ctx != NULL) {
-    P1_PrintDebug("Freeing TLS context.");
-    SSL_CTX_free(context->ssl_ctx);
-    context->ssl_ctx = NULL;
+#ifndef P1_FREERTOS
+  // If the idle connection is readable, the server has closed it (or sent
+  // something unexpected). Either way, we can't use it.
+  struct pollfd poll_fd;
+  poll_fd.fd = context->socket;
+  poll_fd.events = POLLIN;
+  poll_fd.revents = 0;
+  if (poll(&poll_fd, 1, 0) != 0) {
+    return 0;
   }
 #endif
 
-  // Note: We do not clear any of the authenticated, disconnected, etc. flags
-  // here since it is used to determine the return value in Polaris_Run()
-  // _after_ Polaris_Work() has returned and may have closed the socket.
+  return 1;
 }
 
 /******************************************************************************/
@@ -1201,17 +3388,17 @@ static int SendPOSTRequest(PolarisContext_t* context, const char* endpoint_url,
                            int endpoint_port, const char* address,
                            const void* content, size_t content_length) {
   // Calculate the expected header length.
-  static const char* HEADER_TEMPLATE =
+  //
+  // Note: The size is computed at compile time since multiple contexts may send
+  // requests from different threads at once.
+  static const char HEADER_TEMPLATE[] =
       "POST %s HTTP/1.1\r\n"
       "Host: %s:%s\r\n"
       "Content-Type: application/json; charset=utf-8\r\n"
       "Content-Length: %s\r\n"
-      "Connection: Close\r\n"
+      "Connection: %s\r\n"
       "\r\n";
-  static size_t HEADER_TEMPLATE_SIZE = 0;
-  if (HEADER_TEMPLATE_SIZE == 0) {
-    HEADER_TEMPLATE_SIZE = strlen(HEADER_TEMPLATE) - (4 * 2);
-  }
+  const size_t HEADER_TEMPLATE_SIZE = sizeof(HEADER_TEMPLATE) - 1 - (5 * 2);
 
   size_t address_size = strlen(address);
 
@@ -1226,8 +3413,14 @@ static int SendPOSTRequest(PolarisContext_t* context, const char* endpoint_url,
       (size_t)snprintf(content_length_str, sizeof(content_length_str), "%d",
                        (int)content_length);
 
-  int header_size = (int)(HEADER_TEMPLATE_SIZE + address_size + url_size +
-                          port_str_size + content_length_str_size);
+  // We can only reuse the connection if we can store the hostname.
+  int keep_alive =
+      context->http_keep_alive && url_size <= POLARIS_MAX_HTTP_HOST_SIZE;
+  const char* connection_str = keep_alive ? "keep-alive" : "close";
+
+  int header_size =
+      (int)(HEADER_TEMPLATE_SIZE + address_size + url_size + port_str_size +
+            content_length_str_size + strlen(connection_str));
 
   // Copy the payload before building the header. That way we don't accidentally
   // overwrite the payload if it is stored inline in the output buffer.
@@ -1235,7 +3428,7 @@ static int SendPOSTRequest(PolarisContext_t* context, const char* endpoint_url,
   // Note that we use the receive buffer to send HTTP requests since it is
   // larger than the send buffer. We currently only send HTTP requests during
   // authentication, before data is coming in.
-  if (POLARIS_RECV_BUFFER_SIZE < header_size + content_length + 1) {
+  if (context->recv_buffer_size < header_size + content_length + 1) {
     P1_PrintError("Error populating POST request: buffer too small.");
     CloseSocket(context, 1);
     return POLARIS_NOT_ENOUGH_SPACE;
@@ -1247,9 +3440,9 @@ static int SendPOSTRequest(PolarisContext_t* context, const char* endpoint_url,
   context->recv_buffer[header_size + content_length] = '\0';
 
   // Now populate the header.
-  header_size =
-      snprintf((char*)context->recv_buffer, header_size + 1, HEADER_TEMPLATE,
-               address, endpoint_url, port_str, content_length_str);
+  header_size = snprintf((char*)context->recv_buffer, header_size + 1,
+                         HEADER_TEMPLATE, address, endpoint_url, port_str,
+                         content_length_str, connection_str);
   if (header_size < 0) {
     // This shouldn't happen.
     P1_PrintError("Error populating POST request.");
@@ -1261,113 +3454,313 @@ static int SendPOSTRequest(PolarisContext_t* context, const char* endpoint_url,
 
   size_t message_size = header_size + content_length;
 
-  // Send the request.
-  int ret = OpenSocket(context, endpoint_url, endpoint_port);
-  if (ret != POLARIS_SUCCESS) {
-    return ret;
-  }
+  // Send the request, reusing an idle keep-alive connection if we have one. If
+  // the server closes the idle connection before responding, retry once using a
+  // new connection.
+  int ret;
+  while (1) {
+    int reused = IsHTTPConnectionReusable(context, endpoint_url, endpoint_port);
+    if (reused) {
+      P1_PrintDebug("Reusing HTTP connection to %s:%d.", endpoint_url,
+                    endpoint_port);
+      context->http_connection_open = 0;
+    } else {
+      ConnectTiming_t timing;
+      ret = OpenSocket(context, endpoint_url, endpoint_port, &timing);
+      if (ret != POLARIS_SUCCESS) {
+        return ret;
+      }
+
+      if (keep_alive) {
+        memcpy(context->http_host, endpoint_url, url_size + 1);
+        context->http_port = endpoint_port;
+      } else {
+        context->http_host[0] = '\0';
+      }
+    }
 
-  P1_PrintDebug("Sending POST request. [size=%u B]", (unsigned)message_size);
+    P1_PrintDebug("Sending POST request. [size=%u B]", (unsigned)message_size);
 #ifdef POLARIS_USE_TLS
-  ret = SSL_write(context->ssl, context->recv_buffer, message_size);
+    ret = SSL_write(context->ssl, context->recv_buffer, message_size);
 #else
-  ret = send(context->socket, context->recv_buffer, message_size, 0);
+    ret = send(context->socket, context->recv_buffer, message_size,
+               P1_SEND_FLAGS);
 #endif
 
-  if (ret != message_size) {
-    P1_PrintReadWriteError(context, "Error sending POST request", ret);
-    CloseSocket(context, 1);
-    return POLARIS_SEND_ERROR;
-  }
+    if (ret != message_size) {
+      if (reused) {
+        P1_DebugPrintReadWriteError(context, "Idle HTTP connection closed",
+                                    ret);
+        CloseSocket(context, 1);
+        continue;
+      }
+
+      P1_PrintReadWriteError(context, "Error sending POST request", ret);
+      CloseSocket(context, 1);
+      return POLARIS_SEND_ERROR;
+    }
+
+    // Wait for a response.
+    ret = GetHTTPResponse(context, reused);
+    if (ret == HTTP_CONNECTION_STALE) {
+      continue;
+    }
 
-  // Wait for a response.
-  return GetHTTPResponse(context);
+    return ret;
+  }
 }
 
 /******************************************************************************/
-static int GetHTTPResponse(PolarisContext_t* context) {
-  // Read until the connection is closed.
+static int GetHTTPResponse(PolarisContext_t* context, int reused_connection) {
+  // Parse the response as it arrives, storing only the body at the front of
+  // recv_buffer. Headers are never stored, so the entire buffer is available
+  // for the response content.
+  //
+  // The connection is read until the end of the response. If the server closes
+  // the connection after the response, we read until it is closed.
+  HTTPResponseParser_t parser;
+  ResetHTTPParser(&parser);
+  parser.body = context->recv_buffer;
+  parser.body_capacity = context->recv_buffer_size - 1;
+  parser.body_size = 0;
+  parser.body_truncated = 0;
+
+  // If the body does not fit in recv_buffer, we read the remainder into this
+  // buffer and discard it so the connection stays in sync with the server.
+  uint8_t discard_buffer[128];
+
   size_t total_bytes = 0;
-  int bytes_read;
+  int bytes_read = 0;
+  int extra_data = 0;
+  while (parser.state != HTTP_STATE_DONE &&
+         parser.state != HTTP_STATE_INVALID) {
+    uint8_t* read_buffer = discard_buffer;
+    size_t read_size = sizeof(discard_buffer);
+    if (parser.body_size < parser.body_capacity) {
+      read_buffer = parser.body + parser.body_size;
+      read_size = parser.body_capacity - parser.body_size;
+    }
 
 #ifdef POLARIS_USE_TLS
-  while (
-      (bytes_read = SSL_read(context->ssl, context->recv_buffer + total_bytes,
-                             POLARIS_RECV_BUFFER_SIZE - total_bytes - 1)) > 0) {
+    bytes_read = SSL_read(context->ssl, read_buffer, (int)read_size);
 #else
-  while ((bytes_read = recv(context->socket, context->recv_buffer + total_bytes,
-                            POLARIS_RECV_BUFFER_SIZE - total_bytes - 1, 0)) >
-         0) {
+    bytes_read = recv(context->socket, read_buffer, read_size, 0);
 #endif
-    total_bytes += (size_t)bytes_read;
-    if (total_bytes == POLARIS_RECV_BUFFER_SIZE - 1) {
+    if (bytes_read <= 0) {
       break;
     }
+
+    total_bytes += (size_t)bytes_read;
+    size_t bytes_parsed = ParseHTTPData(&parser, read_buffer,
+                                        (size_t)bytes_read);
+    if (bytes_parsed != (size_t)bytes_read) {
+      extra_data = 1;
+    }
   }
 
+  if (parser.state != HTTP_STATE_DONE) {
 #ifdef P1_FREERTOS
-  // Unlike POSIX recv(), which returns <0 and sets ETIMEDOUT on a socket read
-  // timeout, FreeRTOS returns 0.
-  if (bytes_read == 0) {
-    P1_PrintWarning("Socket timed out waiting for HTTP response.");
-    CloseSocket(context, 1);
-    return POLARIS_SEND_ERROR;
-  }
-  // Similarly, FreeRTOS returns -pdFREERTOS_ERRNO_ENOTCONN on an orderly socket
-  // shutdown rather than 0. Any other <0 return is considered an error.
-  else if (bytes_read != -pdFREERTOS_ERRNO_ENOTCONN) {
-    P1_PrintReadWriteError(context,
-                           "Unexpected error while waiting for HTTP response",
-                           bytes_read);
-    CloseSocket(context, 1);
-    return POLARIS_SEND_ERROR;
-  }
+    // Unlike POSIX recv(), which returns <0 and sets ETIMEDOUT on a socket read
+    // timeout, FreeRTOS returns 0. Similarly, FreeRTOS returns
+    // -pdFREERTOS_ERRNO_ENOTCONN on an orderly socket shutdown rather than 0.
+    int closed = bytes_read == -pdFREERTOS_ERRNO_ENOTCONN;
+    if (bytes_read == 0) {
+      P1_PrintWarning("Socket timed out waiting for HTTP response.");
+      CloseSocket(context, 1);
+      return POLARIS_SEND_ERROR;
+    }
 #else
-  // Check for socket read errors. Under normal circumstances, recv() should
-  // return 0 when finished, indicating the HTTP server closed the connection.
-  if (bytes_read < 0) {
-    P1_PrintReadWriteError(context,
-                           "Unexpected error while waiting for HTTP response",
-                           bytes_read);
-    CloseSocket(context, 1);
-    return POLARIS_SEND_ERROR;
-  }
+    int closed = bytes_read == 0;
 #endif
 
-  // Note: Ideally we'd do this just once up above before any of the error
-  // checks instead of having to do it explicitly in all of the if statements.
-  // However, when TLS is enabled, P1_PrintReadWriteError() needs to access
-  // context->ssl, which is freed by CloseSocket().
-  CloseSocket(context, 1);
+    if (parser.state == HTTP_STATE_INVALID) {
+      P1_PrintError("Invalid HTTP response.");
+      CloseSocket(context, 1);
+      return POLARIS_SEND_ERROR;
+    } else if (closed && parser.state == HTTP_STATE_BODY_UNTIL_CLOSE) {
+      // Response complete.
+    } else if (reused_connection && total_bytes == 0) {
+      // The server closed the idle connection before receiving our request.
+      P1_PrintDebug("Idle HTTP connection closed by server.");
+      CloseSocket(context, 1);
+      return HTTP_CONNECTION_STALE;
+    } else if (closed) {
+      P1_PrintError("Connection closed before end of HTTP response.");
+      CloseSocket(context, 1);
+      return POLARIS_SEND_ERROR;
+    } else {
+      P1_PrintReadWriteError(context,
+                             "Unexpected error while waiting for HTTP response",
+                             bytes_read);
+      CloseSocket(context, 1);
+      return POLARIS_SEND_ERROR;
+    }
+  }
 
-  P1_PrintDebug("Received HTTP response. [size=%u B]", (unsigned)total_bytes);
+  // Leave the connection open for the next request if possible.
+  if (parser.state == HTTP_STATE_DONE && !parser.connection_close &&
+      !extra_data && context->http_host[0] != '\0') {
+    context->http_connection_open = 1;
+  } else {
+    CloseSocket(context, 1);
+  }
 
-  // Append a null terminator to the response.
-  context->recv_buffer[total_bytes++] = '\0';
+  P1_PrintDebug("Received HTTP response. [size=%u B, status=%d, content=%u B]",
+                (unsigned)total_bytes, parser.status_code,
+                (unsigned)parser.body_size);
 
-  // Extract the status code.
-  int status_code;
-  if (sscanf((char*)context->recv_buffer, "HTTP/1.1 %d", &status_code) != 1) {
-    P1_PrintError("Invalid HTTP response:\n\n%s", context->recv_buffer);
-    return POLARIS_SEND_ERROR;
-  }
+  // Append a null terminator to the response content.
+  context->recv_buffer[parser.body_size] = '\0';
 
-  // Find the content, then move the response content to the front of the
-  // recv_buffer. We don't care about the HTTP headers.
-  char* content_start = strstr((char*)context->recv_buffer, "\r\n\r\n");
-  if (content_start != NULL) {
-    content_start += 4;
-    size_t content_length =
-        total_bytes - (content_start - (char*)context->recv_buffer);
-    memmove(context->recv_buffer, content_start, content_length);
+  if (parser.body_truncated) {
+    P1_PrintError(
+        "HTTP response content too large for receive buffer. [status=%d, "
+        "buffer_size=%u B]",
+        parser.status_code, (unsigned)context->recv_buffer_size);
+    return POLARIS_NOT_ENOUGH_SPACE;
+  } else if (parser.body_size > 0) {
     P1_PrintDebug("Response content:\n%s", context->recv_buffer);
   } else {
-    // No content in response.
     P1_PrintDebug("No content in response.");
-    context->recv_buffer[0] = '\0';
   }
 
-  return status_code;
+  return parser.status_code;
+}
+
+/******************************************************************************/
+static int IsAuthRejectionText(const char* text, size_t length) {
+  // The corrections service may send other informational text messages, so
+  // only messages describing an authentication failure are considered a
+  // rejection.
+  static const char* KEYWORDS[] = {"auth",      "token",   "denied",
+                                   "forbidden", "invalid", "expired"};
+  for (size_t k = 0; k < sizeof(KEYWORDS) / sizeof(KEYWORDS[0]); ++k) {
+    size_t keyword_length = strlen(KEYWORDS[k]);
+    for (size_t i = 0; i + keyword_length <= length; ++i) {
+      if (MatchesIgnoreCase(text + i, keyword_length, KEYWORDS[k])) {
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/******************************************************************************/
+static void HandleRTCMFrame(void* info, const uint8_t* frame,
+                            size_t size_bytes) {
+  PolarisContext_t* context = (PolarisContext_t*)info;
+
+  // Once the token has been rejected, nothing else received on the connection
+  // is delivered.
+  if (context->authenticated == POLARIS_AUTHENTICATION_REJECTED) {
+    return;
+  }
+
+  // The first message other than a 1029 text message tells us that the network
+  // accepted the authentication token. A 1029 message describing an
+  // authentication failure tells us it was rejected. Any other 1029 message,
+  // including one that cannot be decoded, does not tell us either way.
+  if (context->authenticated == POLARIS_NOT_AUTHENTICATED) {
+    const uint16_t message_type =
+        Polaris_GetRTCMMessageType(frame, size_bytes);
+    if (message_type == POLARIS_RTCM3_TEXT_MESSAGE_TYPE) {
+      const char* text = NULL;
+      size_t text_length = 0;
+      if (Polaris_GetRTCM1029Text(frame, size_bytes, &text, &text_length) !=
+          0) {
+        P1_PrintDebug(
+            "Received malformed RTCM 1029 message. Authentication status "
+            "unknown.");
+      } else if (IsAuthRejectionText(text, text_length)) {
+        P1_PrintWarning(
+            "Warning: Authentication token rejected by corrections service. "
+            "[reason='%.*s']",
+            (int)text_length, text);
+        context->authenticated = POLARIS_AUTHENTICATION_REJECTED;
+        if (context->auth_status_callback) {
+          context->auth_status_callback(context->auth_status_callback_info,
+                                        context, POLARIS_AUTH_REJECTED, text,
+                                        text_length);
+        }
+        return;
+      } else {
+        P1_PrintDebug(
+            "Received RTCM 1029 message. Authentication status unknown. "
+            "[text='%.*s']",
+            (int)text_length, text);
+      }
+    } else {
+      P1_PrintDebug("Received RTCM %u message. Authentication token accepted.",
+                    (unsigned)message_type);
+      context->authenticated = POLARIS_AUTHENTICATED;
+      if (context->auth_status_callback) {
+        context->auth_status_callback(context->auth_status_callback_info,
+                                      context, POLARIS_SUCCESS, NULL, 0);
+      }
+    }
+  }
+
+  if (context->correction_age_enabled) {
+    UpdateCorrectionAge(context, frame, size_bytes);
+  }
+
+  if (context->rtcm_frame_callback) {
+    ++context->stats.frame_callbacks;
+    context->rtcm_frame_callback(context->rtcm_frame_callback_info, context,
+                                 frame, size_bytes);
+  }
+}
+
+/******************************************************************************/
+static void UpdateCorrectionAge(PolarisContext_t* context,
+                                const uint8_t* frame, size_t size_bytes) {
+  uint32_t epoch_time_ms;
+  uint32_t period_ms;
+  if (Polaris_GetRTCMMSMEpochTime(frame, size_bytes, context->leap_seconds,
+                                  &epoch_time_ms, &period_ms) != 0) {
+    return;
+  }
+
+  // Each epoch typically includes one MSM message per constellation. Measure
+  // the age when the first one arrives.
+  PolarisCorrectionAge_t* age = &context->correction_age;
+  if (age->epoch_count > 0 &&
+      age->last_epoch_time_ms % period_ms == epoch_time_ms) {
+    return;
+  }
+
+  // Convert the receive time to GPS time, and compute the difference modulo
+  // the epoch time period (one week, or one day for some GLONASS messages).
+  int64_t gps_time_ms = context->current_receive_time_ns / 1000000 -
+                        GPS_EPOCH_UNIX_TIME_MS +
+                        (int64_t)context->leap_seconds * 1000;
+  int64_t age_ms = (gps_time_ms - (int64_t)epoch_time_ms) % period_ms;
+  if (age_ms < 0) {
+    age_ms += period_ms;
+  }
+  if (age_ms >= period_ms / 2) {
+    age_ms -= period_ms;
+  }
+
+  age->last_epoch_time_ms = epoch_time_ms;
+  age->last_age_ms = (int32_t)age_ms;
+  ++age->epoch_count;
+
+  context->correction_ages_ms[context->correction_age_index] =
+      age->last_age_ms;
+  context->correction_age_index =
+      (context->correction_age_index + 1) % POLARIS_CORRECTION_AGE_WINDOW_SIZE;
+
+  P1_PrintDebug("Received GNSS epoch %u.%03u. [age=%d ms]",
+                (unsigned)(epoch_time_ms / 1000),
+                (unsigned)(epoch_time_ms % 1000), (int)age->last_age_ms);
+}
+
+/******************************************************************************/
+static void ResetCorrectionAge(PolarisContext_t* context) {
+  memset(&context->correction_age, 0, sizeof(context->correction_age));
+  context->correction_age_index = 0;
 }
 
 /******************************************************************************/
@@ -1389,8 +3782,8 @@ void P1_PrintData(const uint8_t* buffer, size_t length) {
 
     if (i % 16 == 15) {
       str[str_length++] = '\0';
-      if (__print_callback) {
-        __print_callback("polaris.c", __LINE__, POLARIS_LOG_LEVEL_TRACE, str);
+      if (__print_callback || P1_IsAsyncPrintEnabled()) {
+        DeliverMessage(__LINE__, POLARIS_LOG_LEVEL_TRACE, str);
       } else {
         P1_fprintf(stderr, "%s", str);
       }
@@ -1400,8 +3793,8 @@ void P1_PrintData(const uint8_t* buffer, size_t length) {
 
   if (str_length != 0) {
     str[str_length++] = '\0';
-    if (__print_callback) {
-      __print_callback("polaris.c", __LINE__, POLARIS_LOG_LEVEL_TRACE, str);
+    if (__print_callback || P1_IsAsyncPrintEnabled()) {
+      DeliverMessage(__LINE__, POLARIS_LOG_LEVEL_TRACE, str);
     } else {
       P1_fprintf(stderr, "%s\n", str);
     }
@@ -1409,6 +3802,212 @@ void P1_PrintData(const uint8_t* buffer, size_t length) {
 }
 #endif
 
+/******************************************************************************/
+#if !P1_NO_PRINT && !defined(P1_FREERTOS)
+#  if (POLARIS_ASYNC_PRINT_QUEUE_SIZE & (POLARIS_ASYNC_PRINT_QUEUE_SIZE - 1)) != 0
+#    error "POLARIS_ASYNC_PRINT_QUEUE_SIZE must be a power of 2."
+#  endif
+
+// Asynchronous printing uses a bounded multi-producer, single-consumer queue.
+// Any thread may queue a message without taking a lock: it claims a slot by
+// advancing the write index, fills it in, and then publishes it by updating the
+// slot's sequence number. The print thread delivers published messages in
+// order and then releases each slot for reuse by advancing its sequence number
+// by the queue size. If the queue is full, the message is dropped and counted
+// rather than blocking the caller.
+//
+// The print thread sleeps on a condition variable when the queue is empty.
+// Callers only take the associated mutex to wake it, and only when it is
+// sleeping.
+typedef struct {
+  uint32_t sequence;
+  int line;
+  int level;
+  P1_TimeValue_t time;
+  char message[POLARIS_MAX_PRINT_LENGTH + 1];
+} AsyncPrintRecord_t;
+
+static AsyncPrintRecord_t __async_print_queue[POLARIS_ASYNC_PRINT_QUEUE_SIZE];
+static uint32_t __async_print_write_index = 0;
+static uint32_t __async_print_read_index = 0;
+static uint32_t __async_print_dropped = 0;
+static int __async_print_stop = 0;
+static int __async_print_waiting = 0;
+static int __async_print_initialized = 0;
+static pthread_mutex_t __async_print_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t __async_print_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t __async_print_thread;
+// Serializes calls to Polaris_SetAsyncPrint(), and draining the queue while
+// asynchronous printing is disabled. Only taken while printing if a message was
+// queued just as asynchronous printing was disabled.
+static pthread_mutex_t __async_print_control_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void DrainPrintQueue(void);
+
+/******************************************************************************/
+static void EnqueuePrintMessage(int line, int level, const char* message) {
+  uint32_t index =
+      __atomic_load_n(&__async_print_write_index, __ATOMIC_RELAXED);
+  AsyncPrintRecord_t* record;
+  while (1) {
+    record = &__async_print_queue[index & (POLARIS_ASYNC_PRINT_QUEUE_SIZE - 1)];
+    uint32_t sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+    int32_t diff = (int32_t)(sequence - index);
+    if (diff == 0) {
+      // The slot is free. Try to claim it. On failure, index is updated to the
+      // current write index.
+      if (__atomic_compare_exchange_n(&__async_print_write_index, &index,
+                                      index + 1, 1, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The slot still holds a message from the previous pass around the queue:
+      // the queue is full.
+      __atomic_fetch_add(&__async_print_dropped, 1, __ATOMIC_RELAXED);
+      return;
+    } else {
+      // Another thread claimed this slot first.
+      index = __atomic_load_n(&__async_print_write_index, __ATOMIC_RELAXED);
+    }
+  }
+
+  record->line = line;
+  record->level = level;
+  P1_GetCurrentTime(&record->time);
+  size_t length = strlen(message);
+  if (length > POLARIS_MAX_PRINT_LENGTH) {
+    length = POLARIS_MAX_PRINT_LENGTH;
+  }
+  memcpy(record->message, message, length);
+  record->message[length] = '\0';
+
+  // Note: Sequentially consistent ordering is required here and in
+  // RunAsyncPrint() so the print thread cannot go to sleep after this message
+  // is published without this thread seeing that it needs to be woken.
+  __atomic_store_n(&record->sequence, index + 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&__async_print_waiting, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&__async_print_mutex);
+    pthread_cond_signal(&__async_print_cond);
+    pthread_mutex_unlock(&__async_print_mutex);
+  }
+
+  // If asynchronous printing was disabled while this message was being queued,
+  // the print thread may have already exited. Print it now.
+  if (!__atomic_load_n(&__async_print_enabled, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&__async_print_control_mutex);
+    if (!__atomic_load_n(&__async_print_enabled, __ATOMIC_RELAXED)) {
+      DrainPrintQueue();
+    }
+    pthread_mutex_unlock(&__async_print_control_mutex);
+  }
+}
+
+/******************************************************************************/
+static int IsPrintQueueEmpty(void) {
+  uint32_t index = __async_print_read_index;
+  const AsyncPrintRecord_t* record =
+      &__async_print_queue[index & (POLARIS_ASYNC_PRINT_QUEUE_SIZE - 1)];
+  return __atomic_load_n(&record->sequence, __ATOMIC_SEQ_CST) != index + 1;
+}
+
+/******************************************************************************/
+static void DrainPrintQueue(void) {
+  while (1) {
+    uint32_t index = __async_print_read_index;
+    AsyncPrintRecord_t* record =
+        &__async_print_queue[index & (POLARIS_ASYNC_PRINT_QUEUE_SIZE - 1)];
+    if (__atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE) != index + 1) {
+      break;
+    }
+
+    OutputMessage(&record->time, record->line, record->level, record->message);
+
+    __atomic_store_n(&record->sequence, index + POLARIS_ASYNC_PRINT_QUEUE_SIZE,
+                     __ATOMIC_RELEASE);
+    __async_print_read_index = index + 1;
+  }
+
+  uint32_t dropped =
+      __atomic_exchange_n(&__async_print_dropped, 0, __ATOMIC_RELAXED);
+  if (dropped > 0) {
+    char message[64];
+    snprintf(message, sizeof(message),
+             "Print queue full. Dropped %u messages.", (unsigned)dropped);
+    OutputMessage(NULL, __LINE__, POLARIS_LOG_LEVEL_WARNING, message);
+  }
+}
+
+/******************************************************************************/
+static void* RunAsyncPrint(void* arg) {
+  (void)arg;
+
+  int stop = 0;
+  while (!stop) {
+    DrainPrintQueue();
+
+    pthread_mutex_lock(&__async_print_mutex);
+    __atomic_store_n(&__async_print_waiting, 1, __ATOMIC_SEQ_CST);
+    while (!__async_print_stop && IsPrintQueueEmpty()) {
+      pthread_cond_wait(&__async_print_cond, &__async_print_mutex);
+    }
+    __atomic_store_n(&__async_print_waiting, 0, __ATOMIC_RELAXED);
+    stop = __async_print_stop;
+    pthread_mutex_unlock(&__async_print_mutex);
+  }
+
+  DrainPrintQueue();
+  return NULL;
+}
+
+/******************************************************************************/
+static void StopAsyncPrint(void) { SetAsyncPrintEnabled(0); }
+
+/******************************************************************************/
+static int SetAsyncPrintEnabled(int enabled) {
+  int ret = POLARIS_SUCCESS;
+  pthread_mutex_lock(&__async_print_control_mutex);
+  int running = __atomic_load_n(&__async_print_enabled, __ATOMIC_RELAXED);
+  if (enabled && !running) {
+    if (!__async_print_initialized) {
+      for (uint32_t i = 0; i < POLARIS_ASYNC_PRINT_QUEUE_SIZE; ++i) {
+        __async_print_queue[i].sequence = i;
+      }
+      // Deliver any queued messages if the application exits without disabling
+      // asynchronous printing.
+      atexit(&StopAsyncPrint);
+      __async_print_initialized = 1;
+    }
+
+    __async_print_stop = 0;
+    if (pthread_create(&__async_print_thread, NULL, &RunAsyncPrint, NULL) !=
+        0) {
+      P1_PrintErrno("Error starting print thread", -1);
+      ret = POLARIS_ERROR;
+    } else {
+      __atomic_store_n(&__async_print_enabled, 1, __ATOMIC_RELEASE);
+    }
+  } else if (!enabled && running) {
+    // Print any remaining messages synchronously from here on, then wait for
+    // the print thread to finish delivering the queue.
+    __atomic_store_n(&__async_print_enabled, 0, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&__async_print_mutex);
+    __async_print_stop = 1;
+    pthread_cond_signal(&__async_print_cond);
+    pthread_mutex_unlock(&__async_print_mutex);
+    pthread_join(__async_print_thread, NULL);
+
+    // Print any messages queued by callers that saw asynchronous printing
+    // enabled after the print thread's final pass.
+    if (!IsPrintQueueEmpty()) {
+      DrainPrintQueue();
+    }
+  }
+  pthread_mutex_unlock(&__async_print_control_mutex);
+  return ret;
+}
+#endif
+
 /******************************************************************************/
 #if !P1_NO_PRINT && POLARIS_USE_TLS
 void ShowCerts(SSL* ssl) {
@@ -8,6 +8,8 @@
 
 #include <stdint.h>
 
+#include "point_one/polaris/histogram.h"
+#include "point_one/polaris/rtcm.h"
 #include "point_one/polaris/socket.h"
 
 #define POLARIS_API_URL "api.pointonenav.com"
@@ -23,7 +25,10 @@
 #endif
 
 /**
- * @brief The size of the data receive buffer (in bytes).
+ * @brief The size of the default data receive buffer (in bytes).
+ *
+ * The receive buffer size may also be specified for an individual context at
+ * runtime using @ref Polaris_InitWithRecvBuffer().
  *
  * @note
  * The receive buffer must be large enough to store the entire HTTP
@@ -33,7 +38,8 @@
  * message (6 bytes header/CRC + 1023 bytes payload). We don't align to RTCM
  * framing, however, so there's no guarantee that the buffer starts at the
  * beginning of an RTCM message or contains either a complete message or only
- * one message.
+ * one message. If you need complete messages, see @ref
+ * Polaris_SetRTCMFrameCallback().
  */
 #ifndef POLARIS_RECV_BUFFER_SIZE
 # define POLARIS_RECV_BUFFER_SIZE 1029
@@ -63,6 +69,20 @@
 # define POLARIS_RECV_TIMEOUT_MS 5000
 #endif
 
+/**
+ * @brief The interval (in ms) at which @ref Polaris_Work() checks for a queued
+ *        position or beacon request before the first request has been sent.
+ *
+ * Polaris will not send any data until it receives a position or beacon
+ * request. Until then, rather than blocking for the full @ref
+ * POLARIS_RECV_TIMEOUT_MS, @ref Polaris_Work() waits for incoming data in short
+ * intervals so a request queued by another thread (see @ref
+ * Polaris_QueueLLAPosition()) is sent promptly.
+ */
+#ifndef POLARIS_REQUEST_POLL_INTERVAL_MS
+# define POLARIS_REQUEST_POLL_INTERVAL_MS 100
+#endif
+
 /**
  * @brief The maximum amount of time (in ms) to wait when sending a message to
  *        Polaris.
@@ -71,6 +91,80 @@
 # define POLARIS_SEND_TIMEOUT_MS 1000
 #endif
 
+/**
+ * @brief The default maximum amount of time (in ms) to wait for a TCP
+ *        connection to be established.
+ *
+ * See @ref Polaris_SetConnectTimeout().
+ */
+#ifndef POLARIS_CONNECT_TIMEOUT_MS
+# define POLARIS_CONNECT_TIMEOUT_MS 10000
+#endif
+
+/**
+ * @brief The delay (in ms) between starting connection attempts to successive
+ *        addresses for the same host.
+ *
+ * If a host resolves to more than one address (e.g., both IPv6 and IPv4), the
+ * addresses are tried in parallel, each starting after this delay if the
+ * previous attempts have not yet completed, as recommended by RFC 8305 ("Happy
+ * Eyeballs").
+ */
+#ifndef POLARIS_CONNECT_ATTEMPT_DELAY_MS
+# define POLARIS_CONNECT_ATTEMPT_DELAY_MS 250
+#endif
+
+/**
+ * @brief The maximum length of an authentication server hostname for which an
+ *        HTTP keep-alive connection may be reused.
+ *
+ * See @ref Polaris_SetHTTPKeepAlive().
+ */
+#ifndef POLARIS_MAX_HTTP_HOST_SIZE
+# define POLARIS_MAX_HTTP_HOST_SIZE 128
+#endif
+
+/**
+ * @brief The maximum number of resolved addresses to try for a single host.
+ */
+#ifndef POLARIS_MAX_CONNECT_ADDRESSES
+# define POLARIS_MAX_CONNECT_ADDRESSES 8
+#endif
+
+/**
+ * @brief The maximum number of hosts stored in the process-wide DNS cache, or
+ *        0 to disable caching.
+ *
+ * Resolved addresses for the authentication server and corrections endpoint
+ * are cached so that reconnecting does not require a new DNS lookup. See @ref
+ * Polaris_ClearDNSCache().
+ */
+#ifndef POLARIS_DNS_CACHE_SIZE
+# define POLARIS_DNS_CACHE_SIZE 8
+#endif
+
+/**
+ * @brief The amount of time (in ms) for which cached DNS results are considered
+ *        current.
+ *
+ * After this time, the cached addresses are still used, but a new lookup is
+ * started in the background to refresh them. If that lookup fails, the
+ * existing addresses continue to be used.
+ */
+#ifndef POLARIS_DNS_CACHE_TTL_MS
+# define POLARIS_DNS_CACHE_TTL_MS 300000
+#endif
+
+/**
+ * @brief The maximum number of endpoints for which TLS sessions are stored for
+ *        resumption.
+ *
+ * See @ref Polaris_IsTLSSessionResumed().
+ */
+#ifndef POLARIS_TLS_SESSION_CACHE_SIZE
+# define POLARIS_TLS_SESSION_CACHE_SIZE 4
+#endif
+
 /**
  * @brief The maximum length of a message when a print callback is registered.
  *
@@ -80,6 +174,55 @@
 # define POLARIS_MAX_PRINT_LENGTH 256
 #endif
 
+/**
+ * @brief The maximum number of messages waiting to be printed when asynchronous
+ *        printing is enabled. Must be a power of 2.
+ *
+ * See @ref Polaris_SetAsyncPrint().
+ */
+#ifndef POLARIS_ASYNC_PRINT_QUEUE_SIZE
+# define POLARIS_ASYNC_PRINT_QUEUE_SIZE 64
+#endif
+
+/**
+ * @brief The default GPS-UTC offset (in seconds) used to compute correction
+ *        age.
+ *
+ * See @ref Polaris_SetLeapSeconds().
+ */
+#ifndef POLARIS_GPS_UTC_LEAP_SECONDS
+# define POLARIS_GPS_UTC_LEAP_SECONDS 18
+#endif
+
+/**
+ * @brief The number of recent GNSS epochs included in the rolling correction
+ *        age statistics.
+ *
+ * See @ref Polaris_GetCorrectionAge().
+ */
+#ifndef POLARIS_CORRECTION_AGE_WINDOW_SIZE
+# define POLARIS_CORRECTION_AGE_WINDOW_SIZE 32
+#endif
+
+/**
+ * @brief The number of recent intervals between reads used to learn the
+ *        incoming data period for adaptive stall detection.
+ *
+ * See @ref Polaris_SetStallDetection().
+ */
+#ifndef POLARIS_STALL_WINDOW_SIZE
+# define POLARIS_STALL_WINDOW_SIZE 16
+#endif
+
+/**
+ * @brief The default minimum adaptive stall timeout (in ms).
+ *
+ * See @ref Polaris_SetStallDetection().
+ */
+#ifndef POLARIS_MIN_STALL_TIMEOUT_MS
+# define POLARIS_MIN_STALL_TIMEOUT_MS 1500
+#endif
+
 /**
  * @name Polaris Return Codes
  * @{
@@ -93,6 +236,18 @@
 #define POLARIS_FORBIDDEN -6
 #define POLARIS_CONNECTION_CLOSED -7
 #define POLARIS_TIMED_OUT -8
+#define POLARIS_AUTH_REJECTED -9
+#define POLARIS_WOULD_BLOCK -10
+/** @} */
+
+/**
+ * @name Polaris Non-Blocking I/O Readiness Flags
+ *
+ * See @ref Polaris_GetPollEvents().
+ * @{
+ */
+#define POLARIS_WANT_READ 0x1
+#define POLARIS_WANT_WRITE 0x2
 /** @} */
 
 /**
@@ -113,30 +268,353 @@ typedef struct PolarisContext_s PolarisContext_t;
 typedef void (*PolarisCallback_t)(void* info, PolarisContext_t* context,
                                   const uint8_t* buffer, size_t size_bytes);
 
+/**
+ * @brief The time at which a block of incoming data was received.
+ *
+ * All times are in nanoseconds since the UNIX epoch (POSIX) or since boot
+ * (FreeRTOS). Comparing `kernel_time_ns` against the time the data was
+ * generated gives the network latency, and comparing it against
+ * `read_time_ns` gives the delay within the host before the data was read.
+ */
+typedef struct {
+  /**
+   * The time the most recent data in the block was received by the kernel, or
+   * 0 if not available. See @ref Polaris_SetKernelTimestamps().
+   */
+  int64_t kernel_time_ns;
+  /** The time the block was read from the socket by the Polaris library. */
+  int64_t read_time_ns;
+} PolarisReceiveTime_t;
+
+/**
+ * @brief A function to be called with each block of incoming data and the time
+ *        it was received.
+ *
+ * @param info The user pointer provided to @ref
+ *        Polaris_SetRTCMTimestampedCallback().
+ * @param context The Polaris context.
+ * @param buffer The received data.
+ * @param size_bytes The number of bytes in `buffer`.
+ * @param receive_time The time the data was received.
+ */
+typedef void (*PolarisTimestampedCallback_t)(
+    void* info, PolarisContext_t* context, const uint8_t* buffer,
+    size_t size_bytes, const PolarisReceiveTime_t* receive_time);
+
+/**
+ * @brief A function to be called when the corrections service accepts or
+ *        rejects the authentication token.
+ *
+ * @param info The user pointer provided to @ref
+ *        Polaris_SetAuthStatusCallback().
+ * @param context The Polaris context.
+ * @param status @ref POLARIS_SUCCESS if the token was accepted, or @ref
+ *        POLARIS_AUTH_REJECTED if it was rejected.
+ * @param message The text explanation sent by the service on rejection, or
+ *        `NULL` if not available. The text is _not_ null-terminated.
+ * @param message_length The length of `message` (in bytes).
+ */
+typedef void (*PolarisAuthStatusCallback_t)(void* info,
+                                            PolarisContext_t* context,
+                                            int status, const char* message,
+                                            size_t message_length);
+
 typedef void (*PolarisPrintCallback_t)(const char* filename, int line,
                                        int level, const char* message);
 
+/**
+ * @brief Connection statistics for a Polaris context.
+ *
+ * Counters are cumulative over all connections made using the context since
+ * @ref Polaris_Init() was called. Times are in milliseconds since the UNIX
+ * epoch (POSIX) or since boot (FreeRTOS), or 0 if the event has not occurred.
+ *
+ * See @ref Polaris_GetStats().
+ */
+typedef struct {
+  /**
+   * @name Corrections Stream
+   * @{
+   */
+  /** The total number of bytes received. */
+  uint64_t bytes_received;
+  /** The number of data blocks received (successful socket reads). */
+  uint64_t reads;
+  /** The number of calls to the @ref Polaris_SetRTCMCallback() callback. */
+  uint64_t callbacks;
+  /** The number of calls to the @ref Polaris_SetRTCMFrameCallback() callback. */
+  uint64_t frame_callbacks;
+  /**
+   * The number of times no data arrived within @ref POLARIS_RECV_TIMEOUT_MS
+   * (blocking mode only).
+   */
+  uint32_t receive_timeouts;
+  /**
+   * The total number of bytes sent to the corrections service, including the
+   * authentication token, unique ID, and position/beacon requests.
+   */
+  uint64_t bytes_sent;
+  /** The number of position/beacon requests sent. */
+  uint32_t requests_sent;
+  /** @} */
+
+  /**
+   * @name Connections
+   * @{
+   */
+  /** The number of attempts to connect to the corrections service. */
+  uint32_t connect_attempts;
+  /** The number of connection attempts that failed. */
+  uint32_t connect_failures;
+  /** Connections closed by @ref Polaris_Disconnect(). */
+  uint32_t closed_by_user;
+  /** Connections closed by the corrections service. */
+  uint32_t closed_remotely;
+  /** Connections closed because of a socket error. */
+  uint32_t closed_on_error;
+  /** Connections closed by @ref Polaris_Run() because no data arrived. */
+  uint32_t closed_on_timeout;
+  /**
+   * Connections closed by @ref Polaris_Run() because the adaptive stall timeout
+   * expired (see @ref Polaris_SetStallDetection()). These are also counted in
+   * `closed_on_timeout`.
+   */
+  uint32_t closed_on_stall;
+  /** Connections closed because the authentication token was rejected. */
+  uint32_t closed_on_auth_rejected;
+  /**
+   * Connections taken over from another context by @ref
+   * Polaris_TakeConnection().
+   */
+  uint32_t connections_taken;
+  /** @} */
+
+  /**
+   * @name Authentication
+   * @{
+   */
+  /** The number of authentication requests sent. */
+  uint32_t auth_requests;
+  /** The number of authentication requests that failed. */
+  uint32_t auth_failures;
+  /** @} */
+
+  /**
+   * @name Timestamps
+   * @{
+   */
+  /** The time the most recent connection was established. */
+  uint64_t last_connect_time_ms;
+  /** The time the first data arrived on the most recent connection. */
+  uint64_t first_byte_time_ms;
+  /** The time the most recent data arrived. */
+  uint64_t last_byte_time_ms;
+  /** @} */
+
+  /**
+   * @name Connection Timing
+   *
+   * The duration of each phase of the most recent connection to the
+   * corrections service and the most recent authentication request, or -1 if
+   * not performed.
+   * @{
+   */
+  /** The time to resolve the endpoint address. */
+  int32_t dns_lookup_ms;
+  /** The time to establish a TCP connection. */
+  int32_t tcp_connect_ms;
+  /** The time to complete the TLS handshake. */
+  int32_t tls_handshake_ms;
+  /** The time to send an authentication request and receive the response. */
+  int32_t auth_ms;
+  /** @} */
+} PolarisStats_t;
+
+/**
+ * @brief TCP socket options.
+ *
+ * Options set to 0 leave the operating system default in place. See @ref
+ * Polaris_SetSocketOptions().
+ */
+typedef struct {
+  /**
+   * If nonzero, disable Nagle's algorithm (`TCP_NODELAY`) so small position
+   * updates are sent immediately.
+   */
+  uint8_t no_delay;
+  /**
+   * If nonzero, enable TCP keepalive (`SO_KEEPALIVE`), so a dead network path
+   * is detected even while no data is being sent.
+   */
+  uint8_t keepalive;
+  /** The idle time (in seconds) before the first keepalive probe is sent. */
+  int keepalive_idle_sec;
+  /** The interval (in seconds) between keepalive probes. */
+  int keepalive_interval_sec;
+  /** The number of unanswered keepalive probes before the connection fails. */
+  int keepalive_count;
+  /**
+   * The maximum time (in ms) that sent data may remain unacknowledged before
+   * the connection fails (`TCP_USER_TIMEOUT`, Linux only).
+   */
+  int user_timeout_ms;
+  /** The socket receive buffer size (`SO_RCVBUF`, in bytes). */
+  int recv_buffer_size;
+  /** The socket send buffer size (`SO_SNDBUF`, in bytes). */
+  int send_buffer_size;
+  /**
+   * The time (in us) to busy poll the network device for incoming data before
+   * sleeping (`SO_BUSY_POLL`, Linux only). This reduces receive latency at the
+   * cost of CPU usage, and may require `CAP_NET_ADMIN`.
+   */
+  int busy_poll_us;
+} PolarisSocketOptions_t;
+
+/**
+ * @brief The age of received corrections data.
+ *
+ * The age of a GNSS epoch is the time between the epoch time reported in the
+ * MSM observation messages and the time the first message for that epoch was
+ * received. Ages are in milliseconds, and may be slightly negative if the local
+ * clock is behind.
+ *
+ * See @ref Polaris_GetCorrectionAge().
+ */
+typedef struct {
+  /** The number of GNSS epochs measured since monitoring was enabled. */
+  uint32_t epoch_count;
+  /**
+   * The time of the most recent epoch (in milliseconds since the start of the
+   * GPS week).
+   */
+  uint32_t last_epoch_time_ms;
+  /** The age of the most recent epoch. */
+  int32_t last_age_ms;
+
+  /**
+   * @name Rolling Statistics
+   *
+   * Statistics over the most recent @ref POLARIS_CORRECTION_AGE_WINDOW_SIZE
+   * epochs.
+   * @{
+   */
+  /** The number of epochs included. */
+  uint32_t window_count;
+  int32_t window_min_age_ms;
+  int32_t window_max_age_ms;
+  int32_t window_mean_age_ms;
+  /** @} */
+} PolarisCorrectionAge_t;
+
 struct PolarisContext_s {
   P1_Socket_t socket;
 
   char auth_token[POLARIS_MAX_TOKEN_SIZE + 1];
+  // The lifetime of auth_token (in seconds) reported by the authentication
+  // server, or 0 if unknown.
+  int32_t auth_token_lifetime_sec;
   uint8_t authenticated;
   uint8_t disconnected;
   size_t total_bytes_received;
   uint8_t data_request_sent;
+  uint8_t nonblocking;
+  uint8_t poll_events;
+  uint8_t batched_reads;
+  int connect_timeout_ms;
+  PolarisSocketOptions_t socket_options;
+
+  // HTTP keep-alive settings and the host for the currently open connection.
+  // See Polaris_SetHTTPKeepAlive().
+  uint8_t http_keep_alive;
+  uint8_t http_connection_open;
+  int http_port;
+  char http_host[POLARIS_MAX_HTTP_HOST_SIZE + 1];
+
+  // The buffer used to receive incoming data. By default, this points to
+  // recv_buffer_storage below. See Polaris_InitWithRecvBuffer().
+  uint8_t* recv_buffer;
+  size_t recv_buffer_size;
 
   // Note: Enforcing 4-byte alignment of the buffers for platforms that require
   // aligned 2- or 4-byte access.
-  uint8_t recv_buffer[POLARIS_RECV_BUFFER_SIZE] __attribute__((aligned (4)));
+  uint8_t recv_buffer_storage[POLARIS_RECV_BUFFER_SIZE]
+      __attribute__((aligned (4)));
   uint8_t send_buffer[POLARIS_SEND_BUFFER_SIZE] __attribute__((aligned (4)));
 
+  // Single-entry mailbox holding the most recent encoded position or beacon
+  // request, written by Polaris_Queue*() from any thread and sent by the thread
+  // receiving data. Protected by a sequence lock: request_sequence is odd while
+  // a write is in progress, and advances by 2 for each completed write.
+  uint32_t request_sequence;
+  uint32_t request_size;
+  uint8_t request_buffer[POLARIS_SEND_BUFFER_SIZE] __attribute__((aligned (4)));
+  uint32_t request_sent_sequence;
+
+  // A request that could not be sent without blocking. The remaining bytes are
+  // sent, unchanged, before any other request. pending_poll_events is what the
+  // socket must be ready for before trying again.
+  uint8_t pending_request_buffer[POLARIS_SEND_BUFFER_SIZE]
+      __attribute__((aligned (4)));
+  uint32_t pending_request_size;
+  uint32_t pending_request_offset;
+  uint8_t pending_poll_events;
+
   PolarisCallback_t rtcm_callback;
   void* rtcm_callback_info;
 
+  PolarisCallback_t rtcm_frame_callback;
+  void* rtcm_frame_callback_info;
+  PolarisRTCMFramer_t rtcm_framer;
+
+  PolarisTimestampedCallback_t rtcm_timestamped_callback;
+  void* rtcm_timestamped_callback_info;
+
+  // Kernel receive timestamp support. See Polaris_SetKernelTimestamps().
+  // kernel_receive_time_ns is updated by each socket read that reports a
+  // timestamp, or 0 if no timestamp has been received on this connection.
+  uint8_t kernel_timestamps;
+  int64_t kernel_receive_time_ns;
+
+  // Correction age monitoring. See Polaris_SetCorrectionAgeMonitor().
+  // correction_ages_ms is a ring buffer holding the ages of the most recent
+  // epochs, the next of which will be written at correction_age_index.
+  uint8_t correction_age_enabled;
+  int8_t leap_seconds;
+  int64_t current_receive_time_ns;
+  PolarisCorrectionAge_t correction_age;
+  int32_t correction_ages_ms[POLARIS_CORRECTION_AGE_WINDOW_SIZE];
+  uint32_t correction_age_index;
+
+  // Adaptive stall detection. See Polaris_SetStallDetection(). read_gaps_ms is
+  // a ring buffer holding the most recent intervals between reads, the next of
+  // which will be written at index (read_gap_count % POLARIS_STALL_WINDOW_SIZE).
+  double stall_multiplier;
+  int min_stall_timeout_ms;
+  uint32_t read_gaps_ms[POLARIS_STALL_WINDOW_SIZE];
+  uint32_t read_gap_count;
+
+  PolarisAuthStatusCallback_t auth_status_callback;
+  void* auth_status_callback_info;
+
   // Note: We're using void* to avoid needing the inclusion of SSL libs in the
   // header file.
+  //
+  // ssl_ctx refers to a TLS context shared by all Polaris contexts, and is held
+  // until Polaris_Free() is called.
   void* ssl_ctx;
   void* ssl;
+  uint8_t tls_session_resumed;
+
+  PolarisStats_t stats;
+
+  // Latency histograms (in microseconds). See
+  // Polaris_GetReadIntervalHistogram() and
+  // Polaris_GetCallbackDurationHistogram().
+  PolarisHistogram_t read_interval_histogram;
+  PolarisHistogram_t callback_duration_histogram;
+  // The time of the most recent successful read on the current connection, or
+  // 0 if no data has been received yet.
+  uint64_t last_read_time_us;
 };
 
 #ifdef __cplusplus
@@ -152,6 +630,34 @@ extern "C" {
  */
 int Polaris_Init(PolarisContext_t* context);
 
+/**
+ * @brief Initialize a Polaris context using a caller-provided receive buffer.
+ *
+ * By default, each context receives data into an internal buffer of @ref
+ * POLARIS_RECV_BUFFER_SIZE bytes. This function allows the buffer size to be
+ * chosen for each context at runtime instead. A larger buffer allows more
+ * data to be received, and dispatched, in a single call (see @ref
+ * Polaris_SetBatchedReads()).
+ *
+ * The buffer is used for all incoming data, including the HTTP authentication
+ * response, and must remain valid until @ref Polaris_Free() is called.
+ *
+ * @note
+ * Because the context refers to the buffer by address, it must not be copied
+ * after initialization.
+ *
+ * @param context The Polaris context to be used.
+ * @param buffer The buffer to be used, or `NULL` to use the default internal
+ *        buffer. Must be 4-byte aligned.
+ * @param size_bytes The size of `buffer` (in bytes).
+ *
+ * @return @ref POLARIS_SUCCESS on success.
+ * @return @ref POLARIS_NOT_ENOUGH_SPACE if the buffer is too small to store an
+ *         HTTP authentication response.
+ */
+int Polaris_InitWithRecvBuffer(PolarisContext_t* context, uint8_t* buffer,
+                               size_t size_bytes);
+
 /**
  * @brief Free memory and data structures used by a Polaris context.
  *
@@ -187,6 +693,37 @@ void Polaris_SetLogLevel(int log_level);
  */
 void Polaris_SetPrintCallback(PolarisPrintCallback_t callback);
 
+/**
+ * @brief Enable or disable asynchronous printing.
+ *
+ * By default, messages are formatted and printed (or passed to the print
+ * callback) immediately by the thread that generated them. At debug or trace
+ * level, that includes several messages for each block of data received by
+ * @ref Polaris_Work(), so a slow print callback (e.g., one that writes to a
+ * file) can delay incoming data.
+ *
+ * When enabled, each message is formatted into a fixed-size queue without
+ * taking a lock, and is printed or passed to the print callback by a background
+ * thread. Messages are delivered in order, and the time printed to stderr is
+ * the time the message was queued. If the queue is full, messages are dropped
+ * rather than blocking the caller, and the number of dropped messages is
+ * reported once space is available. See @ref POLARIS_ASYNC_PRINT_QUEUE_SIZE.
+ *
+ * Disabling asynchronous printing waits for all queued messages to be
+ * delivered. Queued messages are also delivered automatically when the
+ * application exits normally.
+ *
+ * @note
+ * Asynchronous printing is not supported on FreeRTOS.
+ *
+ * @param enabled If nonzero, print asynchronously.
+ *
+ * @return @ref POLARIS_SUCCESS on success.
+ * @return @ref POLARIS_ERROR if the print thread could not be started, or if
+ *         asynchronous printing is not supported on this platform.
+ */
+int Polaris_SetAsyncPrint(int enabled);
+
 /**
  * @brief Authenticate with Polaris.
  *
@@ -199,6 +736,9 @@ void Polaris_SetPrintCallback(PolarisPrintCallback_t callback);
  *
  * @post
  * On success, `context.auth_token` will be populated with the generated token.
+ * If the server reported the lifetime of the token (`expires_in`),
+ * `context.auth_token_lifetime_sec` will be set to the lifetime in seconds;
+ * otherwise, it will be set to 0.
  *
  * @section polaris_unique_id Connection Unique IDs
  * Polaris uses ID strings to uniquely identify client connections made using a
@@ -266,9 +806,10 @@ int Polaris_SetAuthToken(PolarisContext_t* context, const char* auth_token);
  *        token.
  *
  * @note
- * This function can not currently check for rejection of the authentication
- * token by the corrections service. Instead, authentication failure is detected
- * on the first call to @ref Polaris_Work().
+ * This function does not wait for the corrections service to accept or reject
+ * the authentication token. Instead, the response is detected by @ref
+ * Polaris_Work() when the first RTCM message arrives. See @ref
+ * Polaris_SetAuthStatusCallback().
  *
  * @param context The Polaris context to be used.
  *
@@ -292,6 +833,52 @@ int Polaris_Connect(PolarisContext_t* context);
 int Polaris_ConnectTo(PolarisContext_t* context, const char* endpoint_url,
                       int endpoint_port);
 
+/**
+ * @brief Open a connection to the specified corrections service URL without
+ *        sending an authentication token.
+ *
+ * This function performs the first half of @ref Polaris_ConnectTo(): it
+ * resolves the endpoint address, establishes a TCP connection, and performs the
+ * TLS handshake (if enabled). The token is sent separately by calling @ref
+ * Polaris_SendAuthToken().
+ *
+ * Splitting the connection into two steps allows an application to open the
+ * corrections stream while an authentication request is still in progress on a
+ * separate context, rather than waiting for the token before connecting. The
+ * corrections service will close the connection if it does not receive a token
+ * promptly, so the token should be sent as soon as it is available.
+ *
+ * @param context The Polaris context to be used.
+ * @param endpoint_url The desired endpoint URL.
+ * @param endpoint_port The desired endpoint port.
+ *
+ * @return @ref POLARIS_SUCCESS on success.
+ * @return @ref POLARIS_SOCKET_ERROR if a connection could not be established
+ *         with the Polaris corrections server.
+ */
+int Polaris_OpenStream(PolarisContext_t* context, const char* endpoint_url,
+                       int endpoint_port);
+
+/**
+ * @brief Send the stored authentication token on a connection opened with @ref
+ *        Polaris_OpenStream().
+ *
+ * The token must be set by calling @ref Polaris_SetAuthToken() (or @ref
+ * Polaris_AuthenticateTo() on this context) before calling this function. As
+ * with @ref Polaris_ConnectTo(), this function does not wait for the
+ * corrections service to accept or reject the token.
+ *
+ * @param context The Polaris context to be used.
+ *
+ * @return @ref POLARIS_SUCCESS on success.
+ * @return @ref POLARIS_SOCKET_ERROR if the connection is not open.
+ * @return @ref POLARIS_AUTH_ERROR if an authentication token was not provided.
+ *         The connection will be closed.
+ * @return @ref POLARIS_SEND_ERROR if an error occurred while sending the
+ *         authentication token. The connection will be closed.
+ */
+int Polaris_SendAuthToken(PolarisContext_t* context);
+
 /**
  * @brief Connect to the corrections service without providing an authentication
  *        token.
@@ -331,6 +918,60 @@ int Polaris_ConnectWithoutAuth(PolarisContext_t* context,
  */
 void Polaris_Disconnect(PolarisContext_t* context);
 
+/**
+ * @brief Interrupt a call to @ref Polaris_Work() or @ref Polaris_Run() in
+ *        progress on another thread, closing the corrections stream.
+ *
+ * Unlike @ref Polaris_Disconnect(), this function does not use the TLS
+ * connection or close the socket, both of which may be in use by the thread
+ * receiving data. It only marks the connection as disconnected and shuts the
+ * socket down, waking up the receiving thread. That thread then closes the
+ * connection itself before @ref Polaris_Work() or @ref Polaris_Run() returns.
+ *
+ * An HTTP request in progress on another thread (e.g., @ref
+ * Polaris_Authenticate()) is interrupted in the same way, and fails. An idle
+ * HTTP keep-alive connection is not affected.
+ *
+ * @param context The Polaris context to be interrupted.
+ */
+void Polaris_Interrupt(PolarisContext_t* context);
+
+/**
+ * @brief Take over an open corrections stream from another context.
+ *
+ * This function supports "make-before-break" reconnection, e.g., to switch to
+ * a new access token or endpoint without a gap in the data. The new connection
+ * is opened and checked using a separate context (`source`). Once it is
+ * receiving data, the connection is moved to `context`, which continues to
+ * receive data on it using its own callbacks, settings, and statistics. No
+ * DNS lookup, TCP connection, TLS handshake, or authentication is required.
+ *
+ * Any connection currently open on `context` is closed first. A partial RTCM
+ * frame received by `source` is kept, so frames spanning the switch are not
+ * lost. A position or beacon request queued on `context`, if any, is sent
+ * again on the new connection.
+ *
+ * `source` should be configured with the same kernel timestamp and
+ * non-blocking settings as `context`. The batched reads setting of `source`
+ * (see @ref Polaris_SetBatchedReads()) is applied to `context`, since it is
+ * part of the TLS connection. On return, `source` is disconnected, and may be
+ * freed with @ref Polaris_Free().
+ *
+ * @warning
+ * Neither context may be in use by @ref Polaris_Work(), @ref Polaris_Run(), or
+ * @ref Polaris_PollOnce() while this function is called.
+ *
+ * @param context The Polaris context to receive the connection.
+ * @param source The Polaris context with an open corrections stream.
+ *
+ * @return @ref POLARIS_SUCCESS on success.
+ * @return @ref POLARIS_SOCKET_ERROR if `source` does not have an open
+ *         corrections stream.
+ * @return @ref POLARIS_ERROR if the TLS context could not be initialized.
+ */
+int Polaris_TakeConnection(PolarisContext_t* context,
+                           PolarisContext_t* source);
+
 /**
  * @brief Specify a function to be called when RTCM corrections data is
  *        received.
@@ -344,6 +985,115 @@ void Polaris_SetRTCMCallback(PolarisContext_t* context,
                              PolarisCallback_t callback,
                              void* callback_info);
 
+/**
+ * @brief Specify a function to be called for each complete RTCM 3 message
+ *        received.
+ *
+ * Unlike @ref Polaris_SetRTCMCallback(), which is called with each block of
+ * data as it is received from the network, this callback is called once for
+ * each complete RTCM 3 frame (0xD3 preamble, header, payload, and CRC), and
+ * only after the frame's CRC-24Q has been validated. Incomplete or corrupt
+ * frames are discarded.
+ *
+ * Frames that are contained entirely within a single received data block are
+ * passed to the callback directly from `context->recv_buffer` without being
+ * copied. Frames spanning multiple blocks are reassembled internally before
+ * being dispatched.
+ *
+ * Both callbacks may be used at the same time. When both are registered, the
+ * data block callback is called first.
+ *
+ * @param context The Polaris context to be used.
+ * @param callback The function to be called, or `NULL` to disable framing.
+ * @param callback_info An arbitrary pointer that will be passed to the callback
+ *        function when it is called.
+ */
+void Polaris_SetRTCMFrameCallback(PolarisContext_t* context,
+                                  PolarisCallback_t callback,
+                                  void* callback_info);
+
+/**
+ * @brief Specify a function to be called with each block of incoming data and
+ *        the time it was received.
+ *
+ * This callback receives the same data as @ref Polaris_SetRTCMCallback(), and
+ * is called immediately after it. Both callbacks may be used at the same time.
+ *
+ * The receive time includes the time the data was read by the library, and
+ * the time it arrived in the kernel if kernel timestamps are enabled (see @ref
+ * Polaris_SetKernelTimestamps()).
+ *
+ * @param context The Polaris context to be used.
+ * @param callback The function to be called, or `NULL` to disable.
+ * @param callback_info An arbitrary pointer that will be passed to the callback
+ *        function when it is called.
+ */
+void Polaris_SetRTCMTimestampedCallback(PolarisContext_t* context,
+                                        PolarisTimestampedCallback_t callback,
+                                        void* callback_info);
+
+/**
+ * @brief Enable or disable kernel receive timestamps.
+ *
+ * By default, the receive time of incoming data is only known once it has been
+ * read from the socket, which includes any delay in scheduling the thread
+ * calling @ref Polaris_Work(). When enabled, `SO_TIMESTAMPNS` is set on the
+ * corrections stream socket, and the time each packet arrived in the kernel is
+ * read along with the data using `recvmsg()`. The timestamp is reported to the
+ * @ref Polaris_SetRTCMTimestampedCallback() callback.
+ *
+ * For TLS connections, the timestamp is captured as OpenSSL reads from the
+ * socket. If OpenSSL has already buffered the data returned by a read, the
+ * timestamp of the most recent packet it read is reported.
+ *
+ * The setting takes effect on the next connection.
+ *
+ * @note
+ * Kernel timestamps are currently only supported on Linux (and, for TLS
+ * connections, OpenSSL 1.1.0 or newer or BoringSSL).
+ *
+ * @param context The Polaris context to be used.
+ * @param enabled If nonzero, enable kernel timestamps.
+ *
+ * @return @ref POLARIS_SUCCESS on success.
+ * @return @ref POLARIS_ERROR if kernel timestamps are not supported on this
+ *         platform.
+ */
+int Polaris_SetKernelTimestamps(PolarisContext_t* context, int enabled);
+
+/**
+ * @brief Specify a function to be called when the corrections service accepts
+ *        or rejects the authentication token.
+ *
+ * If the authentication token is rejected, the corrections service responds
+ * with an RTCM 1029 text message describing the reason before closing the
+ * connection. @ref Polaris_Work() decodes the incoming RTCM stream, before
+ * delivering it, until one of the following arrives:
+ * - A 1029 text message describing an authentication failure (e.g., an invalid
+ *   or expired token). The token is considered rejected. The callback is called
+ *   with @ref POLARIS_AUTH_REJECTED and the message text, and @ref
+ *   Polaris_Work() closes the connection and returns @ref
+ *   POLARIS_AUTH_REJECTED immediately, without delivering the data received
+ *   with or after the rejection, rather than waiting for the connection to be
+ *   closed remotely.
+ * - Any message other than a 1029 text message. The token is considered
+ *   accepted and the callback is called with @ref POLARIS_SUCCESS.
+ *
+ * Other 1029 text messages, including ones that cannot be decoded, are
+ * delivered normally and do not decide whether the token was accepted.
+ *
+ * The callback is called at most once per connection. It is not called for
+ * connections made with @ref Polaris_ConnectWithoutAuth().
+ *
+ * @param context The Polaris context to be used.
+ * @param callback The function to be called.
+ * @param callback_info An arbitrary pointer that will be passed to the callback
+ *        function when it is called.
+ */
+void Polaris_SetAuthStatusCallback(PolarisContext_t* context,
+                                   PolarisAuthStatusCallback_t callback,
+                                   void* callback_info);
+
 /**
  * @brief Send a position update to the corrections service.
  *
@@ -351,12 +1101,21 @@ void Polaris_SetRTCMCallback(PolarisContext_t* context,
  * You must send a position at least once to associate with a corrections
  * stream before Polaris will return any corrections data.
  *
+ * This function sends the request immediately from the calling thread. To
+ * update the request from a different thread than the one receiving data, use
+ * @ref Polaris_QueueECEFPosition() instead.
+ *
  * @param context The Polaris context to be used.
  * @param x_m The receiver ECEF X position (in meters).
  * @param y_m The receiver ECEF Y position (in meters).
  * @param z_m The receiver ECEF Z position (in meters).
  *
  * @return @ref POLARIS_SUCCESS on success.
+ * @return @ref POLARIS_WOULD_BLOCK if the request could not be sent without
+ *         blocking (non-blocking mode). This is not an error: the request is
+ *         stored in the context and sent by @ref Polaris_PollOnce() once the
+ *         socket is ready (see @ref Polaris_GetPollEvents()), so it should not
+ *         be sent again.
  * @return @ref POLARIS_SEND_ERROR if the request could not be sent.
  * @return @ref POLARIS_SOCKET_ERROR if socket is not currently open.
  */
@@ -370,12 +1129,21 @@ int Polaris_SendECEFPosition(PolarisContext_t* context, double x_m, double y_m,
  * You must send a position at least once to associate with a corrections
  * stream before Polaris will return any corrections data.
  *
+ * This function sends the request immediately from the calling thread. To
+ * update the request from a different thread than the one receiving data, use
+ * @ref Polaris_QueueLLAPosition() instead.
+ *
  * @param context The Polaris context to be used.
  * @param latitude_deg The receiver WGS-84 latitude (in degrees).
  * @param longitude_deg The receiver WGS-84 longitude (in degrees).
  * @param altitude_m The receiver WGS-84 altitude (in meters).
  *
  * @return @ref POLARIS_SUCCESS on success.
+ * @return @ref POLARIS_WOULD_BLOCK if the request could not be sent without
+ *         blocking (non-blocking mode). This is not an error: the request is
+ *         stored in the context and sent by @ref Polaris_PollOnce() once the
+ *         socket is ready (see @ref Polaris_GetPollEvents()), so it should not
+ *         be sent again.
  * @return @ref POLARIS_SEND_ERROR if the request could not be sent.
  * @return @ref POLARIS_SOCKET_ERROR if socket is not currently open.
  */
@@ -388,15 +1156,95 @@ int Polaris_SendLLAPosition(PolarisContext_t* context, double latitude_deg,
  * If desired, override the corrections stream assigned based on specified
  * receiver position and instead send corrections from the requested beacon.
  *
+ * This function sends the request immediately from the calling thread. To
+ * update the request from a different thread than the one receiving data, use
+ * @ref Polaris_QueueBeaconRequest() instead.
+ *
  * @param context The Polaris context to be used.
  * @param beacon_id The desired beacon ID.
  *
  * @return @ref POLARIS_SUCCESS on success.
+ * @return @ref POLARIS_WOULD_BLOCK if the request could not be sent without
+ *         blocking (non-blocking mode). This is not an error: the request is
+ *         stored in the context and sent by @ref Polaris_PollOnce() once the
+ *         socket is ready (see @ref Polaris_GetPollEvents()), so it should not
+ *         be sent again.
  * @return @ref POLARIS_SEND_ERROR if the request could not be sent.
  * @return @ref POLARIS_SOCKET_ERROR if socket is not currently open.
  */
 int Polaris_RequestBeacon(PolarisContext_t* context, const char* beacon_id);
 
+/**
+ * @brief Queue a position update to be sent to the corrections service.
+ *
+ * Unlike @ref Polaris_SendECEFPosition(), this function does not perform any
+ * network I/O. Instead, it stores the request in a single-entry mailbox in the
+ * context, replacing any request that has not been sent yet. The most recent
+ * request is sent by the thread receiving data, the next time @ref
+ * Polaris_Work(), @ref Polaris_Run(), or @ref Polaris_PollOnce() checks the
+ * mailbox, and is sent again automatically each time a new connection is
+ * established.
+ *
+ * This function may be called from any thread at any time, including while
+ * disconnected. It never blocks waiting on I/O or on the receiving thread, and
+ * the most recent update is never dropped.
+ *
+ * @note
+ * Once data is flowing, the mailbox is checked each time data arrives
+ * (typically once per second). Before the first request has been sent, @ref
+ * Polaris_Work() checks it every @ref POLARIS_REQUEST_POLL_INTERVAL_MS. In
+ * non-blocking mode, call @ref Polaris_PollOnce() after queueing a request to
+ * send it immediately.
+ *
+ * @param context The Polaris context to be used.
+ * @param x_m The receiver ECEF X position (in meters).
+ * @param y_m The receiver ECEF Y position (in meters).
+ * @param z_m The receiver ECEF Z position (in meters).
+ *
+ * @return @ref POLARIS_SUCCESS on success.
+ */
+int Polaris_QueueECEFPosition(PolarisContext_t* context, double x_m, double y_m,
+                              double z_m);
+
+/**
+ * @brief Queue a position update to be sent to the corrections service.
+ *
+ * See @ref Polaris_QueueECEFPosition() for details.
+ *
+ * @param context The Polaris context to be used.
+ * @param latitude_deg The receiver WGS-84 latitude (in degrees).
+ * @param longitude_deg The receiver WGS-84 longitude (in degrees).
+ * @param altitude_m The receiver WGS-84 altitude (in meters).
+ *
+ * @return @ref POLARIS_SUCCESS on success.
+ */
+int Polaris_QueueLLAPosition(PolarisContext_t* context, double latitude_deg,
+                             double longitude_deg, double altitude_m);
+
+/**
+ * @brief Queue a request for corrections from a specific base station.
+ *
+ * See @ref Polaris_QueueECEFPosition() for details.
+ *
+ * @param context The Polaris context to be used.
+ * @param beacon_id The desired beacon ID.
+ *
+ * @return @ref POLARIS_SUCCESS on success.
+ * @return @ref POLARIS_NOT_ENOUGH_SPACE if the beacon ID is too long.
+ */
+int Polaris_QueueBeaconRequest(PolarisContext_t* context,
+                               const char* beacon_id);
+
+/**
+ * @brief Clear any queued position or beacon request.
+ *
+ * The request will not be sent on subsequent connections until a new request
+ * is queued.
+ *
+ * @param context The Polaris context to be used.
+ */
+void Polaris_ClearQueuedRequest(PolarisContext_t* context);
+
 /**
  * @brief Receive and dispatch the next block of incoming data.
  *
@@ -404,6 +1252,9 @@ int Polaris_RequestBeacon(PolarisContext_t* context, const char* beacon_id);
  * POLARIS_RECV_TIMEOUT_MS elapses. If @ref Polaris_Disconnect() is called, this
  * function will return immediately.
  *
+ * Any pending request queued by @ref Polaris_QueueLLAPosition() or similar is
+ * sent before waiting for data.
+ *
  * If an error occurs and this function returns <0 (with the exception of @ref
  * POLARIS_TIMED_OUT -- see below), the socket will be closed before the
  * function returns.
@@ -419,12 +1270,15 @@ int Polaris_RequestBeacon(PolarisContext_t* context, const char* beacon_id);
  *
  * @note
  * There is no guarantee that a data block contains a complete RTCM message, or
- * starts on an RTCM message boundary.
+ * starts on an RTCM message boundary. Use @ref Polaris_SetRTCMFrameCallback()
+ * to receive complete messages.
  *
  * @post
- * The received data will be stored in `context->buffer` on return. If a
+ * The received data will be stored in `context->recv_buffer` on return. If a
  * callback function is registered (@ref Polaris_SetRTCMCallback()), it will be
- * called the the received data before this function returns.
+ * called the the received data before this function returns. If a frame
+ * callback is registered (@ref Polaris_SetRTCMFrameCallback()), it will be
+ * called for each RTCM message completed by the received data.
  *
  * @param context The Polaris context to be used.
  *
@@ -432,6 +1286,9 @@ int Polaris_RequestBeacon(PolarisContext_t* context, const char* beacon_id);
  * @return @ref POLARIS_CONNECTION_CLOSED if the connection was closed remotely
  *         or by calling @ref Polaris_Disconnect().
  * @return @ref POLARIS_TIMED_OUT if the socket receive timeout elapsed.
+ * @return @ref POLARIS_AUTH_REJECTED if the corrections service rejected the
+ *         authentication token (invalid or expired access token). See @ref
+ *         Polaris_SetAuthStatusCallback().
  * @return @ref POLARIS_FORBIDDEN if the connection is closed after a position
  *         or beacon request is sent but before any data is received, indicating
  *         a possible authentication failure (invalid or expired access token).
@@ -439,6 +1296,389 @@ int Polaris_RequestBeacon(PolarisContext_t* context, const char* beacon_id);
  */
 int Polaris_Work(PolarisContext_t* context);
 
+/**
+ * @brief Enable or disable batched reads.
+ *
+ * By default, @ref Polaris_Work() performs a single socket read and calls the
+ * data callback once for each read. When data arrives in bursts (e.g., a set of
+ * MSM messages at the start of each GNSS epoch), this may result in several
+ * reads and callbacks for a single burst.
+ *
+ * In batched mode, after the first read completes, the socket is drained
+ * without blocking (`MSG_DONTWAIT`) until no more data is available or the
+ * receive buffer is full, and the data callback is then called once for all
+ * of the accumulated data. For TLS connections, OpenSSL read-ahead is enabled
+ * so that all available data is pulled from the socket at once, and the
+ * decrypted data is drained using `SSL_pending()`.
+ *
+ * Batched mode is most effective with a receive buffer large enough to store a
+ * complete burst. See @ref Polaris_InitWithRecvBuffer().
+ *
+ * @param context The Polaris context to be used.
+ * @param enabled If nonzero, enable batched reads.
+ */
+void Polaris_SetBatchedReads(PolarisContext_t* context, int enabled);
+
+/**
+ * @brief Set the maximum amount of time to wait for a TCP connection to be
+ *        established.
+ *
+ * The timeout applies to each connection to the authentication server and the
+ * corrections endpoint, covering all addresses tried for the host. DNS lookup
+ * and the TLS handshake are not included.
+ *
+ * @note
+ * On FreeRTOS, connections use the socket receive timeout (@ref
+ * POLARIS_RECV_TIMEOUT_MS) and this setting is ignored.
+ *
+ * @param context The Polaris context to be used.
+ * @param timeout_ms The connection timeout (in ms), or <= 0 to use the default
+ *        value, @ref POLARIS_CONNECT_TIMEOUT_MS.
+ */
+void Polaris_SetConnectTimeout(PolarisContext_t* context, int timeout_ms);
+
+/**
+ * @brief Get the default socket options.
+ *
+ * All options are set to 0, using the operating system defaults.
+ *
+ * @param options The structure to be populated.
+ */
+void Polaris_GetDefaultSocketOptions(PolarisSocketOptions_t* options);
+
+/**
+ * @brief Get socket options tuned for low latency and fast detection of dead
+ *        connections.
+ *
+ * Disables Nagle's algorithm and enables TCP keepalive (5 second idle time,
+ * 2 second interval, 3 probes), and fails the connection if sent data is not
+ * acknowledged within 10 seconds. A silently dropped network path (e.g.,
+ * cellular handover) is then detected in roughly 10 seconds instead of waiting
+ * for the connection timeout in @ref Polaris_Run().
+ *
+ * Busy polling is _not_ enabled, since it increases CPU usage. Set
+ * `busy_poll_us` explicitly if desired.
+ *
+ * @param options The structure to be populated.
+ */
+void Polaris_GetLowLatencySocketOptions(PolarisSocketOptions_t* options);
+
+/**
+ * @brief Set the TCP socket options used for new connections.
+ *
+ * The options are applied to each socket opened by the context, including
+ * connections to the authentication server, and take effect on the next
+ * connection. Options that are not supported by the platform are ignored with
+ * a warning.
+ *
+ * @note
+ * Socket options are not currently supported on FreeRTOS, and are ignored.
+ *
+ * @param context The Polaris context to be used.
+ * @param options The options to be used.
+ */
+void Polaris_SetSocketOptions(PolarisContext_t* context,
+                              const PolarisSocketOptions_t* options);
+
+/**
+ * @brief Enable or disable reuse of the connection to the authentication
+ *        server between successive authentication requests.
+ *
+ * By default, each call to @ref Polaris_AuthenticateTo() opens a new TCP (and
+ * TLS) connection to the authentication server, which is closed once the
+ * response is received. When keep-alive is enabled, the connection is left open
+ * after a complete response, provided the server permits it, and is reused by
+ * the next authentication request to the same host. This is useful for
+ * applications authenticating many unique IDs back to back.
+ *
+ * If the server has closed the idle connection, a new connection is opened
+ * automatically. An idle connection is closed when connecting to the
+ * corrections service, when keep-alive is disabled, or when @ref
+ * Polaris_Free() is called.
+ *
+ * @param context The Polaris context to be used.
+ * @param enabled If nonzero, enable HTTP keep-alive.
+ */
+void Polaris_SetHTTPKeepAlive(PolarisContext_t* context, int enabled);
+
+/**
+ * @brief Discard all addresses stored in the process-wide DNS cache.
+ *
+ * By default, the addresses for each host are cached for @ref
+ * POLARIS_DNS_CACHE_TTL_MS, and are refreshed in the background after that.
+ * If none of the cached addresses for a host can be reached, they are looked
+ * up again automatically on the next connection attempt. This function may be
+ * used to force a new lookup for all hosts, e.g., after a network change.
+ *
+ * @note
+ * DNS caching is not supported on FreeRTOS.
+ */
+void Polaris_ClearDNSCache(void);
+
+/**
+ * @brief Check if the most recent connection resumed a previous TLS session.
+ *
+ * All Polaris contexts in a process share a single TLS context. Session
+ * tickets received from each endpoint are stored and used to resume the
+ * session on the next connection, avoiding a full TLS handshake when
+ * reconnecting.
+ *
+ * @param context The Polaris context to be used.
+ *
+ * @return 1 if the session was resumed, or 0 if a full handshake was performed
+ *         or TLS is not enabled.
+ */
+int Polaris_IsTLSSessionResumed(const PolarisContext_t* context);
+
+/**
+ * @brief Get connection statistics for a context.
+ *
+ * See @ref PolarisStats_t for details.
+ *
+ * @note
+ * Statistics are updated by the thread calling @ref Polaris_Work() or @ref
+ * Polaris_Run() without synchronization. Like @ref Polaris_SendECEFPosition(),
+ * this function should be called from that thread (e.g., from a data
+ * callback), or while the connection is not in use.
+ *
+ * @param context The Polaris context to be used.
+ * @param stats The structure to be populated.
+ */
+void Polaris_GetStats(const PolarisContext_t* context, PolarisStats_t* stats);
+
+/**
+ * @brief Get a histogram of the time between successful reads from the
+ *        corrections stream.
+ *
+ * Values are in microseconds. The first read on each connection is not
+ * included, so reconnect times do not appear in the histogram. In batched mode
+ * (see @ref Polaris_SetBatchedReads()), all data drained at once counts as a
+ * single read.
+ *
+ * See @ref PolarisHistogram_t and @ref Polaris_HistogramGetPercentile().
+ *
+ * @note
+ * Like @ref Polaris_GetStats(), this function should be called from the thread
+ * calling @ref Polaris_Work() or @ref Polaris_Run(), or while the connection is
+ * not in use.
+ *
+ * @param context The Polaris context to be used.
+ * @param histogram The structure to be populated.
+ */
+void Polaris_GetReadIntervalHistogram(const PolarisContext_t* context,
+                                      PolarisHistogram_t* histogram);
+
+/**
+ * @brief Get a histogram of the time spent in each call to the @ref
+ *        Polaris_SetRTCMCallback() callback.
+ *
+ * Values are in microseconds. A slow callback delays reading from the socket,
+ * so large values here often explain large read intervals (see @ref
+ * Polaris_GetReadIntervalHistogram()).
+ *
+ * @note
+ * Like @ref Polaris_GetStats(), this function should be called from the thread
+ * calling @ref Polaris_Work() or @ref Polaris_Run(), or while the connection is
+ * not in use.
+ *
+ * @param context The Polaris context to be used.
+ * @param histogram The structure to be populated.
+ */
+void Polaris_GetCallbackDurationHistogram(const PolarisContext_t* context,
+                                          PolarisHistogram_t* histogram);
+
+/**
+ * @brief Clear the read interval and callback duration histograms.
+ *
+ * The next read interval is measured from the most recent read, if any.
+ *
+ * @note
+ * This function is not thread-safe, and should be called from the thread
+ * calling @ref Polaris_Work() or @ref Polaris_Run(), or while the connection is
+ * not in use.
+ *
+ * @param context The Polaris context to be used.
+ */
+void Polaris_ResetHistograms(PolarisContext_t* context);
+
+/**
+ * @brief Enable or disable correction age monitoring.
+ *
+ * When enabled, the incoming RTCM stream is decoded (see @ref
+ * Polaris_SetRTCMFrameCallback()), and the GNSS epoch time of each MSM
+ * observation message (1071-1127) is compared against the time the message was
+ * received. Late corrections degrade RTK performance well before the stream
+ * stops entirely and the connection timeout in @ref Polaris_Run() expires.
+ *
+ * The receive time is the kernel receive time if enabled (see @ref
+ * Polaris_SetKernelTimestamps()), or the time the data was read otherwise.
+ * The receive time is converted to GPS time using the leap second offset
+ * provided to @ref Polaris_SetLeapSeconds().
+ *
+ * @note
+ * The age is only meaningful if the system clock is synchronized to UTC (e.g.,
+ * using NTP or GNSS). Correction age monitoring is not supported on FreeRTOS,
+ * which does not provide the current time.
+ *
+ * @param context The Polaris context to be used.
+ * @param enabled If nonzero, enable correction age monitoring.
+ *
+ * @return @ref POLARIS_SUCCESS on success.
+ * @return @ref POLARIS_ERROR if not supported on this platform.
+ */
+int Polaris_SetCorrectionAgeMonitor(PolarisContext_t* context, int enabled);
+
+/**
+ * @brief Set the GPS-UTC offset used to compute correction age.
+ *
+ * Defaults to @ref POLARIS_GPS_UTC_LEAP_SECONDS. Applications with access to
+ * a GNSS receiver should update this from the leap second count it reports.
+ *
+ * @param context The Polaris context to be used.
+ * @param leap_seconds The number of leap seconds between GPS time and UTC.
+ */
+void Polaris_SetLeapSeconds(PolarisContext_t* context, int leap_seconds);
+
+/**
+ * @brief Get the age of the most recent corrections data.
+ *
+ * See @ref PolarisCorrectionAge_t and @ref Polaris_SetCorrectionAgeMonitor().
+ *
+ * @note
+ * Like @ref Polaris_GetStats(), this function should be called from the thread
+ * calling @ref Polaris_Work() or @ref Polaris_Run(), or while the connection is
+ * not in use.
+ *
+ * @param context The Polaris context to be used.
+ * @param age The structure to be populated.
+ */
+void Polaris_GetCorrectionAge(const PolarisContext_t* context,
+                              PolarisCorrectionAge_t* age);
+
+/**
+ * @brief Enable or disable adaptive stall detection in @ref Polaris_Run().
+ *
+ * Corrections data normally arrives at a steady rate (typically once per
+ * second). When enabled, the interval between reads is measured continuously,
+ * and @ref Polaris_Run() considers the connection lost if no data arrives
+ * within `multiplier` times the longest interval seen over the last @ref
+ * POLARIS_STALL_WINDOW_SIZE reads. With a multiplier of 2.5, a stalled 1 Hz
+ * stream is detected after 2.5 seconds, rather than waiting for the full
+ * connection timeout.
+ *
+ * The stall timeout is never less than `min_timeout_ms`, and never more than
+ * the connection timeout passed to @ref Polaris_Run(). It is not applied until
+ * @ref POLARIS_STALL_WINDOW_SIZE intervals have been measured, or before the
+ * first data arrives on a new connection. Measured intervals are kept when
+ * reconnecting.
+ *
+ * @param context The Polaris context to be used.
+ * @param multiplier The multiple of the learned data period after which the
+ *        stream is considered stalled, or <= 0 to disable (default).
+ * @param min_timeout_ms The minimum stall timeout (in ms), or <= 0 to use the
+ *        default value, @ref POLARIS_MIN_STALL_TIMEOUT_MS.
+ */
+void Polaris_SetStallDetection(PolarisContext_t* context, double multiplier,
+                               int min_timeout_ms);
+
+/**
+ * @brief Get the current adaptive stall timeout.
+ *
+ * See @ref Polaris_SetStallDetection().
+ *
+ * @param context The Polaris context to be used.
+ *
+ * @return The stall timeout (in ms), or -1 if stall detection is disabled or
+ *         not enough data has been received yet.
+ */
+int Polaris_GetStallTimeout(const PolarisContext_t* context);
+
+/**
+ * @brief Enable or disable non-blocking mode.
+ *
+ * By default, @ref Polaris_Work() and @ref Polaris_Run() block while waiting
+ * for incoming data, requiring a dedicated thread for each connection. In
+ * non-blocking mode, the application is instead expected to wait for the
+ * socket returned by @ref Polaris_GetFileDescriptor() to become ready using
+ * `select()`, `poll()`, `epoll`, or similar, and then call @ref
+ * Polaris_PollOnce() to receive and dispatch the available data.
+ *
+ * @note
+ * Non-blocking mode applies to the corrections stream once it is connected.
+ * Authentication and connection (@ref Polaris_Authenticate(), @ref
+ * Polaris_Connect(), etc.) still block until complete.
+ *
+ * @note
+ * Position and beacon requests are sent immediately. In the unlikely event
+ * that the socket send buffer is full, the request will fail with @ref
+ * POLARIS_SEND_ERROR rather than blocking.
+ *
+ * @param context The Polaris context to be used.
+ * @param enabled If nonzero, enable non-blocking mode.
+ */
+void Polaris_SetNonBlocking(PolarisContext_t* context, int enabled);
+
+/**
+ * @brief Get the socket used for the corrections stream.
+ *
+ * The returned socket may be used to wait for incoming data in non-blocking
+ * mode (see @ref Polaris_SetNonBlocking()). The application must not read from
+ * or write to the socket directly.
+ *
+ * @note
+ * The socket changes each time a new connection is established. Applications
+ * should query it again after calling @ref Polaris_Connect() and remove the
+ * old socket from any `select()`/`epoll` sets after a disconnect.
+ *
+ * @param context The Polaris context to be used.
+ *
+ * @return The socket, or @ref P1_INVALID_SOCKET if not connected.
+ */
+P1_Socket_t Polaris_GetFileDescriptor(const PolarisContext_t* context);
+
+/**
+ * @brief Get the socket events to wait for before calling @ref
+ *        Polaris_PollOnce() in non-blocking mode.
+ *
+ * Normally, this will be @ref POLARIS_WANT_READ. For TLS connections, the TLS
+ * library may occasionally need to write to the socket before it can read
+ * more data, in which case this will return @ref POLARIS_WANT_WRITE. @ref
+ * POLARIS_WANT_WRITE is also included while a position or beacon request is
+ * waiting to be sent (see @ref POLARIS_WOULD_BLOCK).
+ *
+ * @param context The Polaris context to be used.
+ *
+ * @return A bitmask of @ref POLARIS_WANT_READ and @ref POLARIS_WANT_WRITE, or 0
+ *         if not connected.
+ */
+int Polaris_GetPollEvents(const PolarisContext_t* context);
+
+/**
+ * @brief Receive and dispatch all currently available data without blocking.
+ *
+ * This function is intended to be used in non-blocking mode (see @ref
+ * Polaris_SetNonBlocking()) once the socket returned by @ref
+ * Polaris_GetFileDescriptor() is ready. It reads and dispatches data to the
+ * registered callback functions until no more data is available, and then
+ * returns immediately.
+ *
+ * As with @ref Polaris_Work(), if an error occurs and this function returns <0
+ * the socket will be closed before the function returns.
+ *
+ * @param context The Polaris context to be used.
+ *
+ * @return The number of received bytes, or 0 if no data was available.
+ * @return @ref POLARIS_CONNECTION_CLOSED if the connection was closed remotely
+ *         or by calling @ref Polaris_Disconnect().
+ * @return @ref POLARIS_AUTH_REJECTED if the corrections service rejected the
+ *         authentication token.
+ * @return @ref POLARIS_FORBIDDEN if the connection is closed after a position
+ *         or beacon request is sent but before any data is received, indicating
+ *         a possible authentication failure (invalid or expired access token).
+ * @return @ref POLARIS_SOCKET_ERROR if the socket is not currently open.
+ */
+int Polaris_PollOnce(PolarisContext_t* context);
+
 /**
  * @brief Receive and dispatch incoming data.
  *
@@ -447,7 +1687,11 @@ int Polaris_Work(PolarisContext_t* context);
  * @ref Polaris_Disconnect() is called.
  *
  * If the specified timeout has elapsed since the last time data was received,
- * the connection will be considered lost and the function will return.
+ * the connection will be considered lost and the function will return. The
+ * timeout is measured from the arrival of the most recent data, and is detected
+ * within a few milliseconds of expiring, independent of @ref
+ * POLARIS_RECV_TIMEOUT_MS (except on FreeRTOS). See also @ref
+ * Polaris_SetStallDetection().
  *
  * @post
  * Unlike @ref Polaris_Work(), a value of @ref POLARIS_TIMED_OUT here indicates
@@ -463,7 +1707,9 @@ int Polaris_Work(PolarisContext_t* context);
  *         both remote and local connection termination.
  * @return @ref POLARIS_CONNECTION_CLOSED if the connection was closed remotely.
  * @return @ref POLARIS_TIMED_OUT if no data was received for the specified
- *         timeout.
+ *         timeout, or the adaptive stall timeout.
+ * @return @ref POLARIS_AUTH_REJECTED if the corrections service rejected the
+ *         authentication token.
  * @return @ref POLARIS_FORBIDDEN if the connection is closed after a position
  *         or beacon request is sent but before any data is received, indicating
  *         a possible authentication failure (invalid or expired access token).
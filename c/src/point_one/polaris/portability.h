@@ -47,6 +47,14 @@ static inline int P1_GetElapsedMS(const P1_TimeValue_t* start,
   return (int)((*end - *start) * portTICK_PERIOD_MS);
 }
 
+static inline uint64_t P1_GetMonotonicTimeUS(void) {
+  return (uint64_t)xTaskGetTickCount() * portTICK_PERIOD_MS * 1000;
+}
+
+static inline int64_t P1_GetCurrentTimeNS(void) {
+  return (int64_t)xTaskGetTickCount() * portTICK_PERIOD_MS * 1000000;
+}
+
 static inline int P1_GetUTCOffsetSec(P1_TimeValue_t* time) { return 0; }
 
 static inline int P1_GetUTCOffsetHours(P1_TimeValue_t* time) {
@@ -58,6 +66,7 @@ static inline int P1_GetUTCOffsetHours(P1_TimeValue_t* time) {
 #  include <errno.h>
 #  include <stdio.h>
 #  include <sys/time.h>
+#  include <time.h>
 
 #  ifndef P1_printf
 #    define P1_printf printf
@@ -89,6 +98,22 @@ static inline int P1_GetElapsedMS(const P1_TimeValue_t* start,
   return (int)((delta.tv_sec * 1000) + (delta.tv_usec / 1000));
 }
 
+// Unlike P1_GetCurrentTime(), this clock is not affected by changes to the
+// system time, and is intended for measuring short intervals.
+static inline uint64_t P1_GetMonotonicTimeUS(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+}
+
+// The same clock as P1_GetCurrentTime() (and kernel receive timestamps), with
+// nanosecond resolution.
+static inline int64_t P1_GetCurrentTimeNS(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return ((int64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
 int P1_GetUTCOffsetSec(P1_TimeValue_t* time);
 
 static inline int P1_GetUTCOffsetHours(P1_TimeValue_t* time) {
@@ -0,0 +1,386 @@
+/**************************************************************************/ /**
+ * @brief RTCM 3 framing support.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/rtcm.h"
+
+#include <string.h> // For memcpy() and memmove()
+
+// CRC-24Q lookup table (polynomial 0x1864CFB).
+static const uint32_t CRC24Q_TABLE[256] = {
+    0x000000, 0x864CFB, 0x8AD50D, 0x0C99F6, 0x93E6E1, 0x15AA1A,
+    0x1933EC, 0x9F7F17, 0xA18139, 0x27CDC2, 0x2B5434, 0xAD18CF,
+    0x3267D8, 0xB42B23, 0xB8B2D5, 0x3EFE2E, 0xC54E89, 0x430272,
+    0x4F9B84, 0xC9D77F, 0x56A868, 0xD0E493, 0xDC7D65, 0x5A319E,
+    0x64CFB0, 0xE2834B, 0xEE1ABD, 0x685646, 0xF72951, 0x7165AA,
+    0x7DFC5C, 0xFBB0A7, 0x0CD1E9, 0x8A9D12, 0x8604E4, 0x00481F,
+    0x9F3708, 0x197BF3, 0x15E205, 0x93AEFE, 0xAD50D0, 0x2B1C2B,
+    0x2785DD, 0xA1C926, 0x3EB631, 0xB8FACA, 0xB4633C, 0x322FC7,
+    0xC99F60, 0x4FD39B, 0x434A6D, 0xC50696, 0x5A7981, 0xDC357A,
+    0xD0AC8C, 0x56E077, 0x681E59, 0xEE52A2, 0xE2CB54, 0x6487AF,
+    0xFBF8B8, 0x7DB443, 0x712DB5, 0xF7614E, 0x19A3D2, 0x9FEF29,
+    0x9376DF, 0x153A24, 0x8A4533, 0x0C09C8, 0x00903E, 0x86DCC5,
+    0xB822EB, 0x3E6E10, 0x32F7E6, 0xB4BB1D, 0x2BC40A, 0xAD88F1,
+    0xA11107, 0x275DFC, 0xDCED5B, 0x5AA1A0, 0x563856, 0xD074AD,
+    0x4F0BBA, 0xC94741, 0xC5DEB7, 0x43924C, 0x7D6C62, 0xFB2099,
+    0xF7B96F, 0x71F594, 0xEE8A83, 0x68C678, 0x645F8E, 0xE21375,
+    0x15723B, 0x933EC0, 0x9FA736, 0x19EBCD, 0x8694DA, 0x00D821,
+    0x0C41D7, 0x8A0D2C, 0xB4F302, 0x32BFF9, 0x3E260F, 0xB86AF4,
+    0x2715E3, 0xA15918, 0xADC0EE, 0x2B8C15, 0xD03CB2, 0x567049,
+    0x5AE9BF, 0xDCA544, 0x43DA53, 0xC596A8, 0xC90F5E, 0x4F43A5,
+    0x71BD8B, 0xF7F170, 0xFB6886, 0x7D247D, 0xE25B6A, 0x641791,
+    0x688E67, 0xEEC29C, 0x3347A4, 0xB50B5F, 0xB992A9, 0x3FDE52,
+    0xA0A145, 0x26EDBE, 0x2A7448, 0xAC38B3, 0x92C69D, 0x148A66,
+    0x181390, 0x9E5F6B, 0x01207C, 0x876C87, 0x8BF571, 0x0DB98A,
+    0xF6092D, 0x7045D6, 0x7CDC20, 0xFA90DB, 0x65EFCC, 0xE3A337,
+    0xEF3AC1, 0x69763A, 0x578814, 0xD1C4EF, 0xDD5D19, 0x5B11E2,
+    0xC46EF5, 0x42220E, 0x4EBBF8, 0xC8F703, 0x3F964D, 0xB9DAB6,
+    0xB54340, 0x330FBB, 0xAC70AC, 0x2A3C57, 0x26A5A1, 0xA0E95A,
+    0x9E1774, 0x185B8F, 0x14C279, 0x928E82, 0x0DF195, 0x8BBD6E,
+    0x872498, 0x016863, 0xFAD8C4, 0x7C943F, 0x700DC9, 0xF64132,
+    0x693E25, 0xEF72DE, 0xE3EB28, 0x65A7D3, 0x5B59FD, 0xDD1506,
+    0xD18CF0, 0x57C00B, 0xC8BF1C, 0x4EF3E7, 0x426A11, 0xC426EA,
+    0x2AE476, 0xACA88D, 0xA0317B, 0x267D80, 0xB90297, 0x3F4E6C,
+    0x33D79A, 0xB59B61, 0x8B654F, 0x0D29B4, 0x01B042, 0x87FCB9,
+    0x1883AE, 0x9ECF55, 0x9256A3, 0x141A58, 0xEFAAFF, 0x69E604,
+    0x657FF2, 0xE33309, 0x7C4C1E, 0xFA00E5, 0xF69913, 0x70D5E8,
+    0x4E2BC6, 0xC8673D, 0xC4FECB, 0x42B230, 0xDDCD27, 0x5B81DC,
+    0x57182A, 0xD154D1, 0x26359F, 0xA07964, 0xACE092, 0x2AAC69,
+    0xB5D37E, 0x339F85, 0x3F0673, 0xB94A88, 0x87B4A6, 0x01F85D,
+    0x0D61AB, 0x8B2D50, 0x145247, 0x921EBC, 0x9E874A, 0x18CBB1,
+    0xE37B16, 0x6537ED, 0x69AE1B, 0xEFE2E0, 0x709DF7, 0xF6D10C,
+    0xFA48FA, 0x7C0401, 0x42FA2F, 0xC4B6D4, 0xC82F22, 0x4E63D9,
+    0xD11CCE, 0x575035, 0x5BC9C3, 0xDD8538,
+};
+
+/******************************************************************************/
+static inline size_t GetFrameSize(const uint8_t* header) {
+  size_t payload_length = (((size_t)header[1] & 0x03) << 8) | header[2];
+  return POLARIS_RTCM3_HEADER_SIZE + payload_length + POLARIS_RTCM3_CRC_SIZE;
+}
+
+/******************************************************************************/
+static inline int IsValidHeader(const uint8_t* header) {
+  // The 6 bits following the preamble are reserved and must be 0.
+  return header[0] == POLARIS_RTCM3_PREAMBLE && (header[1] & 0xFC) == 0;
+}
+
+/******************************************************************************/
+static inline int IsValidCRC(const uint8_t* frame, size_t frame_size) {
+  size_t crc_offset = frame_size - POLARIS_RTCM3_CRC_SIZE;
+  uint32_t expected_crc = ((uint32_t)frame[crc_offset] << 16) |
+                          ((uint32_t)frame[crc_offset + 1] << 8) |
+                          frame[crc_offset + 2];
+  return Polaris_CalculateCRC24Q(frame, crc_offset) == expected_crc;
+}
+
+/******************************************************************************/
+static void DiscardBufferedBytes(PolarisRTCMFramer_t* framer, size_t count,
+                                 int delivered) {
+  // Drop the requested bytes, and then everything up to the next possible
+  // preamble. If the requested bytes were delivered as a frame, they are not
+  // counted as skipped.
+  //
+  // The frame handler may have reset the framer while we were dispatching, in
+  // which case there may be fewer bytes buffered than requested.
+  size_t offset = count < framer->current_size ? count : framer->current_size;
+  size_t delivered_bytes = delivered ? offset : 0;
+  while (offset < framer->current_size &&
+         framer->buffer[offset] != POLARIS_RTCM3_PREAMBLE) {
+    ++offset;
+  }
+
+  framer->skipped_bytes += (uint32_t)(offset - delivered_bytes);
+  framer->current_size -= offset;
+  memmove(framer->buffer, framer->buffer + offset, framer->current_size);
+}
+
+/******************************************************************************/
+static size_t ProcessBuffered(PolarisRTCMFramer_t* framer,
+                              PolarisRTCMFrameHandler_t handler,
+                              void* handler_info) {
+  // Dispatch or discard everything we can from the buffered data. This is
+  // normally a single pass. Multiple passes are only needed to resynchronize
+  // after a CRC failure, where the discarded candidate may have contained the
+  // start of a real frame.
+  size_t frame_count = 0;
+  while (framer->current_size >= POLARIS_RTCM3_HEADER_SIZE) {
+    if (!IsValidHeader(framer->buffer)) {
+      DiscardBufferedBytes(framer, 1, 0);
+      continue;
+    }
+
+    size_t frame_size = GetFrameSize(framer->buffer);
+    if (framer->current_size < frame_size) {
+      break;
+    } else if (IsValidCRC(framer->buffer, frame_size)) {
+      ++framer->frame_count;
+      ++frame_count;
+      handler(handler_info, framer->buffer, frame_size);
+      DiscardBufferedBytes(framer, frame_size, 1);
+    } else {
+      ++framer->crc_error_count;
+      DiscardBufferedBytes(framer, 1, 0);
+    }
+  }
+
+  return frame_count;
+}
+
+/******************************************************************************/
+void Polaris_RTCMFramerReset(PolarisRTCMFramer_t* framer) {
+  framer->current_size = 0;
+  framer->frame_count = 0;
+  framer->crc_error_count = 0;
+  framer->skipped_bytes = 0;
+}
+
+/******************************************************************************/
+size_t Polaris_RTCMFramerProcess(PolarisRTCMFramer_t* framer,
+                                 const uint8_t* buffer, size_t size_bytes,
+                                 PolarisRTCMFrameHandler_t handler,
+                                 void* handler_info) {
+  size_t frame_count = 0;
+  size_t offset = 0;
+  while (offset < size_bytes) {
+    // If we have a partial frame from a previous block, append as much as we
+    // need to complete the header or frame and then try to dispatch it.
+    if (framer->current_size > 0) {
+      size_t needed;
+      if (framer->current_size < POLARIS_RTCM3_HEADER_SIZE) {
+        needed = POLARIS_RTCM3_HEADER_SIZE - framer->current_size;
+      } else {
+        needed = GetFrameSize(framer->buffer) - framer->current_size;
+      }
+
+      size_t remaining = size_bytes - offset;
+      if (needed > remaining) {
+        needed = remaining;
+      }
+
+      memcpy(framer->buffer + framer->current_size, buffer + offset, needed);
+      framer->current_size += needed;
+      offset += needed;
+      frame_count += ProcessBuffered(framer, handler, handler_info);
+      continue;
+    }
+
+    // Otherwise, search for the next preamble.
+    const uint8_t* start = (const uint8_t*)memchr(
+        buffer + offset, POLARIS_RTCM3_PREAMBLE, size_bytes - offset);
+    if (start == NULL) {
+      framer->skipped_bytes += (uint32_t)(size_bytes - offset);
+      break;
+    }
+
+    framer->skipped_bytes += (uint32_t)(start - (buffer + offset));
+    offset = start - buffer;
+
+    // If the entire frame is available in the incoming data, validate and
+    // dispatch it in place without copying it.
+    size_t remaining = size_bytes - offset;
+    if (remaining >= POLARIS_RTCM3_HEADER_SIZE) {
+      if (!IsValidHeader(start)) {
+        ++framer->skipped_bytes;
+        ++offset;
+        continue;
+      }
+
+      size_t frame_size = GetFrameSize(start);
+      if (remaining >= frame_size) {
+        if (IsValidCRC(start, frame_size)) {
+          ++framer->frame_count;
+          ++frame_count;
+          handler(handler_info, start, frame_size);
+          offset += frame_size;
+        } else {
+          ++framer->crc_error_count;
+          ++framer->skipped_bytes;
+          ++offset;
+        }
+        continue;
+      }
+    }
+
+    // Frame is incomplete. Store what we have and wait for more data.
+    memcpy(framer->buffer, start, remaining);
+    framer->current_size = remaining;
+    break;
+  }
+
+  return frame_count;
+}
+
+/******************************************************************************/
+void Polaris_RTCMDedupReset(PolarisRTCMDedup_t* dedup) {
+  dedup->next_index = 0;
+  dedup->key_count = 0;
+  dedup->unique_count = 0;
+  dedup->duplicate_count = 0;
+}
+
+/******************************************************************************/
+int Polaris_RTCMDedupCheck(PolarisRTCMDedup_t* dedup, unsigned source,
+                           const uint8_t* frame, size_t size_bytes) {
+  // Key: 24-bit CRC, 12-bit message type, and frame length. Two different
+  // frames within the window are very unlikely to match.
+  uint64_t key = (uint64_t)size_bytes << 36 |
+                 (uint64_t)Polaris_GetRTCMMessageType(frame, size_bytes) << 24;
+  if (size_bytes >= POLARIS_RTCM3_HEADER_SIZE + POLARIS_RTCM3_CRC_SIZE) {
+    const uint8_t* crc = frame + size_bytes - POLARIS_RTCM3_CRC_SIZE;
+    key |= ((uint64_t)crc[0] << 16) | ((uint64_t)crc[1] << 8) | crc[2];
+  }
+
+  // Find the oldest copy of this frame not yet received on this stream. If
+  // there is one, this is the matching copy from a slower stream. Otherwise,
+  // this is either the first copy, or the same frame repeated on this stream,
+  // and it is new.
+  const uint8_t source_mask =
+      (uint8_t)(1u << (source % POLARIS_RTCM_DEDUP_MAX_SOURCES));
+  size_t index =
+      (dedup->next_index + POLARIS_RTCM_DEDUP_WINDOW_SIZE - dedup->key_count) %
+      POLARIS_RTCM_DEDUP_WINDOW_SIZE;
+  for (size_t i = 0; i < dedup->key_count; ++i) {
+    if (dedup->keys[index] == key && !(dedup->sources[index] & source_mask)) {
+      dedup->sources[index] |= source_mask;
+      ++dedup->duplicate_count;
+      return 0;
+    }
+    index = (index + 1) % POLARIS_RTCM_DEDUP_WINDOW_SIZE;
+  }
+
+  dedup->keys[dedup->next_index] = key;
+  dedup->sources[dedup->next_index] = source_mask;
+  dedup->next_index = (dedup->next_index + 1) % POLARIS_RTCM_DEDUP_WINDOW_SIZE;
+  if (dedup->key_count < POLARIS_RTCM_DEDUP_WINDOW_SIZE) {
+    ++dedup->key_count;
+  }
+  ++dedup->unique_count;
+  return 1;
+}
+
+/******************************************************************************/
+uint32_t Polaris_CalculateCRC24Q(const uint8_t* buffer, size_t length) {
+  uint32_t crc = 0;
+  for (size_t i = 0; i < length; ++i) {
+    crc = ((crc << 8) & 0xFFFFFF) ^ CRC24Q_TABLE[(crc >> 16) ^ buffer[i]];
+  }
+  return crc;
+}
+
+/******************************************************************************/
+uint16_t Polaris_GetRTCMMessageType(const uint8_t* frame, size_t size_bytes) {
+  if (size_bytes < POLARIS_RTCM3_HEADER_SIZE + 2 + POLARIS_RTCM3_CRC_SIZE) {
+    return 0;
+  } else {
+    return (uint16_t)((((uint16_t)frame[3]) << 4) | (frame[4] >> 4));
+  }
+}
+
+/******************************************************************************/
+int Polaris_GetRTCM1029Text(const uint8_t* frame, size_t size_bytes,
+                            const char** text, size_t* text_length) {
+  // Message 1029 header (72 bits):
+  // - Message number (DF002, 12 bits)
+  // - Reference station ID (DF003, 12 bits)
+  // - Modified Julian day (DF051, 16 bits)
+  // - Seconds of day (DF052, 17 bits)
+  // - Number of characters (DF138, 7 bits)
+  // - Number of UTF-8 code units (DF139, 8 bits)
+  static const size_t TEXT_OFFSET = POLARIS_RTCM3_HEADER_SIZE + 9;
+  if (size_bytes < TEXT_OFFSET + POLARIS_RTCM3_CRC_SIZE ||
+      Polaris_GetRTCMMessageType(frame, size_bytes) !=
+          POLARIS_RTCM3_TEXT_MESSAGE_TYPE) {
+    return -1;
+  }
+
+  size_t length = frame[TEXT_OFFSET - 1];
+  if (TEXT_OFFSET + length + POLARIS_RTCM3_CRC_SIZE > size_bytes) {
+    return -2;
+  }
+
+  *text = (const char*)(frame + TEXT_OFFSET);
+  *text_length = length;
+  return 0;
+}
+
+/******************************************************************************/
+int Polaris_IsRTCMMSMType(uint16_t message_type) {
+  // MSM message types are 10X1-10X7, where X identifies the constellation:
+  // 7 = GPS, 8 = GLONASS, 9 = Galileo, 10 = SBAS, 11 = QZSS, 12 = BeiDou.
+  unsigned msm_number = message_type % 10;
+  return message_type >= 1071 && message_type <= 1127 && msm_number >= 1 &&
+         msm_number <= 7;
+}
+
+/******************************************************************************/
+int Polaris_GetRTCMMSMEpochTime(const uint8_t* frame, size_t size_bytes,
+                                int leap_seconds,
+                                uint32_t* gps_time_of_week_ms,
+                                uint32_t* period_ms) {
+  // MSM header (first 54 bits):
+  // - Message number (DF002, 12 bits)
+  // - Reference station ID (DF003, 12 bits)
+  // - GNSS epoch time (30 bits): for GLONASS, the day of week (DF416, 3 bits)
+  //   and time of day (DF034, 27 bits); otherwise, the time of week (in ms).
+  if (size_bytes < POLARIS_RTCM3_HEADER_SIZE + 7 + POLARIS_RTCM3_CRC_SIZE) {
+    return -1;
+  }
+
+  uint16_t message_type = Polaris_GetRTCMMessageType(frame, size_bytes);
+  if (!Polaris_IsRTCMMSMType(message_type)) {
+    return -1;
+  }
+
+  const uint8_t* payload = frame + POLARIS_RTCM3_HEADER_SIZE;
+  uint32_t epoch_time = ((uint32_t)payload[3] << 22) |
+                        ((uint32_t)payload[4] << 14) |
+                        ((uint32_t)payload[5] << 6) | (payload[6] >> 2);
+
+  int64_t time_ms;
+  int64_t period;
+  switch (message_type / 10) {
+    case 108: {
+      // GLONASS: Moscow time (UTC + 3 hours). A day of week of 7 means unknown.
+      uint32_t day_of_week = epoch_time >> 27;
+      uint32_t time_of_day_ms = epoch_time & 0x7FFFFFF;
+      if (time_of_day_ms >= POLARIS_GPS_DAY_MS) {
+        return -2;
+      }
+
+      time_ms = (int64_t)time_of_day_ms - 3 * 3600000 + leap_seconds * 1000;
+      if (day_of_week == 7) {
+        period = POLARIS_GPS_DAY_MS;
+      } else {
+        time_ms += (int64_t)day_of_week * POLARIS_GPS_DAY_MS;
+        period = POLARIS_GPS_WEEK_MS;
+      }
+      break;
+    }
+    default:
+      if (epoch_time >= POLARIS_GPS_WEEK_MS) {
+        return -2;
+      }
+
+      // BeiDou: BDT = GPS - 14 seconds. All other constellations are aligned
+      // with GPS time.
+      time_ms = epoch_time;
+      if (message_type / 10 == 112) {
+        time_ms += 14000;
+      }
+      period = POLARIS_GPS_WEEK_MS;
+      break;
+  }
+
+  // Wrap the converted time back into [0, period).
+  time_ms %= period;
+  if (time_ms < 0) {
+    time_ms += period;
+  }
+
+  *gps_time_of_week_ms = (uint32_t)time_ms;
+  *period_ms = (uint32_t)period;
+  return 0;
+}
@@ -0,0 +1,236 @@
+/**************************************************************************/ /**
+ * @brief RTCM 3 framing support.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h> // For size_t
+#include <stdint.h>
+
+#define POLARIS_RTCM3_PREAMBLE 0xD3
+
+#define POLARIS_RTCM3_HEADER_SIZE 3
+#define POLARIS_RTCM3_CRC_SIZE 3
+#define POLARIS_RTCM3_MAX_PAYLOAD_SIZE 1023
+
+#define POLARIS_RTCM3_TEXT_MESSAGE_TYPE 1029
+
+#define POLARIS_GPS_WEEK_MS 604800000u
+#define POLARIS_GPS_DAY_MS 86400000u
+
+/**
+ * @brief The number of recent frames remembered by @ref PolarisRTCMDedup_t.
+ *
+ * The window must cover the largest expected delay between two streams
+ * carrying the same data, in frames. A frame arriving on the slower stream
+ * after it has left the window will be delivered a second time.
+ */
+#ifndef POLARIS_RTCM_DEDUP_WINDOW_SIZE
+# define POLARIS_RTCM_DEDUP_WINDOW_SIZE 256
+#endif
+
+/**
+ * @brief The maximum number of streams that can be merged by @ref
+ *        PolarisRTCMDedup_t.
+ */
+#define POLARIS_RTCM_DEDUP_MAX_SOURCES 8
+
+/**
+ * @brief The maximum size of a complete RTCM 3 frame (in bytes), including the
+ *        header and CRC.
+ */
+#define POLARIS_RTCM3_MAX_FRAME_SIZE                                \
+  (POLARIS_RTCM3_HEADER_SIZE + POLARIS_RTCM3_MAX_PAYLOAD_SIZE + \
+   POLARIS_RTCM3_CRC_SIZE)
+
+/**
+ * @brief A function to be called for each complete, validated RTCM 3 frame.
+ *
+ * @param info The user pointer provided to @ref Polaris_RTCMFramerProcess().
+ * @param frame A pointer to the start of the frame (the 0xD3 preamble).
+ * @param size_bytes The size of the frame (in bytes), including the header and
+ *        CRC.
+ */
+typedef void (*PolarisRTCMFrameHandler_t)(void* info, const uint8_t* frame,
+                                          size_t size_bytes);
+
+/**
+ * @brief RTCM 3 framer state.
+ *
+ * Frames contained entirely within a block of data passed to @ref
+ * Polaris_RTCMFramerProcess() are delivered in place, without being copied.
+ * Only frames spanning more than one block are accumulated in `buffer`.
+ */
+typedef struct {
+  uint8_t buffer[POLARIS_RTCM3_MAX_FRAME_SIZE];
+  size_t current_size;
+
+  uint32_t frame_count;
+  uint32_t crc_error_count;
+  uint32_t skipped_bytes;
+} PolarisRTCMFramer_t;
+
+/**
+ * @brief RTCM 3 frame deduplication state.
+ *
+ * Used to merge multiple streams carrying the same RTCM data (e.g., two
+ * connections to Polaris for redundancy), so that each frame is delivered only
+ * once. Frames are identified by their CRC, message type, and length, along
+ * with the set of streams they have been received on. The most recent @ref
+ * POLARIS_RTCM_DEDUP_WINDOW_SIZE frames are remembered.
+ *
+ * See @ref Polaris_RTCMDedupCheck().
+ */
+typedef struct {
+  uint64_t keys[POLARIS_RTCM_DEDUP_WINDOW_SIZE];
+  /** A bitmask of the streams each entry in `keys` has been received on. */
+  uint8_t sources[POLARIS_RTCM_DEDUP_WINDOW_SIZE];
+  /** The index of the next entry to be replaced in `keys`. */
+  size_t next_index;
+  /** The number of valid entries in `keys`. */
+  size_t key_count;
+
+  uint32_t unique_count;
+  uint32_t duplicate_count;
+} PolarisRTCMDedup_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reset a framer, discarding any partially received frame.
+ *
+ * @param framer The framer to be reset.
+ */
+void Polaris_RTCMFramerReset(PolarisRTCMFramer_t* framer);
+
+/**
+ * @brief Process a block of incoming data and dispatch complete frames.
+ *
+ * @param framer The framer to be used.
+ * @param buffer The incoming data.
+ * @param size_bytes The number of bytes in `buffer`.
+ * @param handler The function to be called for each complete, valid frame.
+ * @param handler_info An arbitrary pointer that will be passed to `handler`.
+ *
+ * @return The number of frames dispatched.
+ */
+size_t Polaris_RTCMFramerProcess(PolarisRTCMFramer_t* framer,
+                                 const uint8_t* buffer, size_t size_bytes,
+                                 PolarisRTCMFrameHandler_t handler,
+                                 void* handler_info);
+
+/**
+ * @brief Reset a deduplication window, forgetting all previous frames.
+ *
+ * @param dedup The state to be reset.
+ */
+void Polaris_RTCMDedupReset(PolarisRTCMDedup_t* dedup);
+
+/**
+ * @brief Check if a frame has already been received on another stream, and
+ *        remember it if not.
+ *
+ * A frame is a duplicate if an identical frame was recently received on a
+ * different stream, and has not been matched by a frame from this stream yet.
+ * Identical frames repeated on the same stream (e.g., static station
+ * information such as message 1005) are not duplicates: each repeat is
+ * delivered once.
+ *
+ * @param dedup The deduplication state.
+ * @param source An identifier for the stream the frame was received on, less
+ *        than @ref POLARIS_RTCM_DEDUP_MAX_SOURCES.
+ * @param frame A pointer to the start of a complete, valid RTCM 3 frame (e.g.,
+ *        as delivered by @ref Polaris_RTCMFramerProcess()).
+ * @param size_bytes The size of the frame (in bytes), including the header and
+ *        CRC.
+ *
+ * @return 1 if this is the first copy of the frame, or 0 if it is a duplicate
+ *         of a frame received on another stream.
+ */
+int Polaris_RTCMDedupCheck(PolarisRTCMDedup_t* dedup, unsigned source,
+                           const uint8_t* frame, size_t size_bytes);
+
+/**
+ * @brief Calculate the RTCM 3 CRC-24Q value for a block of data.
+ *
+ * @param buffer The data to be checked.
+ * @param length The number of bytes in `buffer`.
+ *
+ * @return The 24-bit CRC value.
+ */
+uint32_t Polaris_CalculateCRC24Q(const uint8_t* buffer, size_t length);
+
+/**
+ * @brief Get the message type of a complete RTCM 3 frame.
+ *
+ * @param frame A pointer to the start of the frame.
+ * @param size_bytes The size of the frame (in bytes).
+ *
+ * @return The 12-bit message type, or 0 if the frame does not contain a message
+ *         type.
+ */
+uint16_t Polaris_GetRTCMMessageType(const uint8_t* frame, size_t size_bytes);
+
+/**
+ * @brief Extract the text string from an RTCM 1029 (Unicode text string)
+ *        message.
+ *
+ * @note
+ * The returned string points into `frame` and is _not_ null-terminated.
+ *
+ * @param frame A pointer to the start of a complete RTCM 1029 frame.
+ * @param size_bytes The size of the frame (in bytes).
+ * @param text Set to the start of the UTF-8 text string on success.
+ * @param text_length Set to the length of the text string (in bytes) on
+ *        success.
+ *
+ * @return 0 on success, or <0 if the frame is not a valid 1029 message.
+ */
+int Polaris_GetRTCM1029Text(const uint8_t* frame, size_t size_bytes,
+                            const char** text, size_t* text_length);
+
+/**
+ * @brief Check if a message type is an MSM (Multiple Signal Message)
+ *        observation message.
+ *
+ * @param message_type The RTCM message type.
+ *
+ * @return 1 for MSM1-7 messages for GPS, GLONASS, Galileo, SBAS, QZSS, or
+ *         BeiDou (1071-1127), or 0 otherwise.
+ */
+int Polaris_IsRTCMMSMType(uint16_t message_type);
+
+/**
+ * @brief Get the GNSS epoch time of an MSM observation message, converted to
+ *        GPS time.
+ *
+ * Galileo, SBAS, and QZSS epoch times are aligned with GPS time. BeiDou epoch
+ * times are converted from BDT (GPS - 14 seconds). GLONASS epoch times are
+ * converted from Moscow time (UTC + 3 hours) using `leap_seconds`.
+ *
+ * GLONASS messages may not specify the day of the week. In that case,
+ * `gps_time_of_week_ms` is only known modulo one day, and `period_ms` is set to
+ * @ref POLARIS_GPS_DAY_MS instead of @ref POLARIS_GPS_WEEK_MS.
+ *
+ * @param frame A pointer to the start of a complete RTCM frame.
+ * @param size_bytes The size of the frame (in bytes).
+ * @param leap_seconds The current GPS-UTC offset (in seconds).
+ * @param gps_time_of_week_ms Set to the epoch time (in milliseconds since the
+ *        start of the GPS week) on success.
+ * @param period_ms Set to the period after which `gps_time_of_week_ms` wraps
+ *        (in milliseconds) on success.
+ *
+ * @return 0 on success, or <0 if the frame is not a valid MSM message.
+ */
+int Polaris_GetRTCMMSMEpochTime(const uint8_t* frame, size_t size_bytes,
+                                int leap_seconds,
+                                uint32_t* gps_time_of_week_ms,
+                                uint32_t* period_ms);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -35,6 +35,14 @@ typedef BaseType_t P1_RecvSize_t;
 
 #define SHUT_RDWR FREERTOS_SHUT_RDWR
 
+#define MSG_DONTWAIT FREERTOS_MSG_DONTWAIT
+
+// Flags used for all send() calls.
+#define P1_SEND_FLAGS 0
+
+// FreeRTOS+TCP does not support kernel receive timestamps.
+#define P1_HAVE_KERNEL_TIMESTAMPS 0
+
 // Aliases mapping FreeRTOS function names to Berkeley names. The APIs are the
 // same as the Berkeley definitions for all of these functions.
 #define socket FreeRTOS_socket
@@ -11,7 +11,9 @@
 #pragma once
 
 #include <netinet/in.h> // For IPPROTO_* macros and hton*()
-#include <netdb.h> // For gethostbyname() and hostent
+#include <netinet/tcp.h> // For TCP_NODELAY and TCP keepalive options
+#include <netdb.h> // For getaddrinfo()
+#include <poll.h> // For poll()
 #include <string.h> // For memcpy()
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -24,3 +26,19 @@ typedef struct sockaddr_in P1_SocketAddrV4_t;
 typedef struct sockaddr P1_SocketAddr_t;
 
 typedef ssize_t P1_RecvSize_t;
+
+// Flags used for all send() calls. Where supported, we suppress SIGPIPE if the
+// remote end has closed the connection and instead return an error.
+#ifdef MSG_NOSIGNAL
+# define P1_SEND_FLAGS MSG_NOSIGNAL
+#else
+# define P1_SEND_FLAGS 0
+#endif
+
+// Kernel receive timestamps (SO_TIMESTAMPNS) are currently supported on Linux
+// only.
+#if defined(__linux__) && defined(SO_TIMESTAMPNS)
+# define P1_HAVE_KERNEL_TIMESTAMPS 1
+#else
+# define P1_HAVE_KERNEL_TIMESTAMPS 0
+#endif
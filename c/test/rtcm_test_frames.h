@@ -0,0 +1,45 @@
+/**************************************************************************/ /**
+ * @brief RTCM 3 frame construction for the Polaris C library tests.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#pragma once
+
+#include <string.h> // For memset()
+
+#include "point_one/polaris/rtcm.h"
+
+/**
+ * @brief Populate the header and CRC of a frame whose payload has already been
+ *        written at `buffer + POLARIS_RTCM3_HEADER_SIZE`.
+ *
+ * @return The size of the frame (in bytes).
+ */
+static inline size_t FinishRTCMFrame(uint8_t* buffer, size_t payload_size) {
+  buffer[0] = POLARIS_RTCM3_PREAMBLE;
+  buffer[1] = (uint8_t)((payload_size >> 8) & 0x03);
+  buffer[2] = (uint8_t)(payload_size & 0xFF);
+
+  size_t crc_offset = POLARIS_RTCM3_HEADER_SIZE + payload_size;
+  uint32_t crc = Polaris_CalculateCRC24Q(buffer, crc_offset);
+  buffer[crc_offset] = (uint8_t)(crc >> 16);
+  buffer[crc_offset + 1] = (uint8_t)(crc >> 8);
+  buffer[crc_offset + 2] = (uint8_t)crc;
+  return crc_offset + POLARIS_RTCM3_CRC_SIZE;
+}
+
+/**
+ * @brief Create a valid frame with the specified message type, with the rest
+ *        of the payload set to `fill`.
+ *
+ * @return The size of the frame (in bytes).
+ */
+static inline size_t MakeRTCMFrame(uint8_t* buffer, uint16_t message_type,
+                                   size_t payload_size, uint8_t fill) {
+  uint8_t* payload = buffer + POLARIS_RTCM3_HEADER_SIZE;
+  memset(payload, fill, payload_size);
+  payload[0] = (uint8_t)(message_type >> 4);
+  payload[1] = (uint8_t)((message_type & 0x0F) << 4);
+  return FinishRTCMFrame(buffer, payload_size);
+}
@@ -0,0 +1,112 @@
+/**************************************************************************/ /**
+ * @brief Reconnect backoff unit tests.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/backoff.h"
+#include "unit_test.h"
+
+/******************************************************************************/
+static void TestDefaults(void) {
+  PolarisBackoff_t backoff;
+  Polaris_BackoffInit(&backoff, 0, 0, 1);
+  CHECK_EQ(backoff.base_delay_ms, POLARIS_BACKOFF_BASE_DELAY_MS);
+  CHECK_EQ(backoff.max_delay_ms, POLARIS_BACKOFF_MAX_DELAY_MS);
+  CHECK_EQ(backoff.attempts, 0);
+
+  // The maximum delay is never less than the base delay.
+  Polaris_BackoffInit(&backoff, 1000, 10, 1);
+  CHECK_EQ(backoff.max_delay_ms, 1000);
+  Polaris_BackoffNext(&backoff);
+  for (int i = 0; i < 10; ++i) {
+    CHECK_EQ(Polaris_BackoffNext(&backoff), 1000);
+  }
+}
+
+/******************************************************************************/
+static void TestBounds(void) {
+  static const uint32_t BASE_DELAY_MS = 100;
+  static const uint32_t MAX_DELAY_MS = 5000;
+
+  for (uint32_t seed = 1; seed <= 100; ++seed) {
+    PolarisBackoff_t backoff;
+    Polaris_BackoffInit(&backoff, BASE_DELAY_MS, MAX_DELAY_MS, seed);
+
+    // The first delay is short, so a dropped connection is reestablished
+    // quickly.
+    uint32_t last_delay_ms = Polaris_BackoffNext(&backoff);
+    CHECK(last_delay_ms <= BASE_DELAY_MS);
+
+    // Later delays are between the base delay and 3 times the previous delay,
+    // limited to the maximum.
+    int reached_max = 0;
+    for (int i = 0; i < 50; ++i) {
+      uint32_t delay_ms = Polaris_BackoffNext(&backoff);
+      CHECK(delay_ms >= BASE_DELAY_MS);
+      CHECK(delay_ms <= MAX_DELAY_MS);
+      if (last_delay_ms * 3 >= BASE_DELAY_MS) {
+        CHECK(delay_ms <= last_delay_ms * 3);
+      }
+      if (delay_ms > MAX_DELAY_MS / 2) {
+        reached_max = 1;
+      }
+      last_delay_ms = delay_ms;
+    }
+
+    // Delays grow while attempts keep failing.
+    CHECK(reached_max);
+    CHECK_EQ(backoff.attempts, 51);
+  }
+}
+
+/******************************************************************************/
+static void TestReset(void) {
+  PolarisBackoff_t backoff;
+  Polaris_BackoffInit(&backoff, 100, 5000, 1234);
+  for (int i = 0; i < 20; ++i) {
+    Polaris_BackoffNext(&backoff);
+  }
+
+  Polaris_BackoffReset(&backoff);
+  CHECK_EQ(backoff.attempts, 0);
+  CHECK_EQ(backoff.last_delay_ms, 0);
+  CHECK(Polaris_BackoffNext(&backoff) <= 100);
+  CHECK(Polaris_BackoffNext(&backoff) >= 100);
+}
+
+/******************************************************************************/
+static void TestJitter(void) {
+  // The same seed produces the same delays, and different seeds produce
+  // different delays.
+  PolarisBackoff_t first;
+  PolarisBackoff_t second;
+  PolarisBackoff_t third;
+  Polaris_BackoffInit(&first, 100, 5000, 1);
+  Polaris_BackoffInit(&second, 100, 5000, 1);
+  Polaris_BackoffInit(&third, 100, 5000, 2);
+  int same_count = 0;
+  for (int i = 0; i < 10; ++i) {
+    uint32_t delay_ms = Polaris_BackoffNext(&first);
+    CHECK_EQ(Polaris_BackoffNext(&second), delay_ms);
+    if (Polaris_BackoffNext(&third) == delay_ms) {
+      ++same_count;
+    }
+  }
+  CHECK(same_count < 10);
+
+  // Automatically chosen seeds differ between clients.
+  Polaris_BackoffInit(&first, 100, 5000, 0);
+  Polaris_BackoffInit(&second, 100, 5000, 0);
+  CHECK(first.random_state != 0);
+  CHECK(first.random_state != second.random_state);
+}
+
+/******************************************************************************/
+int main(void) {
+  RUN_TEST(TestDefaults);
+  RUN_TEST(TestBounds);
+  RUN_TEST(TestReset);
+  RUN_TEST(TestJitter);
+  return UnitTestResult();
+}
@@ -0,0 +1,97 @@
+/**************************************************************************/ /**
+ * @brief Latency histogram unit tests.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/histogram.h"
+#include "unit_test.h"
+
+/******************************************************************************/
+static void TestBucketEdges(void) {
+  // Small values are counted exactly.
+  for (uint32_t value = 0; value < POLARIS_HISTOGRAM_SUB_BUCKET_COUNT;
+       ++value) {
+    CHECK_EQ(Polaris_HistogramGetBucketIndex(value), value);
+    CHECK_EQ(Polaris_HistogramGetBucketLowerBound(value), value);
+  }
+
+  // Each bucket starts where the previous one ends, with no gaps or overlaps.
+  for (size_t i = 1; i < POLARIS_HISTOGRAM_NUM_BUCKETS; ++i) {
+    uint32_t lower_bound = Polaris_HistogramGetBucketLowerBound(i);
+    CHECK(lower_bound > Polaris_HistogramGetBucketLowerBound(i - 1));
+    CHECK_EQ(Polaris_HistogramGetBucketIndex(lower_bound), i);
+    CHECK_EQ(Polaris_HistogramGetBucketIndex(lower_bound - 1), i - 1);
+  }
+
+  // The last bucket ends at the largest 32-bit value.
+  CHECK_EQ(Polaris_HistogramGetBucketIndex(UINT32_MAX),
+           POLARIS_HISTOGRAM_NUM_BUCKETS - 1);
+  CHECK_EQ(Polaris_HistogramGetBucketLowerBound(POLARIS_HISTOGRAM_NUM_BUCKETS),
+           UINT32_MAX);
+
+  // Power-of-two ranges are split into equal sub-buckets.
+  CHECK_EQ(Polaris_HistogramGetBucketIndex(1024),
+           Polaris_HistogramGetBucketIndex(1024 + 255));
+  CHECK(Polaris_HistogramGetBucketIndex(1024 + 256) ==
+        Polaris_HistogramGetBucketIndex(1024) + 1);
+}
+
+/******************************************************************************/
+static void TestRecord(void) {
+  PolarisHistogram_t histogram;
+  Polaris_HistogramReset(&histogram);
+  CHECK_EQ(Polaris_HistogramGetPercentile(&histogram, 50.0), 0);
+  CHECK(Polaris_HistogramGetMean(&histogram) == 0.0);
+
+  Polaris_HistogramRecord(&histogram, 100);
+  Polaris_HistogramRecord(&histogram, 0);
+  Polaris_HistogramRecord(&histogram, UINT32_MAX);
+  CHECK_EQ(histogram.total_count, 3);
+  CHECK_EQ(histogram.min, 0);
+  CHECK_EQ(histogram.max, UINT32_MAX);
+  CHECK_EQ(histogram.sum, 100 + (uint64_t)UINT32_MAX);
+  CHECK_EQ(histogram.counts[0], 1);
+  CHECK_EQ(histogram.counts[Polaris_HistogramGetBucketIndex(100)], 1);
+  CHECK_EQ(histogram.counts[POLARIS_HISTOGRAM_NUM_BUCKETS - 1], 1);
+
+  Polaris_HistogramReset(&histogram);
+  CHECK_EQ(histogram.total_count, 0);
+  CHECK_EQ(histogram.max, 0);
+}
+
+/******************************************************************************/
+static void TestPercentile(void) {
+  PolarisHistogram_t histogram;
+  Polaris_HistogramReset(&histogram);
+  for (uint32_t value = 1; value <= 100; ++value) {
+    Polaris_HistogramRecord(&histogram, value);
+  }
+
+  // The result is the upper end of the bucket containing the percentile, so at
+  // least that many values are less than or equal to it, within the bucket
+  // precision.
+  uint32_t p50 = Polaris_HistogramGetPercentile(&histogram, 50.0);
+  CHECK(p50 >= 50);
+  CHECK(p50 < 50 * 5 / 4 + 1);
+  CHECK_EQ(Polaris_HistogramGetBucketIndex(p50),
+           Polaris_HistogramGetBucketIndex(50));
+
+  // Results are limited to the largest recorded value.
+  CHECK_EQ(Polaris_HistogramGetPercentile(&histogram, 100.0), 100);
+  CHECK_EQ(Polaris_HistogramGetPercentile(&histogram, 150.0), 100);
+
+  // The 0th percentile is the bucket containing the smallest value.
+  CHECK_EQ(Polaris_HistogramGetPercentile(&histogram, 0.0), 1);
+  CHECK_EQ(Polaris_HistogramGetPercentile(&histogram, -1.0), 1);
+
+  CHECK(Polaris_HistogramGetMean(&histogram) == 50.5);
+}
+
+/******************************************************************************/
+int main(void) {
+  RUN_TEST(TestBucketEdges);
+  RUN_TEST(TestRecord);
+  RUN_TEST(TestPercentile);
+  return UnitTestResult();
+}
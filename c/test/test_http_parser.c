@@ -0,0 +1,305 @@
+/**************************************************************************/ /**
+ * @brief HTTP response parser and keep-alive connection unit tests.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+// The HTTP parser and request functions are internal to polaris.c, so it is
+// compiled directly into this test. The test is built without TLS so requests
+// can be sent to a local plain-text server.
+#include "point_one/polaris/polaris.c"
+
+#include <pthread.h>
+
+#include "unit_test.h"
+
+/******************************************************************************/
+static void InitParser(HTTPResponseParser_t* parser, uint8_t* body,
+                       size_t body_capacity) {
+  ResetHTTPParser(parser);
+  parser->body = body;
+  parser->body_capacity = body_capacity;
+  parser->body_size = 0;
+  parser->body_truncated = 0;
+}
+
+/******************************************************************************/
+static void ParseInPieces(HTTPResponseParser_t* parser, const char* response,
+                          size_t piece_size) {
+  size_t size = strlen(response);
+  for (size_t offset = 0; offset < size; offset += piece_size) {
+    size_t count = size - offset < piece_size ? size - offset : piece_size;
+    ParseHTTPData(parser, (const uint8_t*)response + offset, count);
+  }
+}
+
+/******************************************************************************/
+static void TestContentLength(void) {
+  static const char RESPONSE[] =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: application/json\r\n"
+      "content-length: 5\r\n"
+      "\r\n"
+      "hello";
+
+  uint8_t body[64];
+  HTTPResponseParser_t parser;
+  InitParser(&parser, body, sizeof(body));
+  CHECK_EQ(ParseHTTPData(&parser, (const uint8_t*)RESPONSE, strlen(RESPONSE)),
+           strlen(RESPONSE));
+  CHECK_EQ(parser.state, HTTP_STATE_DONE);
+  CHECK_EQ(parser.status_code, 200);
+  CHECK_EQ(parser.connection_close, 0);
+  CHECK_EQ(parser.body_size, 5);
+  CHECK(memcmp(body, "hello", 5) == 0);
+
+  // Data following the end of the response is not consumed.
+  static const char EXTRA[] = "HTTP/1.1 204 No Content\r\n\r\nextra";
+  InitParser(&parser, body, sizeof(body));
+  CHECK_EQ(ParseHTTPData(&parser, (const uint8_t*)EXTRA, strlen(EXTRA)),
+           strlen(EXTRA) - 5);
+  CHECK_EQ(parser.state, HTTP_STATE_DONE);
+  CHECK_EQ(parser.status_code, 204);
+  CHECK_EQ(parser.body_size, 0);
+}
+
+/******************************************************************************/
+static void TestChunked(void) {
+  static const char RESPONSE[] =
+      "HTTP/1.1 100 Continue\r\n"
+      "\r\n"
+      "HTTP/1.1 200 OK\r\n"
+      "Transfer-Encoding: gzip, Chunked\r\n"
+      "Connection: close\r\n"
+      "\r\n"
+      "5\r\n"
+      "hello\r\n"
+      "6;name=value\r\n"
+      " world\r\n"
+      "0\r\n"
+      "Trailer: ignored\r\n"
+      "\r\n";
+
+  uint8_t body[64];
+  HTTPResponseParser_t parser;
+  InitParser(&parser, body, sizeof(body));
+  CHECK_EQ(ParseHTTPData(&parser, (const uint8_t*)RESPONSE, strlen(RESPONSE)),
+           strlen(RESPONSE));
+  CHECK_EQ(parser.state, HTTP_STATE_DONE);
+  CHECK_EQ(parser.status_code, 200);
+  CHECK_EQ(parser.connection_close, 1);
+  CHECK_EQ(parser.body_size, 11);
+  CHECK(memcmp(body, "hello world", 11) == 0);
+
+  // A chunk that does not end with CRLF is invalid.
+  static const char BAD_CHUNK[] =
+      "HTTP/1.1 200 OK\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n"
+      "2\r\n"
+      "abc\r\n";
+  InitParser(&parser, body, sizeof(body));
+  ParseHTTPData(&parser, (const uint8_t*)BAD_CHUNK, strlen(BAD_CHUNK));
+  CHECK_EQ(parser.state, HTTP_STATE_INVALID);
+}
+
+/******************************************************************************/
+static void TestSplitResponse(void) {
+  static const char CHUNKED[] =
+      "HTTP/1.1 200 OK\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n"
+      "a\r\n"
+      "0123456789\r\n"
+      "0\r\n"
+      "\r\n";
+  static const char CONTENT_LENGTH[] =
+      "HTTP/1.1 401 Unauthorized\r\n"
+      "Content-Length: 12\r\n"
+      "\r\n"
+      "unauthorized";
+
+  // Split the responses at every possible boundary size, down to one byte at a
+  // time.
+  for (size_t piece_size = 1; piece_size <= 16; ++piece_size) {
+    uint8_t body[64];
+    HTTPResponseParser_t parser;
+    InitParser(&parser, body, sizeof(body));
+    ParseInPieces(&parser, CHUNKED, piece_size);
+    CHECK_EQ(parser.state, HTTP_STATE_DONE);
+    CHECK_EQ(parser.body_size, 10);
+    CHECK(memcmp(body, "0123456789", 10) == 0);
+
+    InitParser(&parser, body, sizeof(body));
+    ParseInPieces(&parser, CONTENT_LENGTH, piece_size);
+    CHECK_EQ(parser.state, HTTP_STATE_DONE);
+    CHECK_EQ(parser.status_code, 401);
+    CHECK_EQ(parser.body_size, 12);
+    CHECK(memcmp(body, "unauthorized", 12) == 0);
+  }
+}
+
+/******************************************************************************/
+static void TestBodyUntilClose(void) {
+  // Without Content-Length or chunked encoding, the body ends when the
+  // connection is closed.
+  static const char RESPONSE[] =
+      "HTTP/1.0 200 OK\r\n"
+      "\r\n"
+      "partial";
+
+  uint8_t body[4];
+  HTTPResponseParser_t parser;
+  InitParser(&parser, body, sizeof(body));
+  ParseHTTPData(&parser, (const uint8_t*)RESPONSE, strlen(RESPONSE));
+  CHECK_EQ(parser.state, HTTP_STATE_BODY_UNTIL_CLOSE);
+  CHECK_EQ(parser.connection_close, 1);
+  // The body is truncated to the buffer size.
+  CHECK_EQ(parser.body_size, 4);
+  CHECK_EQ(parser.body_truncated, 1);
+
+  static const char INVALID[] = "HTTX/1.1 200 OK\r\n\r\n";
+  InitParser(&parser, body, sizeof(body));
+  ParseHTTPData(&parser, (const uint8_t*)INVALID, strlen(INVALID));
+  CHECK_EQ(parser.state, HTTP_STATE_INVALID);
+}
+
+/******************************************************************************/
+typedef struct {
+  int listen_socket;
+  int request_count;
+} TestServer_t;
+
+/******************************************************************************/
+static int ReadRequest(int sock) {
+  // Read the request headers, followed by the number of content bytes
+  // specified by Content-Length.
+  char request[1024];
+  size_t size = 0;
+  const char* body = NULL;
+  size_t content_length = 0;
+  while (size < sizeof(request) - 1) {
+    ssize_t bytes_read = recv(sock, request + size, sizeof(request) - 1 - size,
+                              0);
+    if (bytes_read <= 0) {
+      return 0;
+    }
+
+    size += (size_t)bytes_read;
+    request[size] = '\0';
+    if (body == NULL) {
+      const char* end = strstr(request, "\r\n\r\n");
+      if (end == NULL) {
+        continue;
+      }
+
+      body = end + 4;
+      const char* length = strstr(request, "Content-Length: ");
+      if (length != NULL) {
+        content_length = (size_t)strtoul(length + 16, NULL, 10);
+      }
+    }
+
+    if (size - (size_t)(body - request) >= content_length) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/******************************************************************************/
+static void SendResponse(int sock, const char* connection, const char* body) {
+  char response[256];
+  int size = snprintf(response, sizeof(response),
+                      "HTTP/1.1 200 OK\r\n"
+                      "Content-Length: %u\r\n"
+                      "Connection: %s\r\n"
+                      "\r\n"
+                      "%s",
+                      (unsigned)strlen(body), connection, body);
+  send(sock, response, (size_t)size, 0);
+}
+
+/******************************************************************************/
+static void* RunStaleConnectionServer(void* arg) {
+  TestServer_t* server = (TestServer_t*)arg;
+
+  // Answer the first request and keep the connection open. Then close it after
+  // the second request arrives, without responding, as a server would if its
+  // idle timeout expired just as the request was sent.
+  int sock = accept(server->listen_socket, NULL, NULL);
+  if (ReadRequest(sock)) {
+    ++server->request_count;
+    SendResponse(sock, "keep-alive", "first");
+  }
+
+  if (ReadRequest(sock)) {
+    ++server->request_count;
+  }
+  close(sock);
+
+  // The client should retry the second request on a new connection.
+  sock = accept(server->listen_socket, NULL, NULL);
+  if (ReadRequest(sock)) {
+    ++server->request_count;
+    SendResponse(sock, "close", "second");
+  }
+  close(sock);
+  return NULL;
+}
+
+/******************************************************************************/
+static void TestStaleKeepAliveRetry(void) {
+  TestServer_t server;
+  server.request_count = 0;
+  server.listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  socklen_t address_size = sizeof(address);
+  CHECK(bind(server.listen_socket, (struct sockaddr*)&address,
+             sizeof(address)) == 0);
+  CHECK(listen(server.listen_socket, 2) == 0);
+  CHECK(getsockname(server.listen_socket, (struct sockaddr*)&address,
+                    &address_size) == 0);
+  int port = ntohs(address.sin_port);
+
+  pthread_t thread;
+  pthread_create(&thread, NULL, &RunStaleConnectionServer, &server);
+
+  PolarisContext_t context;
+  CHECK_EQ(Polaris_Init(&context), POLARIS_SUCCESS);
+  Polaris_SetHTTPKeepAlive(&context, 1);
+
+  static const char CONTENT[] = "{}";
+  CHECK_EQ(SendPOSTRequest(&context, "127.0.0.1", port, "/test", CONTENT,
+                           strlen(CONTENT)),
+           200);
+  CHECK(strcmp((const char*)context.recv_buffer, "first") == 0);
+  CHECK_EQ(context.http_connection_open, 1);
+
+  CHECK_EQ(SendPOSTRequest(&context, "127.0.0.1", port, "/test", CONTENT,
+                           strlen(CONTENT)),
+           200);
+  CHECK(strcmp((const char*)context.recv_buffer, "second") == 0);
+  CHECK_EQ(context.http_connection_open, 0);
+
+  pthread_join(thread, NULL);
+  CHECK_EQ(server.request_count, 3);
+
+  Polaris_Free(&context);
+  close(server.listen_socket);
+}
+
+/******************************************************************************/
+int main(void) {
+  RUN_TEST(TestContentLength);
+  RUN_TEST(TestChunked);
+  RUN_TEST(TestSplitResponse);
+  RUN_TEST(TestBodyUntilClose);
+  RUN_TEST(TestStaleKeepAliveRetry);
+  return UnitTestResult();
+}
@@ -0,0 +1,102 @@
+/**************************************************************************/ /**
+ * @brief RTCM 3 frame deduplication unit tests.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/rtcm.h"
+#include "rtcm_test_frames.h"
+#include "unit_test.h"
+
+#define STREAM_A 0
+#define STREAM_B 1
+#define STREAM_C 2
+
+/******************************************************************************/
+static void TestTwoStreams(void) {
+  uint8_t first[64];
+  uint8_t second[64];
+  size_t first_size = MakeRTCMFrame(first, 1074, 40, 0x01);
+  size_t second_size = MakeRTCMFrame(second, 1074, 40, 0x02);
+
+  PolarisRTCMDedup_t dedup;
+  Polaris_RTCMDedupReset(&dedup);
+
+  // The first copy of each frame is delivered, whichever stream it arrives on.
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_A, first, first_size), 1);
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_B, second, second_size), 1);
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_B, first, first_size), 0);
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_A, second, second_size), 0);
+
+  // A third stream carrying the same data is also merged.
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_C, first, first_size), 0);
+
+  // Once each stream has delivered a frame, another copy is new data.
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_A, first, first_size), 1);
+  CHECK_EQ(dedup.unique_count, 3);
+  CHECK_EQ(dedup.duplicate_count, 3);
+}
+
+/******************************************************************************/
+static void TestRepeatedFrames(void) {
+  // Static messages such as 1005 are repeated with identical contents. Each
+  // repeat is delivered once, not discarded as a duplicate of the last one.
+  uint8_t frame[64];
+  size_t size = MakeRTCMFrame(frame, 1005, 19, 0x03);
+
+  PolarisRTCMDedup_t dedup;
+  Polaris_RTCMDedupReset(&dedup);
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_A, frame, size), 1);
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_A, frame, size), 1);
+
+  // The slower stream's copies match the faster stream's, one for one.
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_B, frame, size), 0);
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_B, frame, size), 0);
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_B, frame, size), 1);
+
+  // Frames that differ only in length or message type are different frames.
+  uint8_t other[64];
+  size_t other_size = MakeRTCMFrame(other, 1006, 19, 0x03);
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_A, other, other_size), 1);
+  other_size = MakeRTCMFrame(other, 1005, 21, 0x03);
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_A, other, other_size), 1);
+}
+
+/******************************************************************************/
+static void TestWindow(void) {
+  // Fill the window with unique frames from one stream, plus one more.
+  static const size_t FRAME_COUNT = POLARIS_RTCM_DEDUP_WINDOW_SIZE + 1;
+  PolarisRTCMDedup_t dedup;
+  Polaris_RTCMDedupReset(&dedup);
+  uint8_t frame[64];
+  for (size_t i = 0; i < FRAME_COUNT; ++i) {
+    size_t size = MakeRTCMFrame(frame, 1077, 20 + i % 16, (uint8_t)(i / 16));
+    CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_A, frame, size), 1);
+  }
+  CHECK_EQ(dedup.key_count, POLARIS_RTCM_DEDUP_WINDOW_SIZE);
+
+  // Frames still in the window are recognized.
+  size_t last = FRAME_COUNT - 1;
+  size_t size =
+      MakeRTCMFrame(frame, 1077, 20 + last % 16, (uint8_t)(last / 16));
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_B, frame, size), 0);
+  size = MakeRTCMFrame(frame, 1077, 21, 0);
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_B, frame, size), 0);
+
+  // The oldest frame has left the window, so a late copy is delivered again.
+  size = MakeRTCMFrame(frame, 1077, 20, 0);
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_B, frame, size), 1);
+
+  // Resetting forgets every frame.
+  Polaris_RTCMDedupReset(&dedup);
+  CHECK_EQ(dedup.key_count, 0);
+  CHECK_EQ(Polaris_RTCMDedupCheck(&dedup, STREAM_B, frame, size), 1);
+}
+
+/******************************************************************************/
+int main(void) {
+  RUN_TEST(TestTwoStreams);
+  RUN_TEST(TestRepeatedFrames);
+  RUN_TEST(TestWindow);
+  return UnitTestResult();
+}
@@ -0,0 +1,160 @@
+/**************************************************************************/ /**
+ * @brief RTCM 3 framer unit tests.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include <string.h> // For memcmp() and memcpy()
+
+#include "point_one/polaris/rtcm.h"
+#include "rtcm_test_frames.h"
+#include "unit_test.h"
+
+#define MAX_FRAMES 8
+
+typedef struct {
+  size_t frame_count;
+  size_t frame_sizes[MAX_FRAMES];
+  uint8_t frames[MAX_FRAMES][POLARIS_RTCM3_MAX_FRAME_SIZE];
+} ReceivedFrames_t;
+
+/******************************************************************************/
+static void HandleFrame(void* info, const uint8_t* frame, size_t size_bytes) {
+  ReceivedFrames_t* received = (ReceivedFrames_t*)info;
+  if (received->frame_count < MAX_FRAMES) {
+    received->frame_sizes[received->frame_count] = size_bytes;
+    memcpy(received->frames[received->frame_count], frame, size_bytes);
+  }
+  ++received->frame_count;
+}
+
+/******************************************************************************/
+static void TestCompleteFrames(void) {
+  uint8_t data[256];
+  size_t size = MakeRTCMFrame(data, 1005, 19, 0x11);
+  size += MakeRTCMFrame(data + size, 1074, 40, 0x22);
+
+  PolarisRTCMFramer_t framer;
+  Polaris_RTCMFramerReset(&framer);
+  ReceivedFrames_t received = {0};
+  CHECK_EQ(Polaris_RTCMFramerProcess(&framer, data, size, &HandleFrame,
+                                     &received),
+           2);
+  CHECK_EQ(received.frame_count, 2);
+  CHECK_EQ(received.frame_sizes[0], 25);
+  CHECK_EQ(received.frame_sizes[1], 46);
+  CHECK_EQ(Polaris_GetRTCMMessageType(received.frames[0], 25), 1005);
+  CHECK_EQ(Polaris_GetRTCMMessageType(received.frames[1], 46), 1074);
+  CHECK_EQ(framer.frame_count, 2);
+  CHECK_EQ(framer.crc_error_count, 0);
+  CHECK_EQ(framer.skipped_bytes, 0);
+  CHECK_EQ(framer.current_size, 0);
+}
+
+/******************************************************************************/
+static void TestSplitFrame(void) {
+  uint8_t data[256];
+  size_t size = MakeRTCMFrame(data, 1077, 100, 0x33);
+
+  // Deliver the frame one byte at a time, including a split header.
+  PolarisRTCMFramer_t framer;
+  Polaris_RTCMFramerReset(&framer);
+  ReceivedFrames_t received = {0};
+  for (size_t i = 0; i < size; ++i) {
+    Polaris_RTCMFramerProcess(&framer, data + i, 1, &HandleFrame, &received);
+    CHECK_EQ(received.frame_count, i + 1 == size ? 1 : 0);
+  }
+
+  CHECK_EQ(received.frame_sizes[0], size);
+  CHECK(memcmp(received.frames[0], data, size) == 0);
+  CHECK_EQ(framer.current_size, 0);
+
+  // Split a frame across two blocks, with a second complete frame in the
+  // second block.
+  size_t second_size = MakeRTCMFrame(data + size, 1087, 30, 0x44);
+  received.frame_count = 0;
+  Polaris_RTCMFramerProcess(&framer, data, 50, &HandleFrame, &received);
+  CHECK_EQ(received.frame_count, 0);
+  Polaris_RTCMFramerProcess(&framer, data + 50, size + second_size - 50,
+                            &HandleFrame, &received);
+  CHECK_EQ(received.frame_count, 2);
+  CHECK(memcmp(received.frames[0], data, size) == 0);
+  CHECK(memcmp(received.frames[1], data + size, second_size) == 0);
+  CHECK_EQ(framer.skipped_bytes, 0);
+}
+
+/******************************************************************************/
+static void TestResyncAfterGarbage(void) {
+  // Garbage, including a preamble byte followed by an invalid header, before a
+  // valid frame.
+  uint8_t data[256] = {0x01, 0x02, POLARIS_RTCM3_PREAMBLE, 0xFF, 0x03, 0x04};
+  size_t garbage_size = 6;
+  size_t size = MakeRTCMFrame(data + garbage_size, 1005, 19, 0x55);
+
+  PolarisRTCMFramer_t framer;
+  Polaris_RTCMFramerReset(&framer);
+  ReceivedFrames_t received = {0};
+  Polaris_RTCMFramerProcess(&framer, data, garbage_size + size, &HandleFrame,
+                            &received);
+  CHECK_EQ(received.frame_count, 1);
+  CHECK(memcmp(received.frames[0], data + garbage_size, size) == 0);
+  CHECK_EQ(framer.skipped_bytes, garbage_size);
+
+  // Same, with the garbage and the frame split into separate blocks.
+  Polaris_RTCMFramerReset(&framer);
+  received.frame_count = 0;
+  Polaris_RTCMFramerProcess(&framer, data, garbage_size + 2, &HandleFrame,
+                            &received);
+  Polaris_RTCMFramerProcess(&framer, data + garbage_size + 2, size - 2,
+                            &HandleFrame, &received);
+  CHECK_EQ(received.frame_count, 1);
+  CHECK(memcmp(received.frames[0], data + garbage_size, size) == 0);
+}
+
+/******************************************************************************/
+static void TestBadCRC(void) {
+  uint8_t data[256];
+  size_t bad_size = MakeRTCMFrame(data, 1005, 19, 0x66);
+  data[10] ^= 0x01;
+  size_t good_size = MakeRTCMFrame(data + bad_size, 1006, 21, 0x77);
+
+  PolarisRTCMFramer_t framer;
+  Polaris_RTCMFramerReset(&framer);
+  ReceivedFrames_t received = {0};
+  Polaris_RTCMFramerProcess(&framer, data, bad_size + good_size, &HandleFrame,
+                            &received);
+  CHECK_EQ(received.frame_count, 1);
+  CHECK_EQ(Polaris_GetRTCMMessageType(received.frames[0], good_size), 1006);
+  CHECK_EQ(framer.crc_error_count, 1);
+  CHECK_EQ(framer.skipped_bytes, bad_size);
+
+  // A frame with a bad CRC may hide the start of a real frame. The framer must
+  // resynchronize within the buffered data, not skip past it.
+  uint8_t truncated[256];
+  size_t good_offset = 8;
+  MakeRTCMFrame(truncated, 1005, 100, 0x00);
+  size_t frame_size = MakeRTCMFrame(truncated + good_offset, 1007, 20, 0x88);
+
+  Polaris_RTCMFramerReset(&framer);
+  received.frame_count = 0;
+  Polaris_RTCMFramerProcess(&framer, truncated, good_offset + frame_size,
+                            &HandleFrame, &received);
+  CHECK_EQ(received.frame_count, 0);
+  // Complete the fake 106-byte frame with zeros, which will fail the CRC check.
+  uint8_t zeros[106] = {0};
+  Polaris_RTCMFramerProcess(&framer, zeros,
+                            106 - (good_offset + frame_size), &HandleFrame,
+                            &received);
+  CHECK_EQ(framer.crc_error_count, 1);
+  CHECK_EQ(received.frame_count, 1);
+  CHECK_EQ(Polaris_GetRTCMMessageType(received.frames[0], frame_size), 1007);
+}
+
+/******************************************************************************/
+int main(void) {
+  RUN_TEST(TestCompleteFrames);
+  RUN_TEST(TestSplitFrame);
+  RUN_TEST(TestResyncAfterGarbage);
+  RUN_TEST(TestBadCRC);
+  return UnitTestResult();
+}
@@ -0,0 +1,158 @@
+/**************************************************************************/ /**
+ * @brief RTCM 3 MSM epoch time decoding unit tests.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/rtcm.h"
+#include "rtcm_test_frames.h"
+#include "unit_test.h"
+
+#define HOUR_MS 3600000u
+#define LEAP_SECONDS 18
+
+/******************************************************************************/
+static size_t MakeMSMFrame(uint8_t* buffer, uint16_t message_type,
+                           uint32_t epoch_time) {
+  // Message number (12 bits), reference station ID (12 bits), and epoch time
+  // (30 bits), followed by the rest of the MSM header.
+  size_t size = MakeRTCMFrame(buffer, message_type, 20, 0);
+  uint8_t* payload = buffer + POLARIS_RTCM3_HEADER_SIZE;
+  payload[1] |= 0x01;
+  payload[2] = 0x23;
+  payload[3] = (uint8_t)(epoch_time >> 22);
+  payload[4] = (uint8_t)(epoch_time >> 14);
+  payload[5] = (uint8_t)(epoch_time >> 6);
+  payload[6] = (uint8_t)((epoch_time << 2) | 0x03);
+  FinishRTCMFrame(buffer, 20);
+  return size;
+}
+
+/******************************************************************************/
+static void TestMSMTypes(void) {
+  CHECK(Polaris_IsRTCMMSMType(1071));
+  CHECK(Polaris_IsRTCMMSMType(1077));
+  CHECK(Polaris_IsRTCMMSMType(1087));
+  CHECK(Polaris_IsRTCMMSMType(1127));
+  CHECK(!Polaris_IsRTCMMSMType(1070));
+  CHECK(!Polaris_IsRTCMMSMType(1078));
+  CHECK(!Polaris_IsRTCMMSMType(1005));
+  CHECK(!Polaris_IsRTCMMSMType(1131));
+}
+
+/******************************************************************************/
+static void TestGPSEpochTime(void) {
+  uint8_t frame[64];
+  uint32_t time_ms = 0;
+  uint32_t period_ms = 0;
+
+  // GPS, Galileo, SBAS, and QZSS times are GPS time of week.
+  static const uint16_t MESSAGE_TYPES[] = {1074, 1097, 1107, 1117};
+  for (size_t i = 0; i < sizeof(MESSAGE_TYPES) / sizeof(MESSAGE_TYPES[0]);
+       ++i) {
+    size_t size = MakeMSMFrame(frame, MESSAGE_TYPES[i], 123456789);
+    CHECK_EQ(Polaris_GetRTCMMSMEpochTime(frame, size, LEAP_SECONDS, &time_ms,
+                                         &period_ms),
+             0);
+    CHECK_EQ(time_ms, 123456789);
+    CHECK_EQ(period_ms, POLARIS_GPS_WEEK_MS);
+  }
+
+  // The largest valid time of week.
+  size_t size = MakeMSMFrame(frame, 1077, POLARIS_GPS_WEEK_MS - 1);
+  CHECK_EQ(Polaris_GetRTCMMSMEpochTime(frame, size, LEAP_SECONDS, &time_ms,
+                                       &period_ms),
+           0);
+  CHECK_EQ(time_ms, POLARIS_GPS_WEEK_MS - 1);
+
+  // Out of range.
+  size = MakeMSMFrame(frame, 1077, POLARIS_GPS_WEEK_MS);
+  CHECK(Polaris_GetRTCMMSMEpochTime(frame, size, LEAP_SECONDS, &time_ms,
+                                    &period_ms) < 0);
+}
+
+/******************************************************************************/
+static void TestBeiDouEpochTime(void) {
+  uint8_t frame[64];
+  uint32_t time_ms = 0;
+  uint32_t period_ms = 0;
+
+  // BDT is 14 seconds behind GPS time.
+  size_t size = MakeMSMFrame(frame, 1124, 100000);
+  CHECK_EQ(Polaris_GetRTCMMSMEpochTime(frame, size, LEAP_SECONDS, &time_ms,
+                                       &period_ms),
+           0);
+  CHECK_EQ(time_ms, 114000);
+  CHECK_EQ(period_ms, POLARIS_GPS_WEEK_MS);
+
+  // Wrap into the next GPS week.
+  size = MakeMSMFrame(frame, 1124, POLARIS_GPS_WEEK_MS - 1000);
+  CHECK_EQ(Polaris_GetRTCMMSMEpochTime(frame, size, LEAP_SECONDS, &time_ms,
+                                       &period_ms),
+           0);
+  CHECK_EQ(time_ms, 13000);
+}
+
+/******************************************************************************/
+static void TestGLONASSEpochTime(void) {
+  uint8_t frame[64];
+  uint32_t time_ms = 0;
+  uint32_t period_ms = 0;
+
+  // Day of week 2, 05:00 Moscow time = 02:00 UTC.
+  size_t size = MakeMSMFrame(frame, 1084, (2u << 27) | (5 * HOUR_MS));
+  CHECK_EQ(Polaris_GetRTCMMSMEpochTime(frame, size, LEAP_SECONDS, &time_ms,
+                                       &period_ms),
+           0);
+  CHECK_EQ(time_ms,
+           2 * POLARIS_GPS_DAY_MS + 2 * HOUR_MS + LEAP_SECONDS * 1000);
+  CHECK_EQ(period_ms, POLARIS_GPS_WEEK_MS);
+
+  // Day of week 0, 01:00 Moscow time is the previous day in UTC, at the end of
+  // the previous GPS week.
+  size = MakeMSMFrame(frame, 1084, 1 * HOUR_MS);
+  CHECK_EQ(Polaris_GetRTCMMSMEpochTime(frame, size, LEAP_SECONDS, &time_ms,
+                                       &period_ms),
+           0);
+  CHECK_EQ(time_ms,
+           POLARIS_GPS_WEEK_MS - 2 * HOUR_MS + LEAP_SECONDS * 1000);
+
+  // Unknown day of week: the time is only known modulo one day.
+  size = MakeMSMFrame(frame, 1087, (7u << 27) | (1 * HOUR_MS));
+  CHECK_EQ(Polaris_GetRTCMMSMEpochTime(frame, size, LEAP_SECONDS, &time_ms,
+                                       &period_ms),
+           0);
+  CHECK_EQ(time_ms, POLARIS_GPS_DAY_MS - 2 * HOUR_MS + LEAP_SECONDS * 1000);
+  CHECK_EQ(period_ms, POLARIS_GPS_DAY_MS);
+
+  // Out of range time of day.
+  size = MakeMSMFrame(frame, 1084, POLARIS_GPS_DAY_MS);
+  CHECK(Polaris_GetRTCMMSMEpochTime(frame, size, LEAP_SECONDS, &time_ms,
+                                    &period_ms) < 0);
+}
+
+/******************************************************************************/
+static void TestInvalidMessages(void) {
+  uint8_t frame[64];
+  uint32_t time_ms = 0;
+  uint32_t period_ms = 0;
+
+  size_t size = MakeRTCMFrame(frame, 1005, 19, 0);
+  CHECK(Polaris_GetRTCMMSMEpochTime(frame, size, LEAP_SECONDS, &time_ms,
+                                    &period_ms) < 0);
+
+  // Too short to contain the epoch time.
+  size = MakeRTCMFrame(frame, 1077, 6, 0);
+  CHECK(Polaris_GetRTCMMSMEpochTime(frame, size, LEAP_SECONDS, &time_ms,
+                                    &period_ms) < 0);
+}
+
+/******************************************************************************/
+int main(void) {
+  RUN_TEST(TestMSMTypes);
+  RUN_TEST(TestGPSEpochTime);
+  RUN_TEST(TestBeiDouEpochTime);
+  RUN_TEST(TestGLONASSEpochTime);
+  RUN_TEST(TestInvalidMessages);
+  return UnitTestResult();
+}
@@ -0,0 +1,61 @@
+/**************************************************************************/ /**
+ * @brief Minimal unit test support for the Polaris C library tests.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdio.h>
+
+static int unit_test_failures = 0;
+
+/**
+ * @brief Check a condition, printing an error and recording a failure if it is
+ *        false.
+ */
+#define CHECK(condition)                                               \
+  do {                                                                 \
+    if (!(condition)) {                                                \
+      fprintf(stderr, "%s:%d: Check failed: %s\n", __FILE__, __LINE__, \
+              #condition);                                             \
+      ++unit_test_failures;                                            \
+    }                                                                  \
+  } while (0)
+
+/**
+ * @brief Check that two integer values are equal.
+ */
+#define CHECK_EQ(actual, expected)                                      \
+  do {                                                                  \
+    long long actual_value = (long long)(actual);                       \
+    long long expected_value = (long long)(expected);                   \
+    if (actual_value != expected_value) {                               \
+      fprintf(stderr, "%s:%d: Check failed: %s == %s (%lld != %lld)\n", \
+              __FILE__, __LINE__, #actual, #expected, actual_value,     \
+              expected_value);                                          \
+      ++unit_test_failures;                                             \
+    }                                                                   \
+  } while (0)
+
+/**
+ * @brief Run a test function, printing its name.
+ */
+#define RUN_TEST(function)                \
+  do {                                    \
+    printf("Running %s...\n", #function); \
+    function();                           \
+  } while (0)
+
+/**
+ * @brief Print the test result and return the process exit code.
+ */
+static inline int UnitTestResult(void) {
+  if (unit_test_failures == 0) {
+    printf("All tests passed.\n");
+    return 0;
+  } else {
+    printf("%d check(s) failed.\n", unit_test_failures);
+    return 1;
+  }
+}
@@ -0,0 +1,108 @@
+/**************************************************************************/ /**
+ * @brief Polaris corrections endpoint selection.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/endpoint_selector.h"
+
+#include <algorithm> // For std::max()
+#include <cmath> // For std::lround()
+
+using namespace point_one::polaris;
+
+constexpr int EndpointSelector::FAILURE_PENALTY_MS;
+constexpr int EndpointSelector::FAILURE_MEMORY_SEC;
+constexpr int EndpointSelector::UNPROVEN_PENALTY_MS;
+constexpr double EndpointSelector::RTT_SMOOTHING_FACTOR;
+
+/******************************************************************************/
+void EndpointSelector::SetEndpoints(
+    const std::vector<PolarisEndpoint>& endpoints) {
+  endpoints_.clear();
+  for (const auto& endpoint : endpoints) {
+    EndpointStatus status;
+    status.endpoint = endpoint;
+    endpoints_.push_back(status);
+  }
+}
+
+/******************************************************************************/
+size_t EndpointSelector::Select() const {
+  auto now = std::chrono::steady_clock::now();
+  int worst_rtt_ms = 0;
+  for (const auto& status : endpoints_) {
+    if (status.rtt_ms > worst_rtt_ms) {
+      worst_rtt_ms = status.rtt_ms;
+    }
+  }
+
+  size_t best_index = 0;
+  int64_t best_score = 0;
+  for (size_t i = 0; i < endpoints_.size(); ++i) {
+    int64_t score = GetScore(i, now, worst_rtt_ms);
+    if (i == 0 || score < best_score) {
+      best_index = i;
+      best_score = score;
+    }
+  }
+  return best_index;
+}
+
+/******************************************************************************/
+bool EndpointSelector::HasRecentFailure(size_t index) const {
+  const EndpointStatus& status = endpoints_[index];
+  return status.consecutive_failures > 0 &&
+         std::chrono::steady_clock::now() - status.last_failure_time <
+             std::chrono::seconds(FAILURE_MEMORY_SEC);
+}
+
+/******************************************************************************/
+void EndpointSelector::RecordConnectTime(size_t index, int rtt_ms) {
+  EndpointStatus& status = endpoints_[index];
+  status.last_rtt_ms = rtt_ms;
+  if (status.rtt_ms < 0) {
+    status.rtt_ms = rtt_ms;
+  } else {
+    status.rtt_ms = (int)std::lround(status.rtt_ms +
+                                     RTT_SMOOTHING_FACTOR *
+                                         (rtt_ms - status.rtt_ms));
+  }
+}
+
+/******************************************************************************/
+void EndpointSelector::RecordSuccess(size_t index) {
+  EndpointStatus& status = endpoints_[index];
+  ++status.successes;
+  status.consecutive_failures = 0;
+}
+
+/******************************************************************************/
+void EndpointSelector::RecordFailure(size_t index) {
+  EndpointStatus& status = endpoints_[index];
+  ++status.failures;
+  ++status.consecutive_failures;
+  status.last_failure_time = std::chrono::steady_clock::now();
+}
+
+/******************************************************************************/
+int64_t EndpointSelector::GetScore(size_t index,
+                                   std::chrono::steady_clock::time_point now,
+                                   int worst_rtt_ms) const {
+  const EndpointStatus& status = endpoints_[index];
+  int64_t score = status.rtt_ms > 0 ? status.rtt_ms : 0;
+
+  // Don't let an endpoint that has never worked look better than one that
+  // has, just because we don't know how slow it is, or because its failures
+  // are no longer recent.
+  if (status.rtt_ms < 0 || (status.successes == 0 && status.failures > 0)) {
+    score = std::max<int64_t>(score, worst_rtt_ms) + UNPROVEN_PENALTY_MS;
+  }
+
+  if (status.consecutive_failures > 0 &&
+      now - status.last_failure_time <
+          std::chrono::seconds(FAILURE_MEMORY_SEC)) {
+    score += (int64_t)status.consecutive_failures * FAILURE_PENALTY_MS;
+  }
+  return score;
+}
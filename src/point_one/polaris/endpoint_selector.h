@@ -0,0 +1,164 @@
+/**************************************************************************/ /**
+ * @brief Polaris corrections endpoint selection.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace point_one {
+namespace polaris {
+
+/**
+ * @brief A Polaris corrections endpoint.
+ */
+struct PolarisEndpoint {
+  /** The endpoint URL. */
+  std::string url;
+  /** The endpoint port, or 0 to use the default port. */
+  int port = 0;
+};
+
+/**
+ * @brief The recent connection history of a corrections endpoint.
+ */
+struct EndpointStatus {
+  PolarisEndpoint endpoint;
+
+  /**
+   * The smoothed time (in ms) to open a connection (TCP connect and TLS
+   * handshake, not including DNS lookup), or -1 if unknown.
+   */
+  int rtt_ms = -1;
+  /** The most recent connection time (in ms), or -1 if unknown. */
+  int last_rtt_ms = -1;
+
+  /** The number of connections that received data. */
+  uint32_t successes = 0;
+  /** The number of failed or lost connections. */
+  uint32_t failures = 0;
+  /** The number of failures since data was last received. */
+  uint32_t consecutive_failures = 0;
+  /** The time of the most recent failure. */
+  std::chrono::steady_clock::time_point last_failure_time;
+};
+
+/**
+ * @brief Choose between multiple corrections endpoints based on their recent
+ *        connection time and failures.
+ *
+ * Each endpoint is scored as its smoothed connection time, plus @ref
+ * FAILURE_PENALTY_MS for each consecutive failure within the last @ref
+ * FAILURE_MEMORY_SEC seconds. The endpoint with the lowest score is selected,
+ * and ties are broken using the order the endpoints were specified.
+ *
+ * Endpoints are scored pessimistically if their connection time is not known
+ * yet, or if they have failed and never received data: they are scored as the
+ * slowest measured connection time plus @ref UNPROVEN_PENALTY_MS. That way, an
+ * endpoint that has never worked will not be preferred over a working one once
+ * its recent failures are forgotten.
+ *
+ * This class is not thread-safe.
+ */
+class EndpointSelector {
+ public:
+  /** The score penalty (in ms) for each recent consecutive failure. */
+  static constexpr int FAILURE_PENALTY_MS = 10000;
+
+  /** Failures older than this are ignored when scoring an endpoint. */
+  static constexpr int FAILURE_MEMORY_SEC = 60;
+
+  /**
+   * The score penalty (in ms) for an endpoint that is not known to work,
+   * relative to the slowest measured endpoint.
+   */
+  static constexpr int UNPROVEN_PENALTY_MS = 1000;
+
+  /** The weight of each new measurement in the smoothed connection time. */
+  static constexpr double RTT_SMOOTHING_FACTOR = 0.25;
+
+  /**
+   * @brief Set the list of endpoints, clearing their history.
+   *
+   * @param endpoints The endpoints, in order of preference.
+   */
+  void SetEndpoints(const std::vector<PolarisEndpoint>& endpoints);
+
+  /**
+   * @brief Get the number of endpoints.
+   *
+   * @return The number of endpoints.
+   */
+  size_t GetNumEndpoints() const { return endpoints_.size(); }
+
+  /**
+   * @brief Get an endpoint.
+   *
+   * @param index The endpoint index.
+   *
+   * @return The endpoint.
+   */
+  const PolarisEndpoint& GetEndpoint(size_t index) const {
+    return endpoints_[index].endpoint;
+  }
+
+  /**
+   * @brief Get the status of all endpoints.
+   *
+   * @return The endpoint status, in the order the endpoints were specified.
+   */
+  const std::vector<EndpointStatus>& GetStatus() const { return endpoints_; }
+
+  /**
+   * @brief Select the endpoint with the best score.
+   *
+   * @return The endpoint index.
+   */
+  size_t Select() const;
+
+  /**
+   * @brief Check if an endpoint has failed recently.
+   *
+   * @param index The endpoint index.
+   *
+   * @return `true` if the endpoint has failed within the last @ref
+   *         FAILURE_MEMORY_SEC seconds, and has not received data since.
+   */
+  bool HasRecentFailure(size_t index) const;
+
+  /**
+   * @brief Record the time taken to open a connection to an endpoint.
+   *
+   * @param index The endpoint index.
+   * @param rtt_ms The connection time (in ms).
+   */
+  void RecordConnectTime(size_t index, int rtt_ms);
+
+  /**
+   * @brief Record that a connection to an endpoint received data.
+   *
+   * @param index The endpoint index.
+   */
+  void RecordSuccess(size_t index);
+
+  /**
+   * @brief Record that a connection to an endpoint failed or was lost.
+   *
+   * @param index The endpoint index.
+   */
+  void RecordFailure(size_t index);
+
+ private:
+  std::vector<EndpointStatus> endpoints_;
+
+  int64_t GetScore(size_t index, std::chrono::steady_clock::time_point now,
+                   int worst_rtt_ms) const;
+};
+
+} // namespace polaris
+} // namespace point_one
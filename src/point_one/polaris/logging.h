@@ -0,0 +1,110 @@
+/**************************************************************************/ /**
+ * @brief Logging support for the Polaris C++ client library.
+ *
+ * Logging uses glog by default. It may be redirected to stderr by defining
+ * `POLARIS_NO_GLOG`, or disabled entirely by defining `P1_NO_PRINT`.
+ *
+ * @note
+ * This is an internal header and should only be included by library source
+ * files.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#pragma once
+
+#include <point_one/polaris/polaris.h>
+
+#if P1_NO_PRINT
+#  include <iostream>
+static std::ostream null_stream(0);
+#  define LOG(severity) null_stream
+#  define VLOG(severity) null_stream
+#  define VLOG_IS_ON(severity) false
+#  define LOG_INFO_STREAM(filename, line) null_stream
+#  define LOG_WARNING_STREAM(filename, line) null_stream
+#  define LOG_ERROR_STREAM(filename, line) null_stream
+
+#elif POLARIS_NO_GLOG
+#  include <iostream>
+
+// Reference:
+// https://stackoverflow.com/questions/49332013/adding-a-new-line-after-stdostream-output-without-explicitly-calling-it
+class StreamDelegate {
+ public:
+  ~StreamDelegate() { std::cerr << std::endl; }
+
+  template <typename T>
+  StreamDelegate& operator<<(T&& val) {
+    std::cerr << std::forward<T>(val);
+    return *this;
+  }
+};
+
+class Stream {
+ public:
+  template <typename T>
+  StreamDelegate operator<<(T&& val) {
+    std::cerr << std::forward<T>(val);
+    return StreamDelegate();
+  }
+};
+
+static Stream cerr_stream;
+static std::ostream null_stream(0);
+
+#  define LOG(severity) cerr_stream
+#  if POLARIS_DEBUG
+#    define VLOG(severity) cerr_stream
+#    define VLOG_IS_ON(severity) true
+#  else  // !POLARIS_DEBUG
+#    define VLOG(severity) null_stream
+#    define VLOG_IS_ON(severity) false
+#  endif  // POLARIS_DEBUG
+
+#  define LOG_INFO_STREAM(filename, line) LOG(INFO)
+#  define LOG_WARNING_STREAM(filename, line) LOG(WARNING)
+#  define LOG_ERROR_STREAM(filename, line) LOG(ERROR)
+
+#else  // !P1_NO_PRINT && !POLARIS_NO_GLOG
+#  include <glog/logging.h>
+
+#  if GOOGLE_STRIP_LOG == 0
+#    define LOG_INFO_STREAM(filename, line) \
+      google::LogMessage(filename, line, google::GLOG_INFO).stream()
+#  else
+#    define LOG_INFO_STREAM(filename, line) google::NullStream()
+#  endif
+
+#  if GOOGLE_STRIP_LOG <= 1
+#    define LOG_WARNING_STREAM(filename, line) \
+      google::LogMessage(filename, line, google::GLOG_WARNING).stream()
+#  else
+#    define LOG_WARNING_STREAM(filename, line) google::NullStream()
+#  endif
+
+#  if GOOGLE_STRIP_LOG <= 2
+#    define LOG_ERROR_STREAM(filename, line) \
+      google::LogMessage(filename, line, google::GLOG_ERROR).stream()
+#  else
+#    define LOG_ERROR_STREAM(filename, line) google::NullStream()
+#  endif
+
+#endif  // P1_NO_PRINT / POLARIS_NO_GLOG
+
+/**
+ * @brief Print callback used to forward messages from the Polaris C library to
+ *        the C++ logging framework.
+ *
+ * See @ref Polaris_SetPrintCallback().
+ */
+static inline void PrintCMessage(const char* filename, int line, int level,
+                                  const char* message) {
+  if (level >= POLARIS_LOG_LEVEL_INFO) {
+    LOG_INFO_STREAM(filename, line) << message;
+  } else if (level == POLARIS_LOG_LEVEL_WARNING) {
+    LOG_WARNING_STREAM(filename, line) << message;
+  } else if (level == POLARIS_LOG_LEVEL_ERROR) {
+    LOG_ERROR_STREAM(filename, line) << message;
+  }
+}
@@ -0,0 +1,111 @@
+/**************************************************************************/ /**
+ * @brief Concurrent authentication of many Polaris connections.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/polaris_batch_authenticator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "point_one/polaris/logging.h"
+#include "point_one/polaris/polaris_interface.h"
+
+using namespace point_one::polaris;
+
+/******************************************************************************/
+PolarisBatchAuthenticator::PolarisBatchAuthenticator(
+    int max_concurrent_requests, const std::string& api_url)
+    : max_concurrent_requests_(std::max(max_concurrent_requests, 1)),
+      api_url_(api_url.empty() ? POLARIS_API_URL : api_url),
+      canceled_(false) {}
+
+/******************************************************************************/
+void PolarisBatchAuthenticator::SetConnectTimeout(int timeout_ms) {
+  connect_timeout_ms_ = timeout_ms;
+}
+
+/******************************************************************************/
+std::vector<PolarisBatchAuthenticator::Result>
+PolarisBatchAuthenticator::Authenticate(const std::vector<Request>& requests,
+                                        ResultCallback callback) {
+  canceled_ = false;
+
+  std::vector<Result> results(requests.size());
+  for (size_t i = 0; i < requests.size(); ++i) {
+    results[i].index = i;
+    results[i].api_key = requests[i].api_key;
+    results[i].unique_id = requests[i].unique_id;
+  }
+
+  // Each worker takes the next request from the list until none remain. Each
+  // worker has its own Polaris context, so its connection to the
+  // authentication server is reused for all of the requests it performs.
+  std::atomic<size_t> next_index(0);
+  std::mutex callback_mutex;
+  auto worker = [&]() {
+    PolarisInterface polaris;
+    polaris.SetHTTPKeepAlive(true);
+    polaris.SetConnectTimeout(connect_timeout_ms_);
+
+    size_t index;
+    while (!canceled_ && (index = next_index++) < requests.size()) {
+      const Request& request = requests[index];
+      Result& result = results[index];
+
+      VLOG(2) << "Authenticating. [index=" << index
+              << ", unique_id=" << request.unique_id << "]";
+      result.status = polaris.AuthenticateTo(request.api_key,
+                                             request.unique_id, api_url_);
+      if (result.status == POLARIS_SUCCESS) {
+        result.auth_token = polaris.GetAuthToken();
+        result.lifetime_sec = polaris.GetAuthTokenLifetime();
+      } else {
+        LOG(WARNING) << "Authentication failed. [unique_id="
+                     << request.unique_id << ", error=" << result.status
+                     << "]";
+      }
+
+      if (callback) {
+        std::unique_lock<std::mutex> lock(callback_mutex);
+        callback(result);
+      }
+    }
+  };
+
+  size_t num_threads =
+      std::min(requests.size(), (size_t)max_concurrent_requests_);
+  VLOG(1) << "Authenticating " << requests.size()
+          << " connections. [api_url=" << api_url_
+          << ", concurrency=" << num_threads << "]";
+
+  auto start_time = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  if (VLOG_IS_ON(1)) {
+    size_t num_succeeded = std::count_if(
+        results.begin(), results.end(),
+        [](const Result& result) { return result.status == POLARIS_SUCCESS; });
+    VLOG(1) << "Finished authenticating. [succeeded=" << num_succeeded << "/"
+            << requests.size() << ", elapsed="
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start_time)
+                   .count()
+            << " ms]";
+  }
+
+  return results;
+}
+
+/******************************************************************************/
+void PolarisBatchAuthenticator::Cancel() { canceled_ = true; }
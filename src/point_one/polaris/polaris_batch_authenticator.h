@@ -0,0 +1,155 @@
+/**************************************************************************/ /**
+ * @brief Concurrent authentication of many Polaris connections.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <point_one/polaris/polaris.h>
+
+namespace point_one {
+namespace polaris {
+
+/**
+ * @brief Generate authentication tokens for a large number of API key/unique
+ *        ID pairs concurrently.
+ *
+ * Each call to @ref PolarisInterface::Authenticate() is a blocking HTTP request
+ * on a new connection to the authentication server. When starting a fleet of
+ * connections (e.g., in a gateway serving many vehicles), performing those
+ * requests one at a time can take a long time.
+ *
+ * This class performs the requests using a fixed number of worker threads, each
+ * of which keeps its connection to the authentication server open between
+ * requests (see @ref Polaris_SetHTTPKeepAlive()). The number of workers limits
+ * the number of concurrent requests sent to the server.
+ *
+ * Example usage:
+ * ```cpp
+ *  std::vector<PolarisBatchAuthenticator::Request> requests;
+ *  requests.push_back({"my-api-key", "vehicle-1234"});
+ *  ...
+ *
+ *  PolarisBatchAuthenticator authenticator(16);
+ *  authenticator.Authenticate(
+ *      requests, [](const PolarisBatchAuthenticator::Result& result) {
+ *        if (result.status == POLARIS_SUCCESS) {
+ *          // Connect using result.auth_token.
+ *        }
+ *      });
+ * ```
+ */
+class PolarisBatchAuthenticator {
+ public:
+  /**
+   * @brief An individual authentication request.
+   */
+  struct Request {
+    /** The Polaris API key to be used. */
+    std::string api_key;
+
+    /**
+     * An optional unique ID used to represent this individual connection. See
+     * @ref polaris_cpp_unique_id for details and requirements.
+     */
+    std::string unique_id;
+  };
+
+  /**
+   * @brief The result of an individual authentication request.
+   */
+  struct Result {
+    /** The index of the request in the list provided to @ref Authenticate(). */
+    size_t index = 0;
+
+    /** The API key used for the request. */
+    std::string api_key;
+
+    /** The unique ID used for the request. */
+    std::string unique_id;
+
+    /**
+     * @ref POLARIS_SUCCESS on success, or an error code returned by @ref
+     * Polaris_AuthenticateTo(). Requests skipped because of a call to @ref
+     * Cancel() are set to @ref POLARIS_ERROR.
+     */
+    int status = POLARIS_ERROR;
+
+    /** The generated authentication token on success. */
+    std::string auth_token;
+
+    /**
+     * The lifetime of the token (in seconds) reported by the authentication
+     * server, or 0 if unknown.
+     */
+    int lifetime_sec = 0;
+  };
+
+  typedef std::function<void(const Result& result)> ResultCallback;
+
+  /**
+   * @brief Create a new instance.
+   *
+   * @param max_concurrent_requests The maximum number of authentication
+   *        requests to perform at once.
+   * @param api_url The authentication server URL, or empty to use the default.
+   */
+  explicit PolarisBatchAuthenticator(int max_concurrent_requests = 8,
+                                     const std::string& api_url = "");
+
+  PolarisBatchAuthenticator(const PolarisBatchAuthenticator&) = delete;
+  PolarisBatchAuthenticator& operator=(const PolarisBatchAuthenticator&) =
+      delete;
+
+  /**
+   * @brief Set the maximum amount of time to wait for a TCP connection to the
+   *        authentication server to be established.
+   *
+   * See @ref Polaris_SetConnectTimeout().
+   *
+   * @param timeout_ms The connection timeout (in ms), or <= 0 to use the
+   *        default value.
+   */
+  void SetConnectTimeout(int timeout_ms);
+
+  /**
+   * @brief Authenticate a list of API key/unique ID pairs.
+   *
+   * This function blocks until all requests have completed. If provided, @ref
+   * callback is called as each request completes, in completion order. Calls
+   * to @ref callback are serialized, but are made from worker threads, so they
+   * should return quickly to avoid delaying other requests.
+   *
+   * @param requests The requests to be performed.
+   * @param callback An optional function to be called as each request
+   *        completes.
+   *
+   * @return The result of each request, in the same order as @ref requests.
+   */
+  std::vector<Result> Authenticate(const std::vector<Request>& requests,
+                                   ResultCallback callback = nullptr);
+
+  /**
+   * @brief Stop sending new requests and return from @ref Authenticate() once
+   *        any requests in progress have completed.
+   *
+   * This function may be called from any thread, including from the result
+   * callback.
+   */
+  void Cancel();
+
+ private:
+  int max_concurrent_requests_;
+  std::string api_url_;
+  int connect_timeout_ms_ = 0;
+  std::atomic<bool> canceled_;
+};
+
+} // namespace polaris
+} // namespace point_one
@@ -6,96 +6,61 @@
 
 #include "point_one/polaris/polaris_client.h"
 
+#include <algorithm>
+#include <cmath> // For std::lround()
 #include <iomanip>
 
-#if P1_NO_PRINT
-#  include <iostream>
-static std::ostream null_stream(0);
-#  define LOG(severity) null_stream
-#  define VLOG(severity) null_stream
-#  define VLOG_IS_ON(severity) false
-#  define LOG_INFO_STREAM(filename, line) null_stream
-#  define LOG_WARNING_STREAM(filename, line) null_stream
-#  define LOG_ERROR_STREAM(filename, line) null_stream
-
-#elif POLARIS_NO_GLOG
-#  include <iostream>
-
-// Reference:
-// https://stackoverflow.com/questions/49332013/adding-a-new-line-after-stdostream-output-without-explicitly-calling-it
-class StreamDelegate {
- public:
-  ~StreamDelegate() { std::cerr << std::endl; }
-
-  template <typename T>
-  StreamDelegate& operator<<(T&& val) {
-    std::cerr << std::forward<T>(val);
-    return *this;
-  }
-};
-
-class Stream {
- public:
-  template <typename T>
-  StreamDelegate operator<<(T&& val) {
-    std::cerr << std::forward<T>(val);
-    return StreamDelegate();
-  }
-};
-
-static Stream cerr_stream;
-static std::ostream null_stream(0);
-
-#  define LOG(severity) cerr_stream
-#  if POLARIS_DEBUG
-#    define VLOG(severity) cerr_stream
-#    define VLOG_IS_ON(severity) true
-#  else  // !POLARIS_DEBUG
-#    define VLOG(severity) null_stream
-#    define VLOG_IS_ON(severity) false
-#  endif  // POLARIS_DEBUG
-
-#  define LOG_INFO_STREAM(filename, line) LOG(INFO)
-#  define LOG_WARNING_STREAM(filename, line) LOG(WARNING)
-#  define LOG_ERROR_STREAM(filename, line) LOG(ERROR)
-
-#else  // !P1_NO_PRINT && !POLARIS_NO_GLOG
-#  include <glog/logging.h>
-
-#  if GOOGLE_STRIP_LOG == 0
-#    define LOG_INFO_STREAM(filename, line) \
-      google::LogMessage(filename, line, google::GLOG_INFO).stream()
-#  else
-#    define LOG_INFO_STREAM(filename, line) google::NullStream()
-#  endif
-
-#  if GOOGLE_STRIP_LOG <= 1
-#    define LOG_WARNING_STREAM(filename, line) \
-      google::LogMessage(filename, line, google::GLOG_WARNING).stream()
-#  else
-#    define LOG_WARNING_STREAM(filename, line) google::NullStream()
-#  endif
-
-#  if GOOGLE_STRIP_LOG <= 2
-#    define LOG_ERROR_STREAM(filename, line) \
-      google::LogMessage(filename, line, google::GLOG_ERROR).stream()
-#  else
-#    define LOG_ERROR_STREAM(filename, line) google::NullStream()
-#  endif
-
-#endif  // P1_NO_PRINT / POLARIS_NO_GLOG
+#include "point_one/polaris/logging.h"
 
 using namespace point_one::polaris;
 
+// Request a new access token once this fraction of the current token's
+// lifetime has elapsed, and at least TOKEN_REFRESH_MIN_MARGIN_SEC before it
+// expires.
+static constexpr double TOKEN_REFRESH_FRACTION = 0.8;
+static constexpr int TOKEN_REFRESH_MIN_MARGIN_SEC = 60;
+
+// The delay before retrying if a background token refresh fails.
+static constexpr int TOKEN_REFRESH_RETRY_SEC = 30;
+
+// Stream IDs used for frame deduplication. The primary connection gets a new ID
+// each time it is replaced by SeamlessReconnect(), so that frames received on
+// both the old and new connections are recognized as duplicates.
+static constexpr unsigned STANDBY_SOURCE = 0;
+static constexpr unsigned FIRST_PRIMARY_SOURCE = 1;
+
 /******************************************************************************/
-static void PrintCMessage(const char* filename, int line, int level,
-                          const char* message) {
-  if (level >= POLARIS_LOG_LEVEL_INFO) {
-    LOG_INFO_STREAM(filename, line) << message;
-  } else if (level == POLARIS_LOG_LEVEL_WARNING) {
-    LOG_WARNING_STREAM(filename, line) << message;
-  } else if (level == POLARIS_LOG_LEVEL_ERROR) {
-    LOG_ERROR_STREAM(filename, line) << message;
+void PolarisClient::RecordFrame(void* info, const uint8_t* frame,
+                                size_t size_bytes) {
+  PolarisClient* client = static_cast<PolarisClient*>(info);
+  Polaris_RTCMDedupCheck(&client->dedup_, client->primary_source_, frame,
+                         size_bytes);
+  client->UpdateHandoffEpoch(frame, size_bytes);
+}
+
+/******************************************************************************/
+void PolarisClient::FilterFrame(void* info, const uint8_t* frame,
+                                size_t size_bytes) {
+  PolarisClient* client = static_cast<PolarisClient*>(info);
+  if (client->handoff_filtering_) {
+    // Once the new connection is ahead of the old one, it can no longer
+    // deliver duplicates. The rest of the data is delivered unchecked.
+    if (client->UpdateHandoffEpoch(frame, size_bytes) ||
+        ++client->handoff_filtered_frames_ > POLARIS_RTCM_DEDUP_WINDOW_SIZE) {
+      client->handoff_filtering_ = false;
+    } else if (!Polaris_RTCMDedupCheck(&client->dedup_,
+                                       client->primary_source_, frame,
+                                       size_bytes)) {
+      return;
+    }
+  }
+
+  if (client->callback_) {
+    client->callback_(frame, size_bytes);
+  }
+
+  if (client->frame_callback_) {
+    client->frame_callback_(frame, size_bytes);
   }
 }
 
@@ -122,30 +87,69 @@ PolarisClient::PolarisClient(const std::string& api_key,
   SetPolarisAuthenticationServer();
   SetPolarisEndpoint();
 
+  Polaris_GetDefaultSocketOptions(&socket_options_);
+  reconnect_policy_ = std::make_shared<BackoffReconnectPolicy>();
+  Polaris_RTCMDedupReset(&dedup_);
+  Polaris_RTCMFramerReset(&handoff_framer_);
+  UpdateStats();
+
   polaris_.SetRTCMCallback([&](const uint8_t* buffer, size_t size_bytes) {
-    std::unique_lock<std::recursive_mutex> lock(mutex_);
-    VLOG(2) << "Received " << size_bytes << " bytes.";
-    bytes_received_ += size_bytes;
+    bool record_frames = false;
+    unsigned handoff_id = 0;
+    {
+      std::unique_lock<std::recursive_mutex> lock(mutex_);
+      // Only copy the statistics if someone asked for them since the last copy.
+      if (stats_requested_.exchange(false)) {
+        UpdateStats();
+      }
+      VLOG(2) << "Received " << size_bytes << " bytes.";
+      record_frames = handoff_active_ && !standby_;
+      handoff_id = handoff_id_;
+    }
 
-    // When we successfully reconnect and get data from the network, reset the
-    // retry count. That way if we have N-1 connection issues earlier in the
-    // day and then just 1 later, we don't end up reauthenticating immediately
-    // thinking we failed N times.
-    //
-    // We wait until we get data since "no data received" is also treated as a
-    // potential authentication issue. The network may send a single RTCM 1029
-    // text message in response to an invalid request, including a bad
-    // authentication. Since we are not parsing the incoming RTCM stream, we
-    // wait until we have received more data than the max 1029 message size
-    // before declaring the connection successful.
-    if (bytes_received_ > 270) {
-      connect_count_ = 0;
+    // Note: mutex_ is not held while delivering data. See delivery_mutex_.
+    std::unique_lock<std::recursive_mutex> lock(delivery_mutex_);
+
+    // While a seamless reconnect is in progress, record the frames received so
+    // they are not delivered again from the new connection.
+    if (record_frames) {
+      StartHandoffRecording(handoff_id);
+      Polaris_RTCMFramerProcess(&handoff_framer_, buffer, size_bytes,
+                                &RecordFrame, this);
     }
 
-    if (callback_) {
+    // In hot-standby mode, data is delivered one frame at a time by
+    // DeliverFrame() instead. After a seamless reconnect, data from the new
+    // connection is also delivered one frame at a time, skipping frames already
+    // received on the old connection, until the new connection catches up. See
+    // DeliverHandoffFrames().
+    suppress_frame_callback_ = handoff_filtering_ && !standby_;
+    if (suppress_frame_callback_) {
+      Polaris_RTCMFramerProcess(&handoff_framer_, buffer, size_bytes,
+                                &FilterFrame, this);
+      if (!handoff_filtering_) {
+        StopHandoffFiltering();
+      }
+    } else if (callback_ && !standby_) {
       callback_(buffer, size_bytes);
     }
   });
+
+  polaris_.SetAuthStatusCallback([&](int status, const std::string& message) {
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+    if (status == POLARIS_SUCCESS) {
+      // When we successfully reconnect and the network accepts our access
+      // token, reset the retry count. That way if we have N-1 connection issues
+      // earlier in the day and then just 1 later, we don't end up
+      // reauthenticating immediately thinking we failed N times.
+      VLOG(1) << "Access token accepted.";
+      connect_count_ = 0;
+      auth_rejections_ = 0;
+    } else {
+      LOG(WARNING) << "Access token rejected by Polaris. [reason='" << message
+                   << "']";
+    }
+  });
 }
 
 /******************************************************************************/
@@ -160,6 +164,16 @@ void PolarisClient::SetAPIKey(const std::string& api_key,
   no_auth_ = false;
 }
 
+/******************************************************************************/
+void PolarisClient::SetTokenCacheDirectory(const std::string& directory) {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  if (directory.empty()) {
+    token_cache_.reset();
+  } else {
+    token_cache_.reset(new TokenCache(directory));
+  }
+}
+
 /******************************************************************************/
 void PolarisClient::SetAuthToken(const std::string& auth_token) {
   std::unique_lock<std::recursive_mutex> lock(mutex_);
@@ -168,6 +182,7 @@ void PolarisClient::SetAuthToken(const std::string& auth_token) {
   no_auth_ = false;
   if (polaris_.SetAuthToken(auth_token) == POLARIS_SUCCESS) {
     auth_valid_ = true;
+    SetTokenLifetime(0);
   } else {
     LOG(ERROR) << "Unable to set authentication token.";
   }
@@ -194,23 +209,43 @@ void PolarisClient::SetPolarisAuthenticationServer(const std::string& api_url) {
 /******************************************************************************/
 void PolarisClient::SetPolarisEndpoint(const std::string& endpoint_url,
                                        int endpoint_port) {
+  PolarisEndpoint endpoint;
+  endpoint.url = endpoint_url;
+  endpoint.port = endpoint_port;
+  SetPolarisEndpoints(std::vector<PolarisEndpoint>(1, endpoint));
+}
+
+/******************************************************************************/
+void PolarisClient::SetPolarisEndpoints(
+    const std::vector<PolarisEndpoint>& endpoints) {
   std::unique_lock<std::recursive_mutex> lock(mutex_);
-  if (endpoint_url.empty()) {
-    endpoint_url_ = POLARIS_ENDPOINT_URL;
-  } else {
-    endpoint_url_ = endpoint_url;
-  }
+  std::vector<PolarisEndpoint> resolved_endpoints(
+      endpoints.empty() ? std::vector<PolarisEndpoint>(1) : endpoints);
+  for (auto& endpoint : resolved_endpoints) {
+    if (endpoint.url.empty()) {
+      endpoint.url = POLARIS_ENDPOINT_URL;
+    }
 
-  if (endpoint_port == 0) {
-    endpoint_port_ =
+    if (endpoint.port == 0) {
+      endpoint.port =
 #ifdef POLARIS_USE_TLS
-        POLARIS_ENDPOINT_TLS_PORT;
+          POLARIS_ENDPOINT_TLS_PORT;
 #else
-        POLARIS_ENDPOINT_PORT;
+          POLARIS_ENDPOINT_PORT;
 #endif
-  } else {
-    endpoint_port_ = endpoint_port;
+    }
   }
+
+  endpoints_.SetEndpoints(resolved_endpoints);
+  endpoint_index_ = 0;
+  endpoint_url_ = resolved_endpoints[0].url;
+  endpoint_port_ = resolved_endpoints[0].port;
+}
+
+/******************************************************************************/
+std::vector<EndpointStatus> PolarisClient::GetEndpointStatus() {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  return endpoints_.GetStatus();
 }
 
 /******************************************************************************/
@@ -219,32 +254,184 @@ void PolarisClient::SetMaxReconnects(int max_reconnect_attempts) {
   max_reconnect_attempts_ = max_reconnect_attempts;
 }
 
+/******************************************************************************/
+void PolarisClient::SetBatchedReads(bool enabled) {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  batched_reads_ = enabled;
+  polaris_.SetBatchedReads(enabled);
+}
+
+/******************************************************************************/
+bool PolarisClient::SetKernelTimestamps(bool enabled) {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  if (polaris_.SetKernelTimestamps(enabled) == POLARIS_SUCCESS) {
+    kernel_timestamps_ = enabled;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+/******************************************************************************/
+void PolarisClient::SetReconnectPolicy(
+    std::shared_ptr<ReconnectPolicy> policy) {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  if (policy) {
+    reconnect_policy_ = policy;
+  } else {
+    reconnect_policy_ = std::make_shared<BackoffReconnectPolicy>();
+  }
+}
+
+/******************************************************************************/
+std::vector<ReconnectAttempt> PolarisClient::GetReconnectHistory() {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  return std::vector<ReconnectAttempt>(reconnect_history_.begin(),
+                                       reconnect_history_.end());
+}
+
+/******************************************************************************/
+void PolarisClient::SetConnectTimeout(int timeout_ms) {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  connect_timeout_ms_ = timeout_ms;
+  polaris_.SetConnectTimeout(timeout_ms);
+}
+
+/******************************************************************************/
+void PolarisClient::SetSocketOptions(const PolarisSocketOptions_t& options) {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  socket_options_ = options;
+  polaris_.SetSocketOptions(options);
+}
+
+/******************************************************************************/
+void PolarisClient::SetParallelConnect(bool enabled) {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  parallel_connect_ = enabled;
+}
+
 /******************************************************************************/
 void PolarisClient::SetRTCMCallback(
     std::function<void(const uint8_t* buffer, size_t size_bytes)> callback) {
-  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  std::unique_lock<std::recursive_mutex> lock(delivery_mutex_);
   callback_ = callback;
 }
 
+/******************************************************************************/
+void PolarisClient::SetRTCMFrameCallback(
+    std::function<void(const uint8_t* buffer, size_t size_bytes)> callback) {
+  {
+    std::unique_lock<std::recursive_mutex> delivery_lock(delivery_mutex_);
+    frame_callback_ = callback;
+  }
+
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  frame_callback_enabled_ = callback != nullptr;
+  UpdateFrameCallback();
+}
+
+/******************************************************************************/
+void PolarisClient::SetRTCMTimestampedCallback(
+    std::function<void(const uint8_t* buffer, size_t size_bytes,
+                       const PolarisReceiveTime_t& receive_time)>
+        callback) {
+  {
+    std::unique_lock<std::recursive_mutex> delivery_lock(delivery_mutex_);
+    timestamped_callback_ = callback;
+  }
+
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  if (callback) {
+    polaris_.SetRTCMTimestampedCallback(
+        [&](const uint8_t* buffer, size_t size_bytes,
+            const PolarisReceiveTime_t& receive_time) {
+          // Note: mutex_ is not held while delivering data. See
+          // delivery_mutex_.
+          std::unique_lock<std::recursive_mutex> lock(delivery_mutex_);
+          if (timestamped_callback_) {
+            timestamped_callback_(buffer, size_bytes, receive_time);
+          }
+        });
+  } else {
+    polaris_.SetRTCMTimestampedCallback(nullptr);
+  }
+}
+
+/******************************************************************************/
+PolarisClient& PolarisClient::EnableHotStandby() {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  if (standby_) {
+    return *standby_;
+  }
+
+  // Note: The standby client is not running yet, so it is safe to configure it
+  // with mutex_ held.
+  standby_.reset(
+      new PolarisClient(api_key_, unique_id_, max_reconnect_attempts_));
+  if (no_auth_) {
+    standby_->SetNoAuthID(unique_id_);
+  } else if (api_key_.empty() && auth_valid_) {
+    standby_->SetAuthToken(polaris_.GetAuthToken());
+  }
+
+  std::vector<PolarisEndpoint> endpoints;
+  for (const auto& status : endpoints_.GetStatus()) {
+    endpoints.push_back(status.endpoint);
+  }
+
+  standby_->SetPolarisAuthenticationServer(api_url_);
+  standby_->SetPolarisEndpoints(endpoints);
+  standby_->SetConnectTimeout(connect_timeout_ms_);
+  standby_->SetSocketOptions(socket_options_);
+  standby_->SetParallelConnect(parallel_connect_);
+  standby_->token_cache_ = token_cache_;
+  standby_->SetRTCMFrameCallback(
+      [this](const uint8_t* buffer, size_t size_bytes) {
+        std::unique_lock<std::recursive_mutex> lock(delivery_mutex_);
+        DeliverFrame(true, buffer, size_bytes);
+      });
+  UpdateFrameCallback();
+  PolarisClient& standby = *standby_;
+  lock.unlock();
+
+  std::unique_lock<std::recursive_mutex> delivery_lock(delivery_mutex_);
+  if (handoff_filtering_) {
+    StopHandoffFiltering();
+  }
+  Polaris_RTCMDedupReset(&dedup_);
+  hot_standby_stats_ = HotStandbyStats();
+  return standby;
+}
+
+/******************************************************************************/
+void PolarisClient::DisableHotStandby() {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  standby_.reset(nullptr);
+  UpdateFrameCallback();
+}
+
+/******************************************************************************/
+HotStandbyStats PolarisClient::GetHotStandbyStats() {
+  std::unique_lock<std::recursive_mutex> lock(delivery_mutex_);
+  return hot_standby_stats_;
+}
+
 /******************************************************************************/
 void PolarisClient::SendECEFPosition(double x_m, double y_m, double z_m) {
   VLOG(1) << "Setting current ECEF position: [" << std::fixed
           << std::setprecision(2) << x_m << ", " << y_m << ", " << z_m << "]";
+
+  // The request is sent by the Run() thread, and resent automatically on
+  // reconnect. This never blocks, even while Run() is reconnecting.
+  polaris_.QueueECEFPosition(x_m, y_m, z_m);
   {
-    std::unique_lock<std::mutex> position_lock(position_mutex_);
-    current_request_type_ = RequestType::ECEF;
-    ecef_position_m_[0] = x_m;
-    ecef_position_m_[1] = y_m;
-    ecef_position_m_[2] = z_m;
+    std::unique_lock<std::mutex> lock(request_mutex_);
+    last_request_ = [=](PolarisInterface& polaris) {
+      polaris.QueueECEFPosition(x_m, y_m, z_m);
+    };
   }
-
-  // If mutex_ is locked, it's probably because PolarisClient::Run() is
-  // reconnecting.  It will send the position once connected.
-  std::unique_lock<std::recursive_mutex> lock(mutex_, std::defer_lock);
-  if (lock.try_lock()) {
-    if (connected_) {
-      polaris_.SendECEFPosition(x_m, y_m, z_m);
-    }
+  if (standby_) {
+    standby_->SendECEFPosition(x_m, y_m, z_m);
   }
 }
 
@@ -254,70 +441,169 @@ void PolarisClient::SendLLAPosition(double latitude_deg, double longitude_deg,
   VLOG(1) << "Setting current LLA position: [" << std::fixed
           << std::setprecision(6) << latitude_deg << ", " << longitude_deg
           << ", " << std::setprecision(2) << altitude_m << "]";
+  polaris_.QueueLLAPosition(latitude_deg, longitude_deg, altitude_m);
   {
-    std::unique_lock<std::mutex> position_lock(position_mutex_);
-    current_request_type_ = RequestType::LLA;
-    lla_position_deg_[0] = latitude_deg;
-    lla_position_deg_[1] = longitude_deg;
-    lla_position_deg_[2] = altitude_m;
+    std::unique_lock<std::mutex> lock(request_mutex_);
+    last_request_ = [=](PolarisInterface& polaris) {
+      polaris.QueueLLAPosition(latitude_deg, longitude_deg, altitude_m);
+    };
   }
 
-  // If mutex_ is locked, it's probably because PolarisClient::Run() is
-  // reconnecting.  It will send the position once connected.
-  std::unique_lock<std::recursive_mutex> lock(mutex_, std::defer_lock);
-  if (lock.try_lock()) {
-    if (connected_) {
-      polaris_.SendLLAPosition(latitude_deg, longitude_deg, altitude_m);
-    }
+  if (standby_) {
+    standby_->SendLLAPosition(latitude_deg, longitude_deg, altitude_m);
   }
 }
 
 /******************************************************************************/
 void PolarisClient::RequestBeacon(const std::string& beacon_id) {
   VLOG(1) << "Requesting beacon '" << beacon_id << "'.";
+  if (polaris_.QueueBeaconRequest(beacon_id) != POLARIS_SUCCESS) {
+    LOG(ERROR) << "Invalid beacon ID specified. [id=" << beacon_id << "]";
+  } else {
+    {
+      std::unique_lock<std::mutex> lock(request_mutex_);
+      last_request_ = [=](PolarisInterface& polaris) {
+        polaris.QueueBeaconRequest(beacon_id);
+      };
+    }
+
+    if (standby_) {
+      standby_->RequestBeacon(beacon_id);
+    }
+  }
+}
+
+/******************************************************************************/
+PolarisStats_t PolarisClient::GetStats() {
+  stats_requested_ = true;
+  std::unique_lock<std::mutex> lock(stats_mutex_);
+  return stats_;
+}
+
+/******************************************************************************/
+PolarisHistogram_t PolarisClient::GetReadIntervalHistogram() {
+  stats_requested_ = true;
+  std::unique_lock<std::mutex> lock(stats_mutex_);
+  return read_interval_histogram_;
+}
+
+/******************************************************************************/
+PolarisHistogram_t PolarisClient::GetCallbackDurationHistogram() {
+  stats_requested_ = true;
+  std::unique_lock<std::mutex> lock(stats_mutex_);
+  return callback_duration_histogram_;
+}
+
+/******************************************************************************/
+void PolarisClient::ResetHistograms() {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
   {
-    std::unique_lock<std::mutex> position_lock(position_mutex_);
-    current_request_type_ = RequestType::BEACON;
-    beacon_id_ = beacon_id;
+    std::unique_lock<std::mutex> stats_lock(stats_mutex_);
+    Polaris_HistogramReset(&read_interval_histogram_);
+    Polaris_HistogramReset(&callback_duration_histogram_);
   }
 
-  // If mutex_ is locked, it's probably because PolarisClient::Run() is
-  // reconnecting.  It will send the position once connected.
-  std::unique_lock<std::recursive_mutex> lock(mutex_, std::defer_lock);
-  if (lock.try_lock()) {
-    if (connected_) {
-      polaris_.RequestBeacon(beacon_id.c_str());
-    }
+  // The Polaris context is only accessed without the mutex held while
+  // connected. Otherwise, we can reset it directly.
+  if (connected_) {
+    reset_histograms_ = true;
+    stats_requested_ = true;
+  } else {
+    polaris_.ResetHistograms();
   }
 }
 
+/******************************************************************************/
+bool PolarisClient::SetCorrectionAgeMonitor(bool enabled) {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  return polaris_.SetCorrectionAgeMonitor(enabled) == POLARIS_SUCCESS;
+}
+
+/******************************************************************************/
+void PolarisClient::SetLeapSeconds(int leap_seconds) {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  polaris_.SetLeapSeconds(leap_seconds);
+}
+
+/******************************************************************************/
+PolarisCorrectionAge_t PolarisClient::GetCorrectionAge() {
+  stats_requested_ = true;
+  std::unique_lock<std::mutex> lock(stats_mutex_);
+  return correction_age_;
+}
+
+/******************************************************************************/
+void PolarisClient::SetStallDetection(double multiplier, int min_timeout_ms) {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  polaris_.SetStallDetection(multiplier, min_timeout_ms);
+}
+
 /******************************************************************************/
 void PolarisClient::Run(double timeout_sec) {
   const int timeout_ms = std::lround(timeout_sec * 1e3);
   int auth_ret = POLARIS_SUCCESS;
   running_ = true;
-  bool previous_connect_failed = false;
+  StartTokenRefresh();
+
+  // In hot-standby mode, run the standby connection in the background. Its
+  // frames are merged with ours by DeliverFrame().
+  if (standby_) {
+    VLOG(1) << "Starting hot-standby connection.";
+    standby_->RunAsync(timeout_sec);
+  }
+
+  ProbeEndpoints();
+  reconnect_delay_ = std::chrono::milliseconds(0);
   while (running_) {
-    // Pause briefly after a failed reconnect attempt.
-    if (previous_connect_failed) {
-      sleep(2);
+    // Wait before reconnecting, as directed by the reconnect policy.
+    if (reconnect_delay_.count() > 0) {
+      WaitToReconnect();
       if (!running_) {
         break;
       }
     }
-    previous_connect_failed = true;
 
     std::unique_lock<std::recursive_mutex> lock(mutex_);
+    run_timeout_ms_ = timeout_ms;
+    SelectEndpoint();
+
+    // Use a token refreshed in the background if available.
+    if (!no_auth_) {
+      UpdateAuthToken();
+    }
 
-    bytes_received_ = 0;
+    // If we have a stored access token for this API key, try that first. It
+    // will be removed if it is rejected by the corrections service.
+    std::string stored_token;
+    int stored_lifetime_sec = 0;
+    if (!auth_valid_ && !no_auth_ && token_cache_ && !api_key_.empty() &&
+        token_cache_->Load(api_url_, api_key_, unique_id_, &stored_token,
+                           &stored_lifetime_sec) &&
+        polaris_.SetAuthToken(stored_token) == POLARIS_SUCCESS) {
+      VLOG(1) << "Using stored access token.";
+      auth_valid_ = true;
+      SetTokenLifetime(stored_lifetime_sec);
+    }
 
-    // Retrieve an access token using the specified API key.
+    // Retrieve an access token using the specified API key. If enabled, open
+    // the corrections stream at the same time.
+    int connect_ret = POLARIS_ERROR;
+    bool connect_attempted = false;
     if (!auth_valid_ && !no_auth_) {
       VLOG(1) << "Authenticating with Polaris service. [api_key="
               << api_key_.substr(0, 7) << "..., unique_id="
               << (unique_id_.empty() ? "<not specified>" : unique_id_)
               << ", api_url=" << api_url_ << "]";
-      auth_ret = polaris_.AuthenticateTo(api_key_, unique_id_, api_url_);
+      int lifetime_sec = 0;
+      if (parallel_connect_) {
+        auth_ret = AuthenticateWhileConnecting(&lifetime_sec, &connect_ret);
+        connect_attempted = auth_ret == POLARIS_SUCCESS;
+      } else {
+        auth_ret = polaris_.AuthenticateTo(api_key_, unique_id_, api_url_);
+        lifetime_sec = polaris_.GetAuthTokenLifetime();
+      }
+
+      UpdateStats();
       if (auth_ret == POLARIS_FORBIDDEN) {
         LOG(ERROR) << "Authentication rejected. Is your API key valid?";
         running_ = false;
@@ -332,10 +618,16 @@ void PolarisClient::Run(double timeout_sec) {
         // Set auth_ret to success before continuing so we don't print out an
         // "exited due to error" message below if the user closes the connection
         // between here and when we call authenticate again.
+        EndAttempt(auth_ret, false, false);
         auth_ret = POLARIS_SUCCESS;
         continue;
       } else {
         auth_valid_ = true;
+        SetTokenLifetime(lifetime_sec);
+        if (token_cache_) {
+          token_cache_->Store(api_url_, api_key_, unique_id_,
+                              polaris_.GetAuthToken(), lifetime_sec);
+        }
       }
     }
 
@@ -344,50 +636,90 @@ void PolarisClient::Run(double timeout_sec) {
     // In the calls below, if the connection times out or the access token is
     // rejected, try to connect again. If it fails too many times, the access
     // token may be expired - try reauthenticating.
-    VLOG(1) << "Authenticated. Connecting to Polaris... [" << endpoint_url_
-            << ":" << endpoint_port_ << "]";
+    if (!connect_attempted) {
+      VLOG(1) << "Authenticated. Connecting to Polaris... [" << endpoint_url_
+              << ":" << endpoint_port_ << "]";
 
-    int connect_ret;
-    if (no_auth_) {
-      connect_ret = polaris_.ConnectWithoutAuth(endpoint_url_, endpoint_port_,
-                                                unique_id_);
-    } else {
-      connect_ret = polaris_.ConnectTo(endpoint_url_, endpoint_port_);
+      if (no_auth_) {
+        connect_ret = polaris_.ConnectWithoutAuth(endpoint_url_, endpoint_port_,
+                                                  unique_id_);
+      } else {
+        connect_ret = polaris_.ConnectTo(endpoint_url_, endpoint_port_);
+      }
     }
 
+    UpdateStats();
     if (connect_ret != POLARIS_SUCCESS) {
       LOG(ERROR) << "Error connecting to Polaris corrections stream. Retrying.";
       if (connect_ret != POLARIS_SOCKET_ERROR) {
         IncrementRetryCount();
       }
+      EndAttempt(connect_ret, false, false, RecordEndpointFailure());
       continue;
     }
 
-    VLOG(1) << "Connected to Polaris...";
+    VLOG(1) << "Connected to Polaris... [tls_session_resumed="
+            << polaris_.IsTLSSessionResumed() << "]";
     connected_ = true;
+    if (stats_.tcp_connect_ms >= 0) {
+      endpoints_.RecordConnectTime(
+          endpoint_index_,
+          stats_.tcp_connect_ms + std::max(stats_.tls_handshake_ms, 0));
+    }
 
-    // If there's an outstanding position update/beacon request resend it on
-    // reconnect. Requests are cleared on a user-requested disconnect, so this
-    // is a no-op on the first connection attempt.
-    int send_ret = ResendRequest();
-    if (send_ret != POLARIS_SUCCESS) {
-      VLOG(1)
-          << "Error resending position update/beacon request. Reconnecting.";
-      connected_ = false;
-      polaris_.Disconnect();
-      if (send_ret != POLARIS_SOCKET_ERROR) {
-        IncrementRetryCount();
+    // Any queued position update/beacon request will be sent by the C library
+    // once the connection is open, including when reconnecting. Requests are
+    // cleared on a user-requested disconnect, so there is nothing to send on
+    // the first connection attempt until the application provides one.
+    uint64_t reads_before_run = stats_.reads;
+
+    // Now release the mutex and start processing data. If the connection was
+    // closed by SeamlessReconnect(), continue on the new connection.
+    int run_ret = POLARIS_SUCCESS;
+    bool took_connection = false;
+    unsigned handoff_id = 0;
+    std::vector<std::vector<uint8_t>> handoff_frames;
+    while (true) {
+      lock.unlock();
+      // Deliver the frames received on a new connection before the switch
+      // before reading more data from it. Note that mutex_ must not be held
+      // while delivering data. See delivery_mutex_.
+      if (took_connection) {
+        DeliverHandoffFrames(handoff_frames, handoff_id);
+        handoff_frames.clear();
       }
-      continue;
-    }
-    previous_connect_failed = false;
 
-    // Now release the mutex and start processing data.
-    lock.unlock();
-    int run_ret = polaris_.Run(timeout_ms);
-    lock.lock();
+      run_ret = polaris_.Run(timeout_ms);
+      lock.lock();
+      // Do not take over the new connection if Disconnect() was called after it
+      // became ready. StopHandoff() will close it.
+      if (!handoff_ready_ || !running_) {
+        break;
+      }
+
+      UpdateStats();
+      if (stats_.reads != reads_before_run &&
+          endpoint_index_ < endpoints_.GetNumEndpoints()) {
+        endpoints_.RecordSuccess(endpoint_index_);
+      }
+
+      handoff_id = handoff_id_;
+      took_connection = TakeHandoffConnection(&handoff_frames);
+      if (!took_connection) {
+        break;
+      }
+      reads_before_run = stats_.reads;
+    }
 
     connected_ = false;
+    UpdateStats();
+    // Note: A rejected connection does not count as receiving data, even though
+    // the rejection message itself was read.
+    const bool received_data = stats_.reads != reads_before_run &&
+                               run_ret != POLARIS_AUTH_REJECTED;
+    if (received_data && endpoint_index_ < endpoints_.GetNumEndpoints()) {
+      endpoints_.RecordSuccess(endpoint_index_);
+    }
 
     if (run_ret == POLARIS_SUCCESS) {
       // Connection closed by a call to PolarisInterface::Disconnect().
@@ -397,6 +729,23 @@ void PolarisClient::Run(double timeout_sec) {
       LOG(WARNING) << "Connection terminated remotely. Reconnecting.";
     } else if (run_ret == POLARIS_TIMED_OUT) {
       LOG(WARNING) << "Connection timed out. Reconnecting.";
+    } else if (run_ret == POLARIS_AUTH_REJECTED) {
+      // The network told us explicitly that the token is no good, so there's
+      // no sense retrying with it. Reauthenticate immediately if we can.
+      //
+      // If a new token is rejected too, the rejection may not be about the
+      // token (e.g., a bad request), so use the reconnect policy from then on
+      // rather than hammering the authentication service.
+      if (!api_key_.empty()) {
+        LOG(WARNING) << "Authentication token rejected. Reauthenticating.";
+        ClearAuthToken();
+        connect_count_ = 0;
+        const bool first_rejection = auth_rejections_++ == 0;
+        EndAttempt(run_ret, true, received_data, first_rejection);
+        continue;
+      } else {
+        LOG(WARNING) << "Authentication token rejected. Reconnecting.";
+      }
     } else if (run_ret == POLARIS_FORBIDDEN) {
       LOG(WARNING) << "Authentication token rejected. Reconnecting.";
     } else if (run_ret == POLARIS_SOCKET_ERROR) {
@@ -405,15 +754,35 @@ void PolarisClient::Run(double timeout_sec) {
       LOG(ERROR) << "Unexpected error. Reconnecting. [error=" << run_ret << "]";
     }
 
-    // Connection closed due to an error. Reconnect.
+    // Connection closed due to an error. Reconnect. If the connection was
+    // lost, try another endpoint. An invalid token is not the endpoint's fault.
     if (run_ret != POLARIS_SOCKET_ERROR) {
       IncrementRetryCount();
     }
+    bool failover = false;
+    if (run_ret != POLARIS_AUTH_REJECTED && run_ret != POLARIS_FORBIDDEN) {
+      failover = RecordEndpointFailure();
+    }
+    EndAttempt(run_ret, true, received_data, failover);
+  }
+
+  StopTokenRefresh();
+  StopHandoff();
+
+  // Note: mutex_ is not held here, so the standby client can finish delivering
+  // any frame in progress.
+  if (standby_) {
+    VLOG(1) << "Stopping hot-standby connection.";
+    standby_->Disconnect();
   }
 
   // Finished running - clear any pending send requests for next time.
   VLOG(1) << "Finished running.";
-  current_request_type_ = RequestType::NONE;
+  polaris_.ClearQueuedRequest();
+  {
+    std::unique_lock<std::mutex> request_lock(request_mutex_);
+    last_request_ = nullptr;
+  }
   connect_count_ = 0;
   if (auth_ret != POLARIS_SUCCESS) {
     LOG(WARNING) << "PolarisClient::Run() exiting on fatal error. [error="
@@ -428,6 +797,80 @@ void PolarisClient::RunAsync(double timeout_sec) {
       new std::thread(std::bind(&PolarisClient::Run, this, timeout_sec)));
 }
 
+/******************************************************************************/
+bool PolarisClient::SeamlessReconnect() {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  if (!running_ || !connected_) {
+    VLOG(1) << "Not connected. Ignoring seamless reconnect request.";
+    return false;
+  } else if (handoff_active_) {
+    VLOG(1) << "Seamless reconnect already in progress.";
+    return false;
+  }
+
+  // Use a token refreshed in the background if available. It will replace the
+  // current token once we switch to the new connection.
+  std::string token;
+  bool token_refreshed = false;
+  TokenExpiration token_expiration;
+  if (!no_auth_) {
+    std::unique_lock<std::mutex> refresh_lock(refresh_mutex_);
+    if (refreshed_token_valid_ &&
+        (!refreshed_token_expiration_.known ||
+         Clock::now() < refreshed_token_expiration_.expiration_time)) {
+      token = refreshed_token_;
+      token_refreshed = true;
+      token_expiration = refreshed_token_expiration_;
+    } else if (auth_valid_) {
+      token = polaris_.GetAuthToken();
+    } else {
+      LOG(WARNING) << "No access token available for seamless reconnect.";
+      return false;
+    }
+  }
+
+  // A previous attempt failed. Its thread has finished, so this will not block.
+  if (handoff_thread_) {
+    handoff_thread_->join();
+    handoff_thread_.reset(nullptr);
+  }
+
+  const size_t index = endpoints_.Select();
+  const PolarisEndpoint endpoint = endpoints_.GetEndpoint(index);
+
+  // Note: We use a separate Polaris context for the new connection since
+  // polaris_ is busy receiving data from the current one.
+  handoff_polaris_.reset(new PolarisInterface());
+  handoff_polaris_->SetConnectTimeout(connect_timeout_ms_);
+  handoff_polaris_->SetSocketOptions(socket_options_);
+  handoff_polaris_->SetBatchedReads(batched_reads_);
+  handoff_polaris_->SetKernelTimestamps(kernel_timestamps_);
+  if (!no_auth_) {
+    handoff_polaris_->SetAuthToken(token);
+  }
+
+  {
+    std::unique_lock<std::mutex> request_lock(request_mutex_);
+    if (last_request_) {
+      last_request_(*handoff_polaris_);
+    }
+  }
+
+  handoff_active_ = true;
+  handoff_ready_ = false;
+  handoff_endpoint_index_ = index;
+  handoff_token_ = token;
+  handoff_token_refreshed_ = token_refreshed;
+  handoff_token_expiration_ = token_expiration;
+  handoff_frames_.clear();
+  ++handoff_id_;
+
+  handoff_thread_.reset(new std::thread(&PolarisClient::RunHandoff, this,
+                                        endpoint.url, endpoint.port, no_auth_,
+                                        unique_id_, run_timeout_ms_));
+  return true;
+}
+
 /******************************************************************************/
 void PolarisClient::Disconnect() {
   std::unique_lock<std::recursive_mutex> lock(mutex_);
@@ -441,8 +884,19 @@ void PolarisClient::Disconnect() {
   running_ = false;
   connected_ = false;
   polaris_.Disconnect();
+  // Close the new connection for a seamless reconnect in progress, including
+  // one that is ready but has not been taken over by Run() yet.
+  if (handoff_active_) {
+    handoff_polaris_->Disconnect();
+  }
   lock.unlock();
 
+  // Interrupt Run() if it is waiting to reconnect.
+  {
+    std::unique_lock<std::mutex> reconnect_lock(reconnect_mutex_);
+    reconnect_cv_.notify_all();
+  }
+
   if (run_thread_) {
     VLOG(1) << "Joining run thread.";
     run_thread_->join();
@@ -450,6 +904,486 @@ void PolarisClient::Disconnect() {
   }
 }
 
+/******************************************************************************/
+int PolarisClient::AuthenticateWhileConnecting(int* lifetime_sec,
+                                               int* connect_ret) {
+  // Note: We use a separate Polaris context for the authentication request
+  // since polaris_ is busy opening the corrections stream.
+  const std::string api_key = api_key_;
+  const std::string unique_id = unique_id_;
+  const std::string api_url = api_url_;
+  const int connect_timeout_ms = connect_timeout_ms_;
+  const PolarisSocketOptions_t socket_options = socket_options_;
+  int auth_ret = POLARIS_ERROR;
+  std::string token;
+  std::thread auth_thread([&]() {
+    PolarisInterface polaris;
+    polaris.SetConnectTimeout(connect_timeout_ms);
+    polaris.SetSocketOptions(socket_options);
+    auth_ret = polaris.AuthenticateTo(api_key, unique_id, api_url);
+    if (auth_ret == POLARIS_SUCCESS) {
+      token = polaris.GetAuthToken();
+      *lifetime_sec = polaris.GetAuthTokenLifetime();
+    }
+  });
+
+  VLOG(1) << "Connecting to Polaris while authenticating... ["
+          << endpoint_url_ << ":" << endpoint_port_ << "]";
+  auto start_time = Clock::now();
+  int open_ret = polaris_.OpenStream(endpoint_url_, endpoint_port_);
+  auto open_time = Clock::now();
+  auth_thread.join();
+
+  VLOG(1) << "Finished connecting and authenticating. [connect="
+          << std::chrono::duration_cast<std::chrono::milliseconds>(open_time -
+                                                                   start_time)
+                 .count()
+          << " ms, total="
+          << std::chrono::duration_cast<std::chrono::milliseconds>(
+                 Clock::now() - start_time)
+                 .count()
+          << " ms, connect_ret=" << open_ret << ", auth_ret=" << auth_ret
+          << "]";
+
+  if (auth_ret == POLARIS_SUCCESS) {
+    auth_ret = polaris_.SetAuthToken(token);
+  }
+
+  if (auth_ret != POLARIS_SUCCESS) {
+    if (open_ret == POLARIS_SUCCESS) {
+      polaris_.Disconnect();
+    }
+    *connect_ret = open_ret;
+  } else if (open_ret != POLARIS_SUCCESS) {
+    *connect_ret = open_ret;
+  } else {
+    *connect_ret = polaris_.SendAuthToken();
+  }
+
+  return auth_ret;
+}
+
+/******************************************************************************/
+void PolarisClient::UpdateFrameCallback() {
+  if (frame_callback_enabled_ || standby_) {
+    polaris_.SetRTCMFrameCallback([&](const uint8_t* buffer,
+                                      size_t size_bytes) {
+      // Note: mutex_ is not held while delivering data. See delivery_mutex_.
+      std::unique_lock<std::recursive_mutex> lock(delivery_mutex_);
+      if (standby_) {
+        DeliverFrame(false, buffer, size_bytes);
+      } else if (frame_callback_ && !suppress_frame_callback_) {
+        frame_callback_(buffer, size_bytes);
+      }
+    });
+  } else {
+    polaris_.SetRTCMFrameCallback(nullptr);
+  }
+}
+
+/******************************************************************************/
+void PolarisClient::DeliverFrame(bool from_standby, const uint8_t* buffer,
+                                 size_t size_bytes) {
+  // First arrival wins: discard the copy from the slower connection.
+  const unsigned source = from_standby ? STANDBY_SOURCE : primary_source_;
+  if (!Polaris_RTCMDedupCheck(&dedup_, source, buffer, size_bytes)) {
+    ++hot_standby_stats_.duplicate_frames;
+    return;
+  }
+
+  ++hot_standby_stats_.frames_delivered;
+  if (from_standby) {
+    ++hot_standby_stats_.standby_frames;
+  } else {
+    ++hot_standby_stats_.primary_frames;
+  }
+
+  if (callback_) {
+    callback_(buffer, size_bytes);
+  }
+
+  if (frame_callback_) {
+    frame_callback_(buffer, size_bytes);
+  }
+}
+
+/******************************************************************************/
+void PolarisClient::UpdateStats() {
+  if (reset_histograms_) {
+    polaris_.ResetHistograms();
+    reset_histograms_ = false;
+  }
+
+  PolarisStats_t stats = polaris_.GetStats();
+  PolarisHistogram_t read_interval_histogram =
+      polaris_.GetReadIntervalHistogram();
+  PolarisHistogram_t callback_duration_histogram =
+      polaris_.GetCallbackDurationHistogram();
+  PolarisCorrectionAge_t correction_age = polaris_.GetCorrectionAge();
+
+  std::unique_lock<std::mutex> lock(stats_mutex_);
+  stats_ = stats;
+  read_interval_histogram_ = read_interval_histogram;
+  callback_duration_histogram_ = callback_duration_histogram;
+  correction_age_ = correction_age;
+}
+
+/******************************************************************************/
+void PolarisClient::EndAttempt(int result, bool connected, bool received_data,
+                               bool retry_immediately) {
+  if (received_data) {
+    failed_attempts_ = 0;
+    reconnect_policy_->Reset();
+  }
+
+  ReconnectAttempt attempt;
+  attempt.time = std::chrono::system_clock::now();
+  attempt.attempt = ++failed_attempts_;
+  attempt.result = result;
+  attempt.endpoint_url = endpoint_url_;
+  attempt.endpoint_port = endpoint_port_;
+  attempt.connected = connected;
+  attempt.received_data = received_data;
+  if (retry_immediately) {
+    reconnect_delay_ = std::chrono::milliseconds(0);
+  } else {
+    reconnect_delay_ = reconnect_policy_->GetDelay(attempt);
+    if (reconnect_delay_.count() < 0) {
+      reconnect_delay_ = std::chrono::milliseconds(0);
+    }
+  }
+  attempt.delay_ms = (int)reconnect_delay_.count();
+
+  reconnect_history_.push_back(attempt);
+  if (reconnect_history_.size() > MAX_RECONNECT_HISTORY) {
+    reconnect_history_.pop_front();
+  }
+
+  VLOG(1) << "Connection attempt " << attempt.attempt
+          << " ended. Reconnecting in " << attempt.delay_ms
+          << " ms. [result=" << result << ", connected=" << connected
+          << ", received_data=" << received_data << "]";
+}
+
+/******************************************************************************/
+void PolarisClient::ProbeEndpoints() {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  const std::vector<EndpointStatus> status = endpoints_.GetStatus();
+  if (status.size() < 2) {
+    return;
+  }
+
+  // Note: We use a separate Polaris context for each endpoint so they can all
+  // be measured in parallel.
+  const int connect_timeout_ms = connect_timeout_ms_;
+  const PolarisSocketOptions_t socket_options = socket_options_;
+  lock.unlock();
+
+  VLOG(1) << "Measuring connection time for " << status.size()
+          << " endpoints.";
+  std::vector<int> rtt_ms(status.size(), -1);
+  std::vector<std::thread> probe_threads;
+  for (size_t i = 0; i < status.size(); ++i) {
+    probe_threads.emplace_back([&, i]() {
+      PolarisInterface polaris;
+      polaris.SetConnectTimeout(connect_timeout_ms);
+      polaris.SetSocketOptions(socket_options);
+      if (polaris.OpenStream(status[i].endpoint.url, status[i].endpoint.port) ==
+          POLARIS_SUCCESS) {
+        PolarisStats_t stats = polaris.GetStats();
+        rtt_ms[i] = stats.tcp_connect_ms + std::max(stats.tls_handshake_ms, 0);
+        polaris.Disconnect();
+      }
+    });
+  }
+
+  for (auto& thread : probe_threads) {
+    thread.join();
+  }
+
+  // The endpoints may have been changed while we were connecting.
+  lock.lock();
+  if (endpoints_.GetNumEndpoints() != status.size()) {
+    return;
+  }
+
+  for (size_t i = 0; i < status.size(); ++i) {
+    VLOG(1) << "Endpoint " << status[i].endpoint.url << ":"
+            << status[i].endpoint.port << ": "
+            << (rtt_ms[i] >= 0 ? std::to_string(rtt_ms[i]) + " ms"
+                               : std::string("connection failed"));
+    if (rtt_ms[i] >= 0) {
+      endpoints_.RecordConnectTime(i, rtt_ms[i]);
+    } else {
+      endpoints_.RecordFailure(i);
+    }
+  }
+}
+
+/******************************************************************************/
+void PolarisClient::SelectEndpoint() {
+  size_t index = endpoints_.Select();
+  const PolarisEndpoint& endpoint = endpoints_.GetEndpoint(index);
+  if (index != endpoint_index_ || endpoint.url != endpoint_url_ ||
+      endpoint.port != endpoint_port_) {
+    VLOG(1) << "Selected endpoint " << endpoint.url << ":" << endpoint.port
+            << ".";
+  }
+
+  endpoint_index_ = index;
+  endpoint_url_ = endpoint.url;
+  endpoint_port_ = endpoint.port;
+}
+
+/******************************************************************************/
+bool PolarisClient::RecordEndpointFailure() {
+  if (endpoint_index_ >= endpoints_.GetNumEndpoints()) {
+    return false;
+  }
+
+  endpoints_.RecordFailure(endpoint_index_);
+  size_t next_index = endpoints_.Select();
+  if (next_index != endpoint_index_ &&
+      !endpoints_.HasRecentFailure(next_index)) {
+    const PolarisEndpoint& endpoint = endpoints_.GetEndpoint(next_index);
+    LOG(WARNING) << "Failing over to endpoint " << endpoint.url << ":"
+                 << endpoint.port << ".";
+    return true;
+  } else {
+    return false;
+  }
+}
+
+/******************************************************************************/
+void PolarisClient::WaitToReconnect() {
+  std::unique_lock<std::mutex> lock(reconnect_mutex_);
+  reconnect_cv_.wait_for(lock, reconnect_delay_, [&]() { return !running_; });
+}
+
+/******************************************************************************/
+void PolarisClient::RunHandoff(const std::string& endpoint_url,
+                               int endpoint_port, bool no_auth,
+                               const std::string& unique_id, int timeout_ms) {
+  PolarisInterface& polaris = *handoff_polaris_;
+  bool received_frame = false;
+  polaris.SetRTCMFrameCallback([&](const uint8_t* buffer, size_t size_bytes) {
+    received_frame = true;
+    handoff_frames_.emplace_back(buffer, buffer + size_bytes);
+  });
+
+  VLOG(1) << "Opening new connection for seamless reconnect. ["
+          << endpoint_url << ":" << endpoint_port << "]";
+  auto start_time = Clock::now();
+  int ret = no_auth ? polaris.ConnectWithoutAuth(endpoint_url, endpoint_port,
+                                                 unique_id)
+                    : polaris.ConnectTo(endpoint_url, endpoint_port);
+
+  // Wait for the first valid RTCM frame. The connection is still checked for
+  // a rejected access token, etc. by Work().
+  while (ret == POLARIS_SUCCESS && !received_frame && running_) {
+    if (Clock::now() - start_time >= std::chrono::milliseconds(timeout_ms)) {
+      ret = POLARIS_TIMED_OUT;
+      break;
+    }
+
+    int work_ret = polaris.Work();
+    if (work_ret < 0 && work_ret != POLARIS_TIMED_OUT) {
+      ret = work_ret;
+    }
+  }
+
+  // If the new connection is ready, wake up Run(). It will close the current
+  // connection and take over the new one as soon as it returns from
+  // PolarisInterface::Run(). Note that the current connection is still in use
+  // by Run(), so we must not close it here.
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  if (ret == POLARIS_SUCCESS && received_frame && running_ && connected_) {
+    VLOG(1) << "New connection ready after "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   Clock::now() - start_time)
+                   .count()
+            << " ms. Closing current connection.";
+    handoff_ready_ = true;
+    polaris_.Interrupt();
+  } else {
+    if (running_) {
+      LOG(WARNING) << "Seamless reconnect failed. Keeping current connection. "
+                      "[error="
+                   << ret << "]";
+    }
+    polaris.Disconnect();
+    handoff_active_ = false;
+  }
+}
+
+/******************************************************************************/
+bool PolarisClient::TakeHandoffConnection(
+    std::vector<std::vector<uint8_t>>* frames) {
+  // RunHandoff() has finished once handoff_ready_ is set, so this will not
+  // block.
+  handoff_thread_->join();
+  handoff_thread_.reset(nullptr);
+  handoff_active_ = false;
+  handoff_ready_ = false;
+
+  // Switch to the new access token first: the new connection was opened with
+  // it.
+  if (!no_auth_ && handoff_token_ != polaris_.GetAuthToken() &&
+      polaris_.SetAuthToken(handoff_token_) == POLARIS_SUCCESS) {
+    VLOG(1) << "Using refreshed access token.";
+    auth_valid_ = true;
+    connect_count_ = 0;
+    if (handoff_token_refreshed_) {
+      SetTokenExpiration(handoff_token_expiration_);
+    }
+  }
+
+  int ret = polaris_.TakeConnection(*handoff_polaris_);
+  handoff_polaris_.reset(nullptr);
+  frames->swap(handoff_frames_);
+  handoff_frames_.clear();
+  UpdateStats();
+  if (ret != POLARIS_SUCCESS) {
+    LOG(WARNING) << "Unable to switch to new connection. Reconnecting.";
+    reconnect_delay_ = std::chrono::milliseconds(0);
+    return false;
+  }
+
+  if (handoff_endpoint_index_ < endpoints_.GetNumEndpoints()) {
+    endpoint_index_ = handoff_endpoint_index_;
+    const PolarisEndpoint& endpoint = endpoints_.GetEndpoint(endpoint_index_);
+    endpoint_url_ = endpoint.url;
+    endpoint_port_ = endpoint.port;
+    if (stats_.tcp_connect_ms >= 0) {
+      endpoints_.RecordConnectTime(
+          endpoint_index_,
+          stats_.tcp_connect_ms + std::max(stats_.tls_handshake_ms, 0));
+    }
+  }
+
+  VLOG(1) << "Switched to new connection. [" << endpoint_url_ << ":"
+          << endpoint_port_ << "]";
+  return true;
+}
+
+/******************************************************************************/
+void PolarisClient::DeliverHandoffFrames(
+    const std::vector<std::vector<uint8_t>>& frames, unsigned handoff_id) {
+  std::unique_lock<std::recursive_mutex> lock(delivery_mutex_);
+
+  // The new connection is a different stream from the old one. Deliver the
+  // frames it received before the switch, skipping any already received on the
+  // old connection.
+  primary_source_ = primary_source_ + 1 < POLARIS_RTCM_DEDUP_MAX_SOURCES
+                        ? primary_source_ + 1
+                        : FIRST_PRIMARY_SOURCE;
+  if (!standby_) {
+    StartHandoffRecording(handoff_id);
+  }
+
+  for (const auto& frame : frames) {
+    if (standby_) {
+      DeliverFrame(false, frame.data(), frame.size());
+    } else if (Polaris_RTCMDedupCheck(&dedup_, primary_source_, frame.data(),
+                                      frame.size())) {
+      UpdateHandoffEpoch(frame.data(), frame.size());
+      if (callback_) {
+        callback_(frame.data(), frame.size());
+      }
+
+      if (frame_callback_) {
+        frame_callback_(frame.data(), frame.size());
+      }
+    }
+  }
+
+  // The old connection may have been behind the new one when it was closed, so
+  // frames received after the switch may still be duplicates. Keep checking
+  // them until the new connection delivers a newer epoch. See FilterFrame().
+  if (!standby_) {
+    Polaris_RTCMFramerReset(&handoff_framer_);
+    handoff_filtering_ = true;
+    handoff_filtered_frames_ = 0;
+  }
+}
+
+/******************************************************************************/
+bool PolarisClient::UpdateHandoffEpoch(const uint8_t* frame,
+                                       size_t size_bytes) {
+  uint32_t time_ms = 0;
+  uint32_t period_ms = 0;
+  if (Polaris_GetRTCMMSMEpochTime(frame, size_bytes,
+                                  POLARIS_GPS_UTC_LEAP_SECONDS, &time_ms,
+                                  &period_ms) < 0) {
+    return false;
+  }
+
+  // Compare the times modulo the shorter period, since GLONASS messages may
+  // only specify the time of day.
+  bool newer = false;
+  if (handoff_epoch_valid_) {
+    const uint32_t period = std::min(period_ms, handoff_epoch_period_ms_);
+    const uint32_t elapsed_ms =
+        (time_ms % period + period - handoff_epoch_ms_ % period) % period;
+    newer = elapsed_ms != 0 && elapsed_ms < period / 2;
+  }
+
+  if (newer || !handoff_epoch_valid_) {
+    handoff_epoch_valid_ = true;
+    handoff_epoch_ms_ = time_ms;
+    handoff_epoch_period_ms_ = period_ms;
+  }
+  return newer;
+}
+
+/******************************************************************************/
+void PolarisClient::StopHandoffFiltering() {
+  if (callback_ && handoff_framer_.current_size > 0) {
+    callback_(handoff_framer_.buffer, handoff_framer_.current_size);
+  }
+
+  handoff_filtering_ = false;
+  Polaris_RTCMFramerReset(&handoff_framer_);
+  Polaris_RTCMDedupReset(&dedup_);
+}
+
+/******************************************************************************/
+void PolarisClient::StartHandoffRecording(unsigned handoff_id) {
+  // Forget the frames recorded for a previous seamless reconnect.
+  if (recorded_handoff_id_ != handoff_id) {
+    if (handoff_filtering_) {
+      StopHandoffFiltering();
+    }
+
+    Polaris_RTCMDedupReset(&dedup_);
+    Polaris_RTCMFramerReset(&handoff_framer_);
+    handoff_epoch_valid_ = false;
+    recorded_handoff_id_ = handoff_id;
+  }
+}
+
+/******************************************************************************/
+void PolarisClient::StopHandoff() {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  if (!handoff_thread_) {
+    return;
+  }
+
+  if (handoff_active_) {
+    handoff_polaris_->Disconnect();
+  }
+
+  std::unique_ptr<std::thread> handoff_thread = std::move(handoff_thread_);
+  lock.unlock();
+  handoff_thread->join();
+  lock.lock();
+
+  handoff_active_ = false;
+  handoff_ready_ = false;
+  handoff_polaris_.reset(nullptr);
+  handoff_frames_.clear();
+}
+
 /******************************************************************************/
 void PolarisClient::IncrementRetryCount() {
   // If we've hit the max reconnect limit, clear the auth token and try to
@@ -462,31 +1396,191 @@ void PolarisClient::IncrementRetryCount() {
     LOG(WARNING) << "Max reconnects exceeded (" << max_reconnect_attempts_
                  << "). Clearing access token and "
                     "retrying authentication.";
-    auth_valid_ = false;
+    ClearAuthToken();
     connect_count_ = 0;
   }
 }
 
 /******************************************************************************/
-int PolarisClient::ResendRequest() {
-  std::unique_lock<std::mutex> position_lock(position_mutex_);
-  if (current_request_type_ == RequestType::ECEF) {
-    VLOG(1) << "Resending ECEF position update. [" << std::fixed
-            << std::setprecision(2) << ecef_position_m_[0] << ", "
-            << ecef_position_m_[1] << ", " << ecef_position_m_[2] << "]";
-    return polaris_.SendECEFPosition(ecef_position_m_[0], ecef_position_m_[1],
-                                     ecef_position_m_[2]);
-  } else if (current_request_type_ == RequestType::LLA) {
-    VLOG(1) << "Resending LLA position update. [" << std::fixed
-            << std::setprecision(7) << lla_position_deg_[0] << ", "
-            << lla_position_deg_[1] << ", " << std::setprecision(2)
-            << lla_position_deg_[2] << "]";
-    return polaris_.SendLLAPosition(lla_position_deg_[0], lla_position_deg_[1],
-                                    lla_position_deg_[2]);
-  } else if (current_request_type_ == RequestType::BEACON) {
-    VLOG(1) << "Resending beacon request. [id=" << beacon_id_ << "]";
-    return polaris_.RequestBeacon(beacon_id_.c_str());
-  } else {
-    return POLARIS_SUCCESS;
+void PolarisClient::SetTokenLifetime(int lifetime_sec) {
+  SetTokenExpiration(GetTokenExpiration(lifetime_sec));
+}
+
+/******************************************************************************/
+void PolarisClient::SetTokenExpiration(const TokenExpiration& expiration) {
+  std::unique_lock<std::mutex> lock(refresh_mutex_);
+  refreshed_token_valid_ = false;
+  token_expiration_ = expiration;
+  refresh_cv_.notify_all();
+}
+
+/******************************************************************************/
+PolarisClient::TokenExpiration PolarisClient::GetTokenExpiration(
+    int lifetime_sec) {
+  TokenExpiration expiration;
+  expiration.known = lifetime_sec > 0;
+  if (expiration.known) {
+    auto now = Clock::now();
+    int margin_sec = std::max((int)std::lround(lifetime_sec *
+                                               (1.0 - TOKEN_REFRESH_FRACTION)),
+                              TOKEN_REFRESH_MIN_MARGIN_SEC);
+    expiration.expiration_time = now + std::chrono::seconds(lifetime_sec);
+    expiration.refresh_time =
+        now + std::chrono::seconds(std::max(lifetime_sec - margin_sec, 0));
+    VLOG(1) << "Access token expires in " << lifetime_sec
+            << " seconds. Refreshing in "
+            << std::max(lifetime_sec - margin_sec, 0) << " seconds.";
+  }
+  return expiration;
+}
+
+/******************************************************************************/
+void PolarisClient::UpdateAuthToken() {
+  std::unique_lock<std::mutex> lock(refresh_mutex_);
+  auto now = Clock::now();
+
+  // A refreshed token may expire before it is used if it could not be
+  // refreshed again in the meantime. Discard it and let the refresh thread
+  // request a new one.
+  if (refreshed_token_valid_ && refreshed_token_expiration_.known &&
+      now >= refreshed_token_expiration_.expiration_time) {
+    LOG(WARNING) << "Refreshed access token expired before use. Discarding.";
+    refreshed_token_valid_ = false;
+    refresh_cv_.notify_all();
+  }
+
+  if (refreshed_token_valid_) {
+    std::string token = refreshed_token_;
+    TokenExpiration expiration = refreshed_token_expiration_;
+    lock.unlock();
+
+    if (polaris_.SetAuthToken(token) == POLARIS_SUCCESS) {
+      VLOG(1) << "Using refreshed access token.";
+      auth_valid_ = true;
+      connect_count_ = 0;
+      SetTokenExpiration(expiration);
+    }
+  } else if (auth_valid_ && token_expiration_.known &&
+             now >= token_expiration_.expiration_time) {
+    LOG(WARNING) << "Access token expired. Reauthenticating.";
+    auth_valid_ = false;
+    token_expiration_.known = false;
+  }
+}
+
+/******************************************************************************/
+void PolarisClient::StartTokenRefresh() {
+  // Tokens can only be refreshed if we have an API key.
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  if (no_auth_ || api_key_.empty() || refresh_thread_) {
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> refresh_lock(refresh_mutex_);
+    refresh_running_ = true;
+  }
+
+  refresh_thread_.reset(new std::thread(&PolarisClient::RunTokenRefresh, this,
+                                        api_key_, unique_id_, api_url_,
+                                        token_cache_, connect_timeout_ms_,
+                                        socket_options_));
+}
+
+/******************************************************************************/
+void PolarisClient::StopTokenRefresh() {
+  {
+    std::unique_lock<std::mutex> lock(refresh_mutex_);
+    refresh_running_ = false;
+    refresh_cv_.notify_all();
+
+    // Do not wait for a request in progress to time out. Note that the refresh
+    // thread closes the connection itself.
+    if (refresh_polaris_) {
+      refresh_polaris_->Interrupt();
+    }
+  }
+
+  if (refresh_thread_) {
+    refresh_thread_->join();
+    refresh_thread_.reset(nullptr);
+  }
+}
+
+/******************************************************************************/
+void PolarisClient::RunTokenRefresh(const std::string& api_key,
+                                    const std::string& unique_id,
+                                    const std::string& api_url,
+                                    std::shared_ptr<TokenCache> token_cache,
+                                    int connect_timeout_ms,
+                                    PolarisSocketOptions_t socket_options) {
+  // Note: We use a separate Polaris context here since polaris_ is in use by
+  // Run(), which may be connected to the corrections stream.
+  std::unique_ptr<PolarisInterface> polaris(new PolarisInterface());
+  polaris->SetConnectTimeout(connect_timeout_ms);
+  polaris->SetSocketOptions(socket_options);
+
+  std::unique_lock<std::mutex> lock(refresh_mutex_);
+  refresh_polaris_ = polaris.get();
+  while (refresh_running_) {
+    // Wait until the newest token we have is due to be refreshed: the
+    // refreshed token if it has not been used yet, or the current token.
+    TokenExpiration& expiration = refreshed_token_valid_
+                                      ? refreshed_token_expiration_
+                                      : token_expiration_;
+    if (!expiration.known) {
+      refresh_cv_.wait(lock);
+      continue;
+    } else if (Clock::now() < expiration.refresh_time) {
+      Clock::time_point refresh_time = expiration.refresh_time;
+      refresh_cv_.wait_until(lock, refresh_time);
+      continue;
+    }
+
+    lock.unlock();
+
+    VLOG(1) << "Refreshing access token.";
+    int ret = polaris->AuthenticateTo(api_key, unique_id, api_url);
+    std::string token;
+    int lifetime_sec = 0;
+    if (ret == POLARIS_SUCCESS) {
+      token = polaris->GetAuthToken();
+      lifetime_sec = polaris->GetAuthTokenLifetime();
+      if (token_cache) {
+        token_cache->Store(api_url, api_key, unique_id, token, lifetime_sec);
+      }
+    }
+
+    lock.lock();
+    if (ret == POLARIS_SUCCESS) {
+      VLOG(1) << "Access token refreshed.";
+      refreshed_token_ = token;
+      refreshed_token_expiration_ = GetTokenExpiration(lifetime_sec);
+      refreshed_token_valid_ = true;
+    } else {
+      LOG(WARNING) << "Unable to refresh access token. Retrying in "
+                   << TOKEN_REFRESH_RETRY_SEC << " seconds. [error=" << ret
+                   << "]";
+      // Note that the token may have changed while we were authenticating.
+      // Only postpone the refresh if it is still due.
+      TokenExpiration& current_expiration =
+          refreshed_token_valid_ ? refreshed_token_expiration_
+                                 : token_expiration_;
+      auto now = Clock::now();
+      if (now >= current_expiration.refresh_time) {
+        current_expiration.refresh_time =
+            now + std::chrono::seconds(TOKEN_REFRESH_RETRY_SEC);
+      }
+    }
+  }
+
+  refresh_polaris_ = nullptr;
+}
+
+/******************************************************************************/
+void PolarisClient::ClearAuthToken() {
+  auth_valid_ = false;
+  if (token_cache_ && !api_key_.empty()) {
+    token_cache_->Remove(api_url_, api_key_, unique_id_);
   }
 }
@@ -7,20 +7,42 @@
 #pragma once
 
 #include <atomic>
-#include <cmath> // For NAN
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <point_one/polaris/polaris.h>
+#include <point_one/polaris/rtcm.h>
 
+#include "point_one/polaris/endpoint_selector.h"
 #include "point_one/polaris/polaris_interface.h"
+#include "point_one/polaris/reconnect_policy.h"
+#include "point_one/polaris/token_cache.h"
 
 namespace point_one {
 namespace polaris {
 
+/**
+ * @brief Frame delivery statistics for hot-standby mode. See @ref
+ *        PolarisClient::EnableHotStandby().
+ */
+struct HotStandbyStats {
+  /** The number of unique RTCM frames delivered. */
+  uint64_t frames_delivered = 0;
+  /** The number of frames delivered from the primary connection. */
+  uint64_t primary_frames = 0;
+  /** The number of frames delivered from the standby connection. */
+  uint64_t standby_frames = 0;
+  /** The number of duplicate frames discarded. */
+  uint64_t duplicate_frames = 0;
+};
+
 /**
  * @brief Polaris C++ client class.
  *
@@ -50,6 +72,9 @@ namespace polaris {
  */
 class PolarisClient {
  public:
+  /** The number of recent attempts kept by @ref GetReconnectHistory(). */
+  static constexpr size_t MAX_RECONNECT_HISTORY = 32;
+
   /**
    * @brief Create a new instance.
    *
@@ -100,6 +125,23 @@ class PolarisClient {
    */
   void SetAPIKey(const std::string& api_key, const std::string& unique_id);
 
+  /**
+   * @brief Store authentication tokens in the specified directory, and reuse
+   *        them after the application restarts.
+   *
+   * When enabled, @ref Run() will connect using the token stored for the
+   * current API key and unique ID, if any, instead of authenticating first. If
+   * the corrections service rejects the stored token, or it has expired, @ref
+   * Run() will reauthenticate and store the new token. See @ref TokenCache.
+   *
+   * Stored tokens are only used when authenticating with an API key provided to
+   * @ref SetAPIKey().
+   *
+   * @param directory The directory in which tokens will be stored, or an empty
+   *        string to disable token storage.
+   */
+  void SetTokenCacheDirectory(const std::string& directory);
+
   /**
    * @brief Specify a known authentication token to use when connecting to the
    *        Polaris corrections service.
@@ -142,6 +184,38 @@ class PolarisClient {
   void SetPolarisEndpoint(const std::string& endpoint_url = "",
                           int endpoint_port = 0);
 
+  /**
+   * @brief Specify a list of corrections endpoints to choose from (e.g.,
+   *        regional hosts and a local relay).
+   *
+   * When more than one endpoint is specified, @ref Run() first measures the
+   * time to open a connection to each endpoint (TCP connect and TLS
+   * handshake) in parallel, and then connects to the endpoint with the best
+   * score, based on the measured connection times, recent failures, and
+   * whether the endpoint has delivered data before (see @ref
+   * EndpointSelector). The connection time is updated each time @ref Run()
+   * connects.
+   *
+   * If a connection attempt fails or the connection is lost, @ref Run() fails
+   * over to the next best endpoint immediately, without waiting for the
+   * reconnect policy (see @ref SetReconnectPolicy()), as long as that endpoint
+   * has not also failed recently.
+   *
+   * @param endpoints The endpoints, in order of preference. An empty URL or a
+   *        port of 0 selects the default value.
+   */
+  void SetPolarisEndpoints(const std::vector<PolarisEndpoint>& endpoints);
+
+  /**
+   * @brief Get the connection time and failure history of each corrections
+   *        endpoint.
+   *
+   * This function may be called from any thread.
+   *
+   * @return The endpoint status, in the order the endpoints were specified.
+   */
+  std::vector<EndpointStatus> GetEndpointStatus();
+
   /**
    * @brief Set the maximum number of times to attempt a reconnection before
    *        reauthenticating.
@@ -155,6 +229,105 @@ class PolarisClient {
    */
   void SetMaxReconnects(int max_reconnect_attempts);
 
+  /**
+   * @brief Set the policy used to decide how long to wait before reconnecting.
+   *
+   * After an attempt to authenticate or connect fails, or the connection is
+   * lost, @ref Run() waits for the delay returned by the policy before trying
+   * again. @ref Disconnect() interrupts the wait immediately.
+   *
+   * By default, a @ref BackoffReconnectPolicy is used: the first reconnect
+   * happens within @ref POLARIS_BACKOFF_BASE_DELAY_MS, and the delay grows
+   * exponentially with random jitter (up to @ref POLARIS_BACKOFF_MAX_DELAY_MS)
+   * while attempts fail. The policy is reset each time data is received.
+   *
+   * @param policy The policy to be used, or `nullptr` to use the default
+   *        policy.
+   */
+  void SetReconnectPolicy(std::shared_ptr<ReconnectPolicy> policy);
+
+  /**
+   * @brief Get the outcome of the most recent connection attempts.
+   *
+   * An entry is added each time an attempt to authenticate or connect fails,
+   * and each time an established connection is lost. At most @ref
+   * MAX_RECONNECT_HISTORY entries are kept. This function may be called from
+   * any thread.
+   *
+   * @return The attempts, oldest first.
+   */
+  std::vector<ReconnectAttempt> GetReconnectHistory();
+
+  /**
+   * @brief Enable or disable batched reads.
+   *
+   * When enabled, all data available on the socket is read before calling the
+   * callback function provided to @ref SetRTCMCallback(), reducing the number
+   * of callbacks when data arrives in bursts. See @ref
+   * Polaris_SetBatchedReads().
+   *
+   * @param enabled If `true`, enable batched reads.
+   */
+  void SetBatchedReads(bool enabled);
+
+  /**
+   * @brief Enable or disable kernel receive timestamps.
+   *
+   * When enabled, the time each block of data arrived in the kernel is
+   * reported to the @ref SetRTCMTimestampedCallback() callback, separating
+   * network latency from delays within the host. Takes effect on the next
+   * connection. See @ref Polaris_SetKernelTimestamps().
+   *
+   * @param enabled If `true`, enable kernel timestamps.
+   *
+   * @return `true` on success, or `false` if not supported on this platform.
+   */
+  bool SetKernelTimestamps(bool enabled);
+
+  /**
+   * @brief Set the maximum amount of time to wait for a TCP connection to be
+   *        established when authenticating or connecting.
+   *
+   * See @ref Polaris_SetConnectTimeout().
+   *
+   * @param timeout_ms The connection timeout (in ms), or <= 0 to use the
+   *        default value.
+   */
+  void SetConnectTimeout(int timeout_ms);
+
+  /**
+   * @brief Set the TCP socket options used for new connections.
+   *
+   * For example, use @ref Polaris_GetLowLatencySocketOptions() to disable
+   * Nagle's algorithm and detect a dead network path using TCP keepalive well
+   * before the connection timeout passed to @ref Run() expires. Takes effect on
+   * the next connection. See @ref Polaris_SetSocketOptions().
+   *
+   * @param options The options to be used.
+   */
+  void SetSocketOptions(const PolarisSocketOptions_t& options);
+
+  /**
+   * @brief Enable or disable connecting to the corrections stream while
+   *        authenticating.
+   *
+   * By default, @ref Run() first requests an access token from the
+   * authentication server, and then connects to the corrections endpoint. Each
+   * step requires a DNS lookup, a TCP connection, and a TLS handshake, so the
+   * time to the first corrections data is the sum of both.
+   *
+   * When enabled, @ref Run() opens the connection to the corrections endpoint
+   * (see @ref PolarisInterface::OpenStream()) at the same time as the
+   * authentication request, and sends the token on that connection as soon as
+   * it arrives. If authentication fails, the connection is closed.
+   *
+   * This has no effect if a valid access token is already available (e.g.,
+   * when reconnecting, or when a token is loaded from the token cache).
+   *
+   * @param enabled If `true`, connect while authenticating.
+   */
+  void SetParallelConnect(bool enabled);
+
   /**
    * @brief Specify a function to be called when incoming RTCM data is received.
    *
@@ -164,6 +337,91 @@ class PolarisClient {
   void SetRTCMCallback(
       std::function<void(const uint8_t* buffer, size_t size_bytes)> callback);
 
+  /**
+   * @brief Specify a function to be called for each complete, valid RTCM 3
+   *        message received.
+   *
+   * Unlike @ref SetRTCMCallback(), this callback is called once per RTCM
+   * message, after its CRC has been validated. See also @ref
+   * Polaris_SetRTCMFrameCallback().
+   *
+   * @param callback A callback function taking a pointer to the start of the
+   *        RTCM frame and the frame size (in bytes), or `nullptr` to disable
+   *        framing.
+   */
+  void SetRTCMFrameCallback(
+      std::function<void(const uint8_t* buffer, size_t size_bytes)> callback);
+
+  /**
+   * @brief Specify a function to be called with each block of incoming data and
+   *        the time it was received.
+   *
+   * This callback receives the same data as @ref SetRTCMCallback(), along
+   * with the time the data was read and, if enabled, the time it arrived in
+   * the kernel (see @ref SetKernelTimestamps()). See also @ref
+   * Polaris_SetRTCMTimestampedCallback().
+   *
+   * @param callback A callback function taking a pointer to the data buffer,
+   *        the data size (in bytes), and the receive time, or `nullptr` to
+   *        disable.
+   */
+  void SetRTCMTimestampedCallback(
+      std::function<void(const uint8_t* buffer, size_t size_bytes,
+                         const PolarisReceiveTime_t& receive_time)>
+          callback);
+
+  /**
+   * @brief Keep a second, standby connection to Polaris open at the same time,
+   *        and merge the data from both connections.
+   *
+   * In hot-standby mode, @ref Run() also runs a second client in the
+   * background, initially configured with the same settings as this client
+   * (API key and unique ID, authentication server, endpoints, connection
+   * timeout, socket options, and token cache). The returned standby client may
+   * be reconfigured before calling @ref Run(), for example to connect to a
+   * different endpoint (@ref SetPolarisEndpoints()), or with a different unique
+   * ID if the account does not allow two connections with the same ID. Its
+   * RTCM callbacks must not be changed.
+   *
+   * RTCM frames from both connections are merged, and each frame is delivered
+   * once to the @ref SetRTCMCallback() and @ref SetRTCMFrameCallback()
+   * callbacks, from whichever connection received it first. If one connection
+   * is lost or stalls, data continues to arrive on the other without waiting
+   * to reconnect. Duplicates are detected using the most recent @ref
+   * POLARIS_RTCM_DEDUP_WINDOW_SIZE frames. Identical frames repeated on the
+   * same connection (e.g., station information) are each delivered once. See
+   * @ref PolarisRTCMDedup_t.
+   *
+   * @note
+   * In hot-standby mode, @ref SetRTCMCallback() is called once per RTCM frame
+   * instead of once per block of data, and non-RTCM data is discarded. The
+   * @ref SetRTCMTimestampedCallback() callback and the statistics from @ref
+   * GetStats() only include the primary connection.
+   *
+   * Position updates and beacon requests are sent on both connections. This
+   * function should be called before sending a position and before @ref
+   * Run(), and must not be called while running.
+   *
+   * @return The standby client. It remains owned by this client.
+   */
+  PolarisClient& EnableHotStandby();
+
+  /**
+   * @brief Disable hot-standby mode and destroy the standby client.
+   *
+   * This function must not be called while running.
+   */
+  void DisableHotStandby();
+
+  /**
+   * @brief Get frame delivery statistics for hot-standby mode.
+   *
+   * This function may be called from any thread.
+   *
+   * @return The current statistics.
+   */
+  HotStandbyStats GetHotStandbyStats();
+
   /**
    * @brief Send a position update to the corrections service.
    *
@@ -171,7 +429,10 @@ class PolarisClient {
    * You must send a position at least once to associate with a corrections
    * stream before Polaris will return any corrections data.
    *
-   * See also @ref Polaris_SendECEFPosition().
+   * This function does not block. The request is sent by the thread calling
+   * @ref Run(), and is resent automatically after reconnecting.
+   *
+   * See also @ref PolarisInterface::QueueECEFPosition().
    *
    * @param x_m The receiver ECEF X position (in meters).
    * @param y_m The receiver ECEF Y position (in meters).
@@ -186,7 +447,10 @@ class PolarisClient {
    * You must send a position at least once to associate with a corrections
    * stream before Polaris will return any corrections data.
    *
-   * See also @ref PolarisInterface::SendLLAPosition().
+   * This function does not block. The request is sent by the thread calling
+   * @ref Run(), and is resent automatically after reconnecting.
+   *
+   * See also @ref PolarisInterface::QueueLLAPosition().
    *
    * @param latitude_deg The receiver WGS-84 latitude (in degrees).
    * @param longitude_deg The receiver WGS-84 longitude (in degrees).
@@ -201,12 +465,120 @@ class PolarisClient {
    * If desired, override the corrections stream assigned based on specified
    * receiver position and instead send corrections from the requested beacon.
    *
-   * See also @ref PolarisInterface::RequestBeacon().
+   * See also @ref PolarisInterface::QueueBeaconRequest().
    *
    * @param beacon_id The desired beacon ID.
    */
   void RequestBeacon(const std::string& beacon_id);
 
+  /**
+   * @brief Get connection statistics.
+   *
+   * This function may be called from any thread. The statistics are copied by
+   * the thread calling @ref Run() each time the connection is opened or closed,
+   * and when data is received after a call to this function or the other
+   * statistics getters below. The values returned are from the most recent
+   * copy, so they may not include data received since the previous call. See
+   * @ref PolarisStats_t for details.
+   *
+   * @note
+   * The authentication statistics only include requests made by @ref Run()
+   * itself, not background token refreshes or requests made while connecting
+   * (see @ref SetParallelConnect()), which use separate Polaris contexts.
+   *
+   * @return The current statistics.
+   */
+  PolarisStats_t GetStats();
+
+  /**
+   * @brief Get a histogram of the time between successful reads from the
+   *        corrections stream (in microseconds).
+   *
+   * This function may be called from any thread. Like @ref GetStats(), the
+   * histogram is copied when data is received after the previous call.
+   *
+   * See also @ref Polaris_GetReadIntervalHistogram().
+   *
+   * @return The current histogram.
+   */
+  PolarisHistogram_t GetReadIntervalHistogram();
+
+  /**
+   * @brief Get a histogram of the time spent in each call to the @ref
+   *        SetRTCMCallback() callback (in microseconds).
+   *
+   * This function may be called from any thread. Like @ref GetStats(), the
+   * histogram is copied when data is received after the previous call. The most
+   * recent callback is not included until the next data arrives.
+   *
+   * See also @ref Polaris_GetCallbackDurationHistogram().
+   *
+   * @return The current histogram.
+   */
+  PolarisHistogram_t GetCallbackDurationHistogram();
+
+  /**
+   * @brief Clear the read interval and callback duration histograms.
+   *
+   * This function may be called from any thread. While connected, the
+   * histograms are cleared by the thread calling @ref Run() when the next data
+   * arrives.
+   */
+  void ResetHistograms();
+
+  /**
+   * @brief Enable or disable correction age monitoring.
+   *
+   * When enabled, the GNSS epoch time of each incoming MSM observation message
+   * is compared against the time it was received. Use @ref GetCorrectionAge()
+   * to detect late corrections before the connection times out. See @ref
+   * Polaris_SetCorrectionAgeMonitor().
+   *
+   * This function should be called before @ref Run().
+   *
+   * @param enabled If `true`, enable correction age monitoring.
+   *
+   * @return `true` on success, or `false` if not supported on this platform.
+   */
+  bool SetCorrectionAgeMonitor(bool enabled);
+
+  /**
+   * @brief Set the GPS-UTC offset used to compute correction age.
+   *
+   * See @ref Polaris_SetLeapSeconds().
+   *
+   * @param leap_seconds The number of leap seconds between GPS time and UTC.
+   */
+  void SetLeapSeconds(int leap_seconds);
+
+  /**
+   * @brief Get the age of the most recent corrections data.
+   *
+   * This function may be called from any thread. Like @ref GetStats(), the
+   * values are copied when data is received after the previous call.
+   *
+   * @return The current correction age statistics.
+   */
+  PolarisCorrectionAge_t GetCorrectionAge();
+
+  /**
+   * @brief Enable or disable adaptive stall detection.
+   *
+   * When enabled, @ref Run() learns the normal interval between incoming data
+   * and reconnects if no data arrives within `multiplier` times that interval,
+   * instead of waiting for the full timeout passed to @ref Run(). For example,
+   * a multiplier of 2.5 detects a stalled 1 Hz stream in about 2.5 seconds.
+   * See @ref Polaris_SetStallDetection().
+   *
+   * This function should be called before @ref Run().
+   *
+   * @param multiplier The multiple of the learned data period after which the
+   *        stream is considered stalled, or <= 0 to disable.
+   * @param min_timeout_ms The minimum stall timeout (in ms), or <= 0 to use the
+   *        default value.
+   */
+  void SetStallDetection(double multiplier, int min_timeout_ms = 0);
+
   /**
    * @brief Connect to Polaris and receive data.
    *
@@ -215,6 +587,13 @@ class PolarisClient {
    * Disconnect() is called. If the incoming data stream stops due to a bad
    * connection or other reasons, this function will reconnect automatically.
    *
+   * If the authentication server reports the lifetime of the access token, a
+   * new token is requested in the background before the current one expires,
+   * so that reconnecting never has to wait for authentication. If the token
+   * expires before a new one is available, this function reauthenticates
+   * before reconnecting rather than attempting to connect with an expired
+   * token.
+   *
    * If no data is received after a maximum number of reconnection attempts
    * specified by @ref SetMaxReconnects(), the authentication token will be
    * cleared automatically and this function will reauthenticate using the
@@ -242,6 +621,38 @@ class PolarisClient {
    */
   void RunAsync(double timeout_sec = 30.0);
 
+  /**
+   * @brief Reconnect to Polaris without interrupting the incoming data.
+   *
+   * Normally, a new connection is only opened after the current one closes, so
+   * no corrections arrive while connecting (DNS lookup, TCP connection, TLS
+   * handshake, and authentication). This function instead opens a new
+   * connection in the background while the current one continues to deliver
+   * data ("make-before-break"), for example to switch to a new access token
+   * or a better endpoint. Once valid RTCM data arrives on the new connection,
+   * the current connection is closed and @ref Run() continues on the new one
+   * immediately. See @ref Polaris_TakeConnection().
+   *
+   * The new connection uses the access token refreshed in the background, if
+   * one is available (see @ref Run()), and the endpoint with the best score
+   * (see @ref SetPolarisEndpoints()). RTCM frames received on it before the
+   * switch are delivered after the switch, unless the same frames were already
+   * received on the old connection. Frames received on the new connection after
+   * the switch are checked in the same way until it delivers a GNSS epoch newer
+   * than the last one delivered from the old connection. While they are being
+   * checked, the RTCM callback receives one complete frame per call.
+   *
+   * If the new connection fails, or no data arrives within the timeout passed
+   * to @ref Run(), it is closed and the current connection is not affected.
+   *
+   * This function does not block, and may be called from any thread.
+   *
+   * @return `true` if a new connection is being opened, or `false` if not
+   *         currently connected, no access token is available, or a seamless
+   *         reconnect is already in progress.
+   */
+  bool SeamlessReconnect();
+
   /**
    * @brief Disconnect from the Polaris service and return from @ref Run().
    *
@@ -251,11 +662,22 @@ class PolarisClient {
   void Disconnect();
 
  private:
-  enum class RequestType { NONE, ECEF, LLA, BEACON };
+  typedef std::chrono::steady_clock Clock;
+
+  /**
+   * @brief The expiration time of an access token, and the time at which it
+   *        should be refreshed.
+   */
+  struct TokenExpiration {
+    bool known = false;
+    Clock::time_point expiration_time;
+    Clock::time_point refresh_time;
+  };
 
   /**
-   * This mutex_ locks members of this class, except for the position-related
-   * fields below.
+   * This mutex_ locks members of this class. Position and beacon requests do
+   * not take it: they are queued in the @ref PolarisInterface without locking,
+   * and sent by the thread calling @ref Run().
    */
   std::recursive_mutex mutex_;
   PolarisInterface polaris_;
@@ -263,32 +685,324 @@ class PolarisClient {
   std::unique_ptr<std::thread> run_thread_;
 
   std::function<void(const uint8_t* buffer, size_t size_bytes)> callback_;
+  std::function<void(const uint8_t* buffer, size_t size_bytes)>
+      frame_callback_;
+  // Set if frame_callback_ is set. Protected by mutex_.
+  bool frame_callback_enabled_ = false;
+  std::function<void(const uint8_t* buffer, size_t size_bytes,
+                     const PolarisReceiveTime_t& receive_time)>
+      timestamped_callback_;
 
   std::string api_url_;
 
+  // The available corrections endpoints, and the one currently selected.
+  EndpointSelector endpoints_;
+  size_t endpoint_index_ = 0;
   std::string endpoint_url_;
   int endpoint_port_ = 0;
 
   bool auth_valid_ = false;
   bool no_auth_ = false;
+  bool parallel_connect_ = false;
+  int connect_timeout_ms_ = 0;
+  PolarisSocketOptions_t socket_options_;
   bool connected_ = false;
   int max_reconnect_attempts_ = -1;
   int connect_count_ = 0;
-  size_t bytes_received_ = 0;
+
+  // The reconnect policy and attempt history. Protected by mutex_, except
+  // reconnect_delay_, which is only used by the thread calling Run().
+  std::shared_ptr<ReconnectPolicy> reconnect_policy_;
+  std::deque<ReconnectAttempt> reconnect_history_;
+  int failed_attempts_ = 0;
+  std::chrono::milliseconds reconnect_delay_{0};
+  // The number of times the access token has been rejected since a token was
+  // last accepted.
+  int auth_rejections_ = 0;
+
+  // Used to wait before reconnecting, so that Disconnect() can interrupt the
+  // wait.
+  std::mutex reconnect_mutex_;
+  std::condition_variable reconnect_cv_;
 
   std::string api_key_;
   std::string unique_id_;
 
+  std::shared_ptr<TokenCache> token_cache_;
+
+  bool batched_reads_ = false;
+  bool kernel_timestamps_ = false;
+  int run_timeout_ms_ = 0;
+
+  // The most recent position or beacon request, used to send the same request
+  // on a new connection opened by SeamlessReconnect(). Protected by
+  // request_mutex_, which is never held while calling into the Polaris context
+  // used by Run().
+  std::mutex request_mutex_;
+  std::function<void(PolarisInterface& polaris)> last_request_;
+
+  // Seamless reconnect state. The new connection is opened by handoff_thread_
+  // using handoff_polaris_, and taken over by the thread calling Run() once
+  // handoff_ready_ is set. Protected by mutex_, except handoff_polaris_ and
+  // handoff_frames_, which are only used by handoff_thread_ until
+  // handoff_active_ is cleared or handoff_ready_ is set.
+  std::unique_ptr<std::thread> handoff_thread_;
+  std::unique_ptr<PolarisInterface> handoff_polaris_;
+  bool handoff_active_ = false;
+  bool handoff_ready_ = false;
+  size_t handoff_endpoint_index_ = 0;
+  std::string handoff_token_;
+  bool handoff_token_refreshed_ = false;
+  TokenExpiration handoff_token_expiration_;
+  std::vector<std::vector<uint8_t>> handoff_frames_;
+  // Incremented for each seamless reconnect. Protected by mutex_.
+  unsigned handoff_id_ = 0;
+  // Used to record the frames received on the old connection in dedup_ while
+  // a seamless reconnect is in progress, and the handoff_id_ of that
+  // reconnect. After the switch, handoff_framer_ is used to check the frames
+  // received on the new connection against dedup_ while handoff_filtering_ is
+  // set, until the new connection delivers a GNSS epoch newer than the last one
+  // delivered (handoff_epoch_ms_), or after POLARIS_RTCM_DEDUP_WINDOW_SIZE
+  // frames. Protected by delivery_mutex_.
+  PolarisRTCMFramer_t handoff_framer_;
+  unsigned recorded_handoff_id_ = 0;
+  bool handoff_filtering_ = false;
+  size_t handoff_filtered_frames_ = 0;
+  bool handoff_epoch_valid_ = false;
+  uint32_t handoff_epoch_ms_ = 0;
+  uint32_t handoff_epoch_period_ms_ = 0;
+  // Set while delivering a block of data checked by FilterFrame(), so the same
+  // frames are not delivered again by the Polaris context frame callback.
+  bool suppress_frame_callback_ = false;
+
+  // The standby client used in hot-standby mode. standby_ is only changed
+  // while not running. The standby client calls DeliverFrame() with its own
+  // mutex held, so delivery_mutex_ must never be held while calling into the
+  // standby client.
+  std::unique_ptr<PolarisClient> standby_;
+
+  // delivery_mutex_ protects the merged frame state used by hot-standby mode
+  // and SeamlessReconnect(), and serializes calls to callback_,
+  // frame_callback_, and timestamped_callback_. Data is delivered without
+  // mutex_ held, so that the standby connection is not blocked while Run()
+  // reconnects, and callbacks may call the getters below. delivery_mutex_ must
+  // never be taken while holding mutex_.
+  std::recursive_mutex delivery_mutex_;
+  PolarisRTCMDedup_t dedup_;
+  // The stream ID of the primary connection in dedup_.
+  unsigned primary_source_ = 1;
+  HotStandbyStats hot_standby_stats_;
+
+  // A copy of the Polaris context statistics, histograms, and correction age,
+  // which may only be read by the thread calling Run(). Written with mutex_
+  // held, when the connection is opened or closed, and on the next read after
+  // one of the getters sets stats_requested_. Protected by stats_mutex_, which
+  // is never held while blocking.
+  std::mutex stats_mutex_;
+  std::atomic<bool> stats_requested_{false};
+  PolarisStats_t stats_;
+  PolarisHistogram_t read_interval_histogram_;
+  PolarisHistogram_t callback_duration_histogram_;
+  PolarisCorrectionAge_t correction_age_;
+  bool reset_histograms_ = false;
+
+  /**
+   * refresh_mutex_ protects the token expiration times and the refreshed token,
+   * which are shared with the background token refresh thread. It is never held
+   * while authenticating.
+   *
+   * The refreshed token's expiration time is fixed when it is acquired. While
+   * it is waiting to be used, it is refreshed on its own schedule.
+   *
+   * refresh_polaris_ is the Polaris context used by the refresh thread, so
+   * that StopTokenRefresh() can interrupt a request in progress.
+   */
+  std::mutex refresh_mutex_;
+  std::condition_variable refresh_cv_;
+  std::unique_ptr<std::thread> refresh_thread_;
+  bool refresh_running_ = false;
+  PolarisInterface* refresh_polaris_ = nullptr;
+  TokenExpiration token_expiration_;
+  bool refreshed_token_valid_ = false;
+  std::string refreshed_token_;
+  TokenExpiration refreshed_token_expiration_;
+
+  /**
+   * @brief Request an access token using a separate Polaris context while
+   *        opening the corrections stream on @ref polaris_, then send the token
+   *        on the stream.
+   *
+   * @param[out] lifetime_sec The lifetime of the new token (in seconds), or 0
+   *             if unknown.
+   * @param[out] connect_ret The result of opening the stream and sending the
+   *             token.
+   *
+   * @return The authentication result. On failure, the stream is closed.
+   */
+  int AuthenticateWhileConnecting(int* lifetime_sec, int* connect_ret);
+
+  /**
+   * @brief Install the @ref polaris_ frame callback needed by @ref
+   *        frame_callback_ and hot-standby mode, if any.
+   *
+   * Must be called with @ref mutex_ held.
+   */
+  void UpdateFrameCallback();
+
+  /**
+   * @brief Deliver an RTCM frame received in hot-standby mode, unless it is a
+   *        duplicate.
+   *
+   * Must be called with @ref delivery_mutex_ held.
+   *
+   * @param from_standby `true` if the frame was received by the standby client.
+   * @param buffer The frame.
+   * @param size_bytes The frame size (in bytes).
+   */
+  void DeliverFrame(bool from_standby, const uint8_t* buffer,
+                    size_t size_bytes);
+
+  /**
+   * @brief Record a frame received on the current connection in @ref dedup_
+   *        during a seamless reconnect. See @ref Polaris_RTCMFramerProcess().
+   */
+  static void RecordFrame(void* info, const uint8_t* frame, size_t size_bytes);
+
+  /**
+   * @brief Deliver a frame received on a new connection after a seamless
+   *        reconnect, unless it was already received on the old connection.
+   *        See @ref Polaris_RTCMFramerProcess().
+   */
+  static void FilterFrame(void* info, const uint8_t* frame, size_t size_bytes);
+
   /**
-   * position_mutex_ protects access to the four position-related members below.
-   * When locking both mutex_ and position_mutex_, in order to prevent possible
-   * deadlock, always lock mutex_ first.
+   * @brief Record the GNSS epoch time of a frame delivered during a seamless
+   *        reconnect, if it is an MSM message.
+   *
+   * Must be called with @ref delivery_mutex_ held.
+   *
+   * @return `true` if the epoch is newer than the last one recorded.
+   */
+  bool UpdateHandoffEpoch(const uint8_t* frame, size_t size_bytes);
+
+  /**
+   * @brief Stop checking the frames received after a seamless reconnect, and
+   *        forget the frames received on the old connection.
+   *
+   * Any partial frame held in @ref handoff_framer_ is passed to @ref callback_
+   * so the data stream is not interrupted. Must be called with @ref
+   * delivery_mutex_ held.
    */
-  std::mutex position_mutex_;
-  RequestType current_request_type_ = RequestType::NONE;
-  double ecef_position_m_[3] = {NAN, NAN, NAN};
-  double lla_position_deg_[3] = {NAN, NAN, NAN};
-  std::string beacon_id_;
+  void StopHandoffFiltering();
+
+  /**
+   * @brief Update the copy of the Polaris context statistics, histograms, and
+   *        correction age, clearing the histograms first if requested by @ref
+   *        ResetHistograms().
+   *
+   * Must be called with @ref mutex_ held, by the thread calling @ref Run().
+   */
+  void UpdateStats();
+
+  /**
+   * @brief Record the outcome of a connection attempt, and get the delay before
+   *        the next attempt from @ref reconnect_policy_.
+   *
+   * Must be called with @ref mutex_ held.
+   *
+   * @param result The result of the attempt.
+   * @param connected `true` if the corrections stream was opened.
+   * @param received_data `true` if any data was received.
+   * @param retry_immediately If `true`, reconnect without waiting.
+   */
+  void EndAttempt(int result, bool connected, bool received_data,
+                  bool retry_immediately = false);
+
+  /**
+   * @brief Measure the time to open a connection to each corrections endpoint,
+   *        if there is more than one.
+   *
+   * Must be called without @ref mutex_ held.
+   */
+  void ProbeEndpoints();
+
+  /**
+   * @brief Select the corrections endpoint to be used for the next connection.
+   *
+   * Must be called with @ref mutex_ held.
+   */
+  void SelectEndpoint();
+
+  /**
+   * @brief Record a failed or lost connection to the current endpoint.
+   *
+   * Must be called with @ref mutex_ held.
+   *
+   * @return `true` if another endpoint is available that has not failed
+   *         recently, in which case @ref Run() should reconnect immediately.
+   */
+  bool RecordEndpointFailure();
+
+  /**
+   * @brief Wait for @ref reconnect_delay_, or until @ref Disconnect() is
+   *        called.
+   *
+   * Must be called without @ref mutex_ held.
+   */
+  void WaitToReconnect();
+
+  /**
+   * @brief Open a new connection using @ref handoff_polaris_ and wait for valid
+   *        data, then close the current connection so @ref Run() can take over
+   *        the new one.
+   *
+   * Runs in @ref handoff_thread_. See @ref SeamlessReconnect().
+   */
+  void RunHandoff(const std::string& endpoint_url, int endpoint_port,
+                  bool no_auth, const std::string& unique_id, int timeout_ms);
+
+  /**
+   * @brief Start recording the frames received on the current connection for
+   *        the seamless reconnect identified by @p handoff_id.
+   *
+   * Must be called with @ref delivery_mutex_ held.
+   */
+  void StartHandoffRecording(unsigned handoff_id);
+
+  /**
+   * @brief Continue on the new connection opened by @ref RunHandoff().
+   *
+   * Must be called with @ref mutex_ held, by the thread calling @ref Run(),
+   * once @ref handoff_ready_ is set. The frames received on the new connection
+   * must then be passed to @ref DeliverHandoffFrames() before reading from it.
+   *
+   * @param[out] frames The frames received on the new connection before the
+   *             switch.
+   *
+   * @return `true` if the new connection was taken over successfully.
+   */
+  bool TakeHandoffConnection(std::vector<std::vector<uint8_t>>* frames);
+
+  /**
+   * @brief Deliver the frames received on a new connection before it was taken
+   *        over, skipping any already received on the old connection, and
+   *        start checking the frames received after the switch.
+   *
+   * Must be called without @ref mutex_ held, by the thread calling @ref Run().
+   *
+   * @param frames The frames returned by @ref TakeHandoffConnection().
+   * @param handoff_id The @ref handoff_id_ of the seamless reconnect.
+   */
+  void DeliverHandoffFrames(const std::vector<std::vector<uint8_t>>& frames,
+                            unsigned handoff_id);
+
+  /**
+   * @brief Cancel a seamless reconnect in progress, if any, and wait for @ref
+   *        handoff_thread_ to finish.
+   *
+   * Must be called without @ref mutex_ held.
+   */
+  void StopHandoff();
 
   /**
    * @brief Increment the reconnect attempt count and clear the current
@@ -297,11 +1011,50 @@ class PolarisClient {
   void IncrementRetryCount();
 
   /**
-   * @brief Resend the current position/beacon request on reconnect.
+   * @brief Clear the current authentication token so @ref Run() will
+   *        reauthenticate, and remove it from the token cache if enabled.
+   */
+  void ClearAuthToken();
+
+  /**
+   * @brief Set the expiration time of the current authentication token, and
+   *        schedule a background refresh ahead of that time.
+   *
+   * @param lifetime_sec The remaining token lifetime (in seconds), or 0 if
+   *        unknown.
+   */
+  void SetTokenLifetime(int lifetime_sec);
+
+  /**
+   * @brief Set the expiration time of the current authentication token.
    *
-   * @return @ref POLARIS_SUCCESS on success or <0 on error.
+   * @param expiration The token expiration and refresh times.
    */
-  int ResendRequest();
+  void SetTokenExpiration(const TokenExpiration& expiration);
+
+  /**
+   * @brief Compute the expiration and refresh times of a newly acquired
+   *        authentication token.
+   *
+   * @param lifetime_sec The token lifetime (in seconds), or 0 if unknown.
+   *
+   * @return The token expiration and refresh times.
+   */
+  static TokenExpiration GetTokenExpiration(int lifetime_sec);
+
+  /**
+   * @brief Before connecting, switch to a refreshed authentication token if
+   *        one is available, or clear the current token if it has expired.
+   */
+  void UpdateAuthToken();
+
+  void StartTokenRefresh();
+  void StopTokenRefresh();
+  void RunTokenRefresh(const std::string& api_key, const std::string& unique_id,
+                       const std::string& api_url,
+                       std::shared_ptr<TokenCache> token_cache,
+                       int connect_timeout_ms,
+                       PolarisSocketOptions_t socket_options);
 };
 
 } // namespace polaris
@@ -0,0 +1,822 @@
+/**************************************************************************/ /**
+ * @brief Event loop for running many Polaris connections on a single thread.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/polaris_event_loop.h"
+
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+
+#include "point_one/polaris/logging.h"
+
+using namespace point_one::polaris;
+
+// The epoll user data value used for the command wakeup event. Connection IDs
+// start at 1.
+static constexpr uint64_t WAKEUP_EVENT_ID = 0;
+
+static constexpr int MAX_EPOLL_EVENTS = 256;
+
+/******************************************************************************/
+PolarisEventLoop::PolarisEventLoop(int num_connect_threads)
+    : running_(false),
+      next_id_(1),
+      connection_count_(0),
+      num_connect_threads_(std::max(num_connect_threads, 1)) {
+  // Note that the C library print level will not change if the VLOG level is
+  // changed dynamically via SetVLOGLevel() at runtime.
+  Polaris_SetPrintCallback(&PrintCMessage);
+  if (VLOG_IS_ON(2)) {
+    Polaris_SetLogLevel(POLARIS_LOG_LEVEL_TRACE);
+  } else if (VLOG_IS_ON(1)) {
+    Polaris_SetLogLevel(POLARIS_LOG_LEVEL_DEBUG);
+  }
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    LOG(ERROR) << "Unable to create epoll instance. [error=" << strerror(errno)
+               << "]";
+  }
+
+  event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (event_fd_ < 0) {
+    LOG(ERROR) << "Unable to create wakeup event. [error=" << strerror(errno)
+               << "]";
+  } else if (epoll_fd_ >= 0) {
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = WAKEUP_EVENT_ID;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &event) < 0) {
+      LOG(ERROR) << "Unable to register wakeup event. [error="
+                 << strerror(errno) << "]";
+    }
+  }
+}
+
+/******************************************************************************/
+PolarisEventLoop::~PolarisEventLoop() {
+  Stop();
+
+  if (event_fd_ >= 0) {
+    close(event_fd_);
+  }
+
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+  }
+}
+
+/******************************************************************************/
+PolarisEventLoop::ConnectionId PolarisEventLoop::AddConnection(
+    const ConnectionConfig& config) {
+  // Note: The connection is constructed here, rather than on the I/O thread,
+  // so the (relatively expensive) context initialization does not delay data
+  // delivery for other connections.
+  std::unique_ptr<Connection> connection(
+      new Connection(config.recv_buffer_size));
+  Connection* conn = connection.get();
+  conn->id = next_id_++;
+  conn->config = config;
+
+  if (conn->config.api_url.empty()) {
+    conn->config.api_url = POLARIS_API_URL;
+  }
+
+  if (conn->config.endpoint_url.empty()) {
+    conn->config.endpoint_url = POLARIS_ENDPOINT_URL;
+  }
+
+  if (conn->config.endpoint_port == 0) {
+    conn->config.endpoint_port =
+#ifdef POLARIS_USE_TLS
+        POLARIS_ENDPOINT_TLS_PORT;
+#else
+        POLARIS_ENDPOINT_PORT;
+#endif
+  }
+
+  if (!conn->config.auth_token.empty()) {
+    if (conn->polaris.SetAuthToken(conn->config.auth_token) ==
+        POLARIS_SUCCESS) {
+      conn->auth_valid = true;
+    } else {
+      LOG(ERROR) << "Unable to set authentication token. [id=" << conn->id
+                 << "]";
+    }
+  }
+
+  // Note: The seed is derived from the time and the address of the backoff
+  // state, so connections added at the same time still use different delays.
+  Polaris_BackoffInit(
+      &conn->backoff,
+      (uint32_t)std::max(conn->config.min_reconnect_delay_ms, 0),
+      (uint32_t)std::max(conn->config.max_reconnect_delay_ms, 0), 0);
+
+  // All callbacks below are issued from Polaris_PollOnce() on the I/O thread.
+  conn->polaris.SetNonBlocking(true);
+  conn->polaris.SetBatchedReads(conn->config.batched_reads);
+  conn->polaris.SetConnectTimeout(conn->config.socket_connect_timeout_ms);
+  conn->polaris.SetRTCMCallback([conn](const uint8_t* buffer,
+                                       size_t size_bytes) {
+    VLOG(2) << "Received " << size_bytes << " bytes. [id=" << conn->id << "]";
+    if (conn->config.rtcm_callback) {
+      conn->config.rtcm_callback(conn->id, buffer, size_bytes);
+    }
+  });
+
+  if (conn->config.rtcm_frame_callback) {
+    conn->polaris.SetRTCMFrameCallback([conn](const uint8_t* buffer,
+                                              size_t size_bytes) {
+      conn->config.rtcm_frame_callback(conn->id, buffer, size_bytes);
+    });
+  }
+
+  conn->polaris.SetAuthStatusCallback([conn](int status,
+                                             const std::string& message) {
+    if (status == POLARIS_SUCCESS) {
+      // See PolarisClient: reset the retry count once the network accepts our
+      // access token so that unrelated failures hours apart don't accumulate.
+      VLOG(1) << "Access token accepted. [id=" << conn->id << "]";
+      conn->connect_count = 0;
+      Polaris_BackoffReset(&conn->backoff);
+      conn->auth_rejections = 0;
+    } else {
+      LOG(WARNING) << "Access token rejected by Polaris. [id=" << conn->id
+                   << ", reason='" << message << "']";
+    }
+  });
+
+  ConnectionId id = conn->id;
+  ++connection_count_;
+
+  Command command;
+  command.type = Command::Type::ADD;
+  command.id = id;
+  command.connection = std::move(connection);
+  PushCommand(std::move(command));
+  return id;
+}
+
+/******************************************************************************/
+void PolarisEventLoop::RemoveConnection(ConnectionId id) {
+  Command command;
+  command.type = Command::Type::REMOVE;
+  command.id = id;
+  PushCommand(std::move(command));
+}
+
+/******************************************************************************/
+void PolarisEventLoop::SendECEFPosition(ConnectionId id, double x_m, double y_m,
+                                        double z_m) {
+  VLOG(1) << "Setting current ECEF position: [" << std::fixed
+          << std::setprecision(2) << x_m << ", " << y_m << ", " << z_m
+          << "] [id=" << id << "]";
+  Command command;
+  command.type = Command::Type::ECEF;
+  command.id = id;
+  command.position[0] = x_m;
+  command.position[1] = y_m;
+  command.position[2] = z_m;
+  PushCommand(std::move(command));
+}
+
+/******************************************************************************/
+void PolarisEventLoop::SendLLAPosition(ConnectionId id, double latitude_deg,
+                                       double longitude_deg,
+                                       double altitude_m) {
+  VLOG(1) << "Setting current LLA position: [" << std::fixed
+          << std::setprecision(6) << latitude_deg << ", " << longitude_deg
+          << ", " << std::setprecision(2) << altitude_m << "] [id=" << id
+          << "]";
+  Command command;
+  command.type = Command::Type::LLA;
+  command.id = id;
+  command.position[0] = latitude_deg;
+  command.position[1] = longitude_deg;
+  command.position[2] = altitude_m;
+  PushCommand(std::move(command));
+}
+
+/******************************************************************************/
+void PolarisEventLoop::RequestBeacon(ConnectionId id,
+                                     const std::string& beacon_id) {
+  VLOG(1) << "Requesting beacon '" << beacon_id << "'. [id=" << id << "]";
+  Command command;
+  command.type = Command::Type::BEACON;
+  command.id = id;
+  command.beacon_id = beacon_id;
+  PushCommand(std::move(command));
+}
+
+/******************************************************************************/
+void PolarisEventLoop::Run() {
+  running_ = true;
+  RunLoop();
+}
+
+/******************************************************************************/
+void PolarisEventLoop::RunAsync() {
+  // Note: running_ is set before the thread is started so that a call to Stop()
+  // immediately after this function returns is not missed.
+  running_ = true;
+  run_thread_.reset(new std::thread(&PolarisEventLoop::RunLoop, this));
+}
+
+/******************************************************************************/
+void PolarisEventLoop::RunLoop() {
+  if (epoll_fd_ < 0 || event_fd_ < 0) {
+    LOG(ERROR) << "Event loop not initialized.";
+    running_ = false;
+    return;
+  }
+
+  // OpenSSL writes to the socket directly, and may trigger a SIGPIPE if a
+  // connection is reset remotely while we are sending (e.g., a TLS shutdown
+  // alert). With thousands of connections this is routine, not fatal, so ignore
+  // the signal unless the application has installed its own handler.
+  struct sigaction action;
+  if (sigaction(SIGPIPE, nullptr, &action) == 0 &&
+      action.sa_handler == SIG_DFL) {
+    signal(SIGPIPE, SIG_IGN);
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(connect_mutex_);
+    workers_running_ = true;
+  }
+
+  for (int i = 0; i < num_connect_threads_; ++i) {
+    connect_threads_.emplace_back(&PolarisEventLoop::ConnectWorker, this);
+  }
+
+  VLOG(1) << "Starting event loop. [connect_threads=" << num_connect_threads_
+          << "]";
+
+  struct epoll_event events[MAX_EPOLL_EVENTS];
+  while (running_) {
+    int timeout_ms = GetPollTimeoutMS(Clock::now());
+    int num_events = epoll_wait(epoll_fd_, events, MAX_EPOLL_EVENTS, timeout_ms);
+    if (num_events < 0) {
+      if (errno == EINTR) {
+        continue;
+      } else {
+        LOG(ERROR) << "Error waiting for socket events. [error="
+                   << strerror(errno) << "]";
+        break;
+      }
+    }
+
+    for (int i = 0; i < num_events; ++i) {
+      ConnectionId id = events[i].data.u64;
+      if (id == WAKEUP_EVENT_ID) {
+        uint64_t count;
+        if (read(event_fd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+          LOG(ERROR) << "Error reading wakeup event. [error="
+                     << strerror(errno) << "]";
+        }
+        continue;
+      }
+
+      // Note that a connection may have been closed by an earlier event in this
+      // same batch.
+      auto it = connections_.find(id);
+      if (it != connections_.end()) {
+        HandleSocketEvent(it->second.get());
+      }
+    }
+
+    ProcessCommands();
+    ProcessConnectResults();
+    ProcessTimers(Clock::now());
+  }
+
+  VLOG(1) << "Stopping event loop.";
+
+  // Stop the connect workers. Any connection attempts in progress will complete
+  // before the threads exit.
+  {
+    std::unique_lock<std::mutex> lock(connect_mutex_);
+    workers_running_ = false;
+    connect_queue_.clear();
+  }
+  connect_cv_.notify_all();
+  for (auto& thread : connect_threads_) {
+    thread.join();
+  }
+  connect_threads_.clear();
+
+  // Close all connections.
+  for (auto& entry : connections_) {
+    RemoveFromPoll(entry.second.get());
+  }
+  connections_.clear();
+  timers_.clear();
+  connection_count_ = 0;
+
+  {
+    std::unique_lock<std::mutex> lock(command_mutex_);
+    commands_.clear();
+    connect_results_.clear();
+  }
+
+  VLOG(1) << "Finished running.";
+}
+
+/******************************************************************************/
+void PolarisEventLoop::Stop() {
+  running_ = false;
+  Wake();
+
+  if (run_thread_) {
+    VLOG(1) << "Joining run thread.";
+    run_thread_->join();
+    run_thread_.reset(nullptr);
+  }
+}
+
+/******************************************************************************/
+size_t PolarisEventLoop::GetConnectionCount() const {
+  return connection_count_;
+}
+
+/******************************************************************************/
+void PolarisEventLoop::PushCommand(Command&& command) {
+  {
+    std::unique_lock<std::mutex> lock(command_mutex_);
+    commands_.push_back(std::move(command));
+  }
+  Wake();
+}
+
+/******************************************************************************/
+void PolarisEventLoop::Wake() {
+  if (event_fd_ >= 0) {
+    uint64_t count = 1;
+    if (write(event_fd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+      LOG(ERROR) << "Error signaling wakeup event. [error=" << strerror(errno)
+                 << "]";
+    }
+  }
+}
+
+/******************************************************************************/
+void PolarisEventLoop::ProcessCommands() {
+  std::vector<Command> commands;
+  {
+    std::unique_lock<std::mutex> lock(command_mutex_);
+    commands.swap(commands_);
+  }
+
+  for (auto& command : commands) {
+    if (command.type == Command::Type::ADD) {
+      Connection* connection = command.connection.get();
+      connections_[command.id] = std::move(command.connection);
+      VLOG(1) << "Added connection. [id=" << command.id << "]";
+      StartConnect(connection);
+      continue;
+    }
+
+    auto it = connections_.find(command.id);
+    if (it == connections_.end() || it->second->removed) {
+      VLOG(1) << "Ignoring request for unknown connection. [id=" << command.id
+              << "]";
+      continue;
+    }
+
+    Connection* connection = it->second.get();
+    if (command.type == Command::Type::REMOVE) {
+      VLOG(1) << "Removing connection. [id=" << command.id << "]";
+      --connection_count_;
+      timers_.erase(std::make_pair(connection->deadline, connection->id));
+      if (connection->state == ConnectionState::CONNECTING) {
+        // If a worker is currently connecting, we can't free the connection
+        // until it finishes. Otherwise, just drop it from the queue.
+        std::unique_lock<std::mutex> lock(connect_mutex_);
+        auto queue_it = std::find(connect_queue_.begin(), connect_queue_.end(),
+                                  connection);
+        if (queue_it == connect_queue_.end()) {
+          connection->removed = true;
+          continue;
+        }
+        connect_queue_.erase(queue_it);
+      } else {
+        RemoveFromPoll(connection);
+      }
+      connections_.erase(it);
+      continue;
+    }
+
+    // Store the request so it can be resent if we reconnect, then send it now if
+    // we're currently connected.
+    if (command.type == Command::Type::BEACON) {
+      connection->request_type = RequestType::BEACON;
+      connection->beacon_id = command.beacon_id;
+    } else {
+      connection->request_type = command.type == Command::Type::ECEF
+                                     ? RequestType::ECEF
+                                     : RequestType::LLA;
+      std::copy(command.position, command.position + 3, connection->position);
+    }
+
+    if (connection->state == ConnectionState::CONNECTED) {
+      int ret = SendRequest(connection);
+      if (ret == POLARIS_SUCCESS || ret == POLARIS_WOULD_BLOCK) {
+        UpdatePollEvents(connection);
+      } else {
+        LOG(WARNING) << "Error sending position update/beacon request. "
+                        "Reconnecting. [id="
+                     << connection->id << ", error=" << ret << "]";
+        CloseConnection(connection, ret);
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+void PolarisEventLoop::ProcessConnectResults() {
+  std::vector<ConnectResult> results;
+  {
+    std::unique_lock<std::mutex> lock(command_mutex_);
+    results.swap(connect_results_);
+  }
+
+  for (auto& result : results) {
+    auto it = connections_.find(result.id);
+    if (it == connections_.end()) {
+      continue;
+    } else if (it->second->removed) {
+      connections_.erase(it);
+    } else {
+      FinishConnect(it->second.get(), result.auth_ret, result.connect_ret);
+    }
+  }
+}
+
+/******************************************************************************/
+void PolarisEventLoop::ProcessTimers(Clock::time_point now) {
+  while (!timers_.empty() && timers_.begin()->first <= now) {
+    ConnectionId id = timers_.begin()->second;
+    timers_.erase(timers_.begin());
+
+    auto it = connections_.find(id);
+    if (it == connections_.end()) {
+      continue;
+    }
+
+    Connection* connection = it->second.get();
+    if (connection->state == ConnectionState::CONNECTED) {
+      // The timer is not moved every time data arrives. Instead, we check when
+      // it fires whether any data arrived since it was set, and if so push it
+      // out again.
+      auto timeout_time =
+          connection->last_data_time +
+          std::chrono::milliseconds(connection->config.connection_timeout_ms);
+      if (timeout_time > now) {
+        SetTimer(connection, timeout_time);
+      } else {
+        LOG(WARNING) << "Connection timed out. Reconnecting. [id="
+                     << connection->id << "]";
+        CloseConnection(connection, POLARIS_TIMED_OUT);
+      }
+    } else if (connection->state == ConnectionState::WAITING_TO_RECONNECT) {
+      StartConnect(connection);
+    }
+  }
+}
+
+/******************************************************************************/
+int PolarisEventLoop::GetPollTimeoutMS(Clock::time_point now) const {
+  if (timers_.empty()) {
+    return -1;
+  } else {
+    auto next = timers_.begin()->first;
+    if (next <= now) {
+      return 0;
+    } else {
+      // Round up so we don't wake up just before the timer expires and spin.
+      auto delay_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(next - now)
+              .count() +
+          1;
+      return (int)std::min<decltype(delay_ms)>(delay_ms, 60000);
+    }
+  }
+}
+
+/******************************************************************************/
+void PolarisEventLoop::HandleSocketEvent(Connection* connection) {
+  if (connection->state != ConnectionState::CONNECTED) {
+    return;
+  }
+
+  // Note: If a request could not be sent without blocking, the Polaris context
+  // keeps it and sends the rest once the socket is writable. UpdatePollEvents()
+  // waits for EPOLLOUT until then.
+  int ret = connection->polaris.PollOnce();
+  // Note: For authenticated connections, the backoff is reset once the access
+  // token is accepted rather than on any data, since a rejection is data too.
+  if (ret > 0) {
+    connection->last_data_time = Clock::now();
+    if (connection->config.no_auth) {
+      Polaris_BackoffReset(&connection->backoff);
+    }
+  }
+
+  if (ret >= 0) {
+    UpdatePollEvents(connection);
+    return;
+  }
+
+  // On error, Polaris_PollOnce() closes the socket before returning.
+  connection->socket = P1_INVALID_SOCKET;
+  connection->epoll_events = 0;
+
+  if (ret == POLARIS_AUTH_REJECTED && !connection->config.api_key.empty()) {
+    // The network told us explicitly that the token is no good, so there's no
+    // sense retrying with it. Reauthenticate, immediately the first time. If a
+    // new token is rejected too, back off as usual rather than hammering the
+    // authentication service.
+    LOG(WARNING) << "Authentication token rejected. Reauthenticating. [id="
+                 << connection->id << "]";
+    connection->auth_valid = false;
+    connection->connect_count = 0;
+    timers_.erase(std::make_pair(connection->deadline, connection->id));
+    if (connection->auth_rejections++ == 0) {
+      StartConnect(connection);
+    } else {
+      ScheduleReconnect(connection, ret);
+    }
+    return;
+  } else if (ret == POLARIS_CONNECTION_CLOSED) {
+    LOG(WARNING) << "Connection terminated remotely. Reconnecting. [id="
+                 << connection->id << "]";
+  } else if (ret == POLARIS_FORBIDDEN || ret == POLARIS_AUTH_REJECTED) {
+    LOG(WARNING) << "Authentication token rejected. Reconnecting. [id="
+                 << connection->id << "]";
+  } else if (ret == POLARIS_SOCKET_ERROR) {
+    LOG(WARNING) << "Socket closed unexpectedly. Reconnecting. [id="
+                 << connection->id << "]";
+  } else {
+    LOG(ERROR) << "Unexpected error. Reconnecting. [id=" << connection->id
+               << ", error=" << ret << "]";
+  }
+
+  if (ret != POLARIS_SOCKET_ERROR) {
+    IncrementRetryCount(connection);
+  }
+  ScheduleReconnect(connection, ret);
+}
+
+/******************************************************************************/
+void PolarisEventLoop::StartConnect(Connection* connection) {
+  SetState(connection, ConnectionState::CONNECTING, POLARIS_SUCCESS);
+  {
+    std::unique_lock<std::mutex> lock(connect_mutex_);
+    connect_queue_.push_back(connection);
+  }
+  connect_cv_.notify_one();
+}
+
+/******************************************************************************/
+void PolarisEventLoop::FinishConnect(Connection* connection, int auth_ret,
+                                     int connect_ret) {
+  if (auth_ret == POLARIS_FORBIDDEN || auth_ret == POLARIS_ERROR) {
+    LOG(ERROR) << "Authentication rejected. Is your API key valid? [id="
+               << connection->id << ", error=" << auth_ret << "]";
+    SetState(connection, ConnectionState::FAILED, auth_ret);
+    return;
+  } else if (auth_ret != POLARIS_SUCCESS) {
+    LOG(WARNING) << "Authentication failed. Retrying. [id=" << connection->id
+                 << ", error=" << auth_ret << "]";
+    ScheduleReconnect(connection, auth_ret);
+    return;
+  }
+
+  connection->auth_valid = true;
+
+  if (connect_ret != POLARIS_SUCCESS) {
+    LOG(WARNING) << "Error connecting to Polaris corrections stream. Retrying. "
+                    "[id="
+                 << connection->id << ", error=" << connect_ret << "]";
+    if (connect_ret != POLARIS_SOCKET_ERROR) {
+      IncrementRetryCount(connection);
+    }
+    ScheduleReconnect(connection, connect_ret);
+    return;
+  }
+
+  VLOG(1) << "Connected to Polaris. [id=" << connection->id << "]";
+  auto now = Clock::now();
+  connection->socket = connection->polaris.GetFileDescriptor();
+  connection->last_data_time = now;
+  SetState(connection, ConnectionState::CONNECTED, POLARIS_SUCCESS);
+
+  // If there's an outstanding position update/beacon request resend it on
+  // reconnect.
+  int send_ret = SendRequest(connection);
+  if (send_ret != POLARIS_SUCCESS && send_ret != POLARIS_WOULD_BLOCK) {
+    LOG(WARNING) << "Error resending position update/beacon request. "
+                    "Reconnecting. [id="
+                 << connection->id << ", error=" << send_ret << "]";
+    CloseConnection(connection, send_ret);
+    return;
+  }
+
+  UpdatePollEvents(connection);
+  SetTimer(connection,
+           now + std::chrono::milliseconds(
+                     connection->config.connection_timeout_ms));
+}
+
+/******************************************************************************/
+void PolarisEventLoop::CloseConnection(Connection* connection, int error) {
+  RemoveFromPoll(connection);
+  if (error != POLARIS_SOCKET_ERROR) {
+    IncrementRetryCount(connection);
+  }
+  ScheduleReconnect(connection, error);
+}
+
+/******************************************************************************/
+void PolarisEventLoop::ScheduleReconnect(Connection* connection, int error) {
+  // Exponential backoff with jitter, so that a large number of connections
+  // dropped at the same time (e.g., a network outage) do not all reconnect in
+  // lockstep. See PolarisBackoff_t.
+  uint32_t delay_ms = Polaris_BackoffNext(&connection->backoff);
+
+  VLOG(1) << "Reconnecting in " << delay_ms << " ms. [id=" << connection->id
+          << "]";
+  SetState(connection, ConnectionState::WAITING_TO_RECONNECT, error);
+  SetTimer(connection, Clock::now() + std::chrono::milliseconds(delay_ms));
+}
+
+/******************************************************************************/
+void PolarisEventLoop::IncrementRetryCount(Connection* connection) {
+  // See PolarisClient::IncrementRetryCount().
+  if (!connection->config.api_key.empty() &&
+      connection->config.max_reconnect_attempts > 0 &&
+      ++connection->connect_count >
+          connection->config.max_reconnect_attempts) {
+    LOG(WARNING) << "Max reconnects exceeded ("
+                 << connection->config.max_reconnect_attempts
+                 << "). Clearing access token and retrying authentication. "
+                    "[id="
+                 << connection->id << "]";
+    connection->auth_valid = false;
+    connection->connect_count = 0;
+  }
+}
+
+/******************************************************************************/
+int PolarisEventLoop::SendRequest(Connection* connection) {
+  if (connection->request_type == RequestType::ECEF) {
+    return connection->polaris.SendECEFPosition(connection->position[0],
+                                                connection->position[1],
+                                                connection->position[2]);
+  } else if (connection->request_type == RequestType::LLA) {
+    return connection->polaris.SendLLAPosition(connection->position[0],
+                                               connection->position[1],
+                                               connection->position[2]);
+  } else if (connection->request_type == RequestType::BEACON) {
+    return connection->polaris.RequestBeacon(connection->beacon_id);
+  } else {
+    return POLARIS_SUCCESS;
+  }
+}
+
+/******************************************************************************/
+void PolarisEventLoop::SetTimer(Connection* connection,
+                                Clock::time_point deadline) {
+  timers_.erase(std::make_pair(connection->deadline, connection->id));
+  connection->deadline = deadline;
+  timers_.emplace(deadline, connection->id);
+}
+
+/******************************************************************************/
+void PolarisEventLoop::UpdatePollEvents(Connection* connection) {
+  int poll_events = connection->polaris.GetPollEvents();
+  uint32_t events = 0;
+  if (poll_events & POLARIS_WANT_READ) {
+    events |= EPOLLIN;
+  }
+  if (poll_events & POLARIS_WANT_WRITE) {
+    events |= EPOLLOUT;
+  }
+
+  if (events == connection->epoll_events) {
+    return;
+  }
+
+  struct epoll_event event;
+  event.events = events;
+  event.data.u64 = connection->id;
+  int op = connection->epoll_events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+  if (epoll_ctl(epoll_fd_, op, connection->socket, &event) < 0) {
+    LOG(ERROR) << "Unable to update socket events. [id=" << connection->id
+               << ", error=" << strerror(errno) << "]";
+  } else {
+    connection->epoll_events = events;
+  }
+}
+
+/******************************************************************************/
+void PolarisEventLoop::RemoveFromPoll(Connection* connection) {
+  // Only touch the epoll set if the socket is still open. If the C library
+  // already closed it, the kernel removed it from the set automatically, and
+  // the descriptor may since have been reused by another connection.
+  if (connection->socket != P1_INVALID_SOCKET &&
+      connection->socket == connection->polaris.GetFileDescriptor()) {
+    if (connection->epoll_events != 0) {
+      epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection->socket, nullptr);
+    }
+
+    // Polaris_Disconnect() closes the socket but leaves the TLS state for
+    // Polaris_PollOnce() to free, since it may be called from another thread.
+    connection->polaris.Disconnect();
+    connection->polaris.PollOnce();
+  }
+
+  connection->socket = P1_INVALID_SOCKET;
+  connection->epoll_events = 0;
+}
+
+/******************************************************************************/
+void PolarisEventLoop::SetState(Connection* connection, ConnectionState state,
+                                int error) {
+  connection->state = state;
+  if (connection->config.state_callback) {
+    connection->config.state_callback(connection->id, state, error);
+  }
+}
+
+/******************************************************************************/
+void PolarisEventLoop::ConnectWorker() {
+  while (true) {
+    Connection* connection;
+    {
+      std::unique_lock<std::mutex> lock(connect_mutex_);
+      connect_cv_.wait(lock, [&]() {
+        return !workers_running_ || !connect_queue_.empty();
+      });
+      if (!workers_running_) {
+        break;
+      }
+
+      connection = connect_queue_.front();
+      connect_queue_.pop_front();
+    }
+
+    ConnectResult result;
+    Connect(connection, &result);
+
+    {
+      std::unique_lock<std::mutex> lock(command_mutex_);
+      connect_results_.push_back(result);
+    }
+    Wake();
+  }
+}
+
+/******************************************************************************/
+void PolarisEventLoop::Connect(Connection* connection, ConnectResult* result) {
+  // Note: This function is called from a connect worker thread. The I/O thread
+  // does not access the Polaris context while the connection is in the
+  // CONNECTING state.
+  const ConnectionConfig& config = connection->config;
+  result->id = connection->id;
+  result->auth_ret = POLARIS_SUCCESS;
+  result->connect_ret = POLARIS_ERROR;
+
+  if (!config.no_auth && !connection->auth_valid) {
+    VLOG(1) << "Authenticating with Polaris service. [id=" << connection->id
+            << ", api_key=" << config.api_key.substr(0, 7)
+            << "..., unique_id="
+            << (config.unique_id.empty() ? "<not specified>"
+                                         : config.unique_id)
+            << ", api_url=" << config.api_url << "]";
+    result->auth_ret = connection->polaris.AuthenticateTo(
+        config.api_key, config.unique_id, config.api_url);
+    if (result->auth_ret != POLARIS_SUCCESS) {
+      return;
+    }
+  }
+
+  VLOG(1) << "Connecting to Polaris... [id=" << connection->id << ", "
+          << config.endpoint_url << ":" << config.endpoint_port << "]";
+  if (config.no_auth) {
+    result->connect_ret = connection->polaris.ConnectWithoutAuth(
+        config.endpoint_url, config.endpoint_port, config.unique_id);
+  } else {
+    result->connect_ret =
+        connection->polaris.ConnectTo(config.endpoint_url, config.endpoint_port);
+  }
+}
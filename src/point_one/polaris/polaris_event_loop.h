@@ -0,0 +1,411 @@
+/**************************************************************************/ /**
+ * @brief Event loop for running many Polaris connections on a single thread.
+ *
+ * @note
+ * This class uses `epoll` and is currently only available on Linux.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <point_one/polaris/backoff.h>
+#include <point_one/polaris/polaris.h>
+
+#include "point_one/polaris/polaris_interface.h"
+
+namespace point_one {
+namespace polaris {
+
+/**
+ * @brief Drive a large number of Polaris connections from a single I/O thread.
+ *
+ * Unlike @ref PolarisClient, which dedicates a thread to each connection, this
+ * class multiplexes all of its connections on one `epoll` set. Incoming data is
+ * read without blocking (see @ref Polaris_PollOnce()) and dispatched to the
+ * callbacks provided for each connection, all on the I/O thread. Connection
+ * timeouts and reconnect backoff are handled using per-connection timers on
+ * that same thread.
+ *
+ * Authentication and connection setup (DNS lookup, TCP connect, TLS handshake,
+ * and the HTTP authentication request) are blocking operations in the Polaris C
+ * library. These are performed by a small, fixed pool of worker threads so they
+ * never stall data delivery for established connections.
+ *
+ * Example usage:
+ * ```cpp
+ *  PolarisEventLoop loop;
+ *  loop.RunAsync();
+ *
+ *  PolarisEventLoop::ConnectionConfig config;
+ *  config.api_key = "my-api-key";
+ *  config.unique_id = "vehicle-1234";
+ *  config.rtcm_callback = [](PolarisEventLoop::ConnectionId id,
+ *                            const uint8_t* buffer, size_t size_bytes) {
+ *    ...
+ *  };
+ *  auto id = loop.AddConnection(config);
+ *
+ *  // Periodically send position updates as each vehicle moves.
+ *  loop.SendLLAPosition(id, ...);
+ *
+ *  // Shut down all connections when finished.
+ *  loop.Stop();
+ * ```
+ *
+ * All public member functions are thread-safe. Callbacks are always called on
+ * the I/O thread and must not block. To make use of more than one core, create
+ * one instance per core and distribute connections between them.
+ */
+class PolarisEventLoop {
+ public:
+  typedef uint64_t ConnectionId;
+
+  /**
+   * @brief The state of an individual connection.
+   */
+  enum class ConnectionState {
+    /** Waiting for authentication and/or a connection to be established. */
+    CONNECTING,
+    /** Connected to the corrections service. */
+    CONNECTED,
+    /** Waiting for the reconnect backoff timer to elapse. */
+    WAITING_TO_RECONNECT,
+    /**
+     * Authentication failed permanently (e.g., invalid API key). The connection
+     * will not be retried, and should be removed by the application.
+     */
+    FAILED,
+  };
+
+  typedef std::function<void(ConnectionId id, const uint8_t* buffer,
+                             size_t size_bytes)>
+      DataCallback;
+
+  typedef std::function<void(ConnectionId id, ConnectionState state,
+                             int error)>
+      StateCallback;
+
+  /**
+   * @brief Settings for an individual connection.
+   */
+  struct ConnectionConfig {
+    /**
+     * The Polaris API key to be used. Ignored if @ref auth_token is set or @ref
+     * no_auth is `true`.
+     */
+    std::string api_key;
+
+    /**
+     * An optional unique ID used to represent this individual connection. See
+     * @ref polaris_cpp_unique_id for details and requirements.
+     */
+    std::string unique_id;
+
+    /** An existing authentication token to be used, if known. */
+    std::string auth_token;
+
+    /**
+     * If `true`, connect using @ref PolarisInterface::ConnectWithoutAuth()
+     * with @ref unique_id.
+     */
+    bool no_auth = false;
+
+    /** The authentication server URL, or empty to use the default. */
+    std::string api_url;
+
+    /** The corrections endpoint URL, or empty to use the default. */
+    std::string endpoint_url;
+
+    /** The corrections endpoint port, or 0 to use the default. */
+    int endpoint_port = 0;
+
+    /**
+     * The maximum amount of time (in ms) to wait for incoming corrections data
+     * before attempting to reconnect.
+     */
+    int connection_timeout_ms = 30000;
+
+    /**
+     * The maximum amount of time (in ms) to wait for a TCP connection to be
+     * established, or 0 to use the default. See @ref
+     * Polaris_SetConnectTimeout().
+     */
+    int socket_connect_timeout_ms = 0;
+
+    /**
+     * The base delay (in ms) before reconnecting after a failure, or 0 to use
+     * the default. See @ref PolarisBackoff_t.
+     */
+    int min_reconnect_delay_ms = 1000;
+
+    /**
+     * The maximum delay (in ms) between reconnect attempts, or 0 to use the
+     * default.
+     */
+    int max_reconnect_delay_ms = 60000;
+
+    /**
+     * The maximum number of times to attempt a reconnection before
+     * reauthenticating. See @ref PolarisClient::SetMaxReconnects().
+     */
+    int max_reconnect_attempts = 2;
+
+    /**
+     * The receive buffer size (in bytes), or 0 to use the default size. See
+     * @ref Polaris_InitWithRecvBuffer().
+     */
+    size_t recv_buffer_size = 0;
+
+    /**
+     * If `true`, drain all available data before calling the data callback.
+     * See @ref Polaris_SetBatchedReads().
+     */
+    bool batched_reads = false;
+
+    /**
+     * A function to be called when incoming RTCM data is received. See @ref
+     * PolarisInterface::SetRTCMCallback().
+     */
+    DataCallback rtcm_callback;
+
+    /**
+     * An optional function to be called for each complete, valid RTCM 3
+     * message. See @ref PolarisInterface::SetRTCMFrameCallback().
+     */
+    DataCallback rtcm_frame_callback;
+
+    /** An optional function to be called when the connection state changes. */
+    StateCallback state_callback;
+  };
+
+  /**
+   * @brief Create a new event loop.
+   *
+   * @param num_connect_threads The number of worker threads used to perform
+   *        blocking authentication and connection requests.
+   */
+  explicit PolarisEventLoop(int num_connect_threads = 4);
+
+  /**
+   * @brief Stop the event loop, closing all connections, and destroy this
+   *        instance.
+   */
+  ~PolarisEventLoop();
+
+  PolarisEventLoop(const PolarisEventLoop&) = delete;
+  PolarisEventLoop& operator=(const PolarisEventLoop&) = delete;
+
+  /**
+   * @brief Add a new connection.
+   *
+   * The connection will be established asynchronously once the event loop is
+   * running.
+   *
+   * @param config The connection settings.
+   *
+   * @return An ID used to refer to the new connection.
+   */
+  ConnectionId AddConnection(const ConnectionConfig& config);
+
+  /**
+   * @brief Close and remove a connection.
+   *
+   * No further callbacks will be issued for the connection once this request
+   * has been processed by the I/O thread.
+   *
+   * @param id The connection to be removed.
+   */
+  void RemoveConnection(ConnectionId id);
+
+  /**
+   * @brief Send a position update for a connection.
+   *
+   * The most recent position or beacon request is stored and resent
+   * automatically each time the connection is reestablished.
+   *
+   * See also @ref PolarisInterface::SendECEFPosition().
+   *
+   * @param id The connection to be updated.
+   * @param x_m The receiver ECEF X position (in meters).
+   * @param y_m The receiver ECEF Y position (in meters).
+   * @param z_m The receiver ECEF Z position (in meters).
+   */
+  void SendECEFPosition(ConnectionId id, double x_m, double y_m, double z_m);
+
+  /**
+   * @brief Send a position update for a connection.
+   *
+   * @copydetails SendECEFPosition()
+   *
+   * See also @ref PolarisInterface::SendLLAPosition().
+   *
+   * @param id The connection to be updated.
+   * @param latitude_deg The receiver WGS-84 latitude (in degrees).
+   * @param longitude_deg The receiver WGS-84 longitude (in degrees).
+   * @param altitude_m The receiver WGS-84 altitude (in meters).
+   */
+  void SendLLAPosition(ConnectionId id, double latitude_deg,
+                       double longitude_deg, double altitude_m);
+
+  /**
+   * @brief Request corrections for a specific base station.
+   *
+   * See also @ref PolarisInterface::RequestBeacon().
+   *
+   * @param id The connection to be updated.
+   * @param beacon_id The desired beacon ID.
+   */
+  void RequestBeacon(ConnectionId id, const std::string& beacon_id);
+
+  /**
+   * @brief Run the event loop on the calling thread.
+   *
+   * This function blocks until @ref Stop() is called. All connections are
+   * closed before it returns.
+   */
+  void Run();
+
+  /**
+   * @brief Run the event loop in a separate thread.
+   */
+  void RunAsync();
+
+  /**
+   * @brief Stop the event loop and close all connections.
+   *
+   * If running asynchronously (@ref RunAsync()), this function will block until
+   * the underlying run thread has been joined.
+   */
+  void Stop();
+
+  /**
+   * @brief Get the number of connections currently managed by this loop.
+   *
+   * @return The connection count.
+   */
+  size_t GetConnectionCount() const;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  enum class RequestType { NONE, ECEF, LLA, BEACON };
+
+  struct Connection {
+    explicit Connection(size_t recv_buffer_size) : polaris(recv_buffer_size) {}
+
+    ConnectionId id = 0;
+    ConnectionConfig config;
+    PolarisInterface polaris;
+
+    ConnectionState state = ConnectionState::CONNECTING;
+    P1_Socket_t socket = P1_INVALID_SOCKET;
+    uint32_t epoll_events = 0;
+
+    bool auth_valid = false;
+    int connect_count = 0;
+    PolarisBackoff_t backoff;
+    // The number of times the access token has been rejected since a token
+    // was last accepted.
+    int auth_rejections = 0;
+    bool removed = false;
+
+    Clock::time_point deadline;
+    Clock::time_point last_data_time;
+
+    RequestType request_type = RequestType::NONE;
+    double position[3] = {0.0, 0.0, 0.0};
+    std::string beacon_id;
+  };
+
+  struct Command {
+    enum class Type { ADD, REMOVE, ECEF, LLA, BEACON };
+
+    Type type;
+    ConnectionId id;
+    std::unique_ptr<Connection> connection;
+    double position[3];
+    std::string beacon_id;
+  };
+
+  struct ConnectResult {
+    ConnectionId id;
+    int auth_ret;
+    int connect_ret;
+  };
+
+  int epoll_fd_ = -1;
+  int event_fd_ = -1;
+
+  std::atomic<bool> running_;
+  std::unique_ptr<std::thread> run_thread_;
+  std::atomic<ConnectionId> next_id_;
+  std::atomic<size_t> connection_count_;
+
+  /**
+   * command_mutex_ protects the command and connect result queues, which are
+   * the only state shared between the I/O thread and other threads.
+   */
+  std::mutex command_mutex_;
+  std::vector<Command> commands_;
+  std::vector<ConnectResult> connect_results_;
+
+  /**
+   * connect_mutex_ protects the queue of connections waiting to be handed to a
+   * connect worker thread.
+   */
+  std::mutex connect_mutex_;
+  std::condition_variable connect_cv_;
+  std::deque<Connection*> connect_queue_;
+  bool workers_running_ = false;
+  int num_connect_threads_;
+  std::vector<std::thread> connect_threads_;
+
+  // The following members are only accessed by the I/O thread.
+  std::unordered_map<ConnectionId, std::unique_ptr<Connection>> connections_;
+  std::set<std::pair<Clock::time_point, ConnectionId>> timers_;
+
+  // Runs until running_ is cleared by Stop(). The caller must set running_.
+  void RunLoop();
+  void PushCommand(Command&& command);
+  void Wake();
+
+  void ProcessCommands();
+  void ProcessConnectResults();
+  void ProcessTimers(Clock::time_point now);
+  int GetPollTimeoutMS(Clock::time_point now) const;
+
+  void HandleSocketEvent(Connection* connection);
+  void StartConnect(Connection* connection);
+  void FinishConnect(Connection* connection, int auth_ret, int connect_ret);
+  void CloseConnection(Connection* connection, int error);
+  void ScheduleReconnect(Connection* connection, int error);
+  void IncrementRetryCount(Connection* connection);
+  int SendRequest(Connection* connection);
+
+  void SetTimer(Connection* connection, Clock::time_point deadline);
+  void UpdatePollEvents(Connection* connection);
+  void RemoveFromPoll(Connection* connection);
+  void SetState(Connection* connection, ConnectionState state, int error);
+
+  void ConnectWorker();
+  static void Connect(Connection* connection, ConnectResult* result);
+};
+
+} // namespace polaris
+} // namespace point_one
@@ -9,9 +9,25 @@
 using namespace point_one::polaris;
 
 /******************************************************************************/
-PolarisInterface::PolarisInterface() {
-  Polaris_Init(&context_);
+PolarisInterface::PolarisInterface() : PolarisInterface(0) {}
+
+/******************************************************************************/
+PolarisInterface::PolarisInterface(size_t recv_buffer_size) {
+  if (recv_buffer_size > 0) {
+    recv_buffer_.reset(new uint8_t[recv_buffer_size]);
+    if (Polaris_InitWithRecvBuffer(&context_, recv_buffer_.get(),
+                                   recv_buffer_size) != POLARIS_SUCCESS) {
+      // Polaris_InitWithRecvBuffer() will print an error.
+      recv_buffer_.reset();
+      Polaris_Init(&context_);
+    }
+  } else {
+    Polaris_Init(&context_);
+  }
+
   Polaris_SetRTCMCallback(&context_, &PolarisInterface::HandleRTCMData, this);
+  Polaris_SetAuthStatusCallback(&context_, &PolarisInterface::HandleAuthStatus,
+                                this);
 }
 
 /******************************************************************************/
@@ -39,6 +55,16 @@ int PolarisInterface::SetAuthToken(const std::string& auth_token) {
   return Polaris_SetAuthToken(&context_, auth_token.c_str());
 }
 
+/******************************************************************************/
+std::string PolarisInterface::GetAuthToken() const {
+  return context_.auth_token;
+}
+
+/******************************************************************************/
+int PolarisInterface::GetAuthTokenLifetime() const {
+  return context_.auth_token_lifetime_sec;
+}
+
 /******************************************************************************/
 int PolarisInterface::Connect() {
   return Polaris_Connect(&context_);
@@ -50,6 +76,17 @@ int PolarisInterface::ConnectTo(const std::string& endpoint_url,
   return Polaris_ConnectTo(&context_, endpoint_url.c_str(), endpoint_port);
 }
 
+/******************************************************************************/
+int PolarisInterface::OpenStream(const std::string& endpoint_url,
+                                 int endpoint_port) {
+  return Polaris_OpenStream(&context_, endpoint_url.c_str(), endpoint_port);
+}
+
+/******************************************************************************/
+int PolarisInterface::SendAuthToken() {
+  return Polaris_SendAuthToken(&context_);
+}
+
 /******************************************************************************/
 int PolarisInterface::ConnectWithoutAuth(
     const std::string& endpoint_url, int endpoint_port,
@@ -63,12 +100,53 @@ void PolarisInterface::Disconnect() {
   Polaris_Disconnect(&context_);
 }
 
+/******************************************************************************/
+void PolarisInterface::Interrupt() { Polaris_Interrupt(&context_); }
+
+/******************************************************************************/
+int PolarisInterface::TakeConnection(PolarisInterface& source) {
+  return Polaris_TakeConnection(&context_, &source.context_);
+}
+
 /******************************************************************************/
 void PolarisInterface::SetRTCMCallback(
     std::function<void(const uint8_t* buffer, size_t size_bytes)> callback) {
   callback_ = callback;
 }
 
+/******************************************************************************/
+void PolarisInterface::SetRTCMFrameCallback(
+    std::function<void(const uint8_t* buffer, size_t size_bytes)> callback) {
+  frame_callback_ = callback;
+  // Only enable the framer if someone is listening for frames.
+  if (frame_callback_) {
+    Polaris_SetRTCMFrameCallback(&context_, &PolarisInterface::HandleRTCMFrame,
+                                 this);
+  } else {
+    Polaris_SetRTCMFrameCallback(&context_, nullptr, nullptr);
+  }
+}
+
+/******************************************************************************/
+void PolarisInterface::SetRTCMTimestampedCallback(
+    std::function<void(const uint8_t* buffer, size_t size_bytes,
+                       const PolarisReceiveTime_t& receive_time)>
+        callback) {
+  timestamped_callback_ = callback;
+  if (timestamped_callback_) {
+    Polaris_SetRTCMTimestampedCallback(
+        &context_, &PolarisInterface::HandleTimestampedRTCMData, this);
+  } else {
+    Polaris_SetRTCMTimestampedCallback(&context_, nullptr, nullptr);
+  }
+}
+
+/******************************************************************************/
+void PolarisInterface::SetAuthStatusCallback(
+    std::function<void(int status, const std::string& message)> callback) {
+  auth_status_callback_ = callback;
+}
+
 /******************************************************************************/
 int PolarisInterface::SendECEFPosition(double x_m, double y_m, double z_m) {
   return Polaris_SendECEFPosition(&context_, x_m, y_m, z_m);
@@ -86,6 +164,29 @@ int PolarisInterface::RequestBeacon(const std::string& beacon_id) {
   return Polaris_RequestBeacon(&context_, beacon_id.c_str());
 }
 
+/******************************************************************************/
+int PolarisInterface::QueueECEFPosition(double x_m, double y_m, double z_m) {
+  return Polaris_QueueECEFPosition(&context_, x_m, y_m, z_m);
+}
+
+/******************************************************************************/
+int PolarisInterface::QueueLLAPosition(double latitude_deg,
+                                       double longitude_deg,
+                                       double altitude_m) {
+  return Polaris_QueueLLAPosition(&context_, latitude_deg, longitude_deg,
+                                  altitude_m);
+}
+
+/******************************************************************************/
+int PolarisInterface::QueueBeaconRequest(const std::string& beacon_id) {
+  return Polaris_QueueBeaconRequest(&context_, beacon_id.c_str());
+}
+
+/******************************************************************************/
+void PolarisInterface::ClearQueuedRequest() {
+  Polaris_ClearQueuedRequest(&context_);
+}
+
 /******************************************************************************/
 int PolarisInterface::Work() {
   return Polaris_Work(&context_);
@@ -96,11 +197,118 @@ int PolarisInterface::Run(int connection_timeout_ms) {
   return Polaris_Run(&context_, connection_timeout_ms);
 }
 
+/******************************************************************************/
+void PolarisInterface::SetNonBlocking(bool enabled) {
+  Polaris_SetNonBlocking(&context_, enabled ? 1 : 0);
+}
+
+/******************************************************************************/
+P1_Socket_t PolarisInterface::GetFileDescriptor() const {
+  return Polaris_GetFileDescriptor(&context_);
+}
+
+/******************************************************************************/
+int PolarisInterface::GetPollEvents() const {
+  return Polaris_GetPollEvents(&context_);
+}
+
+/******************************************************************************/
+int PolarisInterface::PollOnce() {
+  return Polaris_PollOnce(&context_);
+}
+
+/******************************************************************************/
+void PolarisInterface::SetBatchedReads(bool enabled) {
+  Polaris_SetBatchedReads(&context_, enabled ? 1 : 0);
+}
+
+/******************************************************************************/
+int PolarisInterface::SetKernelTimestamps(bool enabled) {
+  return Polaris_SetKernelTimestamps(&context_, enabled ? 1 : 0);
+}
+
+/******************************************************************************/
+void PolarisInterface::SetConnectTimeout(int timeout_ms) {
+  Polaris_SetConnectTimeout(&context_, timeout_ms);
+}
+
+/******************************************************************************/
+void PolarisInterface::SetSocketOptions(const PolarisSocketOptions_t& options) {
+  Polaris_SetSocketOptions(&context_, &options);
+}
+
+/******************************************************************************/
+void PolarisInterface::SetHTTPKeepAlive(bool enabled) {
+  Polaris_SetHTTPKeepAlive(&context_, enabled ? 1 : 0);
+}
+
+/******************************************************************************/
+bool PolarisInterface::IsTLSSessionResumed() const {
+  return Polaris_IsTLSSessionResumed(&context_) != 0;
+}
+
+/******************************************************************************/
+PolarisStats_t PolarisInterface::GetStats() const {
+  PolarisStats_t stats;
+  Polaris_GetStats(&context_, &stats);
+  return stats;
+}
+
+/******************************************************************************/
+PolarisHistogram_t PolarisInterface::GetReadIntervalHistogram() const {
+  PolarisHistogram_t histogram;
+  Polaris_GetReadIntervalHistogram(&context_, &histogram);
+  return histogram;
+}
+
+/******************************************************************************/
+PolarisHistogram_t PolarisInterface::GetCallbackDurationHistogram() const {
+  PolarisHistogram_t histogram;
+  Polaris_GetCallbackDurationHistogram(&context_, &histogram);
+  return histogram;
+}
+
+/******************************************************************************/
+void PolarisInterface::ResetHistograms() { Polaris_ResetHistograms(&context_); }
+
+/******************************************************************************/
+int PolarisInterface::SetCorrectionAgeMonitor(bool enabled) {
+  return Polaris_SetCorrectionAgeMonitor(&context_, enabled ? 1 : 0);
+}
+
+/******************************************************************************/
+void PolarisInterface::SetLeapSeconds(int leap_seconds) {
+  Polaris_SetLeapSeconds(&context_, leap_seconds);
+}
+
+/******************************************************************************/
+PolarisCorrectionAge_t PolarisInterface::GetCorrectionAge() const {
+  PolarisCorrectionAge_t age;
+  Polaris_GetCorrectionAge(&context_, &age);
+  return age;
+}
+
+/******************************************************************************/
+void PolarisInterface::SetStallDetection(double multiplier,
+                                         int min_timeout_ms) {
+  Polaris_SetStallDetection(&context_, multiplier, min_timeout_ms);
+}
+
+/******************************************************************************/
+int PolarisInterface::GetStallTimeout() const {
+  return Polaris_GetStallTimeout(&context_);
+}
+
 /******************************************************************************/
 const uint8_t* PolarisInterface::GetRecvBuffer() const {
   return context_.recv_buffer;
 }
 
+/******************************************************************************/
+size_t PolarisInterface::GetRecvBufferSize() const {
+  return context_.recv_buffer_size;
+}
+
 /******************************************************************************/
 void PolarisInterface::HandleRTCMData(void* ptr, PolarisContext_t* context,
                                       const uint8_t* buffer,
@@ -110,3 +318,35 @@ void PolarisInterface::HandleRTCMData(void* ptr, PolarisContext_t* context,
     interface->callback_(buffer, size_bytes);
   }
 }
+
+/******************************************************************************/
+void PolarisInterface::HandleRTCMFrame(void* ptr, PolarisContext_t* context,
+                                       const uint8_t* buffer,
+                                       size_t size_bytes) {
+  auto interface = static_cast<PolarisInterface*>(ptr);
+  if (interface->frame_callback_) {
+    interface->frame_callback_(buffer, size_bytes);
+  }
+}
+
+/******************************************************************************/
+void PolarisInterface::HandleTimestampedRTCMData(
+    void* ptr, PolarisContext_t* context, const uint8_t* buffer,
+    size_t size_bytes, const PolarisReceiveTime_t* receive_time) {
+  auto interface = static_cast<PolarisInterface*>(ptr);
+  if (interface->timestamped_callback_) {
+    interface->timestamped_callback_(buffer, size_bytes, *receive_time);
+  }
+}
+
+/******************************************************************************/
+void PolarisInterface::HandleAuthStatus(void* ptr, PolarisContext_t* context,
+                                        int status, const char* message,
+                                        size_t message_length) {
+  auto interface = static_cast<PolarisInterface*>(ptr);
+  if (interface->auth_status_callback_) {
+    interface->auth_status_callback_(
+        status, message == nullptr ? std::string()
+                                   : std::string(message, message_length));
+  }
+}
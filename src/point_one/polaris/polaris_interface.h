@@ -7,6 +7,7 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <string>
 
 #include <point_one/polaris/polaris.h>
@@ -43,6 +44,19 @@ class PolarisInterface {
    */
   PolarisInterface();
 
+  /**
+   * @brief Construct a new client instance with a receive buffer of the
+   *        specified size.
+   *
+   * See also @ref Polaris_InitWithRecvBuffer().
+   *
+   * @param recv_buffer_size The desired receive buffer size (in bytes), or 0 to
+   *        use the default size (@ref POLARIS_RECV_BUFFER_SIZE). If the
+   *        requested size is too small to store an HTTP authentication
+   *        response, the default size will be used.
+   */
+  explicit PolarisInterface(size_t recv_buffer_size);
+
   /**
    * @brief Disconnect and destroy this instance.
    */
@@ -99,6 +113,22 @@ class PolarisInterface {
    */
   int SetAuthToken(const std::string& auth_token);
 
+  /**
+   * @brief Get the current authentication token.
+   *
+   * @return The token generated by @ref Authenticate() or provided to @ref
+   *         SetAuthToken(), or an empty string if not set.
+   */
+  std::string GetAuthToken() const;
+
+  /**
+   * @brief Get the lifetime of the current authentication token reported by
+   *        the authentication server.
+   *
+   * @return The token lifetime (in seconds), or 0 if unknown.
+   */
+  int GetAuthTokenLifetime() const;
+
   /**
    * @brief Connect to the corrections service using the stored authentication
    *        token.
@@ -132,6 +162,36 @@ class PolarisInterface {
    */
   int ConnectTo(const std::string& endpoint_url, int endpoint_port);
 
+  /**
+   * @brief Open a connection to the specified corrections service URL without
+   *        sending an authentication token.
+   *
+   * See @ref Polaris_OpenStream().
+   *
+   * @param endpoint_url The desired endpoint URL.
+   * @param endpoint_port The desired endpoint port.
+   *
+   * @return @ref POLARIS_SUCCESS on success.
+   * @return @ref POLARIS_SOCKET_ERROR if a connection could not be established
+   *         with the Polaris corrections server.
+   */
+  int OpenStream(const std::string& endpoint_url, int endpoint_port);
+
+  /**
+   * @brief Send the stored authentication token on a connection opened with
+   *        @ref OpenStream().
+   *
+   * See @ref Polaris_SendAuthToken().
+   *
+   * @return @ref POLARIS_SUCCESS on success.
+   * @return @ref POLARIS_SOCKET_ERROR if the connection is not open.
+   * @return @ref POLARIS_AUTH_ERROR if an authentication token was not
+   *         provided.
+   * @return @ref POLARIS_SEND_ERROR if an error occurred while sending the
+   *         authentication token.
+   */
+  int SendAuthToken();
+
   /**
    * @brief Connect to the corrections service without providing an
    *        authentication token.
@@ -162,6 +222,31 @@ class PolarisInterface {
    */
   void Disconnect();
 
+  /**
+   * @brief Interrupt a call to @ref Run() or @ref Work() in progress on another
+   *        thread, closing the corrections stream.
+   *
+   * An HTTP request in progress (e.g., @ref AuthenticateTo()) is interrupted in
+   * the same way. An idle HTTP keep-alive connection is not affected.
+   *
+   * See also @ref Polaris_Interrupt().
+   */
+  void Interrupt();
+
+  /**
+   * @brief Take over an open corrections stream from another instance.
+   *
+   * See @ref Polaris_TakeConnection().
+   *
+   * @param source The instance with an open corrections stream. On return,
+   *        `source` is disconnected.
+   *
+   * @return @ref POLARIS_SUCCESS on success.
+   * @return @ref POLARIS_SOCKET_ERROR if `source` does not have an open
+   *         corrections stream.
+   */
+  int TakeConnection(PolarisInterface& source);
+
   /**
    * @brief Specify a function to be called when RTCM corrections data is
    *        received.
@@ -173,6 +258,43 @@ class PolarisInterface {
   void SetRTCMCallback(
       std::function<void(const uint8_t* buffer, size_t size_bytes)> callback);
 
+  /**
+   * @brief Specify a function to be called for each complete, valid RTCM 3
+   *        message received.
+   *
+   * See also @ref Polaris_SetRTCMFrameCallback().
+   *
+   * @param callback The function to be called, or `nullptr` to disable
+   *        framing.
+   */
+  void SetRTCMFrameCallback(
+      std::function<void(const uint8_t* buffer, size_t size_bytes)> callback);
+
+  /**
+   * @brief Specify a function to be called with each block of incoming data and
+   *        the time it was received.
+   *
+   * See also @ref Polaris_SetRTCMTimestampedCallback().
+   *
+   * @param callback The function to be called, or `nullptr` to disable.
+   */
+  void SetRTCMTimestampedCallback(
+      std::function<void(const uint8_t* buffer, size_t size_bytes,
+                         const PolarisReceiveTime_t& receive_time)>
+          callback);
+
+  /**
+   * @brief Specify a function to be called when the corrections service
+   *        accepts or rejects the authentication token.
+   *
+   * See also @ref Polaris_SetAuthStatusCallback().
+   *
+   * @param callback The function to be called with @ref POLARIS_SUCCESS or
+   *        @ref POLARIS_AUTH_REJECTED, and the rejection reason if available.
+   */
+  void SetAuthStatusCallback(
+      std::function<void(int status, const std::string& message)> callback);
+
   /**
    * @brief Send a position update to the corrections service.
    *
@@ -187,6 +309,9 @@ class PolarisInterface {
    * @param z_m The receiver ECEF Z position (in meters).
    *
    * @return @ref POLARIS_SUCCESS on success.
+   * @return @ref POLARIS_WOULD_BLOCK if the request will be sent once the
+   *         socket is ready (non-blocking mode). See @ref
+   *         Polaris_SendECEFPosition().
    * @return @ref POLARIS_SEND_ERROR if the request could not be sent.
    * @return @ref POLARIS_SOCKET_ERROR if socket is not currently open.
    */
@@ -206,6 +331,9 @@ class PolarisInterface {
    * @param altitude_m The receiver WGS-84 altitude (in meters).
    *
    * @return @ref POLARIS_SUCCESS on success.
+   * @return @ref POLARIS_WOULD_BLOCK if the request will be sent once the
+   *         socket is ready (non-blocking mode). See @ref
+   *         Polaris_SendECEFPosition().
    * @return @ref POLARIS_SEND_ERROR if the request could not be sent.
    * @return @ref POLARIS_SOCKET_ERROR if socket is not currently open.
    */
@@ -223,11 +351,68 @@ class PolarisInterface {
    * @param beacon_id The desired beacon ID.
    *
    * @return @ref POLARIS_SUCCESS on success.
+   * @return @ref POLARIS_WOULD_BLOCK if the request will be sent once the
+   *         socket is ready (non-blocking mode). See @ref
+   *         Polaris_SendECEFPosition().
    * @return @ref POLARIS_SEND_ERROR if the request could not be sent.
    * @return @ref POLARIS_SOCKET_ERROR if socket is not currently open.
    */
   int RequestBeacon(const std::string& beacon_id);
 
+  /**
+   * @brief Queue a position update to be sent by the thread calling @ref Work()
+   *        or @ref PollOnce().
+   *
+   * This function is safe to call from any thread, and never blocks. Only the
+   * most recent request is kept, and it is resent automatically each time the
+   * connection is reestablished.
+   *
+   * See also @ref Polaris_QueueECEFPosition().
+   *
+   * @param x_m The receiver ECEF X position (in meters).
+   * @param y_m The receiver ECEF Y position (in meters).
+   * @param z_m The receiver ECEF Z position (in meters).
+   *
+   * @return @ref POLARIS_SUCCESS on success.
+   */
+  int QueueECEFPosition(double x_m, double y_m, double z_m);
+
+  /**
+   * @brief Queue a position update to be sent by the thread calling @ref Work()
+   *        or @ref PollOnce().
+   *
+   * @copydetails QueueECEFPosition()
+   *
+   * See also @ref Polaris_QueueLLAPosition().
+   *
+   * @param latitude_deg The receiver WGS-84 latitude (in degrees).
+   * @param longitude_deg The receiver WGS-84 longitude (in degrees).
+   * @param altitude_m The receiver WGS-84 altitude (in meters).
+   *
+   * @return @ref POLARIS_SUCCESS on success.
+   */
+  int QueueLLAPosition(double latitude_deg, double longitude_deg,
+                       double altitude_m);
+
+  /**
+   * @brief Queue a request for corrections from a specific base station.
+   *
+   * See also @ref Polaris_QueueBeaconRequest().
+   *
+   * @param beacon_id The desired beacon ID.
+   *
+   * @return @ref POLARIS_SUCCESS on success.
+   * @return @ref POLARIS_NOT_ENOUGH_SPACE if the beacon ID is too long.
+   */
+  int QueueBeaconRequest(const std::string& beacon_id);
+
+  /**
+   * @brief Discard the queued position or beacon request, if any.
+   *
+   * See also @ref Polaris_ClearQueuedRequest().
+   */
+  void ClearQueuedRequest();
+
   /**
    * @brief Receive and dispatch the next block of incoming data.
    *
@@ -264,6 +449,8 @@ class PolarisInterface {
    * @return @ref POLARIS_CONNECTION_CLOSED if the connection was closed
    *         remotely or by calling @ref Disconnect().
    * @return @ref POLARIS_TIMED_OUT if the socket receive timeout elapsed.
+   * @return @ref POLARIS_AUTH_REJECTED if the corrections service rejected the
+   *         authentication token.
    * @return @ref POLARIS_FORBIDDEN if the connection is closed before any data
    *         is received, indicating an authentication failure (invalid or
    *         expired access token).
@@ -299,12 +486,205 @@ class PolarisInterface {
    *         remotely.
    * @return @ref POLARIS_TIMED_OUT if no data was received for the specified
    *         timeout.
+   * @return @ref POLARIS_AUTH_REJECTED if the corrections service rejected the
+   *         authentication token.
    * @return @ref POLARIS_AUTH_ERROR if the connection is closed before any data
    *         is received, indicating an authentication failure.
    * @return @ref POLARIS_SOCKET_ERROR if the socket is not currently open.
    */
   int Run(int connection_timeout_ms);
 
+  /**
+   * @brief Enable or disable non-blocking mode.
+   *
+   * See also @ref Polaris_SetNonBlocking().
+   *
+   * @param enabled If `true`, enable non-blocking mode.
+   */
+  void SetNonBlocking(bool enabled);
+
+  /**
+   * @brief Get the socket used for the corrections stream.
+   *
+   * See also @ref Polaris_GetFileDescriptor().
+   *
+   * @return The socket, or @ref P1_INVALID_SOCKET if not connected.
+   */
+  P1_Socket_t GetFileDescriptor() const;
+
+  /**
+   * @brief Get the socket events to wait for before calling @ref PollOnce().
+   *
+   * See also @ref Polaris_GetPollEvents().
+   *
+   * @return A bitmask of @ref POLARIS_WANT_READ and @ref POLARIS_WANT_WRITE,
+   *         or 0 if not connected.
+   */
+  int GetPollEvents() const;
+
+  /**
+   * @brief Receive and dispatch all currently available data without blocking.
+   *
+   * See also @ref Polaris_PollOnce().
+   *
+   * @return The number of received bytes, or 0 if no data was available.
+   * @return <0 if the connection was closed or an error occurred. See @ref
+   *         Polaris_PollOnce() for details.
+   */
+  int PollOnce();
+
+  /**
+   * @brief Enable or disable batched reads.
+   *
+   * See also @ref Polaris_SetBatchedReads().
+   *
+   * @param enabled If `true`, drain all available data before calling the data
+   *        callback.
+   */
+  void SetBatchedReads(bool enabled);
+
+  /**
+   * @brief Enable or disable kernel receive timestamps.
+   *
+   * See also @ref Polaris_SetKernelTimestamps().
+   *
+   * @param enabled If `true`, report the time data arrived in the kernel to the
+   *        @ref SetRTCMTimestampedCallback() callback.
+   *
+   * @return @ref POLARIS_SUCCESS on success, or @ref POLARIS_ERROR if not
+   *         supported on this platform.
+   */
+  int SetKernelTimestamps(bool enabled);
+
+  /**
+   * @brief Set the maximum amount of time to wait for a TCP connection to be
+   *        established.
+   *
+   * See also @ref Polaris_SetConnectTimeout().
+   *
+   * @param timeout_ms The connection timeout (in ms), or <= 0 to use the
+   *        default value.
+   */
+  void SetConnectTimeout(int timeout_ms);
+
+  /**
+   * @brief Set the TCP socket options used for new connections.
+   *
+   * See also @ref Polaris_SetSocketOptions(), @ref
+   * Polaris_GetDefaultSocketOptions(), and @ref
+   * Polaris_GetLowLatencySocketOptions().
+   *
+   * @param options The options to be used.
+   */
+  void SetSocketOptions(const PolarisSocketOptions_t& options);
+
+  /**
+   * @brief Enable or disable reuse of the connection to the authentication
+   *        server between successive calls to @ref Authenticate().
+   *
+   * See @ref Polaris_SetHTTPKeepAlive().
+   *
+   * @param enabled If `true`, enable HTTP keep-alive.
+   */
+  void SetHTTPKeepAlive(bool enabled);
+
+  /**
+   * @brief Check if the most recent connection resumed a previous TLS session.
+   *
+   * See also @ref Polaris_IsTLSSessionResumed().
+   *
+   * @return `true` if the session was resumed.
+   */
+  bool IsTLSSessionResumed() const;
+
+  /**
+   * @brief Get connection statistics.
+   *
+   * See also @ref Polaris_GetStats().
+   *
+   * @return The current statistics.
+   */
+  PolarisStats_t GetStats() const;
+
+  /**
+   * @brief Get a histogram of the time between successful reads (in
+   *        microseconds).
+   *
+   * See also @ref Polaris_GetReadIntervalHistogram().
+   *
+   * @return A copy of the current histogram.
+   */
+  PolarisHistogram_t GetReadIntervalHistogram() const;
+
+  /**
+   * @brief Get a histogram of the time spent in the @ref SetRTCMCallback()
+   *        callback (in microseconds).
+   *
+   * See also @ref Polaris_GetCallbackDurationHistogram().
+   *
+   * @return A copy of the current histogram.
+   */
+  PolarisHistogram_t GetCallbackDurationHistogram() const;
+
+  /**
+   * @brief Clear the read interval and callback duration histograms.
+   *
+   * See also @ref Polaris_ResetHistograms().
+   */
+  void ResetHistograms();
+
+  /**
+   * @brief Enable or disable correction age monitoring.
+   *
+   * See also @ref Polaris_SetCorrectionAgeMonitor().
+   *
+   * @param enabled If `true`, measure the age of incoming MSM messages.
+   *
+   * @return @ref POLARIS_SUCCESS on success, or @ref POLARIS_ERROR if not
+   *         supported on this platform.
+   */
+  int SetCorrectionAgeMonitor(bool enabled);
+
+  /**
+   * @brief Set the GPS-UTC offset used to compute correction age.
+   *
+   * See also @ref Polaris_SetLeapSeconds().
+   *
+   * @param leap_seconds The number of leap seconds between GPS time and UTC.
+   */
+  void SetLeapSeconds(int leap_seconds);
+
+  /**
+   * @brief Get the age of the most recent corrections data.
+   *
+   * See also @ref Polaris_GetCorrectionAge().
+   *
+   * @return The current correction age statistics.
+   */
+  PolarisCorrectionAge_t GetCorrectionAge() const;
+
+  /**
+   * @brief Enable or disable adaptive stall detection in @ref Run().
+   *
+   * See also @ref Polaris_SetStallDetection().
+   *
+   * @param multiplier The multiple of the learned data period after which the
+   *        stream is considered stalled, or <= 0 to disable.
+   * @param min_timeout_ms The minimum stall timeout (in ms), or <= 0 to use the
+   *        default value.
+   */
+  void SetStallDetection(double multiplier, int min_timeout_ms = 0);
+
+  /**
+   * @brief Get the current adaptive stall timeout.
+   *
+   * See also @ref Polaris_GetStallTimeout().
+   *
+   * @return The stall timeout (in ms), or -1 if stall detection is disabled or
+   *         not enough data has been received yet.
+   */
+  int GetStallTimeout() const;
+
   /**
    * @brief Get a reference to the buffer where incoming data is stored when
    *        @ref Work() is called.
@@ -313,13 +693,39 @@ class PolarisInterface {
    */
   const uint8_t* GetRecvBuffer() const;
 
+  /**
+   * @brief Get the size of the receive buffer (in bytes).
+   *
+   * @return The buffer size.
+   */
+  size_t GetRecvBufferSize() const;
+
  protected:
   PolarisContext_t context_;
+  std::unique_ptr<uint8_t[]> recv_buffer_;
 
   std::function<void(const uint8_t* buffer, size_t size_bytes)> callback_;
+  std::function<void(const uint8_t* buffer, size_t size_bytes)>
+      frame_callback_;
+  std::function<void(const uint8_t* buffer, size_t size_bytes,
+                     const PolarisReceiveTime_t& receive_time)>
+      timestamped_callback_;
+  std::function<void(int status, const std::string& message)>
+      auth_status_callback_;
 
   static void HandleRTCMData(void* ptr, PolarisContext_t* context,
                              const uint8_t* buffer, size_t size_bytes);
+
+  static void HandleRTCMFrame(void* ptr, PolarisContext_t* context,
+                              const uint8_t* buffer, size_t size_bytes);
+
+  static void HandleTimestampedRTCMData(
+      void* ptr, PolarisContext_t* context, const uint8_t* buffer,
+      size_t size_bytes, const PolarisReceiveTime_t* receive_time);
+
+  static void HandleAuthStatus(void* ptr, PolarisContext_t* context,
+                               int status, const char* message,
+                               size_t message_length);
 };
 
 } // namespace polaris
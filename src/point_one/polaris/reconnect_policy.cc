@@ -0,0 +1,27 @@
+/**************************************************************************/ /**
+ * @brief Polaris reconnect delay policies.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/reconnect_policy.h"
+
+using namespace point_one::polaris;
+
+/******************************************************************************/
+BackoffReconnectPolicy::BackoffReconnectPolicy(
+    std::chrono::milliseconds base_delay, std::chrono::milliseconds max_delay,
+    uint32_t seed) {
+  Polaris_BackoffInit(&backoff_, (uint32_t)base_delay.count(),
+                      (uint32_t)max_delay.count(), seed);
+}
+
+/******************************************************************************/
+std::chrono::milliseconds BackoffReconnectPolicy::GetDelay(
+    const ReconnectAttempt& attempt) {
+  (void)attempt;
+  return std::chrono::milliseconds(Polaris_BackoffNext(&backoff_));
+}
+
+/******************************************************************************/
+void BackoffReconnectPolicy::Reset() { Polaris_BackoffReset(&backoff_); }
@@ -0,0 +1,107 @@
+/**************************************************************************/ /**
+ * @brief Polaris reconnect delay policies.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <point_one/polaris/backoff.h>
+
+namespace point_one {
+namespace polaris {
+
+/**
+ * @brief The outcome of a single attempt to connect to Polaris and receive
+ *        data.
+ */
+struct ReconnectAttempt {
+  /** The time the attempt ended. */
+  std::chrono::system_clock::time_point time;
+  /**
+   * The number of consecutive attempts that did not receive any data, including
+   * this one.
+   */
+  int attempt = 0;
+  /**
+   * The result of the attempt: the return code from authenticating, connecting,
+   * or @ref PolarisInterface::Run().
+   */
+  int result = 0;
+  /** The corrections endpoint URL used for the attempt. */
+  std::string endpoint_url;
+  /** The corrections endpoint port used for the attempt. */
+  int endpoint_port = 0;
+  /** `true` if the connection to the corrections stream was established. */
+  bool connected = false;
+  /** `true` if any data was received before the connection closed. */
+  bool received_data = false;
+  /** The delay (in ms) before the next attempt. */
+  int delay_ms = 0;
+};
+
+/**
+ * @brief Interface for deciding how long @ref PolarisClient::Run() waits before
+ *        reconnecting.
+ *
+ * Implementations are called by the thread calling @ref PolarisClient::Run(),
+ * and need not be thread-safe unless shared between clients.
+ */
+class ReconnectPolicy {
+ public:
+  virtual ~ReconnectPolicy() = default;
+
+  /**
+   * @brief Get the delay before the next connection attempt.
+   *
+   * @param attempt The outcome of the attempt that just finished. The
+   *        `delay_ms` field is not set.
+   *
+   * @return The delay.
+   */
+  virtual std::chrono::milliseconds GetDelay(
+      const ReconnectAttempt& attempt) = 0;
+
+  /**
+   * @brief Reset the delay after a connection successfully receives data.
+   */
+  virtual void Reset() = 0;
+};
+
+/**
+ * @brief Exponential backoff with decorrelated jitter.
+ *
+ * The default policy used by @ref PolarisClient. See @ref PolarisBackoff_t.
+ */
+class BackoffReconnectPolicy : public ReconnectPolicy {
+ public:
+  /**
+   * @brief Create a new policy.
+   *
+   * @param base_delay The base delay. The first delay after a reset is at most
+   *        this value, and later delays are at least this value.
+   * @param max_delay The maximum delay.
+   * @param seed The random seed, or 0 to choose one automatically. See @ref
+   *        Polaris_BackoffInit().
+   */
+  explicit BackoffReconnectPolicy(
+      std::chrono::milliseconds base_delay =
+          std::chrono::milliseconds(POLARIS_BACKOFF_BASE_DELAY_MS),
+      std::chrono::milliseconds max_delay =
+          std::chrono::milliseconds(POLARIS_BACKOFF_MAX_DELAY_MS),
+      uint32_t seed = 0);
+
+  std::chrono::milliseconds GetDelay(const ReconnectAttempt& attempt) override;
+
+  void Reset() override;
+
+ private:
+  PolarisBackoff_t backoff_;
+};
+
+} // namespace polaris
+} // namespace point_one
@@ -0,0 +1,184 @@
+/**************************************************************************/ /**
+ * @brief Persistent storage for Polaris authentication tokens.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/token_cache.h"
+
+#include <fcntl.h> // For open()
+#include <unistd.h> // For fsync() and unlink()
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio> // For std::rename()
+#include <cstdlib> // For mkstemp() and std::strtoll()
+#include <cstring> // For std::strerror()
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "point_one/polaris/logging.h"
+
+using namespace point_one::polaris;
+
+namespace {
+/******************************************************************************/
+int64_t GetUnixTimeSec() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+/******************************************************************************/
+void HashString(uint64_t* hash, const std::string& value) {
+  // 64-bit FNV-1a. The trailing null character separates consecutive values,
+  // so ("ab", "c") and ("a", "bc") produce different hashes.
+  for (size_t i = 0; i <= value.size(); ++i) {
+    *hash ^= (uint8_t)value.c_str()[i];
+    *hash *= 0x100000001B3ull;
+  }
+}
+
+/******************************************************************************/
+bool WriteAll(int fd, const std::string& data) {
+  size_t offset = 0;
+  while (offset < data.size()) {
+    ssize_t ret = write(fd, data.data() + offset, data.size() - offset);
+    if (ret < 0) {
+      return false;
+    }
+    offset += (size_t)ret;
+  }
+  return true;
+}
+} // namespace
+
+constexpr int64_t TokenCache::EXPIRATION_MARGIN_SEC;
+
+/******************************************************************************/
+TokenCache::TokenCache(const std::string& directory) : directory_(directory) {
+  if (directory_.empty()) {
+    directory_ = ".";
+  } else if (directory_.back() == '/') {
+    directory_.pop_back();
+  }
+}
+
+/******************************************************************************/
+bool TokenCache::Load(const std::string& api_url, const std::string& api_key,
+                      const std::string& unique_id, std::string* auth_token,
+                      int* remaining_lifetime_sec) const {
+  std::string path = GetPath(api_url, api_key, unique_id);
+  std::ifstream stream(path);
+  if (!stream) {
+    VLOG(1) << "No stored authentication token found. [path=" << path << "]";
+    return false;
+  }
+
+  // File format:
+  //   expires_at=<UNIX time (in seconds), or 0 if unknown>
+  //   token=<token>
+  std::string line;
+  int64_t expires_at_sec = -1;
+  std::string token;
+  while (std::getline(stream, line)) {
+    if (line.compare(0, 11, "expires_at=") == 0) {
+      expires_at_sec = std::strtoll(line.c_str() + 11, nullptr, 10);
+    } else if (line.compare(0, 6, "token=") == 0) {
+      token = line.substr(6);
+    }
+  }
+
+  if (expires_at_sec < 0 || token.empty()) {
+    LOG(WARNING) << "Ignoring invalid stored authentication token. [path="
+                 << path << "]";
+    return false;
+  }
+
+  int64_t now_sec = GetUnixTimeSec();
+  if (expires_at_sec > 0 && now_sec + EXPIRATION_MARGIN_SEC >= expires_at_sec) {
+    VLOG(1) << "Stored authentication token has expired. [path=" << path
+            << "]";
+    return false;
+  } else {
+    VLOG(1) << "Loaded stored authentication token. [path=" << path << "]";
+    *auth_token = token;
+    if (remaining_lifetime_sec) {
+      *remaining_lifetime_sec =
+          expires_at_sec > 0 ? (int)(expires_at_sec - now_sec) : 0;
+    }
+    return true;
+  }
+}
+
+/******************************************************************************/
+bool TokenCache::Store(const std::string& api_url, const std::string& api_key,
+                       const std::string& unique_id,
+                       const std::string& auth_token, int lifetime_sec) const {
+  std::string path = GetPath(api_url, api_key, unique_id);
+
+  std::ostringstream contents;
+  contents << "expires_at="
+           << (lifetime_sec > 0 ? GetUnixTimeSec() + lifetime_sec : 0) << "\n"
+           << "token=" << auth_token << "\n";
+
+  // Write the token to a temporary file and then rename it over the existing
+  // file. rename() is atomic, so readers (including this application after a
+  // power loss) see either the old file or the new one, never a partial write.
+  //
+  // The temporary file name is unique, so concurrent writers (e.g., a
+  // background token refresh and a hot-standby client) do not overwrite each
+  // other. mkstemp() creates the file readable only by the current user, since
+  // the token grants access to the corrections service.
+  std::string temp_path = path + ".tmpXXXXXX";
+  int fd = mkstemp(&temp_path[0]);
+  if (fd < 0) {
+    LOG(WARNING) << "Unable to store authentication token. [path=" << path
+                 << ", error=" << std::strerror(errno) << "]";
+    return false;
+  }
+
+  bool success = WriteAll(fd, contents.str()) && fsync(fd) == 0;
+  success = close(fd) == 0 && success;
+  if (!success || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Unable to store authentication token. [path=" << path
+                 << ", error=" << std::strerror(errno) << "]";
+    unlink(temp_path.c_str());
+    return false;
+  }
+
+  // Make sure the rename itself is written to disk.
+  fd = open(directory_.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+
+  VLOG(1) << "Stored authentication token. [path=" << path << "]";
+  return true;
+}
+
+/******************************************************************************/
+void TokenCache::Remove(const std::string& api_url, const std::string& api_key,
+                        const std::string& unique_id) const {
+  std::string path = GetPath(api_url, api_key, unique_id);
+  if (unlink(path.c_str()) == 0) {
+    VLOG(1) << "Removed stored authentication token. [path=" << path << "]";
+  }
+}
+
+/******************************************************************************/
+std::string TokenCache::GetPath(const std::string& api_url,
+                                const std::string& api_key,
+                                const std::string& unique_id) const {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  HashString(&hash, api_url);
+  HashString(&hash, api_key);
+  HashString(&hash, unique_id);
+
+  std::ostringstream path;
+  path << directory_ << "/polaris_token_" << std::hex << std::setw(16)
+       << std::setfill('0') << hash;
+  return path.str();
+}
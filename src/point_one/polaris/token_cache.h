@@ -0,0 +1,106 @@
+/**************************************************************************/ /**
+ * @brief Persistent storage for Polaris authentication tokens.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace point_one {
+namespace polaris {
+
+/**
+ * @brief Store authentication tokens on disk so they can be reused after an
+ *        application restarts.
+ *
+ * Authenticating requires a complete HTTP request to the Polaris authentication
+ * server before connecting to the corrections stream. By reusing a previously
+ * generated token, an application can connect to the corrections stream
+ * immediately after starting.
+ *
+ * Each token is stored in a separate file in the specified directory, named
+ * using a hash of the authentication server URL, API key, and unique ID. The
+ * API key itself is not written to disk. Files are replaced atomically, so a
+ * power loss while storing a token will never leave a partially written file.
+ *
+ * Tokens are validated lazily: a stored token is returned until its reported
+ * lifetime elapses, or until it is removed with @ref Remove() (for example,
+ * because the corrections service rejected it).
+ *
+ * @note
+ * This class performs blocking file I/O, and is intended to be used only when
+ * (re)authenticating.
+ */
+class TokenCache {
+ public:
+  /**
+   * Stored tokens are considered expired this many seconds before their
+   * reported expiration time, to avoid connecting with a token that expires
+   * shortly afterward.
+   */
+  static constexpr int64_t EXPIRATION_MARGIN_SEC = 60;
+
+  /**
+   * @brief Create a new cache.
+   *
+   * @param directory The directory in which tokens will be stored. The
+   *        directory must already exist.
+   */
+  explicit TokenCache(const std::string& directory);
+
+  /**
+   * @brief Load a stored token.
+   *
+   * @param api_url The authentication server URL.
+   * @param api_key The API key used to generate the token.
+   * @param unique_id The unique ID used to generate the token.
+   * @param[out] auth_token The stored token.
+   * @param[out] remaining_lifetime_sec If not `nullptr`, set to the remaining
+   *             lifetime of the token (in seconds), or 0 if unknown.
+   *
+   * @return `true` if a token was found and has not expired.
+   */
+  bool Load(const std::string& api_url, const std::string& api_key,
+            const std::string& unique_id, std::string* auth_token,
+            int* remaining_lifetime_sec = nullptr) const;
+
+  /**
+   * @brief Store a token, replacing any existing token for the same API key and
+   *        unique ID.
+   *
+   * @param api_url The authentication server URL.
+   * @param api_key The API key used to generate the token.
+   * @param unique_id The unique ID used to generate the token.
+   * @param auth_token The token to be stored.
+   * @param lifetime_sec The lifetime of the token (in seconds), or 0 if
+   *        unknown. Tokens with an unknown lifetime are returned by @ref Load()
+   *        until they are removed.
+   *
+   * @return `true` on success.
+   */
+  bool Store(const std::string& api_url, const std::string& api_key,
+             const std::string& unique_id, const std::string& auth_token,
+             int lifetime_sec) const;
+
+  /**
+   * @brief Remove a stored token.
+   *
+   * @param api_url The authentication server URL.
+   * @param api_key The API key used to generate the token.
+   * @param unique_id The unique ID used to generate the token.
+   */
+  void Remove(const std::string& api_url, const std::string& api_key,
+              const std::string& unique_id) const;
+
+ private:
+  std::string directory_;
+
+  std::string GetPath(const std::string& api_url, const std::string& api_key,
+                      const std::string& unique_id) const;
+};
+
+} // namespace polaris
+} // namespace point_one
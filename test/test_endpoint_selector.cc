@@ -0,0 +1,126 @@
+/**************************************************************************/ /**
+ * @brief Corrections endpoint selection unit tests.
+ *
+ * Copyright (c) Point One Navigation - All Rights Reserved
+ ******************************************************************************/
+
+#include "point_one/polaris/endpoint_selector.h"
+#include "unit_test.h"
+
+using namespace point_one::polaris;
+
+/******************************************************************************/
+static EndpointSelector MakeSelector(size_t count) {
+  std::vector<PolarisEndpoint> endpoints;
+  for (size_t i = 0; i < count; ++i) {
+    PolarisEndpoint endpoint;
+    endpoint.url = "endpoint" + std::to_string(i) + ".example.com";
+    endpoints.push_back(endpoint);
+  }
+
+  EndpointSelector selector;
+  selector.SetEndpoints(endpoints);
+  return selector;
+}
+
+/******************************************************************************/
+static void TestPreferenceOrder(void) {
+  // With no history, the endpoints are used in the order they were specified.
+  EndpointSelector selector = MakeSelector(3);
+  CHECK_EQ(selector.GetNumEndpoints(), 3);
+  CHECK_EQ(selector.Select(), 0);
+  CHECK(selector.GetEndpoint(2).url == "endpoint2.example.com");
+
+  // Ties between measured endpoints are broken the same way.
+  selector.RecordConnectTime(0, 100);
+  selector.RecordConnectTime(1, 100);
+  selector.RecordConnectTime(2, 100);
+  CHECK_EQ(selector.Select(), 0);
+}
+
+/******************************************************************************/
+static void TestConnectTime(void) {
+  EndpointSelector selector = MakeSelector(3);
+  selector.RecordConnectTime(0, 200);
+  selector.RecordConnectTime(1, 50);
+  selector.RecordConnectTime(2, 120);
+  CHECK_EQ(selector.Select(), 1);
+
+  // A single slow connection does not outweigh the smoothed history.
+  selector.RecordConnectTime(1, 150);
+  CHECK_EQ(selector.GetStatus()[1].last_rtt_ms, 150);
+  CHECK_EQ(selector.GetStatus()[1].rtt_ms, 75);
+  CHECK_EQ(selector.Select(), 1);
+
+  // Consistently slow connections do.
+  for (int i = 0; i < 10; ++i) {
+    selector.RecordConnectTime(1, 300);
+  }
+  CHECK_EQ(selector.Select(), 2);
+
+  // Setting the endpoints clears their history.
+  selector.SetEndpoints({selector.GetEndpoint(0), selector.GetEndpoint(1)});
+  CHECK_EQ(selector.GetNumEndpoints(), 2);
+  CHECK_EQ(selector.GetStatus()[1].rtt_ms, -1);
+  CHECK_EQ(selector.Select(), 0);
+}
+
+/******************************************************************************/
+static void TestFailures(void) {
+  EndpointSelector selector = MakeSelector(2);
+  selector.RecordConnectTime(0, 50);
+  selector.RecordSuccess(0);
+  selector.RecordConnectTime(1, 200);
+  selector.RecordSuccess(1);
+  CHECK_EQ(selector.Select(), 0);
+  CHECK(!selector.HasRecentFailure(0));
+
+  // A recent failure outweighs a faster connection time.
+  selector.RecordFailure(0);
+  CHECK(selector.HasRecentFailure(0));
+  CHECK_EQ(selector.GetStatus()[0].failures, 1);
+  CHECK_EQ(selector.GetStatus()[0].consecutive_failures, 1);
+  CHECK_EQ(selector.Select(), 1);
+
+  // Each consecutive failure adds to the penalty, so the endpoint with the
+  // fewest recent failures is tried again first.
+  selector.RecordFailure(1);
+  selector.RecordFailure(1);
+  CHECK_EQ(selector.Select(), 0);
+
+  // Receiving data clears the penalty, but not the failure count.
+  selector.RecordSuccess(1);
+  CHECK(!selector.HasRecentFailure(1));
+  CHECK_EQ(selector.GetStatus()[1].failures, 2);
+  CHECK_EQ(selector.GetStatus()[1].consecutive_failures, 0);
+  CHECK_EQ(selector.Select(), 1);
+}
+
+/******************************************************************************/
+static void TestUnprovenEndpoints(void) {
+  // An endpoint with an unknown connection time is scored as slower than the
+  // slowest measured endpoint.
+  EndpointSelector selector = MakeSelector(2);
+  selector.RecordConnectTime(1, 5000);
+  selector.RecordSuccess(1);
+  CHECK_EQ(selector.Select(), 1);
+
+  // An endpoint that connects but has never received data is scored the same
+  // way once it fails, even though its connection time is short.
+  selector = MakeSelector(2);
+  selector.RecordConnectTime(0, 10);
+  selector.RecordFailure(0);
+  selector.RecordConnectTime(1, 400);
+  selector.RecordSuccess(1);
+  selector.RecordFailure(1);
+  CHECK_EQ(selector.Select(), 1);
+}
+
+/******************************************************************************/
+int main(void) {
+  RUN_TEST(TestPreferenceOrder);
+  RUN_TEST(TestConnectTime);
+  RUN_TEST(TestFailures);
+  RUN_TEST(TestUnprovenEndpoints);
+  return UnitTestResult();
+}